@@ -0,0 +1,170 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2026 KWin contributors
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+#include "mock_hwcomposer_window.h"
+#include "utils/common.h"
+
+#include <QRandomGenerator>
+#include <QTest>
+
+using namespace KWin;
+
+class BufferAgeTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testInitialAge();
+    void testAgeMatchesContents_data();
+    void testAgeMatchesContents();
+    void testOutOfOrder();
+    void testNotDequeued();
+    void testUnknownBuffer();
+    void testReset();
+    void testPartialRepaint();
+};
+
+void BufferAgeTest::testInitialAge()
+{
+    MockHwcomposerWindow window(3);
+    // the contents of buffers that have never been presented are undefined
+    for (int i = 0; i < 3; ++i) {
+        MockHwcomposerBuffer *buffer = window.dequeueBuffer();
+        QCOMPARE(window.bufferAge(), 0);
+        window.queueBuffer(buffer);
+    }
+    MockHwcomposerBuffer *buffer = window.dequeueBuffer();
+    QCOMPARE(window.bufferAge(), 3);
+    window.queueBuffer(buffer);
+    window.dequeueBuffer();
+    QCOMPARE(window.bufferAge(), 3);
+}
+
+void BufferAgeTest::testAgeMatchesContents_data()
+{
+    QTest::addColumn<int>("bufferCount");
+
+    QTest::addRow("double buffering") << 2;
+    QTest::addRow("triple buffering") << 3;
+    QTest::addRow("quadruple buffering") << 4;
+}
+
+void BufferAgeTest::testAgeMatchesContents()
+{
+    QFETCH(int, bufferCount);
+
+    MockHwcomposerWindow window(bufferCount);
+    for (int frame = 0; frame < 20; ++frame) {
+        MockHwcomposerBuffer *buffer = window.dequeueBuffer();
+        const int age = window.bufferAge();
+        if (buffer->frame == -1) {
+            QCOMPARE(age, 0);
+        } else {
+            QCOMPARE(age, frame - buffer->frame);
+        }
+        buffer->frame = frame;
+        window.queueBuffer(buffer);
+    }
+}
+
+void BufferAgeTest::testOutOfOrder()
+{
+    // The age is that of the buffer that is actually dequeued, whatever the queue order.
+    MockHwcomposerWindow window(3);
+    for (int frame = 0; frame < 30; ++frame) {
+        MockHwcomposerBuffer *buffer = window.dequeueBuffer(frame % 3 == 0 ? 1 : 0);
+        const int age = window.bufferAge();
+        if (buffer->frame == -1) {
+            QCOMPARE(age, 0);
+        } else {
+            QCOMPARE(age, frame - buffer->frame);
+        }
+        buffer->frame = frame;
+        window.queueBuffer(buffer);
+    }
+}
+
+void BufferAgeTest::testNotDequeued()
+{
+    // If EGL hasn't dequeued a buffer yet, it's unknown which one it will render into.
+    MockHwcomposerWindow window(2);
+    window.queueBuffer(window.dequeueBuffer());
+    window.queueBuffer(window.dequeueBuffer());
+    QCOMPARE(window.bufferAge(), 0);
+    window.dequeueBuffer();
+    QCOMPARE(window.bufferAge(), 2);
+}
+
+void BufferAgeTest::testUnknownBuffer()
+{
+    HwcomposerBufferTracker tracker(2);
+    int buffers[3];
+    tracker.bufferPresented(&buffers[0]);
+    tracker.bufferPresented(&buffers[1]);
+    tracker.bufferDequeued(&buffers[0]);
+    QCOMPARE(tracker.bufferAge(), 2);
+
+    // more buffers than announced, the least recently presented one is forgotten
+    tracker.bufferPresented(&buffers[2]);
+    tracker.bufferDequeued(&buffers[0]);
+    QCOMPARE(tracker.bufferAge(), 0);
+    tracker.bufferDequeued(&buffers[1]);
+    QCOMPARE(tracker.bufferAge(), 2);
+}
+
+void BufferAgeTest::testReset()
+{
+    MockHwcomposerWindow window(3);
+    for (int i = 0; i < 5; ++i) {
+        window.queueBuffer(window.dequeueBuffer());
+    }
+    window.dequeueBuffer();
+    QCOMPARE(window.bufferAge(), 3);
+
+    window.tracker()->reset();
+    QCOMPARE(window.bufferAge(), 0);
+}
+
+void BufferAgeTest::testPartialRepaint()
+{
+    // Renders frames with random damage the way EglHwcomposerBackend does and checks that
+    // every presented buffer is up to date.
+    const int cellCount = 64;
+    const QRect screen(0, 0, cellCount, 1);
+    MockHwcomposerWindow window(3, cellCount);
+    DamageJournal journal;
+    QVector<int> scene(cellCount, 0);
+    QRandomGenerator generator(42);
+
+    int repaintedCells = 0;
+    for (int frame = 1; frame <= 100; ++frame) {
+        const int start = generator.bounded(cellCount);
+        const QRect damage(start, 0, 1 + generator.bounded(cellCount - start), 1);
+        for (int x = damage.left(); x <= damage.right(); ++x) {
+            scene[x] = frame;
+        }
+
+        MockHwcomposerBuffer *buffer = window.dequeueBuffer(generator.bounded(2));
+        const QRegion repaint = journal.accumulate(window.bufferAge(), screen) | damage;
+        for (const QRect &rect : repaint) {
+            for (int x = rect.left(); x <= rect.right(); ++x) {
+                buffer->cells[x] = scene[x];
+                repaintedCells++;
+            }
+        }
+        QCOMPARE(buffer->cells, scene);
+
+        window.queueBuffer(buffer);
+        journal.add(damage);
+    }
+
+    // only the first frames are repainted fully
+    QVERIFY(repaintedCells < 100 * cellCount);
+}
+
+QTEST_GUILESS_MAIN(BufferAgeTest)
+#include "buffer_age_test.moc"
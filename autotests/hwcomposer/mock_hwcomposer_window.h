@@ -0,0 +1,83 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2026 KWin contributors
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+#ifndef MOCK_HWCOMPOSER_WINDOW_H
+#define MOCK_HWCOMPOSER_WINDOW_H
+
+#include "backends/hwcomposer/hwcomposer_buffer_tracker.h"
+
+#include <QList>
+#include <QVector>
+
+#include <memory>
+#include <vector>
+
+/**
+ * A buffer of the mock window. The screen is modelled as a row of cells, each cell holds
+ * the number of the frame it has been painted in last.
+ */
+struct MockHwcomposerBuffer
+{
+    int frame = -1;
+    QVector<int> cells;
+};
+
+/**
+ * Mimics the buffer queue of the libhybris HWComposerNativeWindow: queueing a buffer
+ * presents it right away. Buffers are dequeued in the order they have been queued, unless
+ * the test picks another free buffer.
+ */
+class MockHwcomposerWindow
+{
+public:
+    explicit MockHwcomposerWindow(int bufferCount, int cellCount = 0)
+        : m_tracker(bufferCount)
+    {
+        for (int i = 0; i < bufferCount; ++i) {
+            auto buffer = std::make_unique<MockHwcomposerBuffer>();
+            buffer->cells.fill(-1, cellCount);
+            m_freeBuffers.append(buffer.get());
+            m_buffers.push_back(std::move(buffer));
+        }
+    }
+
+    MockHwcomposerBuffer *dequeueBuffer(int index = 0)
+    {
+        MockHwcomposerBuffer *buffer = m_freeBuffers.takeAt(index);
+        m_tracker.bufferDequeued(buffer);
+        return buffer;
+    }
+
+    void queueBuffer(MockHwcomposerBuffer *buffer)
+    {
+        present(buffer);
+        m_freeBuffers.append(buffer);
+    }
+
+    int bufferAge() const
+    {
+        return m_tracker.bufferAge();
+    }
+
+    KWin::HwcomposerBufferTracker *tracker()
+    {
+        return &m_tracker;
+    }
+
+private:
+    void present(MockHwcomposerBuffer *buffer)
+    {
+        m_tracker.bufferPresented(buffer);
+    }
+
+    KWin::HwcomposerBufferTracker m_tracker;
+    std::vector<std::unique_ptr<MockHwcomposerBuffer>> m_buffers;
+    QList<MockHwcomposerBuffer *> m_freeBuffers;
+};
+
+#endif
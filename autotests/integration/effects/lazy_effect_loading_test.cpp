@@ -0,0 +1,126 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2026 KWin contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "kwin_wayland_test.h"
+
+#include "composite.h"
+#include "effectloader.h"
+#include "effects.h"
+#include "platform.h"
+#include "renderbackend.h"
+#include "wayland_server.h"
+#include "workspace.h"
+
+#include <linux/input.h>
+
+using namespace KWin;
+
+static const QString s_socketName = QStringLiteral("wayland_test_effects_lazy_effect_loading-0");
+static const QString s_effectName = QStringLiteral("thumbnailaside");
+
+class LazyEffectLoadingTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+    void cleanup();
+
+    void testShortcutActivation();
+    void testExplicitLoad();
+    void testUnloadDormant();
+};
+
+void LazyEffectLoadingTest::initTestCase()
+{
+    qputenv("XDG_DATA_DIRS", QCoreApplication::applicationDirPath().toUtf8());
+
+    QSignalSpy applicationStartedSpy(kwinApp(), &Application::started);
+    QVERIFY(applicationStartedSpy.isValid());
+    kwinApp()->platform()->setInitialWindowSize(QSize(1280, 1024));
+    QVERIFY(waylandServer()->init(s_socketName));
+
+    auto config = KSharedConfig::openConfig(QString(), KConfig::SimpleConfig);
+    KConfigGroup plugins(config, QStringLiteral("Plugins"));
+    const auto builtinNames = EffectLoader().listOfKnownEffects();
+    for (const QString &name : builtinNames) {
+        plugins.writeEntry(name + QStringLiteral("Enabled"), name == s_effectName);
+    }
+    config->sync();
+    kwinApp()->setConfig(config);
+
+    qputenv("KWIN_COMPOSE", QByteArrayLiteral("O2"));
+
+    kwinApp()->start();
+    QVERIFY(applicationStartedSpy.wait());
+    Test::initWaylandWorkspace();
+
+    QCOMPARE(Compositor::self()->backend()->compositingType(), KWin::OpenGLCompositing);
+}
+
+void LazyEffectLoadingTest::init()
+{
+    auto effectsImpl = qobject_cast<EffectsHandlerImpl *>(effects);
+    QVERIFY(effectsImpl);
+    effectsImpl->reconfigure();
+
+    // The enabled effect is known, but not created until it's needed.
+    QTRY_VERIFY(effectsImpl->isEffectLoaded(s_effectName));
+    QCOMPARE(effectsImpl->loadedEffects(), QStringList{s_effectName});
+    QVERIFY(!effectsImpl->findEffect(s_effectName));
+}
+
+void LazyEffectLoadingTest::cleanup()
+{
+    auto effectsImpl = qobject_cast<EffectsHandlerImpl *>(effects);
+    QVERIFY(effectsImpl);
+    effectsImpl->unloadAllEffects();
+    QVERIFY(effectsImpl->loadedEffects().isEmpty());
+}
+
+void LazyEffectLoadingTest::testShortcutActivation()
+{
+    // This test verifies that the shortcut of a dormant effect creates the effect.
+    auto effectsImpl = qobject_cast<EffectsHandlerImpl *>(effects);
+
+    quint32 timestamp = 0;
+    kwinApp()->platform()->keyboardKeyPressed(KEY_LEFTMETA, timestamp++);
+    kwinApp()->platform()->keyboardKeyPressed(KEY_LEFTCTRL, timestamp++);
+    kwinApp()->platform()->keyboardKeyPressed(KEY_T, timestamp++);
+    kwinApp()->platform()->keyboardKeyReleased(KEY_T, timestamp++);
+    kwinApp()->platform()->keyboardKeyReleased(KEY_LEFTCTRL, timestamp++);
+    kwinApp()->platform()->keyboardKeyReleased(KEY_LEFTMETA, timestamp++);
+
+    QTRY_VERIFY(effectsImpl->findEffect(s_effectName));
+    QCOMPARE(effectsImpl->loadedEffects(), QStringList{s_effectName});
+}
+
+void LazyEffectLoadingTest::testExplicitLoad()
+{
+    // This test verifies that loading a dormant effect by name creates it right away.
+    auto effectsImpl = qobject_cast<EffectsHandlerImpl *>(effects);
+
+    QVERIFY(effectsImpl->loadEffect(s_effectName));
+    QVERIFY(effectsImpl->findEffect(s_effectName));
+    QCOMPARE(effectsImpl->loadedEffects(), QStringList{s_effectName});
+}
+
+void LazyEffectLoadingTest::testUnloadDormant()
+{
+    // This test verifies that a dormant effect can be unloaded without ever being created.
+    auto effectsImpl = qobject_cast<EffectsHandlerImpl *>(effects);
+
+    effectsImpl->unloadEffect(s_effectName);
+    QVERIFY(!effectsImpl->isEffectLoaded(s_effectName));
+    QVERIFY(effectsImpl->loadedEffects().isEmpty());
+}
+
+WAYLANDTEST_MAIN(LazyEffectLoadingTest)
+#include "lazy_effect_loading_test.moc"
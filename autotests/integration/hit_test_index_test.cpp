@@ -0,0 +1,189 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2026 KWin contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "kwin_wayland_test.h"
+#include "abstract_client.h"
+#include "cursor.h"
+#include "input.h"
+#include "platform.h"
+#include "virtualdesktops.h"
+#include "wayland_server.h"
+#include "workspace.h"
+
+#include <KWayland/Client/surface.h>
+
+#include <QRandomGenerator>
+
+#include <cmath>
+
+using namespace KWin;
+
+static const QString s_socketName = QStringLiteral("wayland_test_kwin_hit_test_index-0");
+
+class HitTestIndexTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+    void cleanup();
+
+    void testStackingOrder();
+    void testMove();
+    void testMinimize();
+    void testVirtualDesktop();
+    void benchmarkPointerMotion_data();
+    void benchmarkPointerMotion();
+
+private:
+    AbstractClient *createWindow(const QSize &size);
+
+    QVector<KWayland::Client::Surface *> m_surfaces;
+};
+
+void HitTestIndexTest::initTestCase()
+{
+    qRegisterMetaType<KWin::AbstractClient *>();
+    QSignalSpy applicationStartedSpy(kwinApp(), &Application::started);
+    QVERIFY(applicationStartedSpy.isValid());
+    kwinApp()->platform()->setInitialWindowSize(QSize(1280, 1024));
+    QVERIFY(waylandServer()->init(s_socketName));
+
+    kwinApp()->start();
+    QVERIFY(applicationStartedSpy.wait());
+    Test::initWaylandWorkspace();
+}
+
+void HitTestIndexTest::init()
+{
+    QVERIFY(Test::setupWaylandConnection());
+    workspace()->setActiveOutput(QPoint(640, 512));
+    Cursors::self()->mouse()->setPos(QPoint(640, 512));
+    VirtualDesktopManager::self()->setCount(1);
+}
+
+void HitTestIndexTest::cleanup()
+{
+    qDeleteAll(m_surfaces);
+    m_surfaces.clear();
+    Test::destroyWaylandConnection();
+}
+
+AbstractClient *HitTestIndexTest::createWindow(const QSize &size)
+{
+    KWayland::Client::Surface *surface = Test::createSurface();
+    Test::createXdgToplevelSurface(surface, surface);
+    m_surfaces.append(surface);
+    return Test::renderAndWaitForShown(surface, size, Qt::blue);
+}
+
+void HitTestIndexTest::testStackingOrder()
+{
+    AbstractClient *window1 = createWindow(QSize(100, 50));
+    QVERIFY(window1);
+    AbstractClient *window2 = createWindow(QSize(100, 50));
+    QVERIFY(window2);
+
+    window1->move(QPoint(0, 0));
+    window2->move(QPoint(50, 0));
+
+    QCOMPARE(input()->findManagedToplevel(QPoint(25, 25)), window1);
+    QCOMPARE(input()->findManagedToplevel(QPoint(75, 25)), window2);
+    QCOMPARE(input()->findManagedToplevel(QPoint(125, 25)), window2);
+
+    workspace()->raiseClient(window1);
+    QCOMPARE(input()->findManagedToplevel(QPoint(75, 25)), window1);
+    QCOMPARE(input()->findManagedToplevel(QPoint(125, 25)), window2);
+}
+
+void HitTestIndexTest::testMove()
+{
+    AbstractClient *window = createWindow(QSize(100, 50));
+    QVERIFY(window);
+    window->move(QPoint(0, 0));
+    QCOMPARE(input()->findManagedToplevel(QPoint(25, 25)), window);
+
+    // move the window across a couple of tiles
+    window->move(QPoint(700, 600));
+    QVERIFY(!input()->findManagedToplevel(QPoint(25, 25)));
+    QCOMPARE(input()->findManagedToplevel(QPoint(725, 625)), window);
+    QVERIFY(!input()->findManagedToplevel(QPoint(825, 625)));
+
+    // partially off screen
+    window->move(QPoint(-50, -25));
+    QCOMPARE(input()->findManagedToplevel(QPoint(10, 10)), window);
+    QVERIFY(!input()->findManagedToplevel(QPoint(60, 10)));
+}
+
+void HitTestIndexTest::testMinimize()
+{
+    AbstractClient *window = createWindow(QSize(100, 50));
+    QVERIFY(window);
+    window->move(QPoint(0, 0));
+    QCOMPARE(input()->findManagedToplevel(QPoint(25, 25)), window);
+
+    window->minimize();
+    QVERIFY(!input()->findManagedToplevel(QPoint(25, 25)));
+
+    window->unminimize();
+    QCOMPARE(input()->findManagedToplevel(QPoint(25, 25)), window);
+}
+
+void HitTestIndexTest::testVirtualDesktop()
+{
+    VirtualDesktopManager::self()->setCount(2);
+    VirtualDesktopManager::self()->setCurrent(1u);
+
+    AbstractClient *window = createWindow(QSize(100, 50));
+    QVERIFY(window);
+    window->move(QPoint(0, 0));
+    QCOMPARE(input()->findManagedToplevel(QPoint(25, 25)), window);
+
+    workspace()->sendClientToDesktop(window, 2, false);
+    QVERIFY(!input()->findManagedToplevel(QPoint(25, 25)));
+
+    VirtualDesktopManager::self()->setCurrent(2u);
+    QCOMPARE(input()->findManagedToplevel(QPoint(25, 25)), window);
+}
+
+void HitTestIndexTest::benchmarkPointerMotion_data()
+{
+    QTest::addColumn<int>("windowCount");
+
+    QTest::addRow("10 windows") << 10;
+    QTest::addRow("50 windows") << 50;
+    QTest::addRow("200 windows") << 200;
+}
+
+void HitTestIndexTest::benchmarkPointerMotion()
+{
+    QFETCH(int, windowCount);
+
+    QRandomGenerator generator(windowCount);
+    for (int i = 0; i < windowCount; ++i) {
+        AbstractClient *window = createWindow(QSize(100 + generator.bounded(400), 100 + generator.bounded(300)));
+        QVERIFY(window);
+        window->move(QPoint(generator.bounded(1000), generator.bounded(800)));
+    }
+
+    // a synthetic stream of motion events as sent by a 1000Hz mouse sweeping across the screen
+    QVector<QPointF> motion;
+    for (int i = 0; i < 1000; ++i) {
+        motion.append(QPointF(i * 1.28, 512 + 400 * std::sin(i / 50.0)));
+    }
+
+    quint32 timestamp = 1;
+    QBENCHMARK {
+        for (const QPointF &position : qAsConst(motion)) {
+            kwinApp()->platform()->pointerMotion(position, timestamp++);
+        }
+    }
+}
+
+WAYLANDTEST_MAIN(HitTestIndexTest)
+#include "hit_test_index_test.moc"
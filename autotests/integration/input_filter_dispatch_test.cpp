@@ -0,0 +1,201 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2026 KWin contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "kwin_wayland_test.h"
+#include "cursor.h"
+#include "input.h"
+#include "platform.h"
+#include "wayland_server.h"
+
+#include <QMouseEvent>
+
+#include <linux/input.h>
+
+using namespace KWin;
+
+static const QString s_socketName = QStringLiteral("wayland_test_kwin_input_filter_dispatch-0");
+
+class RecordingFilter : public InputEventFilter
+{
+public:
+    explicit RecordingFilter(EventTypes eventTypes)
+        : InputEventFilter(eventTypes)
+    {
+    }
+
+    bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override
+    {
+        Q_UNUSED(event)
+        Q_UNUSED(nativeButton)
+        pointerEvents++;
+        return false;
+    }
+
+    bool keyEvent(QKeyEvent *event) override
+    {
+        Q_UNUSED(event)
+        keyEvents++;
+        return false;
+    }
+
+    int pointerEvents = 0;
+    int keyEvents = 0;
+};
+
+/**
+ * Stands for the typical filter that bails out early, but only after looking up some state.
+ */
+class IdleFilter : public InputEventFilter
+{
+public:
+    explicit IdleFilter(EventTypes eventTypes)
+        : InputEventFilter(eventTypes)
+    {
+    }
+
+    bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override
+    {
+        Q_UNUSED(nativeButton)
+        return waylandServer()->isScreenLocked() && event->type() == QEvent::None;
+    }
+};
+
+class SinkFilter : public InputEventFilter
+{
+public:
+    SinkFilter()
+        : InputEventFilter(PointerEvents)
+    {
+    }
+
+    bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override
+    {
+        Q_UNUSED(event)
+        Q_UNUSED(nativeButton)
+        return true;
+    }
+};
+
+class InputFilterDispatchTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+
+    void testDispatch();
+    void testUninstall();
+    void benchmarkDispatch_data();
+    void benchmarkDispatch();
+};
+
+void InputFilterDispatchTest::initTestCase()
+{
+    QSignalSpy applicationStartedSpy(kwinApp(), &Application::started);
+    QVERIFY(applicationStartedSpy.isValid());
+    kwinApp()->platform()->setInitialWindowSize(QSize(1280, 1024));
+    QVERIFY(waylandServer()->init(s_socketName));
+
+    kwinApp()->start();
+    QVERIFY(applicationStartedSpy.wait());
+    Test::initWaylandWorkspace();
+}
+
+void InputFilterDispatchTest::init()
+{
+    Cursors::self()->mouse()->setPos(QPoint(640, 512));
+}
+
+void InputFilterDispatchTest::testDispatch()
+{
+    // filters only see the classes of events they are interested in
+    QScopedPointer<RecordingFilter> keyFilter(new RecordingFilter(InputEventFilter::KeyEvents));
+    QScopedPointer<RecordingFilter> pointerFilter(new RecordingFilter(InputEventFilter::PointerEvents));
+    QScopedPointer<RecordingFilter> allFilter(new RecordingFilter(InputEventFilter::AllEvents));
+    input()->prependInputEventFilter(keyFilter.data());
+    input()->prependInputEventFilter(pointerFilter.data());
+    input()->prependInputEventFilter(allFilter.data());
+
+    quint32 timestamp = 1;
+    kwinApp()->platform()->pointerMotion(QPointF(100, 100), timestamp++);
+    QCOMPARE(keyFilter->pointerEvents, 0);
+    QCOMPARE(pointerFilter->pointerEvents, 1);
+    QCOMPARE(allFilter->pointerEvents, 1);
+
+    kwinApp()->platform()->keyboardKeyPressed(KEY_A, timestamp++);
+    kwinApp()->platform()->keyboardKeyReleased(KEY_A, timestamp++);
+    QCOMPARE(keyFilter->keyEvents, 2);
+    QCOMPARE(pointerFilter->keyEvents, 0);
+    QCOMPARE(allFilter->keyEvents, 2);
+
+    kwinApp()->platform()->pointerButtonPressed(BTN_LEFT, timestamp++);
+    kwinApp()->platform()->pointerButtonReleased(BTN_LEFT, timestamp++);
+    QCOMPARE(keyFilter->pointerEvents, 0);
+    QCOMPARE(pointerFilter->pointerEvents, 3);
+    QCOMPARE(allFilter->pointerEvents, 3);
+}
+
+void InputFilterDispatchTest::testUninstall()
+{
+    QScopedPointer<RecordingFilter> first(new RecordingFilter(InputEventFilter::PointerEvents));
+    QScopedPointer<RecordingFilter> second(new RecordingFilter(InputEventFilter::PointerEvents));
+    input()->prependInputEventFilter(second.data());
+    input()->prependInputEventFilter(first.data());
+
+    quint32 timestamp = 1;
+    kwinApp()->platform()->pointerMotion(QPointF(100, 100), timestamp++);
+    QCOMPARE(first->pointerEvents, 1);
+    QCOMPARE(second->pointerEvents, 1);
+
+    // deleting a filter uninstalls it from every event type
+    first.reset();
+    kwinApp()->platform()->pointerMotion(QPointF(110, 100), timestamp++);
+    QCOMPARE(second->pointerEvents, 2);
+
+    input()->uninstallInputEventFilter(second.data());
+    kwinApp()->platform()->pointerMotion(QPointF(120, 100), timestamp++);
+    QCOMPARE(second->pointerEvents, 2);
+}
+
+void InputFilterDispatchTest::benchmarkDispatch_data()
+{
+    QTest::addColumn<bool>("dispatchTable");
+
+    // without the dispatch table every filter was invoked for every event
+    QTest::addRow("every filter") << false;
+    QTest::addRow("dispatch table") << true;
+}
+
+void InputFilterDispatchTest::benchmarkDispatch()
+{
+    QFETCH(bool, dispatchTable);
+
+    // the sink ends the processing, so only the dispatch itself is measured
+    QScopedPointer<SinkFilter> sink(new SinkFilter);
+    input()->prependInputEventFilter(sink.data());
+
+    // about as many filters as setupInputFilters() installs, of which few care about motion
+    const InputEventFilter::EventTypes eventTypes = dispatchTable ? InputEventFilter::KeyEvents : InputEventFilter::AllEvents;
+    QVector<InputEventFilter *> filters;
+    for (int i = 0; i < 15; ++i) {
+        filters.append(new IdleFilter(eventTypes));
+        input()->prependInputEventFilter(filters.last());
+    }
+
+    QMouseEvent event(QEvent::MouseMove, QPointF(640, 512), QPointF(640, 512), Qt::NoButton, Qt::NoButton, Qt::NoModifier);
+    QBENCHMARK {
+        for (int i = 0; i < 1000; ++i) {
+            input()->processFilters(InputEventFilter::PointerEvents, std::bind(&InputEventFilter::pointerEvent, std::placeholders::_1, &event, 0));
+        }
+    }
+
+    qDeleteAll(filters);
+}
+
+WAYLANDTEST_MAIN(InputFilterDispatchTest)
+#include "input_filter_dispatch_test.moc"
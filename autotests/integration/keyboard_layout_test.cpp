@@ -25,6 +25,7 @@
 #include <QDBusConnectionInterface>
 #include <QDBusMessage>
 #include <QDBusPendingCall>
+#include <QDir>
 
 #include <linux/input.h>
 
@@ -58,6 +59,7 @@ private Q_SLOTS:
     void cleanup();
 
     void testReconfigure();
+    void testKeymapCache();
     void testChangeLayoutThroughDBus();
     void testPerLayoutShortcut();
     void testDBusServiceExport();
@@ -185,6 +187,40 @@ void KeyboardLayoutTest::testReconfigure()
     QCOMPARE(xkb->layoutName(1), QStringLiteral("English (US)"));
 }
 
+void KeyboardLayoutTest::testKeymapCache()
+{
+    // this test verifies that compiled keymaps are cached and that a broken cache is ignored
+    QDir cacheDirectory(Xkb::keymapCacheDirectory());
+    QVERIFY(cacheDirectory.removeRecursively());
+
+    layoutGroup.writeEntry("LayoutList", QStringLiteral("fr,us"));
+    layoutGroup.sync();
+    reconfigureLayouts();
+
+    auto xkb = input()->keyboard()->xkb();
+    QCOMPARE(xkb->layoutName(0), QStringLiteral("French"));
+    const QFileInfoList cachedKeymaps = cacheDirectory.entryInfoList(QDir::Files);
+    QCOMPARE(cachedKeymaps.count(), 1);
+    const QByteArray keymap = xkb->keymapContents();
+
+    // loading the same configuration again uses the cached keymap
+    reconfigureLayouts();
+    QCOMPARE(xkb->layoutName(0), QStringLiteral("French"));
+    QCOMPARE(xkb->keymapContents(), keymap);
+    QCOMPARE(cacheDirectory.entryInfoList(QDir::Files).count(), 1);
+
+    // a broken cached keymap is compiled again
+    QFile cacheFile(cachedKeymaps.first().absoluteFilePath());
+    QVERIFY(cacheFile.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    cacheFile.write("xkb_keymap {");
+    cacheFile.close();
+    reconfigureLayouts();
+    QCOMPARE(xkb->layoutName(0), QStringLiteral("French"));
+    QCOMPARE(xkb->numberOfLayouts(), 2u);
+    QVERIFY(cacheFile.open(QIODevice::ReadOnly));
+    QCOMPARE(cacheFile.readAll(), keymap);
+}
+
 void KeyboardLayoutTest::testChangeLayoutThroughDBus()
 {
     // this test verifies that the layout can be changed through DBus
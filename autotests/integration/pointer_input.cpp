@@ -13,6 +13,8 @@
 #include "cursor.h"
 #include "deleted.h"
 #include "effects.h"
+#include "input_event_spy.h"
+#include "inputdevice.h"
 #include "pointer_input.h"
 #include "options.h"
 #include "screenedge.h"
@@ -36,6 +38,8 @@
 #include <KWaylandServer/clientconnection.h>
 #include <KWaylandServer/seat_interface.h>
 
+#include <QScopeGuard>
+
 #include <linux/input.h>
 
 namespace KWin
@@ -86,6 +90,41 @@ static PlatformCursorImage loadReferenceThemeCursor(const CursorShape &shape)
 
 static const QString s_socketName = QStringLiteral("wayland_test_kwin_pointer_input-0");
 
+class MotionDevice : public InputDevice
+{
+    Q_OBJECT
+
+public:
+    QString sysName() const override { return QString(); }
+    QString name() const override { return QStringLiteral("motion device"); }
+    bool isEnabled() const override { return true; }
+    void setEnabled(bool enabled) override { Q_UNUSED(enabled) }
+    LEDs leds() const override { return LEDs(); }
+    void setLeds(LEDs leds) override { Q_UNUSED(leds) }
+    bool isKeyboard() const override { return false; }
+    bool isAlphaNumericKeyboard() const override { return false; }
+    bool isPointer() const override { return true; }
+    bool isTouchpad() const override { return false; }
+    bool isTouch() const override { return false; }
+    bool isTabletTool() const override { return false; }
+    bool isTabletPad() const override { return false; }
+    bool isTabletModeSwitch() const override { return false; }
+    bool isLidSwitch() const override { return false; }
+};
+
+class MotionSpy : public InputEventSpy
+{
+public:
+    void pointerEvent(MouseEvent *event) override
+    {
+        if (event->type() == QEvent::MouseMove) {
+            motions.append(event->coalescedMotions());
+        }
+    }
+
+    QVector<QVector<MouseEvent::RelativeMotion>> motions;
+};
+
 class PointerInputTest : public QObject
 {
     Q_OBJECT
@@ -123,6 +162,7 @@ private Q_SLOTS:
     void testHideShowCursor();
     void testDefaultInputRegion();
     void testEmptyInputRegion();
+    void testMotionBatching();
 
 private:
     void render(KWayland::Client::Surface *surface, const QSize &size = QSize(100, 50));
@@ -1805,6 +1845,89 @@ void PointerInputTest::testEmptyInputRegion()
     QVERIFY(Test::waitForWindowDestroyed(client));
 }
 
+void PointerInputTest::testMotionBatching()
+{
+    // This test verifies that batched pointer motion is delivered before buttons, touch events
+    // and the removal of its device, and that the individual relative motions are kept.
+    options->setPointerMotionBatching(true);
+    auto resetBatching = qScopeGuard([]() {
+        options->setPointerMotionBatching(false);
+    });
+
+    using namespace KWayland::Client;
+    QScopedPointer<Pointer> pointer(m_seat->createPointer());
+    QVERIFY(pointer);
+    QSignalSpy enteredSpy(pointer.data(), &Pointer::entered);
+    QVERIFY(enteredSpy.isValid());
+    QSignalSpy motionSpy(pointer.data(), &Pointer::motion);
+    QVERIFY(motionSpy.isValid());
+    QSignalSpy buttonSpy(pointer.data(), &Pointer::buttonStateChanged);
+    QVERIFY(buttonSpy.isValid());
+
+    QScopedPointer<KWayland::Client::Surface> surface(Test::createSurface());
+    QScopedPointer<Test::XdgToplevel> shellSurface(Test::createXdgToplevelSurface(surface.data()));
+    AbstractClient *client = Test::renderAndWaitForShown(surface.data(), QSize(100, 100), Qt::blue);
+    QVERIFY(client);
+    client->move(QPoint(0, 0));
+    Cursors::self()->mouse()->setPos(QPoint(25, 25));
+    QVERIFY(enteredSpy.wait());
+
+    MotionSpy spy;
+    input()->installInputEventSpy(&spy);
+
+    // the motion is held back until something else happens
+    MotionDevice device;
+    quint32 timestamp = 1;
+    for (int i = 0; i < 10; ++i) {
+        input()->pointer()->processMotion(QSizeF(1, 1), QSizeF(1, 1), timestamp, timestamp * 1000, &device);
+        timestamp++;
+    }
+    QCOMPARE(input()->pointer()->pos(), QPointF(25, 25));
+    QVERIFY(spy.motions.isEmpty());
+
+    // a button press flushes the motion first
+    kwinApp()->platform()->pointerButtonPressed(BTN_LEFT, timestamp++);
+    QCOMPARE(input()->pointer()->pos(), QPointF(35, 35));
+    QCOMPARE(spy.motions.count(), 1);
+    QCOMPARE(spy.motions.first().count(), 10);
+    QCOMPARE(spy.motions.first().last().delta, QSizeF(1, 1));
+    QVERIFY(buttonSpy.wait());
+    QCOMPARE(motionSpy.count(), 1);
+    QCOMPARE(motionSpy.first().first().toPointF(), QPointF(35, 35));
+    kwinApp()->platform()->pointerButtonReleased(BTN_LEFT, timestamp++);
+
+    // without other events the motion is delivered with the next frame at the latest
+    for (int i = 0; i < 5; ++i) {
+        input()->pointer()->processMotion(QSizeF(2, 0), QSizeF(2, 0), timestamp, timestamp * 1000, &device);
+        timestamp++;
+    }
+    QTRY_COMPARE(input()->pointer()->pos(), QPointF(45, 35));
+    QCOMPARE(spy.motions.count(), 2);
+    QCOMPARE(spy.motions.last().count(), 5);
+    QVERIFY(motionSpy.wait());
+    QCOMPARE(motionSpy.last().first().toPointF(), QPointF(45, 35));
+
+    // touch events don't overtake the held back motion either
+    input()->pointer()->processMotion(QSizeF(0, 5), QSizeF(0, 5), timestamp, timestamp * 1000, &device);
+    timestamp++;
+    kwinApp()->platform()->touchDown(0, QPointF(50, 50), timestamp++);
+    QCOMPARE(input()->pointer()->pos(), QPointF(45, 40));
+    QCOMPARE(spy.motions.count(), 3);
+    kwinApp()->platform()->touchUp(0, timestamp++);
+
+    // the motion of a device is delivered before the device goes away
+    input()->pointer()->processMotion(QSizeF(0, 5), QSizeF(0, 5), timestamp, timestamp * 1000, &device);
+    timestamp++;
+    Q_EMIT input()->deviceRemoved(&device);
+    QCOMPARE(input()->pointer()->pos(), QPointF(45, 45));
+    QCOMPARE(spy.motions.count(), 4);
+    QCOMPARE(spy.motions.last().count(), 1);
+
+    input()->uninstallInputEventSpy(&spy);
+    shellSurface.reset();
+    QVERIFY(Test::waitForWindowDestroyed(client));
+}
+
 }
 
 WAYLANDTEST_MAIN(KWin::PointerInputTest)
@@ -0,0 +1,194 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2026 KWin contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "kwin_wayland_test.h"
+#include "abstract_client.h"
+#include "composite.h"
+#include "kwinglplatform.h"
+#include "kwinglutils.h"
+#include "platform.h"
+#include "plugins/screencast/pipewirecore.h"
+#include "plugins/screencast/screencaststream.h"
+#include "plugins/screencast/windowscreencastsource.h"
+#include "renderbackend.h"
+#include "scene.h"
+#include "wayland_server.h"
+
+#include <KWayland/Client/surface.h>
+
+#include <spa/param/buffers.h>
+
+using namespace KWin;
+
+static const QString s_socketName = QStringLiteral("wayland_test_kwin_screencast_readback-0");
+
+/**
+ * A PipeWire consumer that accepts raw video frames in MemFd buffers.
+ */
+class MemFdConsumer
+{
+public:
+    explicit MemFdConsumer(pw_core *core)
+    {
+        m_events.version = PW_VERSION_STREAM_EVENTS;
+        m_events.param_changed = &MemFdConsumer::onParamChanged;
+        m_events.process = &MemFdConsumer::onProcess;
+        m_stream = pw_stream_new(core, "kwin-screencast-readback-test", nullptr);
+        pw_stream_add_listener(m_stream, &m_listener, &m_events, this);
+    }
+
+    ~MemFdConsumer()
+    {
+        pw_stream_destroy(m_stream);
+    }
+
+    bool connect(uint nodeId)
+    {
+        uint8_t buffer[1024];
+        spa_pod_builder builder = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+        spa_rectangle defaultSize = SPA_RECTANGLE(100, 50);
+        spa_rectangle minSize = SPA_RECTANGLE(1, 1);
+        spa_rectangle maxSize = SPA_RECTANGLE(8192, 8192);
+
+        // No modifiers are offered, so the frames are read back into MemFd buffers
+        const spa_pod *params[] = {
+            static_cast<spa_pod *>(spa_pod_builder_add_object(&builder,
+                                                              SPA_TYPE_OBJECT_Format, SPA_PARAM_EnumFormat,
+                                                              SPA_FORMAT_mediaType, SPA_POD_Id(SPA_MEDIA_TYPE_video),
+                                                              SPA_FORMAT_mediaSubtype, SPA_POD_Id(SPA_MEDIA_SUBTYPE_raw),
+                                                              SPA_FORMAT_VIDEO_format, SPA_POD_CHOICE_ENUM_Id(3, SPA_VIDEO_FORMAT_BGRA, SPA_VIDEO_FORMAT_BGRA, SPA_VIDEO_FORMAT_BGR),
+                                                              SPA_FORMAT_VIDEO_size, SPA_POD_CHOICE_RANGE_Rectangle(&defaultSize, &minSize, &maxSize))),
+        };
+        const auto flags = pw_stream_flags(PW_STREAM_FLAG_AUTOCONNECT | PW_STREAM_FLAG_MAP_BUFFERS);
+        return pw_stream_connect(m_stream, PW_DIRECTION_INPUT, nodeId, flags, params, 1) == 0;
+    }
+
+    int frameCount() const
+    {
+        return m_frameCount;
+    }
+
+private:
+    static void onParamChanged(void *data, uint32_t id, const spa_pod *format)
+    {
+        if (!format || id != SPA_PARAM_Format) {
+            return;
+        }
+        MemFdConsumer *consumer = static_cast<MemFdConsumer *>(data);
+
+        uint8_t buffer[1024];
+        spa_pod_builder builder = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+        const spa_pod *params[] = {
+            static_cast<spa_pod *>(spa_pod_builder_add_object(&builder,
+                                                              SPA_TYPE_OBJECT_ParamBuffers, SPA_PARAM_Buffers,
+                                                              SPA_PARAM_BUFFERS_dataType, SPA_POD_Int(1 << SPA_DATA_MemFd))),
+        };
+        pw_stream_update_params(consumer->m_stream, params, 1);
+    }
+
+    static void onProcess(void *data)
+    {
+        MemFdConsumer *consumer = static_cast<MemFdConsumer *>(data);
+        while (pw_buffer *buffer = pw_stream_dequeue_buffer(consumer->m_stream)) {
+            ++consumer->m_frameCount;
+            pw_stream_queue_buffer(consumer->m_stream, buffer);
+        }
+    }
+
+    pw_stream *m_stream = nullptr;
+    spa_hook m_listener;
+    pw_stream_events m_events = {};
+    int m_frameCount = 0;
+};
+
+class ScreencastReadbackTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+    void cleanup();
+
+    void testStatistics();
+};
+
+void ScreencastReadbackTest::initTestCase()
+{
+    qRegisterMetaType<KWin::AbstractClient *>();
+
+    QSignalSpy applicationStartedSpy(kwinApp(), &Application::started);
+    QVERIFY(applicationStartedSpy.isValid());
+    kwinApp()->platform()->setInitialWindowSize(QSize(1280, 1024));
+    QVERIFY(waylandServer()->init(s_socketName));
+
+    qputenv("KWIN_COMPOSE", QByteArrayLiteral("O2"));
+
+    kwinApp()->start();
+    QVERIFY(applicationStartedSpy.wait());
+    Test::initWaylandWorkspace();
+    QCOMPARE(Compositor::self()->backend()->compositingType(), KWin::OpenGLCompositing);
+}
+
+void ScreencastReadbackTest::init()
+{
+    QVERIFY(Test::setupWaylandConnection());
+}
+
+void ScreencastReadbackTest::cleanup()
+{
+    Test::destroyWaylandConnection();
+}
+
+void ScreencastReadbackTest::testStatistics()
+{
+    // This test verifies that the readback statistics of a stream account for the MemFd
+    // frames that have been read back and queued.
+
+    Compositor::self()->scene()->makeOpenGLContextCurrent();
+    if (GLPlatform::instance()->isGLES() ? !hasGLVersion(3, 0) : !hasGLVersion(3, 2) && !hasGLExtension(QByteArrayLiteral("GL_ARB_sync"))) {
+        QSKIP("Asynchronous readback is not supported");
+    }
+
+    QScopedPointer<KWayland::Client::Surface> surface(Test::createSurface());
+    QScopedPointer<Test::XdgToplevel> shellSurface(Test::createXdgToplevelSurface(surface.data()));
+    AbstractClient *client = Test::renderAndWaitForShown(surface.data(), QSize(100, 50), Qt::blue);
+    QVERIFY(client);
+
+    QScopedPointer<WindowScreenCastSource> source(new WindowScreenCastSource(client));
+    QScopedPointer<ScreenCastStream> stream(new ScreenCastStream(source.data(), nullptr));
+    QSignalSpy streamReadySpy(stream.data(), &ScreenCastStream::streamReady);
+    QSignalSpy startStreamingSpy(stream.data(), &ScreenCastStream::startStreaming);
+    if (!stream->init()) {
+        QSKIP("PipeWire is not available");
+    }
+    QCOMPARE(stream->readbackStatistics().frameCount, quint64(0));
+
+    QVERIFY(streamReadySpy.wait());
+    MemFdConsumer consumer(PipeWireCore::self()->pwCore);
+    QVERIFY(consumer.connect(streamReadySpy.last().at(0).toUInt()));
+    QVERIFY(startStreamingSpy.wait());
+
+    Compositor::self()->scene()->makeOpenGLContextCurrent();
+    stream->recordFrame(QRegion(0, 0, 100, 50));
+
+    // The frame is queued once the readback has completed
+    QTRY_COMPARE(stream->readbackStatistics().frameCount, quint64(1));
+    const ScreenCastStream::ReadbackStatistics statistics = stream->readbackStatistics();
+    QVERIFY(statistics.byteCount >= quint64(100 * 50 * 3));
+    QVERIFY(statistics.averageLatency() > std::chrono::nanoseconds::zero());
+    QCOMPARE(statistics.maximumLatency.count(), statistics.averageLatency().count());
+    QTRY_VERIFY(consumer.frameCount() > 0);
+
+    stream.reset();
+    source.reset();
+    shellSurface.reset();
+    QVERIFY(Test::waitForWindowDestroyed(client));
+}
+
+WAYLANDTEST_MAIN(ScreencastReadbackTest)
+#include "screencast_readback_test.moc"
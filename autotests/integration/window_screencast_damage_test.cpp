@@ -0,0 +1,125 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2026 KWin contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "kwin_wayland_test.h"
+#include "abstract_client.h"
+#include "platform.h"
+#include "plugins/screencast/windowscreencastsource.h"
+#include "wayland_server.h"
+#include "workspace.h"
+
+#include <KWayland/Client/shm_pool.h>
+#include <KWayland/Client/subsurface.h>
+#include <KWayland/Client/surface.h>
+
+using namespace KWin;
+
+static const QString s_socketName = QStringLiteral("wayland_test_kwin_window_screencast_damage-0");
+
+class WindowScreencastDamageTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+    void cleanup();
+
+    void testMovedWindow();
+    void testSubSurface();
+};
+
+void WindowScreencastDamageTest::initTestCase()
+{
+    qRegisterMetaType<KWin::AbstractClient *>();
+    qRegisterMetaType<KWin::Toplevel *>();
+
+    QSignalSpy applicationStartedSpy(kwinApp(), &Application::started);
+    QVERIFY(applicationStartedSpy.isValid());
+    kwinApp()->platform()->setInitialWindowSize(QSize(1280, 1024));
+    QVERIFY(waylandServer()->init(s_socketName));
+
+    kwinApp()->start();
+    QVERIFY(applicationStartedSpy.wait());
+    Test::initWaylandWorkspace();
+}
+
+void WindowScreencastDamageTest::init()
+{
+    QVERIFY(Test::setupWaylandConnection());
+}
+
+void WindowScreencastDamageTest::cleanup()
+{
+    Test::destroyWaylandConnection();
+}
+
+static void renderPartially(KWayland::Client::Surface *surface, const QSize &size, const QRect &damage)
+{
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::red);
+    surface->attachBuffer(Test::waylandShmPool()->createBuffer(image));
+    surface->damage(damage);
+    surface->commit(KWayland::Client::Surface::CommitFlag::None);
+}
+
+void WindowScreencastDamageTest::testMovedWindow()
+{
+    // This test verifies that the damage of a window that is not at the origin of the
+    // screen is mapped to the frames of the window stream.
+
+    QScopedPointer<KWayland::Client::Surface> surface(Test::createSurface());
+    QScopedPointer<Test::XdgToplevel> shellSurface(Test::createXdgToplevelSurface(surface.data()));
+    AbstractClient *client = Test::renderAndWaitForShown(surface.data(), QSize(100, 50), Qt::blue);
+    QVERIFY(client);
+
+    client->move(QPoint(300, 200));
+    QCOMPARE(client->clientGeometry(), QRect(300, 200, 100, 50));
+
+    WindowScreenCastSource source(client);
+    QCOMPARE(source.textureSize(), QSize(100, 50));
+
+    QSignalSpy damagedSpy(client, &AbstractClient::damaged);
+    QVERIFY(damagedSpy.isValid());
+    renderPartially(surface.data(), QSize(100, 50), QRect(10, 20, 30, 10));
+    QVERIFY(damagedSpy.wait());
+
+    const QRegion damage = damagedSpy.last().at(1).value<QRegion>();
+    QCOMPARE(source.mapDamage(damage), QRegion(10, 20, 30, 10));
+
+    // Damage outside of the window is dropped.
+    QCOMPARE(source.mapDamage(QRegion(90, 40, 20, 20)), QRegion(90, 40, 10, 10));
+
+    shellSurface.reset();
+    QVERIFY(Test::waitForWindowDestroyed(client));
+}
+
+void WindowScreencastDamageTest::testSubSurface()
+{
+    // This test verifies that windows with subsurfaces are updated as a whole, as the
+    // damage of the subsurfaces is relative to the subsurfaces.
+
+    QScopedPointer<KWayland::Client::Surface> parentSurface(Test::createSurface());
+    QScopedPointer<Test::XdgToplevel> shellSurface(Test::createXdgToplevelSurface(parentSurface.data()));
+    QScopedPointer<KWayland::Client::Surface> childSurface(Test::createSurface());
+    QScopedPointer<KWayland::Client::SubSurface> subSurface(Test::createSubSurface(childSurface.data(), parentSurface.data()));
+    subSurface->setPosition(QPoint(20, 10));
+    Test::render(childSurface.data(), QSize(40, 20), Qt::green);
+
+    AbstractClient *client = Test::renderAndWaitForShown(parentSurface.data(), QSize(100, 50), Qt::blue);
+    QVERIFY(client);
+    client->move(QPoint(300, 200));
+
+    WindowScreenCastSource source(client);
+    QCOMPARE(source.mapDamage(QRegion(0, 0, 10, 10)), QRegion(0, 0, 100, 50));
+
+    shellSurface.reset();
+    QVERIFY(Test::waitForWindowDestroyed(client));
+}
+
+WAYLANDTEST_MAIN(WindowScreencastDamageTest)
+#include "window_screencast_damage_test.moc"
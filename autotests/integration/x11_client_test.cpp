@@ -16,6 +16,7 @@
 #include "deleted.h"
 #include "platform.h"
 #include "screens.h"
+#include "unmanaged.h"
 #include "wayland_server.h"
 #include "workspace.h"
 
@@ -45,6 +46,7 @@ private Q_SLOTS:
     void testFullscreenLayerWithActiveWaylandWindow();
     void testFocusInWithWaylandLastActiveWindow();
     void testX11WindowId();
+    void testFindByWindowId();
     void testCaptionChanges();
     void testCaptionWmName();
     void testCaptionMultipleWindows();
@@ -763,6 +765,82 @@ void X11ClientTest::testX11WindowId()
     QCOMPARE(deletedUuid, uuid);
 }
 
+void X11ClientTest::testFindByWindowId()
+{
+    // this test verifies that clients and unmanaged windows can be found by their window ids
+    QScopedPointer<xcb_connection_t, XcbConnectionDeleter> c(xcb_connect(nullptr, nullptr));
+    QVERIFY(!xcb_connection_has_error(c.data()));
+    const QRect windowGeometry(0, 0, 100, 200);
+    xcb_window_t w = xcb_generate_id(c.data());
+    xcb_create_window(c.data(), XCB_COPY_FROM_PARENT, w, rootWindow(),
+                      windowGeometry.x(),
+                      windowGeometry.y(),
+                      windowGeometry.width(),
+                      windowGeometry.height(),
+                      0, XCB_WINDOW_CLASS_INPUT_OUTPUT, XCB_COPY_FROM_PARENT, 0, nullptr);
+    xcb_size_hints_t hints;
+    memset(&hints, 0, sizeof(hints));
+    xcb_icccm_size_hints_set_position(&hints, 1, windowGeometry.x(), windowGeometry.y());
+    xcb_icccm_size_hints_set_size(&hints, 1, windowGeometry.width(), windowGeometry.height());
+    xcb_icccm_set_wm_normal_hints(c.data(), w, &hints);
+    xcb_map_window(c.data(), w);
+    xcb_flush(c.data());
+
+    QSignalSpy windowCreatedSpy(workspace(), &Workspace::clientAdded);
+    QVERIFY(windowCreatedSpy.isValid());
+    QVERIFY(windowCreatedSpy.wait());
+    X11Client *client = windowCreatedSpy.first().first().value<X11Client *>();
+    QVERIFY(client);
+    QCOMPARE(client->window(), w);
+
+    QCOMPARE(workspace()->findClient(Predicate::WindowMatch, w), client);
+    QCOMPARE(workspace()->findClient(Predicate::WrapperIdMatch, client->wrapperId()), client);
+    QCOMPARE(workspace()->findClient(Predicate::FrameIdMatch, client->frameId()), client);
+    QVERIFY(!workspace()->findClient(Predicate::WindowMatch, client->frameId()));
+    QVERIFY(!workspace()->findClient(Predicate::FrameIdMatch, w));
+    QVERIFY(!workspace()->findUnmanaged(w));
+    if (client->inputId() != XCB_WINDOW_NONE) {
+        QCOMPARE(workspace()->findClient(Predicate::InputIdMatch, client->inputId()), client);
+    }
+
+    // now an override-redirect window
+    xcb_window_t w2 = xcb_generate_id(c.data());
+    const uint32_t values[] = { true };
+    xcb_create_window(c.data(), XCB_COPY_FROM_PARENT, w2, rootWindow(),
+                      windowGeometry.x(), windowGeometry.y(),
+                      windowGeometry.width(), windowGeometry.height(), 0,
+                      XCB_WINDOW_CLASS_INPUT_OUTPUT, XCB_COPY_FROM_PARENT,
+                      XCB_CW_OVERRIDE_REDIRECT, values);
+    xcb_map_window(c.data(), w2);
+    xcb_flush(c.data());
+
+    QSignalSpy unmanagedAddedSpy(workspace(), &Workspace::unmanagedAdded);
+    QVERIFY(unmanagedAddedSpy.isValid());
+    QVERIFY(unmanagedAddedSpy.wait());
+    Unmanaged *unmanaged = unmanagedAddedSpy.first().first().value<Unmanaged *>();
+    QVERIFY(unmanaged);
+    QCOMPARE(workspace()->findUnmanaged(w2), unmanaged);
+    QVERIFY(!workspace()->findClient(Predicate::WindowMatch, w2));
+
+    // destroying the windows removes them from the lookup
+    QSignalSpy unmanagedRemovedSpy(workspace(), &Workspace::unmanagedRemoved);
+    QVERIFY(unmanagedRemovedSpy.isValid());
+    xcb_destroy_window(c.data(), w2);
+    xcb_flush(c.data());
+    QVERIFY(unmanagedRemovedSpy.wait());
+    QVERIFY(!workspace()->findUnmanaged(w2));
+
+    const xcb_window_t frameId = client->frameId();
+    QSignalSpy windowClosedSpy(client, &X11Client::windowClosed);
+    QVERIFY(windowClosedSpy.isValid());
+    xcb_unmap_window(c.data(), w);
+    xcb_destroy_window(c.data(), w);
+    xcb_flush(c.data());
+    QVERIFY(windowClosedSpy.wait());
+    QVERIFY(!workspace()->findClient(Predicate::WindowMatch, w));
+    QVERIFY(!workspace()->findClient(Predicate::FrameIdMatch, frameId));
+}
+
 void X11ClientTest::testCaptionChanges()
 {
     // verifies that caption is updated correctly when the X11 window updates it
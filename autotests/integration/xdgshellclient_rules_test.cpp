@@ -138,6 +138,7 @@ private Q_SLOTS:
     void testNoBorderForceTemporarily();
 
     void testMatchAfterNameChange();
+    void testMatchManyRules();
 
 private:
     template <typename T> void setWindowRule(const QString &property, const T &value, int policy);
@@ -3710,5 +3711,71 @@ void TestXdgShellClientRules::testMatchAfterNameChange()
     QCOMPARE(c->keepAbove(), true);
 }
 
+void TestXdgShellClientRules::testMatchManyRules()
+{
+    // Many rules for other applications, which are skipped through the window class index.
+    const int otherRuleCount = 200;
+    m_config->group("General").writeEntry("count", otherRuleCount + 3);
+    for (int i = 1; i <= otherRuleCount; ++i) {
+        KConfigGroup group = m_config->group(QString::number(i));
+        group.writeEntry("above", false);
+        group.writeEntry("aboverule", int(Rules::Force));
+        group.writeEntry("wmclass", QStringLiteral("org.kde.app%1").arg(i));
+        group.writeEntry("wmclasscomplete", false);
+        group.writeEntry("wmclassmatch", int(Rules::ExactMatch));
+    }
+
+    // An exact rule for our window class.
+    KConfigGroup exactGroup = m_config->group(QString::number(otherRuleCount + 1));
+    exactGroup.writeEntry("above", true);
+    exactGroup.writeEntry("aboverule", int(Rules::Force));
+    exactGroup.writeEntry("wmclass", "org.kde.foo");
+    exactGroup.writeEntry("wmclasscomplete", false);
+    exactGroup.writeEntry("wmclassmatch", int(Rules::ExactMatch));
+
+    // A substring rule with a lower priority, its "above" property must not override the exact rule.
+    KConfigGroup substringGroup = m_config->group(QString::number(otherRuleCount + 2));
+    substringGroup.writeEntry("above", false);
+    substringGroup.writeEntry("aboverule", int(Rules::Force));
+    substringGroup.writeEntry("skippager", true);
+    substringGroup.writeEntry("skippagerrule", int(Rules::Force));
+    substringGroup.writeEntry("wmclass", "kde.fo");
+    substringGroup.writeEntry("wmclasscomplete", false);
+    substringGroup.writeEntry("wmclassmatch", int(Rules::SubstringMatch));
+
+    // A rule matching the title by a regular expression.
+    KConfigGroup titleGroup = m_config->group(QString::number(otherRuleCount + 3));
+    titleGroup.writeEntry("skiptaskbar", true);
+    titleGroup.writeEntry("skiptaskbarrule", int(Rules::Force));
+    titleGroup.writeEntry("title", "^Build [0-9]+ finished$");
+    titleGroup.writeEntry("titlematch", int(Rules::RegExpMatch));
+    m_config->sync();
+
+    workspace()->slotReconfigure();
+
+    AbstractClient *client;
+    KWayland::Client::Surface *surface;
+    Test::XdgToplevel *shellSurface;
+    std::tie(client, surface, shellSurface) = createWindow(QStringLiteral("org.kde.foo"));
+    QVERIFY(client);
+    QCOMPARE(client->keepAbove(), true);
+    QCOMPARE(client->skipPager(), true);
+    QCOMPARE(client->skipTaskbar(), false);
+
+    // The title rule is re-evaluated when the caption changes.
+    QSignalSpy captionChangedSpy(client, &AbstractClient::captionChanged);
+    QVERIFY(captionChangedSpy.isValid());
+    shellSurface->set_title(QStringLiteral("Build 42 finished"));
+    surface->commit(KWayland::Client::Surface::CommitFlag::None);
+    QVERIFY(captionChangedSpy.wait());
+    QTRY_COMPARE(client->skipTaskbar(), true);
+    QCOMPARE(client->keepAbove(), true);
+
+    // Destroy the client.
+    delete shellSurface;
+    delete surface;
+    QVERIFY(Test::waitForWindowDestroyed(client));
+}
+
 WAYLANDTEST_MAIN(TestXdgShellClientRules)
 #include "xdgshellclient_rules_test.moc"
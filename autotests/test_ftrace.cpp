@@ -7,9 +7,14 @@
     SPDX-License-Identifier: LGPL-2.0-or-later
 */
 
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QObject>
+#include <QTemporaryDir>
 #include <QTemporaryFile>
 #include <QTest>
+#include <QThread>
 
 #include "ftrace.h"
 
@@ -22,6 +27,12 @@ private Q_SLOTS:
     void benchmarkTraceOff();
     void benchmarkTraceDurationOff();
     void enable();
+    void benchmarkScopeOff();
+    void benchmarkScopeOn();
+    void ringEvents();
+    void ringWrapAround();
+    void ringThreads();
+    void dumpTrace();
 
 private:
     QTemporaryFile m_tempFile;
@@ -67,6 +78,138 @@ void TestFTrace::enable()
     QCOMPARE(m_tempFile.readLine(), "TEST_DURATIONboo end_ctx=1\n");
 }
 
+void TestFTrace::benchmarkScopeOff()
+{
+    QBENCHMARK {
+        fTraceScope("BENCH", 123);
+    }
+}
+
+void TestFTrace::benchmarkScopeOn()
+{
+    KWin::FTraceLogger::self()->setRingEnabled(true);
+    QBENCHMARK {
+        fTraceScope("BENCH", 123);
+    }
+    KWin::FTraceLogger::self()->setRingEnabled(false);
+}
+
+static QVector<KWin::FTraceEvent> eventsNamed(const char *name)
+{
+    QVector<KWin::FTraceEvent> events;
+    const auto recorded = KWin::FTraceLogger::self()->recordedEvents();
+    for (const KWin::FTraceEvent &event : recorded) {
+        if (qstrcmp(event.name, name) == 0) {
+            events.append(event);
+        }
+    }
+    return events;
+}
+
+void TestFTrace::ringEvents()
+{
+    KWin::FTraceLogger::self()->setRingEnabled(true);
+    QVERIFY(KWin::FTraceLogger::self()->isRingEnabled());
+
+    {
+        fTraceScope("RING_SCOPE", 42);
+        fTraceEvent("RING_INSTANT");
+    }
+
+    KWin::FTraceLogger::self()->setRingEnabled(false);
+    fTraceEvent("RING_INSTANT");
+
+    const auto scope = eventsNamed("RING_SCOPE");
+    QCOMPARE(scope.count(), 2);
+    QCOMPARE(scope[0].phase, KWin::FTraceEvent::Begin);
+    QCOMPARE(scope[0].argument, quint64(42));
+    QCOMPARE(scope[1].phase, KWin::FTraceEvent::End);
+    QVERIFY(scope[1].timestamp >= scope[0].timestamp);
+
+    const auto instant = eventsNamed("RING_INSTANT");
+    QCOMPARE(instant.count(), 1);
+    QCOMPARE(instant[0].phase, KWin::FTraceEvent::Instant);
+    QVERIFY(instant[0].timestamp >= scope[0].timestamp);
+    QVERIFY(instant[0].timestamp <= scope[1].timestamp);
+}
+
+void TestFTrace::ringWrapAround()
+{
+    KWin::FTraceLogger::self()->setRingEnabled(true);
+    for (int i = 0; i < KWin::FTraceLogger::ringCapacity + 10; ++i) {
+        fTraceEvent("RING_WRAP", i);
+    }
+    KWin::FTraceLogger::self()->setRingEnabled(false);
+
+    // only the newest events of this thread are kept
+    const auto events = eventsNamed("RING_WRAP");
+    QVERIFY(events.count() <= KWin::FTraceLogger::ringCapacity);
+    QVERIFY(!events.isEmpty());
+    QCOMPARE(events.last().argument, quint64(KWin::FTraceLogger::ringCapacity + 9));
+    for (int i = 1; i < events.count(); ++i) {
+        QCOMPARE(events[i].argument, events[i - 1].argument + 1);
+    }
+}
+
+void TestFTrace::ringThreads()
+{
+    KWin::FTraceLogger::self()->setRingEnabled(true);
+
+    QScopedPointer<QThread> thread(QThread::create([]() {
+        for (int i = 0; i < 100; ++i) {
+            fTraceEvent("RING_THREAD", i);
+        }
+    }));
+    thread->start();
+    // read concurrently with the writer, this must not return torn events
+    while (!thread->isFinished()) {
+        for (const KWin::FTraceEvent &event : eventsNamed("RING_THREAD")) {
+            QVERIFY(event.argument < 100);
+        }
+    }
+    QVERIFY(thread->wait());
+    KWin::FTraceLogger::self()->setRingEnabled(false);
+
+    QCOMPARE(eventsNamed("RING_THREAD").count(), 100);
+}
+
+void TestFTrace::dumpTrace()
+{
+    KWin::FTraceLogger::self()->setRingEnabled(true);
+    {
+        fTraceScope("DUMP \"quoted\"", 7);
+    }
+    KWin::FTraceLogger::self()->setRingEnabled(false);
+
+    QTemporaryDir dir;
+    const QString fileName = dir.filePath(QStringLiteral("trace.json"));
+    QVERIFY(KWin::FTraceLogger::self()->dumpTrace(fileName));
+
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QJsonParseError error;
+    const QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &error);
+    QCOMPARE(error.error, QJsonParseError::NoError);
+
+    QJsonArray dumped;
+    const QJsonArray events = document.object().value(QStringLiteral("traceEvents")).toArray();
+    for (const QJsonValue &value : events) {
+        if (value.toObject().value(QStringLiteral("name")).toString() == QLatin1String("DUMP \"quoted\"")) {
+            dumped.append(value);
+        }
+    }
+    QCOMPARE(dumped.count(), 2);
+
+    const QJsonObject begin = dumped[0].toObject();
+    const QJsonObject end = dumped[1].toObject();
+    QCOMPARE(begin.value(QStringLiteral("ph")).toString(), QStringLiteral("B"));
+    QCOMPARE(end.value(QStringLiteral("ph")).toString(), QStringLiteral("E"));
+    QCOMPARE(begin.value(QStringLiteral("args")).toObject().value(QStringLiteral("value")).toInt(), 7);
+    QCOMPARE(begin.value(QStringLiteral("pid")).toInt(), int(QCoreApplication::applicationPid()));
+    QCOMPARE(begin.value(QStringLiteral("tid")), end.value(QStringLiteral("tid")));
+    QVERIFY(end.value(QStringLiteral("ts")).toDouble() >= begin.value(QStringLiteral("ts")).toDouble());
+}
+
 QTEST_MAIN(TestFTrace)
 
 #include "test_ftrace.moc"
@@ -0,0 +1,200 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2026 KWin contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "occlusionmap.h"
+
+#include <QRandomGenerator>
+#include <QTest>
+
+using namespace KWin;
+
+class OcclusionMapTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testEmpty();
+    void testFullyCovered();
+    void testPartialTilesNotOccluded();
+    void testEdgeTiles();
+    void testOutsideArea();
+    void testSubtracted();
+    void testConservative();
+    void testReset();
+    void benchmarkCulling_data();
+    void benchmarkCulling();
+};
+
+void OcclusionMapTest::testEmpty()
+{
+    OcclusionMap map(QRect(0, 0, 1920, 1080));
+    QVERIFY(!map.isOccluded(QRect(0, 0, 10, 10)));
+    QVERIFY(map.occludedRegion(QRect(0, 0, 1920, 1080)).isEmpty());
+    QCOMPARE(map.subtracted(QRegion(0, 0, 100, 100)), QRegion(0, 0, 100, 100));
+}
+
+void OcclusionMapTest::testFullyCovered()
+{
+    OcclusionMap map(QRect(0, 0, 1920, 1080));
+    map.add(QRect(0, 0, 1920, 1080));
+    QVERIFY(map.isOccluded(QRect(0, 0, 1920, 1080)));
+    QVERIFY(map.isOccluded(QRect(100, 100, 10, 10)));
+    QCOMPARE(map.occludedRegion(QRect(0, 0, 1920, 1080)), QRegion(0, 0, 1920, 1080));
+    QVERIFY(map.subtracted(QRegion(0, 0, 1920, 1080)).isEmpty());
+}
+
+void OcclusionMapTest::testPartialTilesNotOccluded()
+{
+    OcclusionMap map(QRect(0, 0, 640, 640), 64);
+    // covers tiles 1..2 completely, tiles 0 and 3 partially
+    map.add(QRect(32, 64, 200, 64));
+    QVERIFY(map.isOccluded(QRect(64, 64, 128, 64)));
+    QVERIFY(!map.isOccluded(QRect(32, 64, 200, 64)));
+    QVERIFY(!map.isOccluded(QRect(64, 64, 128, 65)));
+    QCOMPARE(map.occludedRegion(QRect(0, 0, 640, 640)), QRegion(64, 64, 128, 64));
+}
+
+void OcclusionMapTest::testEdgeTiles()
+{
+    // the last column and row are smaller than the tile size
+    OcclusionMap map(QRect(0, 0, 100, 100), 64);
+    map.add(QRect(64, 64, 36, 36));
+    QVERIFY(map.isOccluded(QRect(64, 64, 36, 36)));
+    QVERIFY(map.isOccluded(QRect(64, 64, 100, 100)));
+    QCOMPARE(map.occludedRegion(QRect(0, 0, 100, 100)), QRegion(64, 64, 36, 36));
+}
+
+void OcclusionMapTest::testOutsideArea()
+{
+    OcclusionMap map(QRect(1920, 0, 1920, 1080));
+    map.add(QRect(0, 0, 1920, 1080));
+    QVERIFY(!map.isOccluded(QRect(1920, 0, 64, 64)));
+    // nothing of the rect is inside the area
+    QVERIFY(map.isOccluded(QRect(0, 0, 64, 64)));
+
+    map.add(QRect(1920, 0, 128, 128));
+    QVERIFY(map.isOccluded(QRect(1920, 0, 128, 128)));
+    QCOMPARE(map.occludedRegion(QRect(1920, 0, 1920, 1080)), QRegion(1920, 0, 128, 128));
+}
+
+void OcclusionMapTest::testSubtracted()
+{
+    OcclusionMap map(QRect(0, 0, 512, 512), 64);
+    map.add(QRect(0, 0, 128, 128));
+    map.add(QRect(256, 0, 128, 256));
+
+    const QRegion region(0, 0, 512, 512);
+    const QRegion expected = region - QRegion(0, 0, 128, 128) - QRegion(256, 0, 128, 256);
+    QCOMPARE(map.subtracted(region), expected);
+}
+
+void OcclusionMapTest::testConservative()
+{
+    // whatever the map culls must be covered by the exact union of the opaque regions
+    QRandomGenerator generator(42);
+    const QRect area(0, 0, 1920, 1080);
+    OcclusionMap map(area);
+    QRegion exact;
+    for (int i = 0; i < 50; ++i) {
+        const QRect rect(generator.bounded(area.width()), generator.bounded(area.height()),
+                         generator.bounded(600), generator.bounded(600));
+        map.add(rect);
+        exact |= rect;
+
+        const QRegion occluded = map.occludedRegion(area);
+        QVERIFY((occluded - exact).isEmpty());
+    }
+}
+
+void OcclusionMapTest::testReset()
+{
+    OcclusionMap map(QRect(0, 0, 640, 480));
+    map.add(QRect(0, 0, 640, 480));
+    QVERIFY(map.isOccluded(QRect(0, 0, 640, 480)));
+
+    map.reset(QRect(0, 0, 640, 480));
+    QVERIFY(!map.isOccluded(QRect(0, 0, 640, 480)));
+
+    map.add(QRect(0, 0, 640, 480));
+    map.reset(QRect(0, 0, 1280, 720));
+    QCOMPARE(map.area(), QRect(0, 0, 1280, 720));
+    QVERIFY(!map.isOccluded(QRect(0, 0, 64, 64)));
+}
+
+struct SyntheticWindow
+{
+    QRegion region;
+    QRegion clip;
+};
+
+static QVector<SyntheticWindow> buildStack(const QRect &area, int count)
+{
+    // windows with rounded corners, which gives each opaque clip a handful of rects
+    QRandomGenerator generator(count);
+    QVector<SyntheticWindow> stack;
+    stack.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        const QRect geometry(generator.bounded(area.width() - 200), generator.bounded(area.height() - 200),
+                             200 + generator.bounded(800), 200 + generator.bounded(600));
+        QRegion clip(geometry.adjusted(0, 8, 0, -8));
+        for (int corner = 0; corner < 8; ++corner) {
+            clip |= QRect(geometry.x() + 8 - corner, geometry.y() + corner, geometry.width() - 2 * (8 - corner), 1);
+            clip |= QRect(geometry.x() + 8 - corner, geometry.bottom() - corner, geometry.width() - 2 * (8 - corner), 1);
+        }
+        stack.append({geometry, clip});
+    }
+    return stack;
+}
+
+void OcclusionMapTest::benchmarkCulling_data()
+{
+    QTest::addColumn<int>("windowCount");
+    QTest::addColumn<bool>("tiled");
+
+    for (int windowCount : {10, 50, 100, 250, 500}) {
+        QTest::addRow("QRegion, %d windows", windowCount) << windowCount << false;
+        QTest::addRow("OcclusionMap, %d windows", windowCount) << windowCount << true;
+    }
+}
+
+void OcclusionMapTest::benchmarkCulling()
+{
+    QFETCH(int, windowCount);
+    QFETCH(bool, tiled);
+
+    const QRect area(0, 0, 3840, 2160);
+    const QVector<SyntheticWindow> stack = buildStack(area, windowCount);
+
+    // mirrors the occlusion culling pass of Scene::paintSimpleScreen()
+    if (tiled) {
+        OcclusionMap map;
+        QBENCHMARK {
+            map.reset(area);
+            for (int i = stack.count() - 1; i >= 0; --i) {
+                QRegion region = stack[i].region;
+                if (map.isOccluded(region.boundingRect())) {
+                    region = QRegion();
+                } else {
+                    region = map.subtracted(region);
+                }
+                map.add(stack[i].clip);
+            }
+        }
+    } else {
+        QBENCHMARK {
+            QRegion allclips;
+            for (int i = stack.count() - 1; i >= 0; --i) {
+                QRegion region = stack[i].region;
+                region -= allclips;
+                allclips |= stack[i].clip;
+            }
+        }
+    }
+}
+
+QTEST_GUILESS_MAIN(OcclusionMapTest)
+#include "test_occlusion_map.moc"
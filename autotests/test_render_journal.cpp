@@ -0,0 +1,164 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2026 KWin contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "renderjournal.h"
+
+#include <QTest>
+
+using namespace KWin;
+using namespace std::chrono_literals;
+
+class RenderJournalTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testEmpty();
+    void testMissedVblanks();
+    void testDiscardFrame();
+    void testCapacity();
+    void testPercentiles();
+    void testGpuEstimate();
+    void testReset();
+};
+
+static void renderFrame(RenderJournal &journal, std::chrono::nanoseconds expectedPresentation)
+{
+    journal.beginFrame(expectedPresentation);
+    journal.endFrame();
+}
+
+void RenderJournalTest::testEmpty()
+{
+    RenderJournal journal;
+    QCOMPARE(journal.presentedFrameCount(), quint64(0));
+    QCOMPARE(journal.missedVblankCount(), quint64(0));
+    QVERIFY(journal.timings().isEmpty());
+    QVERIFY(journal.renderTimePercentile(99) == 0ns);
+    QVERIFY(journal.latencyPercentile(50) == 0ns);
+}
+
+void RenderJournalTest::testMissedVblanks()
+{
+    RenderJournal journal;
+    const std::chrono::nanoseconds vblankInterval = 16ms;
+
+    // on time
+    renderFrame(journal, 1s);
+    QVERIFY(!journal.presentFrame(1s, vblankInterval));
+    // two vblanks late
+    renderFrame(journal, 2s);
+    QVERIFY(journal.presentFrame(2s + 33ms, vblankInterval));
+    // slightly more than half a refresh cycle late
+    renderFrame(journal, 3s);
+    QVERIFY(journal.presentFrame(3s + 9ms, vblankInterval));
+    // a bit of jitter is not a missed vblank
+    renderFrame(journal, 4s);
+    QVERIFY(!journal.presentFrame(4s + 2ms, vblankInterval));
+
+    QCOMPARE(journal.presentedFrameCount(), quint64(4));
+    QCOMPARE(journal.lateFrameCount(), quint64(2));
+    QCOMPARE(journal.missedVblankCount(), quint64(3));
+
+    const QVector<FrameTiming> timings = journal.timings();
+    QCOMPARE(timings.count(), 4);
+    QVERIFY(timings[1].expectedPresentation == 2s);
+    QVERIFY(timings[1].presentation == 2s + 33ms);
+    QVERIFY(timings[1].renderEnd >= timings[1].renderBegin);
+}
+
+void RenderJournalTest::testDiscardFrame()
+{
+    RenderJournal journal;
+    renderFrame(journal, 1s);
+    renderFrame(journal, 2s);
+    journal.discardFrame();
+    journal.presentFrame(2s, 16ms);
+
+    // the first frame failed, so the presentation belongs to the second one
+    QCOMPARE(journal.presentedFrameCount(), quint64(1));
+    QVERIFY(journal.timings().constFirst().expectedPresentation == 2s);
+
+    // there is nothing left to present
+    journal.presentFrame(3s, 16ms);
+    QCOMPARE(journal.presentedFrameCount(), quint64(1));
+}
+
+void RenderJournalTest::testCapacity()
+{
+    RenderJournal journal;
+    const int frameCount = RenderJournal::timingCapacity + 100;
+    for (int i = 1; i <= frameCount; ++i) {
+        renderFrame(journal, i * 16ms);
+        journal.presentFrame(i * 16ms, 16ms);
+    }
+
+    QCOMPARE(journal.presentedFrameCount(), quint64(frameCount));
+    const QVector<FrameTiming> timings = journal.timings();
+    QCOMPARE(timings.count(), RenderJournal::timingCapacity);
+    QVERIFY(timings.constFirst().presentation == 101 * 16ms);
+    QVERIFY(timings.constLast().presentation == frameCount * 16ms);
+}
+
+void RenderJournalTest::testPercentiles()
+{
+    RenderJournal journal;
+    for (int i = 1; i <= 20; ++i) {
+        renderFrame(journal, i * 16ms);
+        journal.presentFrame(i * 16ms, 16ms);
+    }
+
+    const std::chrono::nanoseconds p50 = journal.renderTimePercentile(50);
+    const std::chrono::nanoseconds p99 = journal.renderTimePercentile(99);
+    const std::chrono::nanoseconds p100 = journal.renderTimePercentile(100);
+    QVERIFY(p50 <= p99);
+    QVERIFY(p99 <= p100);
+
+    std::chrono::nanoseconds maximum = 0ns;
+    const QVector<FrameTiming> timings = journal.timings();
+    for (const FrameTiming &timing : timings) {
+        maximum = std::max(maximum, timing.renderTime());
+    }
+    QVERIFY(p100 == maximum);
+}
+
+void RenderJournalTest::testGpuEstimate()
+{
+    RenderJournal journal;
+    QVERIFY(journal.estimate(99) == 0ns);
+
+    // the CPU side of these frames is close to free, so the GPU times dominate
+    renderFrame(journal, 1s);
+    for (int i = 1; i <= 100; ++i) {
+        journal.addGpuRenderTime(std::chrono::milliseconds(i));
+    }
+    QVERIFY(journal.estimate(99) == 99ms);
+    QVERIFY(journal.estimate(50) == 50ms);
+
+    // only the last estimateWindow samples are taken into account
+    for (int i = 0; i < RenderJournal::estimateWindow; ++i) {
+        journal.addGpuRenderTime(2ms);
+    }
+    QVERIFY(journal.estimate(99) == 2ms);
+}
+
+void RenderJournalTest::testReset()
+{
+    RenderJournal journal;
+    renderFrame(journal, 1s);
+    journal.presentFrame(1s + 40ms, 16ms);
+    QCOMPARE(journal.presentedFrameCount(), quint64(1));
+    QVERIFY(journal.missedVblankCount() > 0);
+
+    journal.reset();
+    QCOMPARE(journal.presentedFrameCount(), quint64(0));
+    QCOMPARE(journal.missedVblankCount(), quint64(0));
+    QVERIFY(journal.timings().isEmpty());
+}
+
+QTEST_GUILESS_MAIN(RenderJournalTest)
+#include "test_render_journal.moc"
@@ -0,0 +1,419 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2026 KWin contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "stackingorder.h"
+
+#include <QRandomGenerator>
+#include <QTest>
+
+using namespace KWin;
+
+struct FakeWindow
+{
+    Layer layer = NormalLayer;
+};
+
+using Constraint = StackingConstraint<FakeWindow>;
+
+static Layer layerOf(const FakeWindow *window)
+{
+    return window->layer;
+}
+
+/**
+ * The list based implementation Workspace::constrainedStackingOrder() used to have.
+ */
+static QList<FakeWindow *> referenceStackingOrder(const QList<FakeWindow *> &windows, const QList<Constraint *> &constraints)
+{
+    std::array<QList<FakeWindow *>, NumLayers> layers;
+    for (FakeWindow *window : windows) {
+        layers[layerOf(window)] << window;
+    }
+
+    QList<FakeWindow *> stacking;
+    for (uint layer = FirstLayer; layer < NumLayers; ++layer) {
+        stacking += layers[layer];
+    }
+
+    QQueue<Constraint *> queue;
+    for (Constraint *constraint : constraints) {
+        if (constraint->parents.isEmpty()) {
+            constraint->enqueued = true;
+            queue.enqueue(constraint);
+        } else {
+            constraint->enqueued = false;
+        }
+    }
+
+    while (!queue.isEmpty()) {
+        Constraint *constraint = queue.dequeue();
+
+        const int belowIndex = stacking.indexOf(constraint->below);
+        const int aboveIndex = stacking.indexOf(constraint->above);
+        if (belowIndex == -1 || aboveIndex == -1) {
+            continue;
+        } else if (aboveIndex < belowIndex) {
+            stacking.removeAt(aboveIndex);
+            stacking.insert(belowIndex, constraint->above);
+        }
+
+        for (Constraint *child : qAsConst(constraint->children)) {
+            if (!child->enqueued) {
+                child->enqueued = true;
+                queue.enqueue(child);
+            }
+        }
+    }
+
+    return stacking;
+}
+
+/**
+ * A stack of windows with transient trees, constrained the way Workspace::constrain() does.
+ */
+class Scenario
+{
+public:
+    Scenario(int windowCount, quint32 seed)
+        : m_generator(seed)
+    {
+        m_storage.resize(windowCount);
+        for (FakeWindow &window : m_storage) {
+            const int kind = m_generator.bounded(20);
+            if (kind == 0) {
+                window.layer = DesktopLayer;
+            } else if (kind == 1) {
+                window.layer = DockLayer;
+            } else if (kind == 2) {
+                window.layer = AboveLayer;
+            }
+            windows.append(&window);
+        }
+
+        // every fourth window starts a chain of up to eight transients
+        for (int i = 0; i < windowCount; i += 4) {
+            const int depth = m_generator.bounded(1, 9);
+            FakeWindow *parent = &m_storage[i];
+            for (int j = 0; j < depth; ++j) {
+                FakeWindow *child = &m_storage[m_generator.bounded(windowCount)];
+                constrain(parent, child);
+                parent = child;
+            }
+        }
+
+        shuffle();
+    }
+
+    ~Scenario()
+    {
+        qDeleteAll(constraints);
+    }
+
+    void constrain(FakeWindow *below, FakeWindow *above)
+    {
+        if (below == above) {
+            return;
+        }
+        QList<Constraint *> parents;
+        QList<Constraint *> children;
+        for (Constraint *constraint : qAsConst(constraints)) {
+            if (constraint->below == below && constraint->above == above) {
+                return;
+            }
+            if (constraint->below == above) {
+                children << constraint;
+            } else if (constraint->above == below) {
+                parents << constraint;
+            }
+        }
+
+        Constraint *constraint = new Constraint();
+        constraint->below = below;
+        constraint->above = above;
+        constraint->parents = parents;
+        constraint->children = children;
+        constraints << constraint;
+
+        for (Constraint *parent : qAsConst(parents)) {
+            parent->children << constraint;
+        }
+        for (Constraint *child : qAsConst(children)) {
+            child->parents << constraint;
+        }
+    }
+
+    void shuffle()
+    {
+        for (int i = windows.count() - 1; i > 0; --i) {
+            windows.swapItemsAt(i, m_generator.bounded(i + 1));
+        }
+    }
+
+    /**
+     * Raises or lowers a random window in the unconstrained stacking order.
+     */
+    void restack()
+    {
+        FakeWindow *window = windows.takeAt(m_generator.bounded(windows.count()));
+        if (m_generator.bounded(2)) {
+            windows.append(window);
+        } else {
+            windows.prepend(window);
+        }
+    }
+
+    QList<FakeWindow *> windows;
+    QList<Constraint *> constraints;
+
+private:
+    QVector<FakeWindow> m_storage;
+    QRandomGenerator m_generator;
+};
+
+class StackingOrderTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testLayers();
+    void testConstraint();
+    void testConstraintChain();
+    void testMissingWindow();
+    void testRelabel();
+    void testMatchesReference_data();
+    void testMatchesReference();
+    void testIncrementalRestack();
+    void testIncrementalMatchesReference_data();
+    void testIncrementalMatchesReference();
+    void benchmarkRestack_data();
+    void benchmarkRestack();
+};
+
+void StackingOrderTest::testLayers()
+{
+    FakeWindow desktop{DesktopLayer};
+    FakeWindow normal1;
+    FakeWindow dock{DockLayer};
+    FakeWindow normal2;
+
+    const QList<FakeWindow *> stacking = constrainStackingOrder<FakeWindow>({&dock, &normal1, &desktop, &normal2}, layerOf, {});
+    QCOMPARE(stacking, (QList<FakeWindow *>{&desktop, &normal1, &normal2, &dock}));
+}
+
+void StackingOrderTest::testConstraint()
+{
+    FakeWindow parent;
+    FakeWindow child;
+    FakeWindow other;
+
+    Constraint constraint;
+    constraint.below = &parent;
+    constraint.above = &child;
+
+    // the child is moved right above its parent
+    QList<FakeWindow *> stacking = constrainStackingOrder<FakeWindow>({&child, &parent, &other}, layerOf, {&constraint});
+    QCOMPARE(stacking, (QList<FakeWindow *>{&parent, &child, &other}));
+
+    // but stays where it is if it's above its parent already
+    stacking = constrainStackingOrder<FakeWindow>({&parent, &other, &child}, layerOf, {&constraint});
+    QCOMPARE(stacking, (QList<FakeWindow *>{&parent, &other, &child}));
+}
+
+void StackingOrderTest::testConstraintChain()
+{
+    Scenario scenario(0, 0);
+    FakeWindow a;
+    FakeWindow b;
+    FakeWindow c;
+    FakeWindow other;
+    scenario.constrain(&a, &b);
+    scenario.constrain(&b, &c);
+
+    const QList<FakeWindow *> stacking = constrainStackingOrder<FakeWindow>({&c, &b, &other, &a}, layerOf, scenario.constraints);
+    QCOMPARE(stacking, (QList<FakeWindow *>{&other, &a, &b, &c}));
+}
+
+void StackingOrderTest::testMissingWindow()
+{
+    FakeWindow parent;
+    FakeWindow child;
+    FakeWindow grandChild;
+    Scenario scenario(0, 0);
+    scenario.constrain(&parent, &child);
+    scenario.constrain(&child, &grandChild);
+
+    // the children of a constraint with a missing window are not applied
+    const QList<FakeWindow *> stacking = constrainStackingOrder<FakeWindow>({&grandChild, &child}, layerOf, scenario.constraints);
+    QCOMPARE(stacking, (QList<FakeWindow *>{&grandChild, &child}));
+}
+
+void StackingOrderTest::testRelabel()
+{
+    // every move halves the gap above the first window, until the labels have to be spread out
+    QVector<FakeWindow> windows(64);
+    StackingList<FakeWindow> list(windows.count());
+    for (FakeWindow &window : windows) {
+        list.append(&window);
+    }
+    for (int i = 2; i < windows.count(); ++i) {
+        list.moveAbove(list.indexOf(&windows[i]), list.indexOf(&windows[0]));
+    }
+
+    QList<FakeWindow *> expected{&windows[0]};
+    for (int i = windows.count() - 1; i >= 2; --i) {
+        expected << &windows[i];
+    }
+    expected << &windows[1];
+    QCOMPARE(list.toList(), expected);
+
+    for (int i = 1; i < expected.count(); ++i) {
+        QVERIFY(list.isBelow(list.indexOf(expected[i - 1]), list.indexOf(expected[i])));
+    }
+}
+
+void StackingOrderTest::testMatchesReference_data()
+{
+    QTest::addColumn<int>("windowCount");
+
+    QTest::addRow("50 windows") << 50;
+    QTest::addRow("200 windows") << 200;
+    QTest::addRow("1000 windows") << 1000;
+}
+
+void StackingOrderTest::testMatchesReference()
+{
+    QFETCH(int, windowCount);
+
+    Scenario scenario(windowCount, windowCount);
+    for (int i = 0; i < 50; ++i) {
+        scenario.restack();
+        const QList<FakeWindow *> expected = referenceStackingOrder(scenario.windows, scenario.constraints);
+        QCOMPARE(constrainStackingOrder(scenario.windows, layerOf, scenario.constraints), expected);
+    }
+}
+
+void StackingOrderTest::testIncrementalRestack()
+{
+    FakeWindow desktop{DesktopLayer};
+    FakeWindow parent;
+    FakeWindow transient;
+    FakeWindow normal;
+    FakeWindow keepAbove{AboveLayer};
+    Scenario scenario(0, 0);
+    scenario.constrain(&parent, &transient);
+
+    ConstrainedStackingOrder<FakeWindow> order;
+    QVERIFY(!order.restack({&transient, &desktop, &parent, &normal, &keepAbove}));
+    order.update({&transient, &desktop, &parent, &normal, &keepAbove}, layerOf, scenario.constraints);
+    QCOMPARE(order.windows(), (QList<FakeWindow *>{&desktop, &parent, &transient, &normal, &keepAbove}));
+
+    // a raised window stays below the keep above window
+    QVERIFY(order.restack({&transient, &desktop, &parent, &keepAbove, &normal}));
+    QCOMPARE(order.windows(), (QList<FakeWindow *>{&desktop, &parent, &transient, &normal, &keepAbove}));
+
+    // and a lowered window stays above the desktop
+    QVERIFY(order.restack({&normal, &transient, &desktop, &parent, &keepAbove}));
+    QCOMPARE(order.windows(), (QList<FakeWindow *>{&desktop, &normal, &parent, &transient, &keepAbove}));
+
+    // a lowered keep above window stays above the normal windows
+    QVERIFY(order.restack({&keepAbove, &normal, &transient, &desktop, &parent}));
+    QCOMPARE(order.windows(), (QList<FakeWindow *>{&desktop, &normal, &parent, &transient, &keepAbove}));
+
+    // restacking a window that takes part in a constraint needs a full update
+    QVERIFY(!order.restack({&keepAbove, &normal, &desktop, &parent, &transient}));
+
+    // and so does any other change
+    order.update({&keepAbove, &normal, &desktop, &parent, &transient}, layerOf, scenario.constraints);
+    QVERIFY(!order.restack({&keepAbove, &desktop, &normal, &parent, &transient}));
+    QVERIFY(!order.restack({&keepAbove, &normal, &desktop, &parent}));
+
+    order.invalidate();
+    QVERIFY(!order.restack({&keepAbove, &normal, &desktop, &parent, &transient}));
+}
+
+void StackingOrderTest::testIncrementalMatchesReference_data()
+{
+    QTest::addColumn<int>("windowCount");
+
+    QTest::addRow("50 windows") << 50;
+    QTest::addRow("200 windows") << 200;
+    QTest::addRow("1000 windows") << 1000;
+}
+
+void StackingOrderTest::testIncrementalMatchesReference()
+{
+    QFETCH(int, windowCount);
+
+    Scenario scenario(windowCount, windowCount);
+    ConstrainedStackingOrder<FakeWindow> order;
+    int incremental = 0;
+    for (int i = 0; i < 200; ++i) {
+        scenario.restack();
+        if (order.restack(scenario.windows)) {
+            ++incremental;
+        } else {
+            order.update(scenario.windows, layerOf, scenario.constraints);
+        }
+        QCOMPARE(order.windows(), referenceStackingOrder(scenario.windows, scenario.constraints));
+    }
+    QVERIFY(incremental > 0);
+}
+
+enum class Implementation {
+    Reference,
+    StackingList,
+    Incremental,
+};
+
+void StackingOrderTest::benchmarkRestack_data()
+{
+    QTest::addColumn<int>("windowCount");
+    QTest::addColumn<int>("implementation");
+
+    for (int windowCount : {50, 200, 500, 2000}) {
+        QTest::addRow("QList, %d windows", windowCount) << windowCount << int(Implementation::Reference);
+        QTest::addRow("StackingList, %d windows", windowCount) << windowCount << int(Implementation::StackingList);
+        QTest::addRow("ConstrainedStackingOrder, %d windows", windowCount) << windowCount << int(Implementation::Incremental);
+    }
+}
+
+void StackingOrderTest::benchmarkRestack()
+{
+    QFETCH(int, windowCount);
+    QFETCH(int, implementation);
+
+    // Every fourth window has transients and one in twenty is kept above, so some of the
+    // restacked windows take part in constraints and need a full update.
+    Scenario scenario(windowCount, windowCount);
+    switch (Implementation(implementation)) {
+    case Implementation::Reference:
+        QBENCHMARK {
+            scenario.restack();
+            referenceStackingOrder(scenario.windows, scenario.constraints);
+        }
+        break;
+    case Implementation::StackingList:
+        QBENCHMARK {
+            scenario.restack();
+            constrainStackingOrder(scenario.windows, layerOf, scenario.constraints);
+        }
+        break;
+    case Implementation::Incremental: {
+        ConstrainedStackingOrder<FakeWindow> order;
+        QBENCHMARK {
+            scenario.restack();
+            if (!order.restack(scenario.windows)) {
+                order.update(scenario.windows, layerOf, scenario.constraints);
+            }
+        }
+        break;
+    }
+    }
+}
+
+QTEST_GUILESS_MAIN(StackingOrderTest)
+#include "test_stacking_order.moc"
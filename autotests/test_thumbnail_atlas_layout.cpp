@@ -0,0 +1,177 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2026 KWin contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "scripting/thumbnailatlaslayout.h"
+
+#include <QTest>
+
+using namespace KWin;
+
+class ThumbnailAtlasLayoutTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testCellSize_data();
+    void testCellSize();
+    void testContentsRect();
+    void testMixedSizes();
+    void testReuse();
+    void testFull();
+    void testShelvesCollapse();
+    void testTallerShelf();
+    void testTooLarge();
+};
+
+static bool overlaps(const QVector<QRect> &cells)
+{
+    for (int i = 0; i < cells.count(); ++i) {
+        for (int j = i + 1; j < cells.count(); ++j) {
+            if (cells[i].intersects(cells[j])) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void ThumbnailAtlasLayoutTest::testCellSize_data()
+{
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<QSize>("cellSize");
+
+    QTest::newRow("tiny") << QSize(1, 1) << QSize(32, 32);
+    QTest::newRow("exact") << QSize(30, 62) << QSize(32, 64);
+    QTest::newRow("padding") << QSize(31, 63) << QSize(64, 96);
+    QTest::newRow("thumbnail") << QSize(320, 180) << QSize(352, 192);
+}
+
+void ThumbnailAtlasLayoutTest::testCellSize()
+{
+    QFETCH(QSize, size);
+    QFETCH(QSize, cellSize);
+    QCOMPARE(ThumbnailAtlasLayout::cellSize(size), cellSize);
+}
+
+void ThumbnailAtlasLayoutTest::testContentsRect()
+{
+    const QRect cell(64, 32, 352, 192);
+    const QRect contents = ThumbnailAtlasLayout::contentsRect(cell, QSize(320, 180));
+    QCOMPARE(contents, QRect(65, 33, 320, 180));
+    QVERIFY(cell.contains(contents.adjusted(-1, -1, 1, 1)));
+}
+
+void ThumbnailAtlasLayoutTest::testMixedSizes()
+{
+    // Thumbnails of all sizes share the atlas.
+    ThumbnailAtlasLayout layout(QSize(1024, 1024));
+    QVERIFY(layout.isEmpty());
+
+    const QVector<QSize> sizes{
+        QSize(320, 180), QSize(200, 200), QSize(320, 180), QSize(100, 400),
+        QSize(640, 360), QSize(50, 50), QSize(320, 180), QSize(200, 200),
+    };
+    QVector<QRect> cells;
+    for (const QSize &size : sizes) {
+        const QSize cellSize = ThumbnailAtlasLayout::cellSize(size);
+        const QRect cell = layout.allocate(cellSize);
+        QVERIFY(!cell.isNull());
+        QCOMPARE(cell.size(), cellSize);
+        QVERIFY(QRect(QPoint(0, 0), layout.size()).contains(cell));
+        cells.append(cell);
+    }
+    QVERIFY(!overlaps(cells));
+    QVERIFY(!layout.isEmpty());
+
+    for (const QRect &cell : qAsConst(cells)) {
+        layout.release(cell);
+    }
+    QVERIFY(layout.isEmpty());
+}
+
+void ThumbnailAtlasLayoutTest::testReuse()
+{
+    ThumbnailAtlasLayout layout(QSize(1024, 1024));
+    const QSize cellSize = ThumbnailAtlasLayout::cellSize(QSize(300, 200));
+
+    const QRect first = layout.allocate(cellSize);
+    const QRect second = layout.allocate(cellSize);
+    const QRect third = layout.allocate(cellSize);
+    QCOMPARE(first.y(), second.y());
+    QCOMPARE(second.y(), third.y());
+
+    // A released cell is handed out again instead of growing the atlas.
+    layout.release(second);
+    QCOMPARE(layout.allocate(cellSize), second);
+
+    // Neighbouring free ranges are merged, so a wider cell fits where two were.
+    layout.release(second);
+    layout.release(third);
+    const QSize widerCellSize(cellSize.width() * 2, cellSize.height());
+    QCOMPARE(layout.allocate(widerCellSize), QRect(second.topLeft(), widerCellSize));
+}
+
+void ThumbnailAtlasLayoutTest::testFull()
+{
+    ThumbnailAtlasLayout layout(QSize(256, 256));
+    const QSize cellSize(64, 64);
+
+    QVector<QRect> cells;
+    for (int i = 0; i < 16; ++i) {
+        const QRect cell = layout.allocate(cellSize);
+        QVERIFY(!cell.isNull());
+        cells.append(cell);
+    }
+    QVERIFY(!overlaps(cells));
+    QVERIFY(layout.allocate(cellSize).isNull());
+
+    layout.release(cells[5]);
+    QCOMPARE(layout.allocate(cellSize), cells[5]);
+    QVERIFY(layout.allocate(cellSize).isNull());
+}
+
+void ThumbnailAtlasLayoutTest::testShelvesCollapse()
+{
+    ThumbnailAtlasLayout layout(QSize(256, 256));
+
+    const QRect top = layout.allocate(QSize(256, 64));
+    const QRect bottom = layout.allocate(QSize(256, 192));
+    QVERIFY(!top.isNull());
+    QVERIFY(!bottom.isNull());
+    QVERIFY(layout.allocate(QSize(32, 32)).isNull());
+
+    // Once the bottom shelf is empty, its space can be used for cells of another height.
+    layout.release(bottom);
+    const QRect cell = layout.allocate(QSize(128, 128));
+    QCOMPARE(cell, QRect(0, 64, 128, 128));
+}
+
+void ThumbnailAtlasLayoutTest::testTallerShelf()
+{
+    ThumbnailAtlasLayout layout(QSize(256, 256));
+
+    const QRect first = layout.allocate(QSize(128, 128));
+    const QRect second = layout.allocate(QSize(64, 96));
+    QCOMPARE(first, QRect(0, 0, 128, 128));
+    QCOMPARE(second, QRect(0, 128, 64, 96));
+
+    // There's no room for another shelf, so the cell goes to the shortest shelf it fits on.
+    QCOMPARE(layout.allocate(QSize(64, 64)), QRect(64, 128, 64, 64));
+    QCOMPARE(layout.allocate(QSize(128, 64)), QRect(128, 128, 128, 64));
+    QCOMPARE(layout.allocate(QSize(128, 128)), QRect(128, 0, 128, 128));
+}
+
+void ThumbnailAtlasLayoutTest::testTooLarge()
+{
+    ThumbnailAtlasLayout layout(QSize(256, 256));
+    QVERIFY(layout.allocate(QSize(288, 32)).isNull());
+    QVERIFY(layout.allocate(QSize(32, 288)).isNull());
+    QVERIFY(layout.isEmpty());
+}
+
+QTEST_GUILESS_MAIN(ThumbnailAtlasLayoutTest)
+#include "test_thumbnail_atlas_layout.moc"
@@ -261,6 +261,9 @@ void AbstractClient::updateLayer()
 void AbstractClient::invalidateLayer()
 {
     m_layer = UnknownLayer;
+    if (Workspace *ws = workspace()) {
+        ws->invalidateConstrainedStackingOrder();
+    }
 }
 
 Layer AbstractClient::belongsToLayer() const
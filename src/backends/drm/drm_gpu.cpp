@@ -578,6 +578,11 @@ const QVector<DrmPipeline*> DrmGpu::pipelines() const
     return m_pipelines;
 }
 
+QVector<DrmPlane*> DrmGpu::planes() const
+{
+    return m_planes;
+}
+
 DrmVirtualOutput *DrmGpu::createVirtualOutput(const QString &name, const QSize &size, double scale, VirtualOutputMode mode)
 {
     auto output = new DrmVirtualOutput(name, this, size);
@@ -766,6 +771,11 @@ QVector<DrmObject*> DrmGpu::unusedObjects() const
             ret.removeOne(pipeline->pending.crtc->primaryPlane());
             ret.removeOne(pipeline->pending.crtc->cursorPlane());
         }
+        // the pipelines enable and disable their overlay planes themselves
+        const auto overlayPlanes = pipeline->usedOverlayPlanes();
+        for (DrmPlane *plane : overlayPlanes) {
+            ret.removeOne(plane);
+        }
     }
     return ret;
 }
@@ -69,6 +69,7 @@ public:
 
     QVector<DrmAbstractOutput*> outputs() const;
     const QVector<DrmPipeline*> pipelines() const;
+    QVector<DrmPlane*> planes() const;
 
     void setEglDisplay(EGLDisplay display);
     void setEglBackend(EglGbmBackend *eglBackend);
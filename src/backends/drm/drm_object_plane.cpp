@@ -42,6 +42,7 @@ DrmPlane::DrmPlane(DrmGpu *gpu, uint32_t planeId)
             QByteArrayLiteral("reflect-x"),
             QByteArrayLiteral("reflect-y")}),
         PropertyDefinition(QByteArrayLiteral("IN_FORMATS"), Requirement::Optional),
+        PropertyDefinition(QByteArrayLiteral("zpos"), Requirement::Optional),
         }, DRM_MODE_OBJECT_PLANE)
 {
 }
@@ -164,7 +165,8 @@ void DrmPlane::setBuffer(DrmBuffer *buffer)
 
 bool DrmPlane::needsModeset() const
 {
-    if (!gpu()->atomicModeSetting() || type() == TypeIndex::Cursor) {
+    // cursor and overlay planes can be enabled and disabled without a modeset
+    if (!gpu()->atomicModeSetting() || type() != TypeIndex::Primary) {
         return false;
     }
     auto rotation = getProp(PropertyIndex::Rotation);
@@ -179,6 +181,16 @@ bool DrmPlane::isCrtcSupported(int pipeIndex) const
     return (m_possibleCrtcs & (1 << pipeIndex));
 }
 
+bool DrmPlane::isBelow(const DrmPlane *other) const
+{
+    const auto zpos = getProp(PropertyIndex::Zpos);
+    const auto otherZpos = other->getProp(PropertyIndex::Zpos);
+    if (zpos && otherZpos) {
+        return zpos->current() < otherZpos->current();
+    }
+    return type() == TypeIndex::Primary && other->type() != TypeIndex::Primary;
+}
+
 QMap<uint32_t, QVector<uint64_t>> DrmPlane::formats() const
 {
     return m_supportedFormats;
@@ -40,6 +40,7 @@ public:
         CrtcId,
         Rotation,
         In_Formats,
+        Zpos,
         Count
     };
     Q_ENUM(PropertyIndex)
@@ -69,6 +70,11 @@ public:
     TypeIndex type() const;
 
     bool isCrtcSupported(int pipeIndex) const;
+    /**
+     * Returns @c true if the plane is stacked below @a other. Planes without a zpos
+     * property are assumed to be stacked above the primary plane.
+     */
+    bool isBelow(const DrmPlane *other) const;
     QMap<uint32_t, QVector<uint64_t>> formats() const;
 
     QSharedPointer<DrmBuffer> current() const;
@@ -50,8 +50,9 @@ bool DrmPipeline::present(const QSharedPointer<DrmBuffer> &buffer)
     Q_ASSERT(buffer);
     m_primaryBuffer = buffer;
     auto buf = dynamic_cast<DrmGbmBuffer*>(buffer.data());
-    // with direct scanout disallow modesets, calling presentFailed() and logging warnings
-    bool directScanout = buf && buf->clientBuffer();
+    // with direct scanout or overlays disallow modesets, calling presentFailed() and logging warnings;
+    // the caller falls back to presenting a composited buffer
+    bool directScanout = (buf && buf->clientBuffer()) || !pending.overlays.isEmpty();
     if (gpu()->needsModeset()) {
         if (directScanout) {
             return false;
@@ -201,6 +202,23 @@ bool DrmPipeline::populateAtomicValues(drmModeAtomicReq *req, uint32_t &flags)
             pending.crtc->cursorPlane()->setPending(DrmPlane::PropertyIndex::CrtcId, (activePending() && pending.cursorBo) ? pending.crtc->id() : 0);
         }
     }
+    const auto overlayPlanes = usedOverlayPlanes();
+    for (DrmPlane *plane : overlayPlanes) {
+        const auto it = std::find_if(pending.overlays.constBegin(), pending.overlays.constEnd(), [plane](const State::Overlay &overlay) {
+            return overlay.plane == plane;
+        });
+        if (activePending() && it != pending.overlays.constEnd()) {
+            plane->set(it->source.topLeft(), it->source.size(), it->destination.topLeft(), it->destination.size());
+            plane->setBuffer(it->buffer.get());
+            plane->setPending(DrmPlane::PropertyIndex::CrtcId, pending.crtc->id());
+            plane->setTransformation(DrmPlane::Transformation::Rotate0);
+        } else {
+            plane->disable();
+        }
+        if (!plane->atomicPopulate(req)) {
+            return false;
+        }
+    }
     if (!m_connector->atomicPopulate(req)) {
         return false;
     }
@@ -283,6 +301,10 @@ void DrmPipeline::atomicCommitFailed()
             pending.crtc->cursorPlane()->rollbackPending();
         }
     }
+    const auto overlayPlanes = usedOverlayPlanes();
+    for (DrmPlane *plane : overlayPlanes) {
+        plane->rollbackPending();
+    }
 }
 
 void DrmPipeline::atomicCommitSuccessful(CommitMode mode)
@@ -296,6 +318,10 @@ void DrmPipeline::atomicCommitSuccessful(CommitMode mode)
             pending.crtc->cursorPlane()->commitPending();
         }
     }
+    const auto overlayPlanes = usedOverlayPlanes();
+    for (DrmPlane *plane : overlayPlanes) {
+        plane->commitPending();
+    }
     if (mode != CommitMode::Test) {
         if (activePending()) {
             m_pageflipPending = true;
@@ -310,6 +336,21 @@ void DrmPipeline::atomicCommitSuccessful(CommitMode mode)
                 pending.crtc->cursorPlane()->commit();
             }
         }
+        for (DrmPlane *plane : overlayPlanes) {
+            const auto it = std::find_if(pending.overlays.constBegin(), pending.overlays.constEnd(), [plane](const State::Overlay &overlay) {
+                return overlay.plane == plane;
+            });
+            if (it != pending.overlays.constEnd()) {
+                plane->setNext(it->buffer);
+                m_releasedOverlayPlanes.removeOne(plane);
+            } else {
+                plane->setNext(nullptr);
+                if (!m_releasedOverlayPlanes.contains(plane)) {
+                    m_releasedOverlayPlanes << plane;
+                }
+            }
+            plane->commit();
+        }
         m_current = pending;
         if (mode == CommitMode::CommitModeset && activePending()) {
             pageFlipped(std::chrono::steady_clock::now().time_since_epoch());
@@ -415,6 +456,65 @@ bool DrmPipeline::moveCursor(QPoint pos)
     return result;
 }
 
+bool DrmPipeline::addOverlay(const State::Overlay &overlay)
+{
+    Q_ASSERT(gpu()->atomicModeSetting());
+    pending.overlays << overlay;
+    if (commitPipelines({this}, CommitMode::Test)) {
+        m_next = pending;
+        return true;
+    } else {
+        pending.overlays.removeLast();
+        return false;
+    }
+}
+
+void DrmPipeline::clearOverlays()
+{
+    pending.overlays.clear();
+    m_next.overlays.clear();
+}
+
+QVector<DrmPlane *> DrmPipeline::availableOverlayPlanes() const
+{
+    if (!gpu()->atomicModeSetting() || !pending.crtc || !pending.crtc->primaryPlane()) {
+        return {};
+    }
+    const auto pipelines = gpu()->pipelines();
+    const auto planes = gpu()->planes();
+    QVector<DrmPlane *> ret;
+    for (DrmPlane *plane : planes) {
+        if (plane->type() != DrmPlane::TypeIndex::Overlay || !plane->isCrtcSupported(pending.crtc->pipeIndex())) {
+            continue;
+        }
+        // planes below the primary plane would need transparent holes in the composited buffer
+        if (plane->isBelow(pending.crtc->primaryPlane())) {
+            continue;
+        }
+        const bool used = std::any_of(pipelines.constBegin(), pipelines.constEnd(), [this, plane](const DrmPipeline *pipeline) {
+            return pipeline != this && (pipeline->usedOverlayPlanes().contains(plane) || pipeline->m_releasedOverlayPlanes.contains(plane));
+        });
+        if (!used) {
+            ret << plane;
+        }
+    }
+    return ret;
+}
+
+QVector<DrmPlane *> DrmPipeline::usedOverlayPlanes() const
+{
+    QVector<DrmPlane *> ret;
+    for (const State::Overlay &overlay : pending.overlays) {
+        ret << overlay.plane;
+    }
+    for (const State::Overlay &overlay : m_current.overlays) {
+        if (!ret.contains(overlay.plane)) {
+            ret << overlay.plane;
+        }
+    }
+    return ret;
+}
+
 void DrmPipeline::applyPendingChanges()
 {
     if (!pending.crtc) {
@@ -466,6 +566,14 @@ void DrmPipeline::pageFlipped(std::chrono::nanoseconds timestamp)
     if (m_current.crtc->cursorPlane()) {
         m_current.crtc->cursorPlane()->flipBuffer();
     }
+    for (const State::Overlay &overlay : qAsConst(m_current.overlays)) {
+        overlay.plane->flipBuffer();
+    }
+    // the buffers of disabled overlay planes can be released now
+    for (DrmPlane *plane : qAsConst(m_releasedOverlayPlanes)) {
+        plane->flipBuffer();
+    }
+    m_releasedOverlayPlanes.clear();
     m_pageflipPending = false;
     if (m_output) {
         m_output->pageFlipped(timestamp);
@@ -667,6 +775,10 @@ void DrmPipeline::printDebugInfo() const
             printProps(pending.crtc->cursorPlane(), PrintMode::All);
         }
     }
+    const auto overlayPlanes = usedOverlayPlanes();
+    for (DrmPlane *plane : overlayPlanes) {
+        printProps(plane, PrintMode::All);
+    }
 }
 
 }
@@ -10,6 +10,7 @@
 #pragma once
 
 #include <QPoint>
+#include <QRect>
 #include <QSize>
 #include <QVector>
 #include <QSharedPointer>
@@ -107,6 +108,19 @@ public:
         QPoint cursorHotspot;
         QSharedPointer<DrmDumbBuffer> cursorBo;
 
+        /**
+         * A buffer that is shown on an overlay plane, on top of the primary plane.
+         */
+        struct Overlay {
+            DrmPlane *plane = nullptr;
+            QSharedPointer<DrmBuffer> buffer;
+            // in buffer pixels
+            QRect source;
+            // in pixels of the mode
+            QRect destination;
+        };
+        QVector<Overlay> overlays;
+
         // the transformation that this pipeline will apply to submitted buffers
         DrmPlane::Transformations bufferTransformation = DrmPlane::Transformation::Rotate0;
         // the transformation that buffers submitted to the pipeline should have
@@ -114,6 +128,21 @@ public:
     };
     State pending;
 
+    /**
+     * Adds @a overlay to the pending state if the configuration passes an atomic test.
+     * The overlay is shown with the next presented buffer.
+     */
+    bool addOverlay(const State::Overlay &overlay);
+    void clearOverlays();
+    /**
+     * overlay planes that are not used by another pipeline and can be used by this one
+     */
+    QVector<DrmPlane *> availableOverlayPlanes() const;
+    /**
+     * overlay planes that are used by the pending or the committed state
+     */
+    QVector<DrmPlane *> usedOverlayPlanes() const;
+
     enum class CommitMode {
         Test,
         Commit,
@@ -153,6 +182,8 @@ private:
 
     QSharedPointer<DrmBuffer> m_primaryBuffer;
     QSharedPointer<DrmBuffer> m_oldTestBuffer;
+    // overlay planes that were disabled by the last commit but still hold a buffer until the page flip
+    QVector<DrmPlane *> m_releasedOverlayPlanes;
     bool m_pageflipPending = false;
     bool m_modesetPresentPending = false;
 
@@ -32,6 +32,7 @@
 #include <kwinglplatform.h>
 #include <kwineglimagetexture.h>
 // system
+#include <algorithm>
 #include <gbm.h>
 #include <unistd.h>
 #include <errno.h>
@@ -622,7 +623,15 @@ void EglGbmBackend::endFrame(AbstractOutput *drmOutput, const QRegion &renderedR
 
     const QRegion dirty = damagedRegion.intersected(output.output->geometry());
     QSharedPointer<DrmBuffer> buffer = endFrameWithBuffer(drmOutput, dirty);
-    output.output->present(buffer, dirty);
+    if (!output.output->present(buffer, dirty) && buffer && !output.overlaySurfaces.isEmpty()) {
+        // The surfaces on the overlay planes are missing from this frame; don't try them again
+        // and composite them with the next one
+        qCDebug(KWIN_DRM) << "Presenting with overlay planes failed on output" << output.output->name();
+        output.failedOverlaySurfaces << output.overlaySurfaces;
+        clearOverlays(output);
+        output.output->present(buffer, dirty);
+        output.output->renderLoop()->scheduleRepaint();
+    }
 }
 
 void EglGbmBackend::updateBufferAge(Output &output, const QRegion &dirty)
@@ -633,6 +642,54 @@ void EglGbmBackend::updateBufferAge(Output &output, const QRegion &dirty)
     }
 }
 
+static bool hasExplicitModifier(KWaylandServer::LinuxDmaBufV1ClientBuffer *buffer)
+{
+    const auto planes = buffer->planes();
+    return planes.first().modifier != DRM_FORMAT_MOD_INVALID
+        || planes.first().offset > 0
+        || planes.count() > 1;
+}
+
+/**
+ * Imports the dmabuf of a client buffer so that it can be scanned out. Buffers with explicit
+ * modifiers can only be imported if the gpu supports modifiers for framebuffers.
+ */
+gbm_bo *EglGbmBackend::importClientBuffer(KWaylandServer::LinuxDmaBufV1ClientBuffer *buffer) const
+{
+    const auto planes = buffer->planes();
+    gbm_bo *importedBuffer;
+    if (hasExplicitModifier(buffer)) {
+        if (!m_gpu->addFB2ModifiersSupported()) {
+            return nullptr;
+        }
+        gbm_import_fd_modifier_data data = {};
+        data.format = buffer->format();
+        data.width = (uint32_t) buffer->size().width();
+        data.height = (uint32_t) buffer->size().height();
+        data.num_fds = planes.count();
+        data.modifier = planes.first().modifier;
+        for (int i = 0; i < planes.count(); i++) {
+            data.fds[i] = planes[i].fd;
+            data.offsets[i] = planes[i].offset;
+            data.strides[i] = planes[i].stride;
+        }
+        importedBuffer = gbm_bo_import(m_gpu->gbmDevice(), GBM_BO_IMPORT_FD_MODIFIER, &data, GBM_BO_USE_SCANOUT);
+    } else {
+        auto plane = planes.first();
+        gbm_import_fd_data data = {};
+        data.fd = plane.fd;
+        data.width = (uint32_t) buffer->size().width();
+        data.height = (uint32_t) buffer->size().height();
+        data.stride = plane.stride;
+        data.format = buffer->format();
+        importedBuffer = gbm_bo_import(m_gpu->gbmDevice(), GBM_BO_IMPORT_FD, &data, GBM_BO_USE_SCANOUT);
+    }
+    if (!importedBuffer && errno != EINVAL) {
+        qCWarning(KWIN_DRM) << "Importing buffer for direct scanout failed:" << strerror(errno);
+    }
+    return importedBuffer;
+}
+
 bool EglGbmBackend::scanout(AbstractOutput *drmOutput, SurfaceItem *surfaceItem)
 {
     static bool valid;
@@ -704,41 +761,13 @@ bool EglGbmBackend::scanout(AbstractOutput *drmOutput, SurfaceItem *surfaceItem)
         return false;
     }
 
-    gbm_bo *importedBuffer;
-    if (planes.first().modifier != DRM_FORMAT_MOD_INVALID
-        || planes.first().offset > 0
-        || planes.count() > 1) {
-        if (!m_gpu->addFB2ModifiersSupported() || !output.output->supportedModifiers(buffer->format()).contains(planes.first().modifier)) {
-            sendFeedback();
-            return false;
-        }
-        gbm_import_fd_modifier_data data = {};
-        data.format = buffer->format();
-        data.width = (uint32_t) buffer->size().width();
-        data.height = (uint32_t) buffer->size().height();
-        data.num_fds = planes.count();
-        data.modifier = planes.first().modifier;
-        for (int i = 0; i < planes.count(); i++) {
-            data.fds[i] = planes[i].fd;
-            data.offsets[i] = planes[i].offset;
-            data.strides[i] = planes[i].stride;
-        }
-        importedBuffer = gbm_bo_import(m_gpu->gbmDevice(), GBM_BO_IMPORT_FD_MODIFIER, &data, GBM_BO_USE_SCANOUT);
-    } else {
-        auto plane = planes.first();
-        gbm_import_fd_data data = {};
-        data.fd = plane.fd;
-        data.width = (uint32_t) buffer->size().width();
-        data.height = (uint32_t) buffer->size().height();
-        data.stride = plane.stride;
-        data.format = buffer->format();
-        importedBuffer = gbm_bo_import(m_gpu->gbmDevice(), GBM_BO_IMPORT_FD, &data, GBM_BO_USE_SCANOUT);
+    if (hasExplicitModifier(buffer) && !output.output->supportedModifiers(buffer->format()).contains(planes.first().modifier)) {
+        sendFeedback();
+        return false;
     }
+    gbm_bo *importedBuffer = importClientBuffer(buffer);
     if (!importedBuffer) {
         sendFeedback();
-        if (errno != EINVAL) {
-            qCWarning(KWIN_DRM) << "Importing buffer for direct scanout failed:" << strerror(errno);
-        }
         return false;
     }
     // damage tracking for screen casting
@@ -763,6 +792,7 @@ bool EglGbmBackend::scanout(AbstractOutput *drmOutput, SurfaceItem *surfaceItem)
     }
     // ensure that a context is current like with normal presentation
     makeCurrent();
+    clearOverlays(output);
     if (output.output->present(bo, damage)) {
         if (output.scanoutSurface != surface) {
             auto path = surface->client()->executablePath();
@@ -780,6 +810,125 @@ bool EglGbmBackend::scanout(AbstractOutput *drmOutput, SurfaceItem *surfaceItem)
     }
 }
 
+/**
+ * Computes where the buffer of @a item is taken from and where it ends up on the output.
+ * Returns @c false if the plane would have to transform or fractionally crop the buffer.
+ */
+static bool overlayGeometry(const SurfaceItem *item, const DrmAbstractOutput *output, QRect *source, QRect *destination)
+{
+    const QMatrix4x4 surfaceToBuffer = item->surfaceToBufferMatrix();
+    if (surfaceToBuffer(0, 1) != 0 || surfaceToBuffer(1, 0) != 0
+        || surfaceToBuffer(0, 0) <= 0 || surfaceToBuffer(1, 1) <= 0) {
+        return false;
+    }
+    const QRectF sourceF(surfaceToBuffer.map(QPointF(0, 0)), surfaceToBuffer.map(QPointF(item->size().width(), item->size().height())));
+    const QRect geometry = output->geometry();
+    const QRect globalRect = item->mapToGlobal(item->rect());
+    const QRectF destinationF(QPointF(globalRect.topLeft() - geometry.topLeft()) * output->scale(), QSizeF(globalRect.size()) * output->scale());
+
+    *source = sourceF.toRect();
+    *destination = destinationF.toRect();
+    return QRectF(*source) == sourceF && QRectF(*destination) == destinationF
+        && !source->isEmpty() && !destination->isEmpty();
+}
+
+QVector<SurfaceItem *> EglGbmBackend::assignOverlays(AbstractOutput *drmOutput, const QVector<SurfaceItem *> &candidates)
+{
+    static bool valid;
+    static const bool overlaysDisabled = qEnvironmentVariableIntValue("KWIN_DRM_NO_OVERLAYS", &valid) == 1 && valid;
+
+    Q_ASSERT(m_outputs.contains(drmOutput));
+    Output &output = m_outputs[drmOutput];
+    const auto pipelineOutput = qobject_cast<DrmOutput *>(output.output);
+    // framebuffers of client buffers that stay on a plane are reused
+    const auto previousOverlays = pipelineOutput ? pipelineOutput->pipeline()->pending.overlays : QVector<DrmPipeline::State::Overlay>();
+    clearOverlays(output);
+
+    if (overlaysDisabled || candidates.isEmpty() || !pipelineOutput || !isPrimary()
+        || m_gpu->needsModeset() || output.current.shadowBuffer
+        || output.output->transform() != AbstractWaylandOutput::Transform::Normal) {
+        return {};
+    }
+    DrmPipeline *pipeline = pipelineOutput->pipeline();
+    QVector<DrmPlane *> planes = pipeline->availableOverlayPlanes();
+    output.failedOverlaySurfaces.removeAll(nullptr);
+
+    QVector<SurfaceItem *> assigned;
+    for (SurfaceItem *candidate : candidates) {
+        if (planes.isEmpty()) {
+            break;
+        }
+        const auto item = qobject_cast<SurfaceItemWayland *>(candidate);
+        KWaylandServer::SurfaceInterface *surface = item ? item->surface() : nullptr;
+        if (!surface || output.failedOverlaySurfaces.contains(surface)) {
+            continue;
+        }
+        const auto buffer = qobject_cast<KWaylandServer::LinuxDmaBufV1ClientBuffer *>(surface->buffer());
+        if (!buffer || buffer->planes().isEmpty()) {
+            continue;
+        }
+        QRect source;
+        QRect destination;
+        if (!overlayGeometry(item, output.output, &source, &destination)) {
+            continue;
+        }
+
+        const auto supportsBuffer = [buffer](DrmPlane *plane) {
+            const auto formats = plane->formats();
+            if (!formats.contains(buffer->format())) {
+                return false;
+            }
+            return !hasExplicitModifier(buffer) || formats[buffer->format()].contains(buffer->planes().first().modifier);
+        };
+        if (std::none_of(planes.constBegin(), planes.constEnd(), supportsBuffer)) {
+            continue;
+        }
+        QSharedPointer<DrmBuffer> bo;
+        for (const auto &overlay : previousOverlays) {
+            const auto gbmBuffer = overlay.buffer.dynamicCast<DrmGbmBuffer>();
+            if (gbmBuffer && gbmBuffer->clientBuffer() == buffer) {
+                bo = gbmBuffer;
+                break;
+            }
+        }
+        if (!bo) {
+            gbm_bo *importedBuffer = importClientBuffer(buffer);
+            if (!importedBuffer) {
+                continue;
+            }
+            bo = QSharedPointer<DrmGbmBuffer>::create(m_gpu, importedBuffer, buffer);
+            if (!bo->bufferId()) {
+                continue;
+            }
+        }
+        for (auto it = planes.begin(); it != planes.end(); ++it) {
+            if (!supportsBuffer(*it)) {
+                continue;
+            }
+            if (pipeline->addOverlay(DrmPipeline::State::Overlay{
+                    .plane = *it,
+                    .buffer = bo,
+                    .source = source,
+                    .destination = destination,
+                })) {
+                planes.erase(it);
+                output.overlaySurfaces << surface;
+                assigned << candidate;
+                break;
+            }
+        }
+    }
+    return assigned;
+}
+
+void EglGbmBackend::clearOverlays(Output &output)
+{
+    if (const auto pipelineOutput = qobject_cast<DrmOutput *>(output.output)) {
+        pipelineOutput->pipeline()->clearOverlays();
+    }
+    output.overlaySurfaces.clear();
+}
+
 QSharedPointer<DrmBuffer> EglGbmBackend::renderTestFrame(DrmAbstractOutput *output)
 {
     beginFrame(output);
@@ -22,6 +22,7 @@ struct gbm_bo;
 
 namespace KWaylandServer
 {
+class LinuxDmaBufV1ClientBuffer;
 class SurfaceInterface;
 }
 
@@ -65,6 +66,7 @@ public:
     void endFrame(AbstractOutput *output, const QRegion &renderedRegion, const QRegion &damagedRegion) override;
     void init() override;
     bool scanout(AbstractOutput *output, SurfaceItem *surfaceItem) override;
+    QVector<SurfaceItem *> assignOverlays(AbstractOutput *output, const QVector<SurfaceItem *> &candidates) override;
     bool prefer10bpc() const override;
 
     QSharedPointer<GLTexture> textureForOutput(AbstractOutput *requestedOutput) const override;
@@ -115,6 +117,11 @@ private:
         } scanoutCandidate;
         QSharedPointer<DrmBuffer> scanoutBuffer;
         QPointer<KWaylandServer::SurfaceInterface> oldScanoutCandidate;
+
+        // the surfaces that are shown on overlay planes with the next frame
+        QVector<QPointer<KWaylandServer::SurfaceInterface>> overlaySurfaces;
+        // surfaces for which presenting on an overlay plane failed
+        QVector<QPointer<KWaylandServer::SurfaceInterface>> failedOverlaySurfaces;
     };
 
     bool doesRenderFit(const Output &output, const Output::RenderData &render);
@@ -129,6 +136,8 @@ private:
     QRegion prepareRenderingForOutput(Output &output);
     QSharedPointer<DrmBuffer> importFramebuffer(Output &output, const QRegion &dirty) const;
     QSharedPointer<DrmBuffer> endFrameWithBuffer(AbstractOutput *output, const QRegion &dirty);
+    gbm_bo *importClientBuffer(KWaylandServer::LinuxDmaBufV1ClientBuffer *buffer) const;
+    void clearOverlays(Output &output);
     void updateBufferAge(Output &output, const QRegion &dirty);
     std::optional<GbmFormat> chooseFormat(Output &output) const;
 
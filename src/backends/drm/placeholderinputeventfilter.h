@@ -16,6 +16,11 @@ namespace KWin
 class PlaceholderInputEventFilter : public InputEventFilter
 {
 public:
+    PlaceholderInputEventFilter()
+        : InputEventFilter(PointerEvents | WheelEvents | KeyEvents | TouchEvents)
+    {
+    }
+
     bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override;
     bool wheelEvent(QWheelEvent *event) override;
     bool keyEvent(QKeyEvent *event) override;
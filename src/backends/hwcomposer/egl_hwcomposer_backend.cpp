@@ -64,6 +64,17 @@ void EglHwcomposerBackend::init()
 
     initKWinGL();
     initBufferAge();
+
+    // libhybris usually doesn't implement EGL_EXT_buffer_age, the native window knows
+    // the age of the buffer EGL has dequeued as well
+    m_eglBufferAge = supportsBufferAge();
+    if (!m_eglBufferAge && qgetenv("KWIN_USE_BUFFER_AGE") != "0") {
+        setSupportsBufferAge(true);
+    }
+    if (!supportsSwapBuffersWithDamage()) {
+        m_swapBuffersWithDamageKHR = hasExtension(QByteArrayLiteral("EGL_KHR_swap_buffers_with_damage"));
+    }
+
     initWayland();
 }
 
@@ -137,16 +148,66 @@ QRegion EglHwcomposerBackend::beginFrame(AbstractOutput *output)
 {
     Q_UNUSED(output)
     makeContextCurrent();
-    return m_damageJournal.accumulate(0, screens()->geometry());
-
+    if (supportsBufferAge()) {
+        if (!m_eglBufferAge) {
+            // drivers that dequeue the buffer only once they render to it get full repaints
+            m_bufferAge = m_nativeSurface->bufferAge();
+        }
+        return m_damageJournal.accumulate(m_bufferAge, screens()->geometry());
+    }
+    return screens()->geometry();
 }
 
 void EglHwcomposerBackend::endFrame(AbstractOutput *output, const QRegion &renderedRegion, const QRegion &damagedRegion)
 {
     Q_UNUSED(output)
-    Q_UNUSED(damagedRegion)
-    eglSwapBuffers(eglDisplay(), surface());
-    m_damageJournal.add(renderedRegion);
+    Q_UNUSED(renderedRegion)
+    const QRegion damage = damagedRegion.intersected(screens()->geometry());
+    presentFrame(damage);
+
+    if (supportsBufferAge()) {
+        m_damageJournal.add(damage);
+        if (m_eglBufferAge) {
+            eglQuerySurface(eglDisplay(), surface(), EGL_BUFFER_AGE_EXT, &m_bufferAge);
+        }
+    }
+}
+
+static QVector<EGLint> regionToRects(const QRegion &region, int height, int scale)
+{
+    QVector<EGLint> rects;
+    rects.reserve(region.rectCount() * 4);
+    for (const QRect &rect : region) {
+        // the damage is in logical pixels, the surface in device pixels
+        rects << rect.left() * scale;
+        rects << height - (rect.y() + rect.height()) * scale;
+        rects << rect.width() * scale;
+        rects << rect.height() * scale;
+    }
+    return rects;
+}
+
+void EglHwcomposerBackend::presentFrame(const QRegion &damage)
+{
+    if (damage.isEmpty() || (!supportsSwapBuffersWithDamage() && !m_swapBuffersWithDamageKHR)) {
+        if (!eglSwapBuffers(eglDisplay(), surface())) {
+            qCCritical(KWIN_HWCOMPOSER, "eglSwapBuffers() failed: %x", eglGetError());
+            m_damageJournal.clear();
+        }
+        return;
+    }
+
+    QVector<EGLint> rects = regionToRects(damage, m_backend->size().height(), m_backend->scale());
+    EGLBoolean result;
+    if (supportsSwapBuffersWithDamage()) {
+        result = eglSwapBuffersWithDamageEXT(eglDisplay(), surface(), rects.data(), rects.count() / 4);
+    } else {
+        result = eglSwapBuffersWithDamageKHR(eglDisplay(), surface(), rects.data(), rects.count() / 4);
+    }
+    if (!result) {
+        qCCritical(KWIN_HWCOMPOSER, "eglSwapBuffersWithDamage() failed: %x", eglGetError());
+        m_damageJournal.clear();
+    }
 }
 
 SurfaceTexture *EglHwcomposerBackend::createSurfaceTextureInternal(SurfacePixmapInternal *pixmap)
@@ -35,9 +35,13 @@ private:
     bool initRenderingContext();
     bool initBufferConfigs();
     bool makeContextCurrent();
+    void presentFrame(const QRegion &damage);
     HwcomposerBackend *m_backend;
     HwcomposerWindow *m_nativeSurface = nullptr;
     DamageJournal m_damageJournal;
+    int m_bufferAge = 0;
+    bool m_eglBufferAge = false;
+    bool m_swapBuffersWithDamageKHR = false;
 };
 
 }
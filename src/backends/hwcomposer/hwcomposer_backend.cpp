@@ -47,7 +47,7 @@ using namespace KWaylandServer;
 namespace KWin {
 
 BacklightInputEventFilter::BacklightInputEventFilter(HwcomposerBackend *backend)
-    : InputEventFilter()
+    : InputEventFilter(PointerEvents | WheelEvents | KeyEvents | TouchEvents)
     , m_backend(backend)
 {
 }
@@ -436,7 +436,7 @@ void HwcomposerBackend::wakeVSync()
 HwcomposerWindow::HwcomposerWindow(HwcomposerBackend *backend) //! [dba debug: 2021-06-18]
     : HWComposerNativeWindow( backend->size().width(),  backend->size().height(), HAL_PIXEL_FORMAT_RGBA_8888), m_backend(backend)
 {
-    setBufferCount(3);
+    setBufferCount(bufferCount);
     m_hwc2_primary_display = m_backend->hwc2_display();
     hwc2_compat_layer_t *layer = hwc2_compat_display_create_layer(m_hwc2_primary_display);
     hwc2_compat_layer_set_composition_type(layer, HWC2_COMPOSITION_CLIENT);
@@ -455,8 +455,25 @@ HwcomposerWindow::~HwcomposerWindow()
     }
 }
 
+int HwcomposerWindow::bufferAge() const
+{
+    return m_bufferTracker.bufferAge();
+}
+
+int HwcomposerWindow::dequeueBuffer(BaseNativeWindowBuffer **buffer, int *fenceFd)
+{
+    const int result = HWComposerNativeWindow::dequeueBuffer(buffer, fenceFd);
+    if (result == 0) {
+        m_bufferTracker.bufferDequeued(*buffer);
+    }
+    return result;
+}
+
 void HwcomposerWindow::present(HWComposerNativeWindowBuffer *buffer)
 {
+    // The buffer holds the new frame even if the display rejects it below
+    m_bufferTracker.bufferPresented(static_cast<BaseNativeWindowBuffer *>(buffer));
+
     uint32_t numTypes = 0;
     uint32_t numRequests = 0;
     int displayId = 0;
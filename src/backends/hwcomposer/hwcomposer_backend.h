@@ -10,6 +10,7 @@
 #define KWIN_HWCOMPOSER_BACKEND_H
 #include "platform.h"
 #include "abstract_wayland_output.h"
+#include "hwcomposer_buffer_tracker.h"
 #include "input.h"
 #include "backends/libinput/libinputbackend.h"
 
@@ -159,10 +160,22 @@ public:
     virtual ~HwcomposerWindow();
     void present(HWComposerNativeWindowBuffer *buffer) override;
 
+    /**
+     * The age of the buffer that EGL renders into, see EGL_EXT_buffer_age. It's @c 0 if
+     * EGL hasn't dequeued a buffer since the last frame was presented.
+     */
+    int bufferAge() const;
+
+    static constexpr int bufferCount = 3;
+
+protected:
+    int dequeueBuffer(BaseNativeWindowBuffer **buffer, int *fenceFd) override;
+
 private:
     friend HwcomposerBackend;
     HwcomposerWindow(HwcomposerBackend *backend);
     HwcomposerBackend *m_backend;
+    HwcomposerBufferTracker m_bufferTracker{bufferCount};
     int lastPresentFence = -1;
 
     hwc2_compat_display_t *m_hwc2_primary_display = nullptr;
@@ -0,0 +1,68 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2026 KWin contributors
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+#include "hwcomposer_buffer_tracker.h"
+
+namespace KWin
+{
+
+HwcomposerBufferTracker::HwcomposerBufferTracker(int bufferCount)
+    : m_bufferCount(bufferCount)
+{
+    m_buffers.reserve(bufferCount);
+}
+
+int HwcomposerBufferTracker::bufferCount() const
+{
+    return m_bufferCount;
+}
+
+void HwcomposerBufferTracker::bufferDequeued(const void *buffer)
+{
+    m_dequeuedBuffer = buffer;
+}
+
+void HwcomposerBufferTracker::bufferPresented(const void *buffer)
+{
+    m_frame++;
+    m_dequeuedBuffer = nullptr;
+    for (int i = 0; i < m_buffers.count(); ++i) {
+        if (m_buffers[i].first == buffer) {
+            m_buffers.remove(i);
+            break;
+        }
+    }
+    if (m_buffers.count() == m_bufferCount) {
+        // more buffers than announced, forget the one that has been presented least recently
+        m_buffers.removeFirst();
+    }
+    m_buffers.append(qMakePair(buffer, m_frame));
+}
+
+int HwcomposerBufferTracker::bufferAge() const
+{
+    if (!m_dequeuedBuffer) {
+        return 0;
+    }
+    for (const auto &presented : m_buffers) {
+        if (presented.first == m_dequeuedBuffer) {
+            return int(m_frame - presented.second + 1);
+        }
+    }
+    // a buffer that has never been presented
+    return 0;
+}
+
+void HwcomposerBufferTracker::reset()
+{
+    m_frame = 0;
+    m_dequeuedBuffer = nullptr;
+    m_buffers.clear();
+}
+
+} // namespace KWin
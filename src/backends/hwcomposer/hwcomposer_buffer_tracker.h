@@ -0,0 +1,64 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2026 KWin contributors
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+#ifndef KWIN_HWCOMPOSER_BUFFER_TRACKER_H
+#define KWIN_HWCOMPOSER_BUFFER_TRACKER_H
+
+#include <QPair>
+#include <QVector>
+
+namespace KWin
+{
+
+/**
+ * The HwcomposerBufferTracker class computes the buffer age for a native window that
+ * reports which buffer it hands out to EGL and which buffer it presents, like the libhybris
+ * HWComposerNativeWindow. It makes no assumption about the order of the buffer queue.
+ *
+ * The buffer age follows the semantics of EGL_EXT_buffer_age: @c 0 if the contents of the
+ * back buffer are undefined, @c 1 if it holds the previous frame, and so on.
+ */
+class HwcomposerBufferTracker
+{
+public:
+    explicit HwcomposerBufferTracker(int bufferCount = 3);
+
+    int bufferCount() const;
+
+    /**
+     * Records that @a buffer has been handed out to be rendered into.
+     */
+    void bufferDequeued(const void *buffer);
+
+    /**
+     * Records that @a buffer holds the frame that is being presented.
+     */
+    void bufferPresented(const void *buffer);
+
+    /**
+     * Returns the age of the buffer that has been dequeued last, or @c 0 if no buffer has
+     * been dequeued since the last frame was presented.
+     */
+    int bufferAge() const;
+
+    /**
+     * Forgets all presented buffers, e.g. after the buffers have been reallocated.
+     */
+    void reset();
+
+private:
+    int m_bufferCount;
+    quint64 m_frame = 0;
+    const void *m_dequeuedBuffer = nullptr;
+    // the presented buffers and the frames they hold, least recently presented first
+    QVector<QPair<const void *, quint64>> m_buffers;
+};
+
+} // namespace KWin
+
+#endif
@@ -402,12 +402,16 @@ void Compositor::registerRenderLoop(RenderLoop *renderLoop, AbstractOutput *outp
     Q_ASSERT(!m_renderLoops.contains(renderLoop));
     m_renderLoops.insert(renderLoop, output);
     connect(renderLoop, &RenderLoop::frameRequested, this, &Compositor::handleFrameRequested);
+    if (output) {
+        m_frameStats.insert(renderLoop, new FrameStatsDBusInterface(output, renderLoop));
+    }
 }
 
 void Compositor::unregisterRenderLoop(RenderLoop *renderLoop)
 {
     Q_ASSERT(m_renderLoops.contains(renderLoop));
     m_renderLoops.remove(renderLoop);
+    delete m_frameStats.take(renderLoop);
     disconnect(renderLoop, &RenderLoop::frameRequested, this, &Compositor::handleFrameRequested);
 }
 
@@ -624,6 +628,8 @@ void Compositor::composite(RenderLoop *renderLoop)
 
     const auto &output = m_renderLoops[renderLoop];
     fTraceDuration("Paint (", output ? output->name() : QStringLiteral("screens"), ")");
+    // the render loop tells apart the outputs without formatting the output name
+    fTraceScope("Paint", quintptr(renderLoop));
 
     const auto windows = windowsToRender();
 
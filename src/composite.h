@@ -11,6 +11,7 @@
 
 #include <kwinglobals.h>
 
+#include <QHash>
 #include <QObject>
 #include <QTimer>
 #include <QRegion>
@@ -20,6 +21,7 @@ namespace KWin
 
 class AbstractOutput;
 class CompositorSelectionOwner;
+class FrameStatsDBusInterface;
 class RenderBackend;
 class RenderLoop;
 class Scene;
@@ -143,6 +145,7 @@ private:
     Scene *m_scene = nullptr;
     RenderBackend *m_backend = nullptr;
     QMap<RenderLoop *, AbstractOutput *> m_renderLoops;
+    QHash<RenderLoop *, FrameStatsDBusInterface *> m_frameStats;
 };
 
 class KWIN_EXPORT WaylandCompositor final : public Compositor
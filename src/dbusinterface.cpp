@@ -10,11 +10,13 @@
 // own
 #include "dbusinterface.h"
 #include "compositingadaptor.h"
+#include "framestatsadaptor.h"
 #include "pluginsadaptor.h"
 #include "virtualdesktopmanageradaptor.h"
 
 // kwin
 #include "abstract_client.h"
+#include "abstract_output.h"
 #include "atoms.h"
 #include "composite.h"
 #include "debug_console.h"
@@ -23,6 +25,8 @@
 #include "platform.h"
 #include "pluginmanager.h"
 #include "renderbackend.h"
+#include "renderjournal.h"
+#include "renderloop.h"
 #include "kwinadaptor.h"
 #include "unmanaged.h"
 #include "workspace.h"
@@ -555,4 +559,62 @@ void PluginManagerDBusInterface::UnloadPlugin(const QString &name)
     m_manager->unloadPlugin(name);
 }
 
+FrameStatsDBusInterface::FrameStatsDBusInterface(AbstractOutput *output, RenderLoop *renderLoop)
+    : m_output(output)
+    , m_renderLoop(renderLoop)
+{
+    QString name = output->name();
+    for (QChar &c : name) {
+        if (!(c.isLetterOrNumber() && c.unicode() < 128) && c != QLatin1Char('_')) {
+            c = QLatin1Char('_');
+        }
+    }
+    m_objectPath = QStringLiteral("/FrameStats/") + name;
+
+    new FrameStatsAdaptor(this);
+    QDBusConnection::sessionBus().registerObject(m_objectPath,
+                                                 QStringLiteral("org.kde.KWin.FrameStats"),
+                                                 this);
+}
+
+FrameStatsDBusInterface::~FrameStatsDBusInterface()
+{
+    QDBusConnection::sessionBus().unregisterObject(m_objectPath);
+}
+
+QString FrameStatsDBusInterface::outputName() const
+{
+    return m_output->name();
+}
+
+int FrameStatsDBusInterface::refreshRate() const
+{
+    return m_renderLoop->refreshRate();
+}
+
+qulonglong FrameStatsDBusInterface::presentedFrames() const
+{
+    return m_renderLoop->renderJournal()->presentedFrameCount();
+}
+
+qulonglong FrameStatsDBusInterface::lateFrames() const
+{
+    return m_renderLoop->renderJournal()->lateFrameCount();
+}
+
+qulonglong FrameStatsDBusInterface::missedVblanks() const
+{
+    return m_renderLoop->renderJournal()->missedVblankCount();
+}
+
+qlonglong FrameStatsDBusInterface::RenderTimePercentile(double percentile)
+{
+    return m_renderLoop->renderJournal()->renderTimePercentile(percentile).count();
+}
+
+qlonglong FrameStatsDBusInterface::LatencyPercentile(double percentile)
+{
+    return m_renderLoop->renderJournal()->latencyPercentile(percentile).count();
+}
+
 } // namespace
@@ -18,8 +18,10 @@
 namespace KWin
 {
 
+class AbstractOutput;
 class Compositor;
 class PluginManager;
+class RenderLoop;
 class VirtualDesktopManager;
 
 /**
@@ -295,6 +297,43 @@ private:
     PluginManager *m_manager;
 };
 
+/**
+ * @brief Exports the frame timings of an output on the D-Bus.
+ *
+ * The interface is exported as /FrameStats/<output name>, with characters that are not
+ * allowed in object paths replaced by underscores.
+ */
+class FrameStatsDBusInterface : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.kde.KWin.FrameStats")
+
+    Q_PROPERTY(QString OutputName READ outputName)
+    Q_PROPERTY(int RefreshRate READ refreshRate)
+    Q_PROPERTY(qulonglong PresentedFrames READ presentedFrames)
+    Q_PROPERTY(qulonglong LateFrames READ lateFrames)
+    Q_PROPERTY(qulonglong MissedVblanks READ missedVblanks)
+
+public:
+    FrameStatsDBusInterface(AbstractOutput *output, RenderLoop *renderLoop);
+    ~FrameStatsDBusInterface() override;
+
+    QString outputName() const;
+    int refreshRate() const;
+    qulonglong presentedFrames() const;
+    qulonglong lateFrames() const;
+    qulonglong missedVblanks() const;
+
+public Q_SLOTS:
+    qlonglong RenderTimePercentile(double percentile);
+    qlonglong LatencyPercentile(double percentile);
+
+private:
+    AbstractOutput *m_output;
+    RenderLoop *m_renderLoop;
+    QString m_objectPath;
+};
+
 } // namespace
 
 #endif // KWIN_DBUS_INTERFACE_H
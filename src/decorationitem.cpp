@@ -52,6 +52,16 @@ void DecorationRenderer::invalidate()
     m_imageSizesDirty = true;
 }
 
+void DecorationRenderer::finish()
+{
+}
+
+QPoint DecorationRenderer::texturePosition(Qt::Edge edge) const
+{
+    Q_UNUSED(edge)
+    return QPoint();
+}
+
 QRegion DecorationRenderer::damage() const
 {
     return m_damage;
@@ -142,6 +152,8 @@ DecorationItem::DecorationItem(KDecoration2::Decoration *decoration, AbstractCli
 
     connect(renderer(), &DecorationRenderer::damaged,
             this, &DecorationItem::scheduleRepaint);
+    connect(renderer(), &DecorationRenderer::texturePositionsChanged,
+            this, &DecorationItem::discardQuads);
 
     setSize(window->size());
     handleOutputChanged();
@@ -154,6 +166,7 @@ void DecorationItem::preprocess()
         m_renderer->render(damage);
         m_renderer->resetDamage();
     }
+    m_renderer->finish();
 }
 
 void DecorationItem::handleOutputChanged()
@@ -242,7 +255,6 @@ WindowQuadList DecorationItem::buildQuads() const
 
     QRect left, top, right, bottom;
     const qreal devicePixelRatio = m_renderer->effectiveDevicePixelRatio();
-    const int texturePad = DecorationRenderer::TexturePad;
 
     if (const AbstractClient *client = qobject_cast<const AbstractClient *>(m_window)) {
         client->layoutDecorationRects(left, top, right, bottom);
@@ -250,14 +262,10 @@ WindowQuadList DecorationItem::buildQuads() const
         deleted->layoutDecorationRects(left, top, right, bottom);
     }
 
-    const int topHeight = std::ceil(top.height() * devicePixelRatio);
-    const int bottomHeight = std::ceil(bottom.height() * devicePixelRatio);
-    const int leftWidth = std::ceil(left.width() * devicePixelRatio);
-
-    const QPoint topPosition(0, 0);
-    const QPoint bottomPosition(0, topPosition.y() + topHeight + (2 * texturePad));
-    const QPoint leftPosition(0, bottomPosition.y() + bottomHeight + (2 * texturePad));
-    const QPoint rightPosition(0, leftPosition.y() + leftWidth + (2 * texturePad));
+    const QPoint topPosition = m_renderer->texturePosition(Qt::TopEdge);
+    const QPoint bottomPosition = m_renderer->texturePosition(Qt::BottomEdge);
+    const QPoint leftPosition = m_renderer->texturePosition(Qt::LeftEdge);
+    const QPoint rightPosition = m_renderer->texturePosition(Qt::RightEdge);
 
     WindowQuadList list;
     if (left.isValid()) {
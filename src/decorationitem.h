@@ -33,6 +33,18 @@ public:
     virtual void render(const QRegion &region) = 0;
     void invalidate();
 
+    /**
+     * Called right before the decoration is painted. Renderers that rasterise the decoration
+     * asynchronously make finished results visible here. The default implementation does nothing.
+     */
+    virtual void finish();
+
+    /**
+     * Returns the position of the padded decoration part at the given @a edge in the texture.
+     * The default implementation returns a null point, for renderers that don't use textures.
+     */
+    virtual QPoint texturePosition(Qt::Edge edge) const;
+
     // TODO: Move damage tracking inside DecorationItem.
     QRegion damage() const;
     void addDamage(const QRegion &region);
@@ -47,6 +59,7 @@ public:
 
 Q_SIGNALS:
     void damaged(const QRegion &region);
+    void texturePositionsChanged();
 
 protected:
     explicit DecorationRenderer(Decoration::DecoratedClientImpl *client);
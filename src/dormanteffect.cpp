@@ -0,0 +1,460 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2026 KWin contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "dormanteffect.h"
+#include "input.h"
+#include "screenedge.h"
+#include "utils/common.h"
+
+#include <kwineffects.h>
+
+#include <KConfigGroup>
+#include <KGlobalAccel>
+#include <KLocalizedString>
+
+#include <QAction>
+#include <QDBusConnection>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
+#include <QDBusVirtualObject>
+#include <QJsonArray>
+#include <QJsonObject>
+
+#include <limits>
+
+namespace KWin
+{
+
+/**
+ * Receives the calls to the DBus object of a dormant effect until the real effect has been
+ * loaded and registered its own object.
+ */
+class DormantDBusObject : public QDBusVirtualObject
+{
+public:
+    DormantDBusObject(DormantEffect *effect, const QString &path)
+        : QDBusVirtualObject(effect)
+        , m_effect(effect)
+        , m_path(path)
+    {
+    }
+
+    QString path() const
+    {
+        return m_path;
+    }
+
+    QString introspect(const QString &path) const override
+    {
+        Q_UNUSED(path)
+        return QString();
+    }
+
+    bool handleMessage(const QDBusMessage &message, const QDBusConnection &connection) override
+    {
+        Q_UNUSED(connection)
+        if (message.type() != QDBusMessage::MethodCallMessage) {
+            return false;
+        }
+        // Browsing the bus must not load the effect.
+        if (message.interface() == QLatin1String("org.freedesktop.DBus.Introspectable")) {
+            return false;
+        }
+        DormantEffect::Trigger trigger;
+        trigger.type = DormantEffect::Trigger::Type::DBusCall;
+        trigger.message = message;
+        m_effect->addTrigger(trigger);
+        return true;
+    }
+
+private:
+    DormantEffect *m_effect;
+    QString m_path;
+};
+
+static const QString s_translationDomain = QStringLiteral("kwin_effects");
+static const QString s_forwardingConnection = QStringLiteral("kwin_dormant_effects");
+
+static std::optional<SwipeDirection> swipeDirectionFromString(const QString &direction)
+{
+    if (direction == QLatin1String("up")) {
+        return SwipeDirection::Up;
+    } else if (direction == QLatin1String("down")) {
+        return SwipeDirection::Down;
+    } else if (direction == QLatin1String("left")) {
+        return SwipeDirection::Left;
+    } else if (direction == QLatin1String("right")) {
+        return SwipeDirection::Right;
+    }
+    return std::nullopt;
+}
+
+static std::optional<PointerAxisDirection> axisDirectionFromString(const QString &direction)
+{
+    if (direction == QLatin1String("up")) {
+        return PointerAxisUp;
+    } else if (direction == QLatin1String("down")) {
+        return PointerAxisDown;
+    } else if (direction == QLatin1String("left")) {
+        return PointerAxisLeft;
+    } else if (direction == QLatin1String("right")) {
+        return PointerAxisRight;
+    }
+    return std::nullopt;
+}
+
+static Qt::KeyboardModifiers modifiersFromString(const QString &modifiers)
+{
+    // QKeySequence can't hold modifiers without a key, so parse them with a placeholder key.
+    const QKeySequence sequence = QKeySequence::fromString(modifiers + QLatin1String("+A"), QKeySequence::PortableText);
+    if (sequence.isEmpty()) {
+        return Qt::NoModifier;
+    }
+    return Qt::KeyboardModifiers(sequence[0] & Qt::KeyboardModifierMask);
+}
+
+static NET::WindowType windowTypeFromString(const QString &type)
+{
+    static const QHash<QString, NET::WindowType> types{
+        {QStringLiteral("Normal"), NET::Normal},
+        {QStringLiteral("Desktop"), NET::Desktop},
+        {QStringLiteral("Dock"), NET::Dock},
+        {QStringLiteral("Toolbar"), NET::Toolbar},
+        {QStringLiteral("Menu"), NET::Menu},
+        {QStringLiteral("Dialog"), NET::Dialog},
+        {QStringLiteral("Utility"), NET::Utility},
+        {QStringLiteral("Splash"), NET::Splash},
+        {QStringLiteral("DropdownMenu"), NET::DropdownMenu},
+        {QStringLiteral("PopupMenu"), NET::PopupMenu},
+        {QStringLiteral("Tooltip"), NET::Tooltip},
+        {QStringLiteral("Notification"), NET::Notification},
+        {QStringLiteral("ComboBox"), NET::ComboBox},
+        {QStringLiteral("DNDIcon"), NET::DNDIcon},
+        {QStringLiteral("OnScreenDisplay"), NET::OnScreenDisplay},
+        {QStringLiteral("CriticalNotification"), NET::CriticalNotification},
+    };
+    return types.value(type, NET::Unknown);
+}
+
+static QList<int> intListFromJson(const QJsonArray &array)
+{
+    QList<int> list;
+    for (const QJsonValue &value : array) {
+        list.append(value.toInt());
+    }
+    return list;
+}
+
+EffectActivation EffectActivation::fromMetaData(const KPluginMetaData &metaData)
+{
+    const QJsonObject object = metaData.rawData()
+                                   .value(QLatin1String("org.kde.kwin.effect")).toObject()
+                                   .value(QLatin1String("activation")).toObject();
+
+    EffectActivation activation;
+    activation.configGroup = object.value(QLatin1String("configGroup")).toString();
+
+    const QJsonArray shortcuts = object.value(QLatin1String("shortcuts")).toArray();
+    for (const QJsonValue &value : shortcuts) {
+        const QJsonObject shortcutObject = value.toObject();
+        Shortcut shortcut;
+        shortcut.name = shortcutObject.value(QLatin1String("name")).toString();
+        if (shortcut.name.isEmpty()) {
+            qCWarning(KWIN_CORE) << "Ignoring an unnamed shortcut in the activation of" << metaData.pluginId();
+            continue;
+        }
+        shortcut.text = shortcutObject.value(QLatin1String("text")).toString();
+        const QJsonArray defaultShortcuts = shortcutObject.value(QLatin1String("default")).toArray();
+        for (const QJsonValue &sequence : defaultShortcuts) {
+            shortcut.defaultShortcuts.append(QKeySequence::fromString(sequence.toString(), QKeySequence::PortableText));
+        }
+        shortcut.touchBordersKey = shortcutObject.value(QLatin1String("touchBorders")).toString();
+        shortcut.touchpadSwipe = swipeDirectionFromString(shortcutObject.value(QLatin1String("touchpadSwipe")).toString());
+        const QJsonObject axis = shortcutObject.value(QLatin1String("axis")).toObject();
+        if (!axis.isEmpty()) {
+            shortcut.axis = axisDirectionFromString(axis.value(QLatin1String("direction")).toString());
+            shortcut.axisModifiers = modifiersFromString(axis.value(QLatin1String("modifiers")).toString());
+        }
+        activation.shortcuts.append(shortcut);
+    }
+
+    const QJsonArray screenEdges = object.value(QLatin1String("screenEdges")).toArray();
+    for (const QJsonValue &value : screenEdges) {
+        const QJsonObject edgeObject = value.toObject();
+        ScreenEdge edge;
+        edge.key = edgeObject.value(QLatin1String("key")).toString();
+        edge.defaultBorders = intListFromJson(edgeObject.value(QLatin1String("default")).toArray());
+        if (!edge.key.isEmpty()) {
+            activation.screenEdges.append(edge);
+        }
+    }
+
+    const QJsonArray dbusObjects = object.value(QLatin1String("dbus")).toArray();
+    for (const QJsonValue &value : dbusObjects) {
+        const QJsonObject dbusObject = value.toObject();
+        DBusObject dbus;
+        dbus.service = dbusObject.value(QLatin1String("service")).toString();
+        dbus.path = dbusObject.value(QLatin1String("path")).toString();
+        if (!dbus.path.isEmpty()) {
+            activation.dbusObjects.append(dbus);
+        }
+    }
+
+    const QJsonArray windowTypes = object.value(QLatin1String("windowTypes")).toArray();
+    for (const QJsonValue &value : windowTypes) {
+        const NET::WindowType type = windowTypeFromString(value.toString());
+        if (type == NET::Unknown) {
+            qCWarning(KWIN_CORE) << "Unknown window type" << value.toString() << "in the activation of" << metaData.pluginId();
+            continue;
+        }
+        activation.windowTypes.append(type);
+    }
+
+    activation.inactiveConfig = object.value(QLatin1String("inactiveConfig")).toObject().toVariantMap();
+
+    return activation;
+}
+
+bool EffectActivation::isValid() const
+{
+    return !shortcuts.isEmpty() || !screenEdges.isEmpty() || !dbusObjects.isEmpty() || !windowTypes.isEmpty();
+}
+
+bool EffectActivation::isInactive(const KSharedConfig::Ptr &config) const
+{
+    if (inactiveConfig.isEmpty()) {
+        return true;
+    }
+    const KConfigGroup group(config, configGroup);
+    for (auto it = inactiveConfig.constBegin(); it != inactiveConfig.constEnd(); ++it) {
+        if (group.readEntry(it.key().toUtf8().constData(), it.value()) != it.value()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+DormantEffect::DormantEffect(const KPluginMetaData &metaData, LoadEffectFlags flags,
+                             const EffectActivation &activation, const KSharedConfig::Ptr &config,
+                             QObject *parent)
+    : QObject(parent)
+    , m_metaData(metaData)
+    , m_flags(flags)
+    , m_activation(activation)
+    , m_config(config)
+{
+    for (const EffectActivation::Shortcut &shortcut : qAsConst(m_activation.shortcuts)) {
+        QAction *action = new QAction(this);
+        action->setObjectName(shortcut.name);
+        if (!shortcut.text.isEmpty()) {
+            action->setText(i18nd(s_translationDomain.toUtf8().constData(), shortcut.text.toUtf8().constData()));
+        }
+        KGlobalAccel::self()->setDefaultShortcut(action, shortcut.defaultShortcuts);
+        KGlobalAccel::self()->setShortcut(action, shortcut.defaultShortcuts);
+        input()->registerShortcut(shortcut.defaultShortcuts.value(0), action);
+        if (shortcut.axis) {
+            input()->registerAxisShortcut(shortcut.axisModifiers, *shortcut.axis, action);
+        }
+        if (shortcut.touchpadSwipe) {
+            input()->registerTouchpadSwipeShortcut(*shortcut.touchpadSwipe, action);
+        }
+        connect(action, &QAction::triggered, this, [this, action]() {
+            Trigger trigger;
+            trigger.type = Trigger::Type::Action;
+            trigger.action = action->objectName();
+            addTrigger(trigger);
+        });
+        m_actions.append(action);
+    }
+
+    for (const EffectActivation::DBusObject &object : qAsConst(m_activation.dbusObjects)) {
+        DormantDBusObject *dbusObject = new DormantDBusObject(this, object.path);
+        if (!QDBusConnection::sessionBus().registerVirtualObject(object.path, dbusObject)) {
+            qCWarning(KWIN_CORE) << "Failed to register" << object.path << "for" << name();
+            delete dbusObject;
+            continue;
+        }
+        if (!object.service.isEmpty()) {
+            QDBusConnection::sessionBus().registerService(object.service);
+        }
+        m_dbusObjects.append(dbusObject);
+    }
+
+    reserveBorders();
+}
+
+DormantEffect::~DormantEffect()
+{
+    unreserveBorders();
+    for (DormantDBusObject *object : qAsConst(m_dbusObjects)) {
+        QDBusConnection::sessionBus().unregisterObject(object->path());
+    }
+    // The actions must be gone before the real effect registers its own actions with the same
+    // names, deleting them later would make KGlobalAccel forget about the new ones.
+    qDeleteAll(m_actions);
+}
+
+QString DormantEffect::name() const
+{
+    return m_metaData.pluginId();
+}
+
+KPluginMetaData DormantEffect::metaData() const
+{
+    return m_metaData;
+}
+
+LoadEffectFlags DormantEffect::flags() const
+{
+    return m_flags;
+}
+
+const EffectActivation &DormantEffect::activation() const
+{
+    return m_activation;
+}
+
+void DormantEffect::reconfigure()
+{
+    unreserveBorders();
+    reserveBorders();
+}
+
+bool DormantEffect::isActivatedBy(EffectWindow *window) const
+{
+    return m_activation.windowTypes.contains(window->windowType());
+}
+
+QVector<DormantEffect::Trigger> DormantEffect::takeTriggers()
+{
+    return std::exchange(m_triggers, QVector<Trigger>());
+}
+
+void DormantEffect::unregisterServices()
+{
+    for (const EffectActivation::DBusObject &object : qAsConst(m_activation.dbusObjects)) {
+        if (!object.service.isEmpty()) {
+            QDBusConnection::sessionBus().unregisterService(object.service);
+        }
+    }
+}
+
+bool DormantEffect::borderActivated(ElectricBorder border)
+{
+    Trigger trigger;
+    trigger.type = Trigger::Type::ScreenEdge;
+    trigger.border = border;
+    addTrigger(trigger);
+    return true;
+}
+
+void DormantEffect::addTrigger(const Trigger &trigger)
+{
+    m_triggers.append(trigger);
+    if (m_triggers.count() == 1) {
+        Q_EMIT activationRequested(name());
+    }
+}
+
+QList<int> DormantEffect::readBorders(const QString &key, const QList<int> &defaultBorders) const
+{
+    const KConfigGroup group(m_config, m_activation.configGroup);
+    return group.readEntry(key.toUtf8().constData(), defaultBorders);
+}
+
+void DormantEffect::reserveBorders()
+{
+    for (const EffectActivation::ScreenEdge &edge : qAsConst(m_activation.screenEdges)) {
+        const QList<int> borders = readBorders(edge.key, edge.defaultBorders);
+        for (int border : borders) {
+            if (border < 0 || border >= ELECTRIC_COUNT) {
+                continue;
+            }
+            m_reservedBorders.append(ElectricBorder(border));
+            ScreenEdges::self()->reserve(ElectricBorder(border), this, "borderActivated");
+        }
+    }
+
+    // Touch screen edges are handled like the effects do, only the sides can be used.
+    static const QVector<ElectricBorder> relevantBorders{ElectricLeft, ElectricTop, ElectricRight, ElectricBottom};
+    for (int i = 0; i < m_activation.shortcuts.count(); ++i) {
+        const EffectActivation::Shortcut &shortcut = m_activation.shortcuts[i];
+        if (shortcut.touchBordersKey.isEmpty()) {
+            continue;
+        }
+        const QList<int> borders = readBorders(shortcut.touchBordersKey, {});
+        for (int border : borders) {
+            if (!relevantBorders.contains(ElectricBorder(border))) {
+                continue;
+            }
+            m_touchBorders.append(qMakePair(ElectricBorder(border), m_actions[i]));
+            ScreenEdges::self()->reserveTouch(ElectricBorder(border), m_actions[i]);
+        }
+    }
+}
+
+void DormantEffect::unreserveBorders()
+{
+    for (ElectricBorder border : qAsConst(m_reservedBorders)) {
+        ScreenEdges::self()->unreserve(border, this);
+    }
+    m_reservedBorders.clear();
+
+    for (const auto &touchBorder : qAsConst(m_touchBorders)) {
+        ScreenEdges::self()->unreserveTouch(touchBorder.first, touchBorder.second);
+    }
+    m_touchBorders.clear();
+}
+
+void DormantEffect::replayTriggers(const QVector<Trigger> &triggers, Effect *effect, QObject *context)
+{
+    for (const Trigger &trigger : triggers) {
+        switch (trigger.type) {
+        case Trigger::Type::Action:
+            if (QAction *action = effect->findChild<QAction *>(trigger.action)) {
+                action->trigger();
+            } else {
+                qCWarning(KWIN_CORE) << "Effect has no action" << trigger.action;
+            }
+            break;
+        case Trigger::Type::ScreenEdge:
+            effect->borderActivated(trigger.border);
+            break;
+        case Trigger::Type::DBusCall: {
+            // The caller is waiting for a reply from us, so the call is passed on to the object
+            // of the effect and its reply is relayed back. The call goes through a connection of
+            // its own, QtDBus delivers calls to objects of the same connection locally and those
+            // can't be answered with a delayed reply.
+            const QDBusMessage &message = trigger.message;
+            QDBusMessage call = QDBusMessage::createMethodCall(QDBusConnection::sessionBus().baseService(), message.path(),
+                                                               message.interface(), message.member());
+            call.setArguments(message.arguments());
+            QDBusConnection connection = QDBusConnection::connectToBus(QDBusConnection::SessionBus, s_forwardingConnection);
+            // Calls like picking a color wait for the user, the caller's timeout applies instead.
+            const QDBusPendingCall pendingCall = connection.asyncCall(call, std::numeric_limits<int>::max());
+            QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(pendingCall, context);
+            QObject::connect(watcher, &QDBusPendingCallWatcher::finished, context, [message](QDBusPendingCallWatcher *watcher) {
+                watcher->deleteLater();
+                if (!message.isReplyRequired()) {
+                    return;
+                }
+                const QDBusMessage reply = watcher->reply();
+                if (reply.type() == QDBusMessage::ErrorMessage) {
+                    QDBusConnection::sessionBus().send(message.createErrorReply(reply.errorName(), reply.errorMessage()));
+                } else {
+                    QDBusConnection::sessionBus().send(message.createReply(reply.arguments()));
+                }
+            });
+            break;
+        }
+        }
+    }
+}
+
+} // namespace KWin
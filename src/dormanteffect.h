@@ -0,0 +1,194 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2026 KWin contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "effectloader.h"
+
+#include <kwinglobals.h>
+
+#include <KPluginMetaData>
+#include <NETWM>
+
+#include <QDBusMessage>
+#include <QKeySequence>
+#include <QObject>
+#include <QVariantMap>
+#include <QVector>
+
+#include <optional>
+#include <utility>
+
+class QAction;
+
+namespace KWin
+{
+class DormantDBusObject;
+class EffectWindow;
+
+/**
+ * The EffectActivation class describes what activates an effect that is loaded on demand.
+ *
+ * The triggers are read from the "activation" object in the "org.kde.kwin.effect" section of
+ * the metadata of the effect, for example
+ *
+ * @code
+ * "activation": {
+ *     "configGroup": "Effect-DesktopGrid",
+ *     "shortcuts": [
+ *         { "name": "ShowDesktopGrid", "text": "Show Desktop Grid", "default": ["Ctrl+F8"],
+ *           "touchBorders": "TouchBorderActivate", "touchpadSwipe": "up" }
+ *     ],
+ *     "screenEdges": [ { "key": "BorderActivate" } ],
+ *     "dbus": [ { "service": "org.kde.KWin.Foo", "path": "/org/kde/KWin/Foo" } ],
+ *     "windowTypes": [ "Dialog" ],
+ *     "inactiveConfig": { "InitialZoom": 1.0 }
+ * }
+ * @endcode
+ *
+ * Shortcuts name the actions of the effect. The config group is the one the effect reads its
+ * screen edges from, and the effect is only loaded on demand while the entries in inactiveConfig
+ * have the given values.
+ */
+class EffectActivation
+{
+public:
+    struct Shortcut
+    {
+        QString name;
+        QString text;
+        QList<QKeySequence> defaultShortcuts;
+        QString touchBordersKey;
+        std::optional<SwipeDirection> touchpadSwipe;
+        std::optional<PointerAxisDirection> axis;
+        Qt::KeyboardModifiers axisModifiers;
+    };
+
+    struct ScreenEdge
+    {
+        QString key;
+        QList<int> defaultBorders;
+    };
+
+    struct DBusObject
+    {
+        QString service;
+        QString path;
+    };
+
+    static EffectActivation fromMetaData(const KPluginMetaData &metaData);
+
+    /**
+     * Returns @c true if the effect declares at least one trigger.
+     */
+    bool isValid() const;
+
+    /**
+     * Returns @c true if the configuration of the effect in @a config doesn't require the
+     * effect to be loaded right away.
+     */
+    bool isInactive(const KSharedConfig::Ptr &config) const;
+
+    QString configGroup;
+    QVector<Shortcut> shortcuts;
+    QVector<ScreenEdge> screenEdges;
+    QVector<DBusObject> dbusObjects;
+    QVector<NET::WindowType> windowTypes;
+    QVariantMap inactiveConfig;
+};
+
+/**
+ * The DormantEffect class stands in for an enabled effect until one of its triggers fires.
+ *
+ * It registers the shortcuts, screen edges and DBus objects of the effect, but nothing else,
+ * so an effect that is never used costs neither GPU memory nor a place in the effect chain.
+ * Once a trigger fires, activationRequested() is emitted. The loader then destroys the dormant
+ * effect, creates the real one and replays the triggers on it.
+ */
+class DormantEffect : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Trigger
+    {
+        enum class Type {
+            Action,
+            ScreenEdge,
+            DBusCall,
+        };
+        Type type;
+        QString action;
+        ElectricBorder border = ElectricNone;
+        QDBusMessage message;
+    };
+
+    DormantEffect(const KPluginMetaData &metaData, LoadEffectFlags flags,
+                  const EffectActivation &activation, const KSharedConfig::Ptr &config,
+                  QObject *parent = nullptr);
+    ~DormantEffect() override;
+
+    QString name() const;
+    KPluginMetaData metaData() const;
+    LoadEffectFlags flags() const;
+    const EffectActivation &activation() const;
+
+    /**
+     * Reserves the screen edges again after the configuration of the effect has changed.
+     */
+    void reconfigure();
+
+    /**
+     * Returns @c true if adding @a window has to activate the effect.
+     */
+    bool isActivatedBy(EffectWindow *window) const;
+
+    /**
+     * Returns the triggers that fired since the effect became dormant.
+     */
+    QVector<Trigger> takeTriggers();
+
+    /**
+     * Hands the @a triggers over to @a effect, which has been created in their response.
+     * DBus replies are relayed by objects parented to @a context.
+     */
+    static void replayTriggers(const QVector<Trigger> &triggers, Effect *effect, QObject *context);
+
+    /**
+     * Unregisters the service names of the effect. They are kept while the effect is activated
+     * because the real effect registers them again.
+     */
+    void unregisterServices();
+
+public Q_SLOTS:
+    bool borderActivated(ElectricBorder border);
+
+Q_SIGNALS:
+    void activationRequested(const QString &name);
+
+private:
+    void addTrigger(const Trigger &trigger);
+    void reserveBorders();
+    void unreserveBorders();
+    QList<int> readBorders(const QString &key, const QList<int> &defaultBorders) const;
+
+    KPluginMetaData m_metaData;
+    LoadEffectFlags m_flags;
+    EffectActivation m_activation;
+    KSharedConfig::Ptr m_config;
+    QVector<QAction *> m_actions;
+    QVector<DormantDBusObject *> m_dbusObjects;
+    QList<ElectricBorder> m_reservedBorders;
+    QList<QPair<ElectricBorder, QAction *>> m_touchBorders;
+    QVector<Trigger> m_triggers;
+
+    friend class DormantDBusObject;
+};
+
+} // namespace KWin
@@ -21,7 +21,7 @@ namespace KWin
 {
 
 DpmsInputEventFilter::DpmsInputEventFilter()
-    : InputEventFilter()
+    : InputEventFilter(PointerEvents | WheelEvents | KeyEvents | TouchEvents)
 {
     KSharedConfig::Ptr kwinSettings = kwinApp()->config();
     m_enableDoubleTap = kwinSettings->group("Wayland").readEntry<bool>("DoubleTapWakeup", true);
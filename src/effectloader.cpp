@@ -11,8 +11,10 @@
 // KWin
 #include <config-kwin.h>
 #include <kwineffects.h>
+#include "dormanteffect.h"
 #include "plugin.h"
 #include "scripting/scriptedeffect.h"
+#include "startuptimeline.h"
 #include "utils/common.h"
 // KDE
 #include <KConfigGroup>
@@ -22,6 +24,7 @@
 #include <QtConcurrentRun>
 #include <QDebug>
 #include <QFutureWatcher>
+#include <QSharedPointer>
 #include <QStaticPlugin>
 #include <QStringList>
 
@@ -62,6 +65,11 @@ LoadEffectFlags AbstractEffectLoader::readConfig(const QString &effectName, bool
     return LoadEffectFlags();
 }
 
+KSharedConfig::Ptr AbstractEffectLoader::config() const
+{
+    return m_config;
+}
+
 static const QString s_nameProperty = QStringLiteral("X-KDE-PluginInfo-Name");
 static const QString s_jsConstraint = QStringLiteral("[X-Plasma-API] == 'javascript'");
 static const QString s_serviceType = QStringLiteral("KWin/Effect");
@@ -145,12 +153,12 @@ bool ScriptedEffectLoader::loadEffect(const KPluginMetaData &effect, LoadEffectF
 
 void ScriptedEffectLoader::queryAndLoadAll()
 {
-    if (m_queryConnection) {
+    if (m_queryWatcher) {
         return;
     }
     // perform querying for the services in a thread
     QFutureWatcher<QList<KPluginMetaData>> *watcher = new QFutureWatcher<QList<KPluginMetaData>>(this);
-    m_queryConnection = connect(watcher, &QFutureWatcher<QList<KPluginMetaData>>::finished, this,
+    connect(watcher, &QFutureWatcher<QList<KPluginMetaData>>::finished, this,
         [this, watcher]() {
             const auto effects = watcher->result();
             for (const auto &effect : effects) {
@@ -160,9 +168,10 @@ void ScriptedEffectLoader::queryAndLoadAll()
                 }
             }
             watcher->deleteLater();
-            m_queryConnection = QMetaObject::Connection();
+            m_queryWatcher = nullptr;
         },
         Qt::QueuedConnection);
+    m_queryWatcher = watcher;
     watcher->setFuture(QtConcurrent::run(this, &ScriptedEffectLoader::findAllEffects));
 }
 
@@ -187,8 +196,12 @@ KPluginMetaData ScriptedEffectLoader::findEffect(const QString &name) const
 
 void ScriptedEffectLoader::clear()
 {
-    disconnect(m_queryConnection);
-    m_queryConnection = QMetaObject::Connection();
+    if (m_queryWatcher) {
+        // the query keeps running, but its result is dropped with the watcher
+        m_queryWatcher->disconnect(this);
+        m_queryWatcher->deleteLater();
+        m_queryWatcher = nullptr;
+    }
     m_queue->clear();
 }
 
@@ -200,6 +213,7 @@ PluginEffectLoader::PluginEffectLoader(QObject *parent)
 
 PluginEffectLoader::~PluginEffectLoader()
 {
+    qDeleteAll(m_dormantEffects);
 }
 
 bool PluginEffectLoader::hasEffect(const QString &name) const
@@ -268,6 +282,9 @@ QStringList PluginEffectLoader::listOfKnownEffects() const
 
 bool PluginEffectLoader::loadEffect(const QString &name)
 {
+    if (m_dormantEffects.contains(name)) {
+        return activateEffect(name) != nullptr;
+    }
     const auto info = findEffect(name);
     if (!info.isValid()) {
         return false;
@@ -276,44 +293,59 @@ bool PluginEffectLoader::loadEffect(const QString &name)
 }
 
 bool PluginEffectLoader::loadEffect(const KPluginMetaData &info, LoadEffectFlags flags)
+{
+    return createEffect(info, flags) != nullptr;
+}
+
+EffectPluginFactory *PluginEffectLoader::checkedFactory(const KPluginMetaData &info, LoadEffectFlags flags) const
 {
     if (!info.isValid()) {
         qCDebug(KWIN_CORE) << "Plugin info is not valid";
-        return false;
+        return nullptr;
     }
     const QString name = info.pluginId();
     if (!flags.testFlag(LoadEffectFlag::Load)) {
         qCDebug(KWIN_CORE) << "Loading flags disable effect: " << name;
-        return false;
+        return nullptr;
     }
-    if (m_loadedEffects.contains(name)) {
+    if (m_loadedEffects.contains(name) || m_dormantEffects.contains(name)) {
         qCDebug(KWIN_CORE) << name << " already loaded";
-        return false;
+        return nullptr;
     }
     EffectPluginFactory *effectFactory = factory(info);
     if (!effectFactory) {
         qCDebug(KWIN_CORE) << "Couldn't get an EffectPluginFactory for: " << name;
-        return false;
+        return nullptr;
     }
 
     effects->makeOpenGLContextCurrent();
     if (!effectFactory->isSupported()) {
         qCDebug(KWIN_CORE) << "Effect is not supported: " << name;
-        return false;
+        return nullptr;
     }
 
     if (flags.testFlag(LoadEffectFlag::CheckDefaultFunction)) {
         if (!effectFactory->enabledByDefault()) {
             qCDebug(KWIN_CORE) << "Enabled by default function disables effect: " << name;
-            return false;
+            return nullptr;
         }
     }
+    return effectFactory;
+}
+
+Effect *PluginEffectLoader::createEffect(const KPluginMetaData &info, LoadEffectFlags flags)
+{
+    EffectPluginFactory *effectFactory = checkedFactory(info, flags);
+    if (!effectFactory) {
+        return nullptr;
+    }
+    const QString name = info.pluginId();
 
     // ok, now we can try to create the Effect
     Effect *e = effectFactory->createEffect();
     if (!e) {
         qCDebug(KWIN_CORE) << "Failed to create effect: " << name;
-        return false;
+        return nullptr;
     }
     // insert in our loaded effects
     m_loadedEffects << name;
@@ -324,18 +356,125 @@ bool PluginEffectLoader::loadEffect(const KPluginMetaData &info, LoadEffectFlags
     );
     qCDebug(KWIN_CORE) << "Successfully loaded plugin effect: " << name;
     Q_EMIT effectLoaded(e, name);
+    return e;
+}
+
+/**
+ * Effects that are only used on demand, e.g. when a shortcut is pressed, are not created
+ * right away. A DormantEffect registers their triggers instead and the effect is created once
+ * one of them fires.
+ */
+bool PluginEffectLoader::deferEffect(const KPluginMetaData &info, LoadEffectFlags flags)
+{
+    if (!KConfigGroup(config(), "Compositing").readEntry("LazyEffectLoading", true)) {
+        return false;
+    }
+
+    const EffectActivation activation = EffectActivation::fromMetaData(info);
+    if (!activation.isValid() || !activation.isInactive(config())) {
+        return false;
+    }
+    if (!checkedFactory(info, flags)) {
+        // The effect can't be loaded, trying again right away won't help.
+        return true;
+    }
+
+    const QString name = info.pluginId();
+    DormantEffect *dormant = new DormantEffect(info, flags, activation, config(), this);
+    connect(dormant, &DormantEffect::activationRequested, this, &PluginEffectLoader::activateEffect, Qt::QueuedConnection);
+    m_dormantEffects.insert(name, dormant);
+    qCDebug(KWIN_CORE) << "Deferred loading plugin effect: " << name;
     return true;
 }
 
-void PluginEffectLoader::queryAndLoadAll()
+bool PluginEffectLoader::isEffectDormant(const QString &name) const
 {
-    const auto effects = findAllEffects();
-    for (const auto &effect : effects) {
-        const LoadEffectFlags flags = readConfig(effect.pluginId(), effect.isEnabledByDefault());
-        if (flags.testFlag(LoadEffectFlag::Load)) {
-            loadEffect(effect, flags);
+    return m_dormantEffects.contains(name);
+}
+
+QStringList PluginEffectLoader::dormantEffects() const
+{
+    return m_dormantEffects.keys();
+}
+
+Effect *PluginEffectLoader::activateEffect(const QString &name)
+{
+    DormantEffect *dormant = m_dormantEffects.take(name);
+    if (!dormant) {
+        return nullptr;
+    }
+    const KPluginMetaData info = dormant->metaData();
+    const LoadEffectFlags flags = dormant->flags();
+    const QVector<DormantEffect::Trigger> triggers = dormant->takeTriggers();
+    delete dormant;
+
+    qCDebug(KWIN_CORE) << "Activating plugin effect: " << name;
+    Effect *effect = createEffect(info, flags);
+    if (effect) {
+        DormantEffect::replayTriggers(triggers, effect, this);
+    }
+    return effect;
+}
+
+void PluginEffectLoader::activateEffectsForWindow(EffectWindow *window)
+{
+    QStringList names;
+    for (DormantEffect *dormant : qAsConst(m_dormantEffects)) {
+        if (dormant->isActivatedBy(window)) {
+            names << dormant->name();
         }
     }
+    for (const QString &name : qAsConst(names)) {
+        activateEffect(name);
+    }
+}
+
+void PluginEffectLoader::unloadDormantEffect(const QString &name)
+{
+    if (DormantEffect *dormant = m_dormantEffects.take(name)) {
+        dormant->unregisterServices();
+        delete dormant;
+    }
+}
+
+void PluginEffectLoader::reconfigureDormantEffect(const QString &name)
+{
+    DormantEffect *dormant = m_dormantEffects.value(name);
+    if (!dormant) {
+        return;
+    }
+    if (!dormant->activation().isInactive(config())) {
+        activateEffect(name);
+    } else {
+        dormant->reconfigure();
+    }
+}
+
+void PluginEffectLoader::queryAndLoadAll()
+{
+    if (m_queryWatcher) {
+        return;
+    }
+    // the phase lasts until the effects are loaded, not just until the query is started
+    auto phase = QSharedPointer<StartupPhase>::create(QStringLiteral("effects"));
+    // reading the metadata of all plugins is slow, query them in a thread
+    QFutureWatcher<QVector<KPluginMetaData>> *watcher = new QFutureWatcher<QVector<KPluginMetaData>>(this);
+    connect(watcher, &QFutureWatcher<QVector<KPluginMetaData>>::finished, this,
+        [this, watcher, phase]() {
+            const auto effects = watcher->result();
+            for (const auto &effect : effects) {
+                const LoadEffectFlags flags = readConfig(effect.pluginId(), effect.isEnabledByDefault());
+                if (flags.testFlag(LoadEffectFlag::Load) && !deferEffect(effect, flags)) {
+                    loadEffect(effect, flags);
+                }
+            }
+            phase->end();
+            watcher->deleteLater();
+            m_queryWatcher = nullptr;
+        },
+        Qt::QueuedConnection);
+    m_queryWatcher = watcher;
+    watcher->setFuture(QtConcurrent::run(this, &PluginEffectLoader::findAllEffects));
 }
 
 QVector<KPluginMetaData> PluginEffectLoader::findAllEffects() const
@@ -350,13 +489,25 @@ void PluginEffectLoader::setPluginSubDirectory(const QString &directory)
 
 void PluginEffectLoader::clear()
 {
+    if (m_queryWatcher) {
+        // the query keeps running, but its result is dropped with the watcher
+        m_queryWatcher->disconnect(this);
+        m_queryWatcher->deleteLater();
+        m_queryWatcher = nullptr;
+    }
+
+    const QStringList dormant = m_dormantEffects.keys();
+    for (const QString &name : dormant) {
+        unloadDormantEffect(name);
+    }
 }
 
 EffectLoader::EffectLoader(QObject *parent)
     : AbstractEffectLoader(parent)
+    , m_pluginLoader(new PluginEffectLoader(this))
 {
     m_loaders << new ScriptedEffectLoader(this)
-              << new PluginEffectLoader(this);
+              << m_pluginLoader;
     for (auto it = m_loaders.constBegin(); it != m_loaders.constEnd(); ++it) {
         connect(*it, &AbstractEffectLoader::effectLoaded, this, &AbstractEffectLoader::effectLoaded);
     }
@@ -423,4 +574,34 @@ void EffectLoader::clear()
     }
 }
 
+bool EffectLoader::isEffectDormant(const QString &name) const
+{
+    return m_pluginLoader->isEffectDormant(name);
+}
+
+QStringList EffectLoader::dormantEffects() const
+{
+    return m_pluginLoader->dormantEffects();
+}
+
+Effect *EffectLoader::activateEffect(const QString &name)
+{
+    return m_pluginLoader->activateEffect(name);
+}
+
+void EffectLoader::activateEffectsForWindow(EffectWindow *window)
+{
+    m_pluginLoader->activateEffectsForWindow(window);
+}
+
+void EffectLoader::unloadDormantEffect(const QString &name)
+{
+    m_pluginLoader->unloadDormantEffect(name);
+}
+
+void EffectLoader::reconfigureDormantEffect(const QString &name)
+{
+    m_pluginLoader->reconfigureDormantEffect(name);
+}
+
 } // namespace KWin
@@ -15,15 +15,20 @@
 // Qt
 #include <QObject>
 #include <QFlags>
+#include <QFutureWatcher>
+#include <QHash>
 #include <QMap>
 #include <QPair>
+#include <QPointer>
 #include <QStaticPlugin>
 #include <QQueue>
 
 namespace KWin
 {
+class DormantEffect;
 class Effect;
 class EffectPluginFactory;
+class EffectWindow;
 
 /**
  * @brief Flags defining how a Loader should load an Effect.
@@ -183,6 +188,8 @@ protected:
      */
     LoadEffectFlags readConfig(const QString &effectName, bool defaultValue) const;
 
+    KSharedConfig::Ptr config() const;
+
 private:
     KSharedConfig::Ptr m_config;
 };
@@ -291,7 +298,7 @@ private:
     KPluginMetaData findEffect(const QString &name) const;
     QStringList m_loadedEffects;
     EffectLoadQueue< ScriptedEffectLoader, KPluginMetaData > *m_queue;
-    QMetaObject::Connection m_queryConnection;
+    QPointer<QFutureWatcherBase> m_queryWatcher;
 };
 
 class PluginEffectLoader : public AbstractEffectLoader
@@ -312,12 +319,35 @@ public:
 
     void setPluginSubDirectory(const QString &directory);
 
+    /**
+     * Returns @c true if the effect @a name is enabled, but waits for one of its triggers to
+     * be loaded.
+     */
+    bool isEffectDormant(const QString &name) const;
+    QStringList dormantEffects() const;
+    /**
+     * Loads the dormant effect @a name and returns it, or @c nullptr if it couldn't be loaded.
+     */
+    Effect *activateEffect(const QString &name);
+    /**
+     * Loads the dormant effects that are triggered by @a window. This has to be called before
+     * the window is announced to the effects.
+     */
+    void activateEffectsForWindow(EffectWindow *window);
+    void unloadDormantEffect(const QString &name);
+    void reconfigureDormantEffect(const QString &name);
+
 private:
     QVector<KPluginMetaData> findAllEffects() const;
     KPluginMetaData findEffect(const QString &name) const;
     EffectPluginFactory *factory(const KPluginMetaData &info) const;
+    EffectPluginFactory *checkedFactory(const KPluginMetaData &info, LoadEffectFlags flags) const;
+    Effect *createEffect(const KPluginMetaData &info, LoadEffectFlags flags);
+    bool deferEffect(const KPluginMetaData &info, LoadEffectFlags flags);
     QStringList m_loadedEffects;
+    QHash<QString, DormantEffect *> m_dormantEffects;
     QString m_pluginSubDirectory;
+    QPointer<QFutureWatcherBase> m_queryWatcher;
 };
 
 class KWIN_EXPORT EffectLoader : public AbstractEffectLoader
@@ -334,8 +364,22 @@ public:
     void setConfig(KSharedConfig::Ptr config) override;
     void clear() override;
 
+    /**
+     * Effects that declare activation triggers in their metadata are not created until one of
+     * their triggers fires, these functions manage such dormant effects.
+     *
+     * @see PluginEffectLoader::isEffectDormant()
+     */
+    bool isEffectDormant(const QString &name) const;
+    QStringList dormantEffects() const;
+    Effect *activateEffect(const QString &name);
+    void activateEffectsForWindow(EffectWindow *window);
+    void unloadDormantEffect(const QString &name);
+    void reconfigureDormantEffect(const QString &name);
+
 private:
     QList<AbstractEffectLoader*> m_loaders;
+    PluginEffectLoader *m_pluginLoader;
 };
 
 }
@@ -171,6 +171,7 @@ EffectsHandlerImpl::EffectsHandlerImpl(Compositor *compositor, Scene *scene)
     connect(ws, &Workspace::internalClientAdded, this,
         [this](InternalClient *client) {
             setupClientConnections(client);
+            m_effectLoader->activateEffectsForWindow(client->effectWindow());
             Q_EMIT windowAdded(client->effectWindow());
         }
     );
@@ -503,6 +504,15 @@ void EffectsHandlerImpl::startPaint()
     m_currentPaintEffectFrameIterator = m_activeEffects.constBegin();
 }
 
+void EffectsHandlerImpl::endPaint()
+{
+    m_activeEffects.clear();
+    m_currentDrawWindowIterator = m_activeEffects.constEnd();
+    m_currentPaintWindowIterator = m_activeEffects.constEnd();
+    m_currentPaintScreenIterator = m_activeEffects.constEnd();
+    m_currentPaintEffectFrameIterator = m_activeEffects.constEnd();
+}
+
 void EffectsHandlerImpl::slotClientMaximized(KWin::AbstractClient *c, MaximizeMode maxMode)
 {
     bool horizontal = false;
@@ -542,6 +552,7 @@ void EffectsHandlerImpl::slotClientShown(KWin::Toplevel *t)
     AbstractClient *c = static_cast<AbstractClient *>(t);
     disconnect(c, &Toplevel::windowShown, this, &EffectsHandlerImpl::slotClientShown);
     setupClientConnections(c);
+    m_effectLoader->activateEffectsForWindow(c->effectWindow());
     Q_EMIT windowAdded(c->effectWindow());
 }
 
@@ -550,6 +561,7 @@ void EffectsHandlerImpl::slotUnmanagedShown(KWin::Toplevel *t)
     Q_ASSERT(qobject_cast<Unmanaged *>(t));
     Unmanaged *u = static_cast<Unmanaged*>(t);
     setupUnmanagedConnections(u);
+    m_effectLoader->activateEffectsForWindow(u->effectWindow());
     Q_EMIT windowAdded(u->effectWindow());
 }
 
@@ -766,6 +778,10 @@ void* EffectsHandlerImpl::getProxy(QString name)
         if ((*it).first == name)
             return (*it).second->proxy();
 
+    // another effect is about to use the dormant one
+    if (Effect *effect = m_effectLoader->activateEffect(name)) {
+        return effect->proxy();
+    }
     return nullptr;
 }
 
@@ -1338,6 +1354,7 @@ QStringList EffectsHandlerImpl::loadedEffects() const
     std::transform(loaded_effects.constBegin(), loaded_effects.constEnd(),
         std::back_inserter(listModules),
         [](const EffectPair &pair) { return pair.first; });
+    listModules << m_effectLoader->dormantEffects();
     return listModules;
 }
 
@@ -1362,6 +1379,10 @@ void EffectsHandlerImpl::unloadEffect(const QString& name)
         }
     );
     if (it == effect_order.end()) {
+        if (m_effectLoader->isEffectDormant(name)) {
+            m_effectLoader->unloadDormantEffect(name);
+            return;
+        }
         qCDebug(KWIN_CORE) << "EffectsHandler::unloadEffect : Effect not loaded :" << name;
         return;
     }
@@ -1405,13 +1426,17 @@ void EffectsHandlerImpl::reconfigureEffect(const QString& name)
             (*it).second->reconfigure(Effect::ReconfigureAll);
             return;
         }
+    if (m_effectLoader->isEffectDormant(name)) {
+        kwinApp()->config()->reparseConfiguration();
+        m_effectLoader->reconfigureDormantEffect(name);
+    }
 }
 
 bool EffectsHandlerImpl::isEffectLoaded(const QString& name) const
 {
     auto it = std::find_if(loaded_effects.constBegin(), loaded_effects.constEnd(),
         [&name](const EffectPair &pair) { return pair.first == name; });
-    return it != loaded_effects.constEnd();
+    return it != loaded_effects.constEnd() || m_effectLoader->isEffectDormant(name);
 }
 
 bool EffectsHandlerImpl::isEffectSupported(const QString &name)
@@ -1490,6 +1515,21 @@ bool EffectsHandlerImpl::blocksDirectScanout() const
     return false;
 }
 
+bool EffectsHandlerImpl::hasActiveEffects() const
+{
+    // The effects that paint the current frame keep doing so until it's done, even if they
+    // are no longer active by then.
+    if (!m_activeEffects.isEmpty()) {
+        return true;
+    }
+    for (const EffectPair &pair : loaded_effects) {
+        if (pair.second->isActive()) {
+            return true;
+        }
+    }
+    return false;
+}
+
 KWaylandServer::Display *EffectsHandlerImpl::waylandDisplay() const
 {
     if (waylandServer()) {
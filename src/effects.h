@@ -184,6 +184,7 @@ public:
 
     // internal (used by kwin core or compositing code)
     void startPaint();
+    void endPaint();
     void grabbedKeyboardEvent(QKeyEvent* e);
     bool hasKeyboardGrab() const;
 
@@ -200,6 +201,12 @@ public:
      */
     bool blocksDirectScanout() const;
 
+    /**
+     * @returns whether any effect takes part in painting. While a frame is painted this covers
+     * the effects that paint it, before a frame is started the effects that will paint it.
+     */
+    bool hasActiveEffects() const;
+
     /**
      * @returns Whether we are currently in a desktop rendering process triggered by paintDesktop hook
      */
@@ -30,6 +30,34 @@ namespace KWin
 
 static const QByteArray s_blurAtomName = QByteArrayLiteral("_KDE_NET_WM_BLUR_BEHIND_REGION");
 
+// the granularity at which cached blurs are updated
+static const int s_cacheTileSize = 64;
+
+static int alignToTile(int value)
+{
+    return std::floor(value / double(s_cacheTileSize)) * s_cacheTileSize;
+}
+
+static QRegion alignToTiles(const QRegion &region)
+{
+    QRegion tiles;
+    for (const QRect &rect : region) {
+        tiles += QRect(QPoint(alignToTile(rect.left()), alignToTile(rect.top())),
+                       QPoint(alignToTile(rect.right()) + s_cacheTileSize - 1,
+                              alignToTile(rect.bottom()) + s_cacheTileSize - 1));
+    }
+    return tiles;
+}
+
+static QRegion grow(const QRegion &region, int margin)
+{
+    QRegion grown;
+    for (const QRect &rect : region) {
+        grown += rect.adjusted(-margin, -margin, margin, margin);
+    }
+    return grown;
+}
+
 KWaylandServer::BlurManagerInterface *BlurEffect::s_blurManager = nullptr;
 QTimer *BlurEffect::s_blurManagerRemoveTimer = nullptr;
 
@@ -114,6 +142,7 @@ bool BlurEffect::renderTargetsValid() const
 
 void BlurEffect::deleteFBOs()
 {
+    m_blurCache.clear();
     qDeleteAll(m_renderTargets);
 
     m_renderTargets.clear();
@@ -339,6 +368,7 @@ void BlurEffect::slotWindowAdded(EffectWindow *w)
 
 void BlurEffect::slotWindowDeleted(EffectWindow *w)
 {
+    m_blurCache.remove(w);
     auto it = windowBlurChangedConnections.find(w);
     if (it == windowBlurChangedConnections.end()) {
         return;
@@ -533,15 +563,48 @@ void BlurEffect::prePaintWindow(EffectWindow* w, WindowPrePaintData& data, std::
     const QRegion blurArea = blurRegion(w).translated(w->pos()) & screen;
     const QRegion expandedBlur = (w->isDock() ? blurArea : expand(blurArea)) & screen;
 
-    // if this window or a window underneath the blurred area is painted again we have to
-    // blur everything
-    if (m_paintedArea.intersects(expandedBlur) || data.paint.intersects(blurArea)) {
+    const QRect renderScreen = GLRenderTarget::virtualScreenGeometry();
+    BlurCache *cache = findBlurCache(w, renderScreen);
+    if (cache && !cache->dirty.isEmpty()) {
+        // the window hasn't been blurred since parts of the cache became stale, e.g.
+        // because it was covered or isn't blurred at all, don't keep repainting its backdrop
+        discardBlurCache(w, renderScreen);
+        cache = nullptr;
+    }
+    if (cache) {
+        // the blurred backdrop only changes where a window underneath is painted again,
+        // and it has to be blurred again up to the kernel radius around that
+        const QRegion cacheArea = blurArea & renderScreen;
+        if (cache->area != cacheArea) {
+            cache->area = cacheArea;
+            cache->dirty = cacheArea;
+        } else if (m_paintedArea.intersects(expandedBlur)) {
+            cache->dirty |= alignToTiles(expand(m_paintedArea & expandedBlur)) & cacheArea;
+        }
+
+        const QRegion staleCache = grow(cache->dirty, cacheMargin());
+        const QRegion staleBlur = (w->isDock() ? staleCache : expand(staleCache)) & screen;
+        if (!staleBlur.isEmpty()) {
+            data.paint |= staleBlur;
+            if (staleBlur.intersects(m_currentBlur)) {
+                data.paint |= m_currentBlur;
+            }
+        }
+    } else if (m_paintedArea.intersects(expandedBlur) || data.paint.intersects(blurArea)) {
+        // if this window or a window underneath the blurred area is painted again we have to
+        // blur everything
         data.paint |= expandedBlur;
         // we have to check again whether we do not damage a blurred area
         // of a window
         if (expandedBlur.intersects(m_currentBlur)) {
             data.paint |= m_currentBlur;
         }
+
+        // the whole backdrop is painted, so the blur can be cached from now on
+        const QRegion cacheArea = blurArea & renderScreen;
+        if (!cacheArea.isEmpty()) {
+            m_blurCache.insert(w, BlurCache{renderScreen, cacheArea, cacheArea, {}, {}});
+        }
     }
 
     m_currentBlur |= expandedBlur;
@@ -606,8 +669,12 @@ void BlurEffect::drawWindow(EffectWindow *w, int mask, const QRegion &region, Wi
         EffectWindow* modal = w->transientFor();
         const bool transientForIsDock = (modal ? modal->isDock() : false);
 
+        // the cached blur can't be used for a transformed window, prePaintWindow() discards
+        // the cache if the backdrop changes in the meantime
+        BlurCache *cache = (scaled || translated) ? nullptr : findBlurCache(w, screen);
+
         if (!shape.isEmpty()) {
-            doBlur(shape, screen, data.opacity(), data.screenProjectionMatrix(), w->isDock() || transientForIsDock, w->frameGeometry());
+            doBlur(shape, screen, data.opacity(), data.screenProjectionMatrix(), w->isDock() || transientForIsDock, w->frameGeometry(), cache);
         }
     }
 
@@ -655,62 +722,93 @@ void BlurEffect::generateNoiseTexture()
     m_noiseTexture->setWrapMode(GL_REPEAT);
 }
 
-void BlurEffect::doBlur(const QRegion& shape, const QRect& screen, const float opacity, const QMatrix4x4 &screenProjection, bool isDock, QRect windowRect)
+BlurEffect::BlurCache *BlurEffect::findBlurCache(const EffectWindow *w, const QRect &screen)
+{
+    for (auto it = m_blurCache.find(w); it != m_blurCache.end() && it.key() == w; ++it) {
+        if (it->screen == screen) {
+            return &(*it);
+        }
+    }
+    return nullptr;
+}
+
+void BlurEffect::discardBlurCache(const EffectWindow *w, const QRect &screen)
+{
+    for (auto it = m_blurCache.find(w); it != m_blurCache.end() && it.key() == w; ++it) {
+        if (it->screen == screen) {
+            m_blurCache.erase(it);
+            return;
+        }
+    }
+}
+
+void BlurEffect::doBlur(const QRegion& shape, const QRect& screen, const float opacity, const QMatrix4x4 &screenProjection, bool isDock, QRect windowRect, BlurCache *cache)
 {
     // Blur would not render correctly on a secondary monitor because of wrong coordinates
     // BUG: 393723
     const int xTranslate = -screen.x();
     const int yTranslate = effects->virtualScreenSize().height() - screen.height() - screen.y();
 
-    const QRegion expandedBlurRegion = expand(shape) & expand(screen);
-
     const bool useSRGB = m_renderTextures.first().internalFormat() == GL_SRGB8_ALPHA8;
 
-    // Upload geometry for the down and upsample iterations
     GLVertexBuffer *vbo = GLVertexBuffer::streamingBuffer();
-    vbo->reset();
+    GLTexture *blurredTexture = &m_renderTextures[1];
+    QRectF textureRect(0, 0, 1, 1);
+    int vboStart = 0;
 
-    uploadGeometry(vbo, expandedBlurRegion.translated(xTranslate, yTranslate), shape);
-    vbo->bindArrays();
+    if (cache) {
+        if (cache->dirty.isEmpty()) {
+            m_cacheHits++;
 
-    const QRect sourceRect = expandedBlurRegion.boundingRect() & screen;
-    const QRect destRect = sourceRect.translated(xTranslate, yTranslate);
+            if (useSRGB) {
+                glEnable(GL_FRAMEBUFFER_SRGB);
+            }
+        } else {
+            if (cache->dirty == cache->area) {
+                m_cacheMisses++;
+            } else {
+                m_partialCacheUpdates++;
+            }
 
-    GLRenderTarget::pushRenderTargets(m_renderTargetStack);
-    int blurRectCount = expandedBlurRegion.rectCount() * 6;
+            // Only blur the tiles whose backdrop has changed and the margin around them that
+            // the up sample pass reads, prePaintWindow() made sure the backdrop around that is
+            // painted in this frame
+            const QRegion updatedRegion = grow(cache->dirty, cacheMargin());
+            const QRegion expandedBlurRegion = expand(updatedRegion) & expand(screen);
 
-    /*
-     * If the window is a dock or panel we avoid the "extended blur" effect.
-     * Extended blur is when windows that are not under the blurred area affect
-     * the final blur result.
-     * We want to avoid this on panels, because it looks really weird and ugly
-     * when maximized windows or windows near the panel affect the dock blur.
-     */
-    if (isDock) {
-        m_renderTargets.last()->blitFromFramebuffer(sourceRect, destRect);
+            vbo->reset();
+            uploadGeometry(vbo, expandedBlurRegion.translated(xTranslate, yTranslate), QRegion());
+            vbo->bindArrays();
+            renderBlur(vbo, expandedBlurRegion, cache->area, screen, isDock);
+            vbo->unbindArrays();
 
-        if (useSRGB) {
-            glEnable(GL_FRAMEBUFFER_SRGB);
+            updateBlurCache(cache, updatedRegion, screen);
+            cache->dirty = QRegion();
         }
 
-        const QRect screenRect = effects->virtualScreenGeometry();
-        QMatrix4x4 mvp;
-        mvp.ortho(0, screenRect.width(), screenRect.height(), 0, 0, 65535);
-        copyScreenSampleTexture(vbo, blurRectCount, shape.translated(xTranslate, yTranslate), mvp);
+        // Only the shape of the window is painted from the cached texture
+        vbo->reset();
+        uploadGeometry(vbo, QRegion(), shape);
+        vbo->bindArrays();
+        blurredTexture = cache->texture.data();
+        const QSizeF renderTextureSize = m_renderTextures[1].size();
+        textureRect = QRectF(cache->textureRect.x() / renderTextureSize.width(),
+                             cache->textureRect.y() / renderTextureSize.height(),
+                             cache->textureRect.width() / renderTextureSize.width(),
+                             cache->textureRect.height() / renderTextureSize.height());
     } else {
-        m_renderTargets.first()->blitFromFramebuffer(sourceRect, destRect);
+        m_cacheMisses++;
 
-        if (useSRGB) {
-            glEnable(GL_FRAMEBUFFER_SRGB);
-        }
+        const QRegion expandedBlurRegion = expand(shape) & expand(screen);
 
-        // Remove the m_renderTargets[0] from the top of the stack that we will not use
-        GLRenderTarget::popRenderTarget();
+        // Upload geometry for the down and upsample iterations
+        vbo->reset();
+        uploadGeometry(vbo, expandedBlurRegion.translated(xTranslate, yTranslate), shape);
+        vbo->bindArrays();
+        renderBlur(vbo, expandedBlurRegion, shape, screen, isDock);
+        vboStart = expandedBlurRegion.rectCount() * 6 * (m_downSampleIterations + 1);
     }
 
-    downSampleTexture(vbo, blurRectCount);
-    upSampleTexture(vbo, blurRectCount);
-
     // Modulate the blurred texture with the window opacity if the window isn't opaque
     if (opacity < 1.0) {
         glEnable(GL_BLEND);
@@ -725,7 +823,7 @@ void BlurEffect::doBlur(const QRegion& shape, const QRect& screen, const float o
         glBlendFunc(GL_CONSTANT_ALPHA, GL_ONE_MINUS_CONSTANT_ALPHA);
     }
 
-    upscaleRenderToScreen(vbo, blurRectCount * (m_downSampleIterations + 1), shape.rectCount() * 6, screenProjection, windowRect.topLeft());
+    upscaleRenderToScreen(blurredTexture, textureRect, vbo, vboStart, shape.rectCount() * 6, screenProjection, windowRect.topLeft());
 
     if (useSRGB) {
         glDisable(GL_FRAMEBUFFER_SRGB);
@@ -752,25 +850,133 @@ void BlurEffect::doBlur(const QRegion& shape, const QRect& screen, const float o
             // Add the shader's output directly to the pixels in framebuffer.
             glBlendFunc(GL_ONE, GL_ONE);
         }
-        applyNoise(vbo, blurRectCount * (m_downSampleIterations + 1), shape.rectCount() * 6, screenProjection, windowRect.topLeft());
+        applyNoise(vbo, vboStart, shape.rectCount() * 6, screenProjection, windowRect.topLeft());
         glDisable(GL_BLEND);
     }
 
     vbo->unbindArrays();
 }
 
-void BlurEffect::upscaleRenderToScreen(GLVertexBuffer *vbo, int vboStart, int blurRectCount, const QMatrix4x4 &screenProjection, QPoint windowPosition)
+/**
+ * Blurs the @p expandedBlurRegion of the screen, the vertices of which are at the start of @p vbo.
+ * The result is left in the first down sample texture.
+ */
+void BlurEffect::renderBlur(GLVertexBuffer *vbo, const QRegion &expandedBlurRegion, const QRegion &blurShape, const QRect &screen, bool isDock)
+{
+    const int xTranslate = -screen.x();
+    const int yTranslate = effects->virtualScreenSize().height() - screen.height() - screen.y();
+
+    const bool useSRGB = m_renderTextures.first().internalFormat() == GL_SRGB8_ALPHA8;
+
+    const QRect sourceRect = expandedBlurRegion.boundingRect() & screen;
+    const QRect destRect = sourceRect.translated(xTranslate, yTranslate);
+
+    GLRenderTarget::pushRenderTargets(m_renderTargetStack);
+    int blurRectCount = expandedBlurRegion.rectCount() * 6;
+
+    /*
+     * If the window is a dock or panel we avoid the "extended blur" effect.
+     * Extended blur is when windows that are not under the blurred area affect
+     * the final blur result.
+     * We want to avoid this on panels, because it looks really weird and ugly
+     * when maximized windows or windows near the panel affect the dock blur.
+     */
+    if (isDock) {
+        m_renderTargets.last()->blitFromFramebuffer(sourceRect, destRect);
+
+        if (useSRGB) {
+            glEnable(GL_FRAMEBUFFER_SRGB);
+        }
+
+        const QRect screenRect = effects->virtualScreenGeometry();
+        QMatrix4x4 mvp;
+        mvp.ortho(0, screenRect.width(), screenRect.height(), 0, 0, 65535);
+        copyScreenSampleTexture(vbo, blurRectCount, blurShape.translated(xTranslate, yTranslate), mvp);
+    } else {
+        m_renderTargets.first()->blitFromFramebuffer(sourceRect, destRect);
+
+        if (useSRGB) {
+            glEnable(GL_FRAMEBUFFER_SRGB);
+        }
+
+        // Remove the m_renderTargets[0] from the top of the stack that we will not use
+        GLRenderTarget::popRenderTarget();
+    }
+
+    downSampleTexture(vbo, blurRectCount);
+    upSampleTexture(vbo, blurRectCount);
+}
+
+int BlurEffect::cacheMargin() const
 {
-    m_renderTextures[1].bind();
+    // the up sample pass to the screen reads up to m_offset pixels around the painted
+    // shape, plus one for the linear filtering, rounded up to whole texels
+    return (int(std::ceil(m_offset)) + 2) & ~1;
+}
+
+void BlurEffect::updateBlurCache(BlurCache *cache, const QRegion &region, const QRect &screen)
+{
+    const int xTranslate = -screen.x();
+    const int yTranslate = effects->virtualScreenSize().height() - screen.height() - screen.y();
+
+    const GLTexture &blurredTexture = m_renderTextures[1];
+    const QRect blurredRect(QPoint(0, 0), blurredTexture.size());
+
+    // the texture has half the size of the screen and is upside down
+    const auto toTexels = [&](const QRect &rect) {
+        const QRect translated = rect.translated(xTranslate, yTranslate);
+        const QRect texel = QRect(QPoint(translated.left() / 2, translated.top() / 2),
+                                  QPoint((translated.right() + 1) / 2, (translated.bottom() + 1) / 2)) & blurredRect;
+        if (texel.isEmpty()) {
+            return QRect();
+        }
+        return QRect(texel.x(), blurredRect.height() - texel.y() - texel.height(), texel.width(), texel.height());
+    };
+
+    // The texture only covers the blur area and the margin that the up sample pass reads.
+    // The area only changes together with all of it becoming dirty, so the whole texture
+    // is filled again when it's reallocated
+    const QRect textureRect = toTexels(grow(cache->area.boundingRect(), cacheMargin()).boundingRect());
+    if (textureRect.isEmpty()) {
+        return;
+    }
+    if (!cache->texture || cache->textureRect != textureRect) {
+        cache->texture.reset(new GLTexture(blurredTexture.internalFormat(), textureRect.size()));
+        cache->texture->setFilter(GL_LINEAR);
+        cache->texture->setWrapMode(GL_CLAMP_TO_EDGE);
+        cache->textureRect = textureRect;
+    }
+
+    GLRenderTarget::pushRenderTarget(m_renderTargets[1]);
+    cache->texture->bind();
+    for (const QRect &rect : region) {
+        const QRect texel = toTexels(rect) & textureRect;
+        if (texel.isEmpty()) {
+            continue;
+        }
+        glCopyTexSubImage2D(GL_TEXTURE_2D, 0, texel.x() - textureRect.x(), texel.y() - textureRect.y(),
+                            texel.x(), texel.y(), texel.width(), texel.height());
+    }
+    cache->texture->unbind();
+    GLRenderTarget::popRenderTarget();
+}
+
+void BlurEffect::upscaleRenderToScreen(GLTexture *texture, const QRectF &textureRect, GLVertexBuffer *vbo, int vboStart, int blurRectCount, const QMatrix4x4 &screenProjection, QPoint windowPosition)
+{
+    texture->bind();
 
     m_shader->bind(BlurShader::UpSampleType);
     m_shader->setTargetTextureSize(m_renderTextures[0].size() * GLRenderTarget::virtualScreenScale());
+    m_shader->setTextureRect(textureRect);
 
     m_shader->setOffset(m_offset);
     m_shader->setModelViewProjectionMatrix(screenProjection);
 
     //Render to the screen
     vbo->draw(GL_TRIANGLES, vboStart, blurRectCount);
+
+    // The up sample passes between the render textures sample all of the texture
+    m_shader->setTextureRect(QRectF(0, 0, 1, 1));
     m_shader->unbind();
 }
 
@@ -868,5 +1074,15 @@ bool BlurEffect::blocksDirectScanout() const
     return false;
 }
 
+QString BlurEffect::debug(const QString &parameter) const
+{
+    Q_UNUSED(parameter)
+    return QStringLiteral("cached windows: %1, cache hits: %2, partial cache updates: %3, cache misses: %4")
+        .arg(m_blurCache.count())
+        .arg(m_cacheHits)
+        .arg(m_partialCacheUpdates)
+        .arg(m_cacheMisses);
+}
+
 } // namespace KWin
 
@@ -12,6 +12,8 @@
 #include <kwinglplatform.h>
 #include <kwinglutils.h>
 
+#include <QMultiHash>
+#include <QSharedPointer>
 #include <QVector>
 #include <QVector2D>
 #include <QStack>
@@ -53,6 +55,8 @@ public:
 
     bool blocksDirectScanout() const override;
 
+    QString debug(const QString &parameter) const override;
+
 public Q_SLOTS:
     void slotWindowAdded(KWin::EffectWindow *w);
     void slotWindowDeleted(KWin::EffectWindow *w);
@@ -60,6 +64,22 @@ public Q_SLOTS:
     void slotScreenGeometryChanged();
 
 private:
+    /**
+     * The blurred backdrop of a window on one screen, at the resolution of the first down
+     * sample texture.
+     */
+    struct BlurCache
+    {
+        QRect screen;
+        // the blur region of the window on the screen
+        QRegion area;
+        // the parts of the area whose backdrop has been painted since they were last blurred
+        QRegion dirty;
+        // the part of the first down sample texture that the texture holds, upside down
+        QRect textureRect;
+        QSharedPointer<GLTexture> texture;
+    };
+
     QRect expand(const QRect &rect) const;
     QRegion expand(const QRegion &region) const;
     bool renderTargetsValid() const;
@@ -69,12 +89,17 @@ private:
     QRegion blurRegion(const EffectWindow *w) const;
     bool shouldBlur(const EffectWindow *w, int mask, const WindowPaintData &data) const;
     void updateBlurRegion(EffectWindow *w) const;
-    void doBlur(const QRegion &shape, const QRect &screen, const float opacity, const QMatrix4x4 &screenProjection, bool isDock, QRect windowRect);
+    BlurCache *findBlurCache(const EffectWindow *w, const QRect &screen);
+    void discardBlurCache(const EffectWindow *w, const QRect &screen);
+    void doBlur(const QRegion &shape, const QRect &screen, const float opacity, const QMatrix4x4 &screenProjection, bool isDock, QRect windowRect, BlurCache *cache = nullptr);
+    void renderBlur(GLVertexBuffer *vbo, const QRegion &expandedBlurRegion, const QRegion &blurShape, const QRect &screen, bool isDock);
+    int cacheMargin() const;
+    void updateBlurCache(BlurCache *cache, const QRegion &region, const QRect &screen);
     void uploadRegion(QVector2D *&map, const QRegion &region, const int downSampleIterations);
     void uploadGeometry(GLVertexBuffer *vbo, const QRegion &blurRegion, const QRegion &windowRegion);
     void generateNoiseTexture();
 
-    void upscaleRenderToScreen(GLVertexBuffer *vbo, int vboStart, int blurRectCount, const QMatrix4x4 &screenProjection, QPoint windowPosition);
+    void upscaleRenderToScreen(GLTexture *texture, const QRectF &textureRect, GLVertexBuffer *vbo, int vboStart, int blurRectCount, const QMatrix4x4 &screenProjection, QPoint windowPosition);
     void applyNoise(GLVertexBuffer *vbo, int vboStart, int blurRectCount, const QMatrix4x4 &screenProjection, QPoint windowPosition);
     void downSampleTexture(GLVertexBuffer *vbo, int blurRectCount);
     void upSampleTexture(GLVertexBuffer *vbo, int blurRectCount);
@@ -116,6 +141,11 @@ private:
 
     QMap <EffectWindow*, QMetaObject::Connection> windowBlurChangedConnections;
 
+    QMultiHash<const EffectWindow *, BlurCache> m_blurCache;
+    quint64 m_cacheHits = 0;
+    quint64 m_partialCacheUpdates = 0;
+    quint64 m_cacheMisses = 0;
+
     static KWaylandServer::BlurManagerInterface *s_blurManager;
     static QTimer *s_blurManagerRemoveTimer;
 };
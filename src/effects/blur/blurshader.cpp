@@ -93,19 +93,21 @@ BlurShader::BlurShader(QObject *parent)
     QTextStream streamFragUp(&fragmentUpSource);
 
     streamFragUp << glHeaderString << glUniformString;
+    streamFragUp << "uniform vec4 textureRect;\n";
 
     streamFragUp << "void main(void)\n";
     streamFragUp << "{\n";
-    streamFragUp << "    vec2 uv = vec2(gl_FragCoord.xy / renderTextureSize);\n";
+    streamFragUp << "    vec2 uv = (gl_FragCoord.xy / renderTextureSize - textureRect.xy) / textureRect.zw;\n";
+    streamFragUp << "    vec2 texel = halfpixel / textureRect.zw;\n";
     streamFragUp << "    \n";
-    streamFragUp << "    vec4 sum = " << texture2D << "(texUnit, uv + vec2(-halfpixel.x * 2.0, 0.0) * offset);\n";
-    streamFragUp << "    sum += " << texture2D << "(texUnit, uv + vec2(-halfpixel.x, halfpixel.y) * offset) * 2.0;\n";
-    streamFragUp << "    sum += " << texture2D << "(texUnit, uv + vec2(0.0, halfpixel.y * 2.0) * offset);\n";
-    streamFragUp << "    sum += " << texture2D << "(texUnit, uv + vec2(halfpixel.x, halfpixel.y) * offset) * 2.0;\n";
-    streamFragUp << "    sum += " << texture2D << "(texUnit, uv + vec2(halfpixel.x * 2.0, 0.0) * offset);\n";
-    streamFragUp << "    sum += " << texture2D << "(texUnit, uv + vec2(halfpixel.x, -halfpixel.y) * offset) * 2.0;\n";
-    streamFragUp << "    sum += " << texture2D << "(texUnit, uv + vec2(0.0, -halfpixel.y * 2.0) * offset);\n";
-    streamFragUp << "    sum += " << texture2D << "(texUnit, uv + vec2(-halfpixel.x, -halfpixel.y) * offset) * 2.0;\n";
+    streamFragUp << "    vec4 sum = " << texture2D << "(texUnit, uv + vec2(-texel.x * 2.0, 0.0) * offset);\n";
+    streamFragUp << "    sum += " << texture2D << "(texUnit, uv + vec2(-texel.x, texel.y) * offset) * 2.0;\n";
+    streamFragUp << "    sum += " << texture2D << "(texUnit, uv + vec2(0.0, texel.y * 2.0) * offset);\n";
+    streamFragUp << "    sum += " << texture2D << "(texUnit, uv + vec2(texel.x, texel.y) * offset) * 2.0;\n";
+    streamFragUp << "    sum += " << texture2D << "(texUnit, uv + vec2(texel.x * 2.0, 0.0) * offset);\n";
+    streamFragUp << "    sum += " << texture2D << "(texUnit, uv + vec2(texel.x, -texel.y) * offset) * 2.0;\n";
+    streamFragUp << "    sum += " << texture2D << "(texUnit, uv + vec2(0.0, -texel.y * 2.0) * offset);\n";
+    streamFragUp << "    sum += " << texture2D << "(texUnit, uv + vec2(-texel.x, -texel.y) * offset) * 2.0;\n";
     streamFragUp << "    \n";
     streamFragUp << "    " << fragColor << " = sum / 12.0;\n";
     streamFragUp << "}\n";
@@ -170,6 +172,7 @@ BlurShader::BlurShader(QObject *parent)
         m_offsetLocationUpsample = m_shaderUpsample->uniformLocation("offset");
         m_renderTextureSizeLocationUpsample = m_shaderUpsample->uniformLocation("renderTextureSize");
         m_halfpixelLocationUpsample = m_shaderUpsample->uniformLocation("halfpixel");
+        m_textureRectLocationUpsample = m_shaderUpsample->uniformLocation("textureRect");
 
         m_mvpMatrixLocationCopysample = m_shaderCopysample->uniformLocation("modelViewProjectionMatrix");
         m_renderTextureSizeLocationCopysample = m_shaderCopysample->uniformLocation("renderTextureSize");
@@ -199,6 +202,7 @@ BlurShader::BlurShader(QObject *parent)
         m_shaderUpsample->setUniform(m_offsetLocationUpsample, float(1.0));
         m_shaderUpsample->setUniform(m_renderTextureSizeLocationUpsample, QVector2D(1.0, 1.0));
         m_shaderUpsample->setUniform(m_halfpixelLocationUpsample, QVector2D(1.0, 1.0));
+        m_shaderUpsample->setUniform(m_textureRectLocationUpsample, m_textureRectUpsample);
         ShaderManager::instance()->popShader();
 
         ShaderManager::instance()->pushShader(m_shaderCopysample.data());
@@ -361,6 +365,21 @@ void BlurShader::setTexturePosition(const QPoint &texPos)
     m_shaderNoisesample->setUniform(m_texStartPosLocationNoisesample, QVector2D(-texPos.x(), texPos.y()));
 }
 
+void BlurShader::setTextureRect(const QRectF &textureRect)
+{
+    if (!isValid()) {
+        return;
+    }
+
+    const QVector4D rect(textureRect.x(), textureRect.y(), textureRect.width(), textureRect.height());
+    if (rect == m_textureRectUpsample) {
+        return;
+    }
+
+    m_textureRectUpsample = rect;
+    m_shaderUpsample->setUniform(m_textureRectLocationUpsample, rect);
+}
+
 void BlurShader::setBlurRect(const QRect &blurRect, const QSize &screenSize)
 {
     if (!isValid()) {
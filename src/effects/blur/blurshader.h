@@ -45,6 +45,11 @@ public:
     void setNoiseTextureSize(const QSize &noiseTextureSize);
     void setTexturePosition(const QPoint &texPos);
     void setBlurRect(const QRect &blurRect, const QSize &screenSize);
+    /**
+     * Sets the part of the render texture that the texture sampled by the up sample pass
+     * covers, in normalized texture coordinates.
+     */
+    void setTextureRect(const QRectF &textureRect);
 
 private:
     QScopedPointer<GLShader> m_shaderDownsample;
@@ -61,6 +66,7 @@ private:
     int m_offsetLocationUpsample;
     int m_renderTextureSizeLocationUpsample;
     int m_halfpixelLocationUpsample;
+    int m_textureRectLocationUpsample;
 
     int m_mvpMatrixLocationCopysample;
     int m_renderTextureSizeLocationCopysample;
@@ -81,6 +87,7 @@ private:
 
     float m_offsetUpsample = 0.0;
     QMatrix4x4 m_matrixUpsample;
+    QVector4D m_textureRectUpsample = QVector4D(0.0, 0.0, 1.0, 1.0);
 
     QMatrix4x4 m_matrixCopysample;
 
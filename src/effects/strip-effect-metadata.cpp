@@ -41,6 +41,14 @@ static bool stripMetaData(const QString &fileName, const QString &target)
     QJsonObject strippedRootObject;
     strippedRootObject["KPlugin"] = kpluginObject;
 
+    // The activation triggers are needed to load the effect on demand.
+    const QJsonValue activation = originalRootObject["org.kde.kwin.effect"]["activation"];
+    if (activation.isObject()) {
+        QJsonObject effectObject;
+        effectObject["activation"] = activation;
+        strippedRootObject["org.kde.kwin.effect"] = effectObject;
+    }
+
     QFile targetFile(target);
     if (!targetFile.open(QFile::WriteOnly)) {
         qWarning("Failed to open %s: %s", qPrintable(target), qPrintable(targetFile.errorString()));
@@ -25,6 +25,7 @@
 #include <KGlobalAccel>
 #include <KLocalizedString>
 
+#include <kwingltexturecache.h>
 #include <kwinglutils.h>
 
 namespace KWin
@@ -162,8 +163,7 @@ GLTexture *ZoomEffect::ensureCursorTexture()
         m_cursorTextureDirty = false;
         const auto cursor = effects->cursorImage();
         if (!cursor.image().isNull()) {
-            m_cursorTexture.reset(new GLTexture(cursor.image()));
-            m_cursorTexture->setWrapMode(GL_CLAMP_TO_EDGE);
+            m_cursorTexture = GLTextureCache::instance()->texture(cursor.image());
         }
     }
     return m_cursorTexture.data();
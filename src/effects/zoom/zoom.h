@@ -119,7 +119,7 @@ private:
     QPoint prevPoint;
     QTime lastMouseEvent;
     QTime lastFocusEvent;
-    QScopedPointer<GLTexture> m_cursorTexture;
+    QSharedPointer<GLTexture> m_cursorTexture;
     bool m_cursorTextureDirty = false;
     bool isMouseHidden;
     QTimeLine timeline;
@@ -10,26 +10,118 @@
 
 #include "ftrace.h"
 
+#include <QCoreApplication>
 #include <QDBusConnection>
 #include <QDebug>
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
+#include <QHash>
+#include <QSaveFile>
 #include <QScopeGuard>
 #include <QTextStream>
+#include <QThread>
 
 namespace KWin
 {
 KWIN_SINGLETON_FACTORY(KWin::FTraceLogger)
 
+/**
+ * The FTraceRing class is a fixed-size ring of trace events written by a single thread.
+ *
+ * Each slot is guarded by a sequence number, which is odd while the slot is being
+ * written, so the ring can be read from another thread without blocking the writer.
+ * Slots that are overwritten while being read are skipped.
+ */
+class FTraceRing
+{
+public:
+    FTraceRing(quint64 threadId, const QString &threadName)
+        : threadId(threadId)
+        , threadName(threadName)
+        , m_slots(new Slot[FTraceLogger::ringCapacity])
+    {
+    }
+
+    void record(const FTraceEvent &event)
+    {
+        const quint64 index = m_count.load(std::memory_order_relaxed);
+        Slot &slot = m_slots[index % FTraceLogger::ringCapacity];
+
+        slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.timestamp.store(event.timestamp.count(), std::memory_order_relaxed);
+        slot.name.store(event.name, std::memory_order_relaxed);
+        slot.argument.store(event.argument, std::memory_order_relaxed);
+        slot.phase.store(event.phase, std::memory_order_relaxed);
+        slot.sequence.store(2 * index + 2, std::memory_order_release);
+
+        m_count.store(index + 1, std::memory_order_release);
+    }
+
+    void read(QVector<FTraceEvent> *events) const
+    {
+        const quint64 count = m_count.load(std::memory_order_acquire);
+        const quint64 first = count > quint64(FTraceLogger::ringCapacity) ? count - FTraceLogger::ringCapacity : 0;
+
+        for (quint64 index = first; index < count; ++index) {
+            const Slot &slot = m_slots[index % FTraceLogger::ringCapacity];
+            const quint64 sequence = slot.sequence.load(std::memory_order_acquire);
+            if (sequence != 2 * index + 2) {
+                continue;
+            }
+            FTraceEvent event;
+            event.timestamp = std::chrono::nanoseconds(slot.timestamp.load(std::memory_order_relaxed));
+            event.name = slot.name.load(std::memory_order_relaxed);
+            event.argument = slot.argument.load(std::memory_order_relaxed);
+            event.phase = FTraceEvent::Phase(slot.phase.load(std::memory_order_relaxed));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) != sequence) {
+                continue;
+            }
+            events->append(event);
+        }
+    }
+
+    const quint64 threadId;
+    const QString threadName;
+
+private:
+    struct Slot
+    {
+        std::atomic<quint64> sequence{0};
+        std::atomic<qint64> timestamp{0};
+        std::atomic<const char *> name{nullptr};
+        std::atomic<quint64> argument{0};
+        std::atomic<quint32> phase{0};
+    };
+
+    std::unique_ptr<Slot[]> m_slots;
+    std::atomic<quint64> m_count{0};
+};
+
+// Distinguishes logger instances so a thread never uses a ring of a destroyed logger
+static std::atomic<quint64> s_loggerGeneration{0};
+
+struct ThreadRing
+{
+    quint64 generation = 0;
+    FTraceRing *ring = nullptr;
+};
+static thread_local ThreadRing t_ring;
+
 FTraceLogger::FTraceLogger(QObject *parent)
     : QObject(parent)
+    , m_generation(++s_loggerGeneration)
 {
+    if (qEnvironmentVariableIsSet("KWIN_PERF_TRACE_RING")) {
+        setRingEnabled(true);
+    }
     if (qEnvironmentVariableIsSet("KWIN_PERF_FTRACE")) {
         setEnabled(true);
-    } else {
-        QDBusConnection::sessionBus().registerObject(QStringLiteral("/FTrace"), this, QDBusConnection::ExportScriptableContents);
     }
+    // Keep the object available on the bus, the rings can only be dumped from there
+    QDBusConnection::sessionBus().registerObject(QStringLiteral("/FTrace"), this, QDBusConnection::ExportScriptableContents);
 }
 
 bool FTraceLogger::isEnabled() const
@@ -113,6 +205,126 @@ QString FTraceLogger::filePath()
     return markerFileInfo.absoluteFilePath();
 }
 
+void FTraceLogger::setRingEnabled(bool enabled)
+{
+    if (m_ringEnabled.exchange(enabled) == enabled) {
+        return;
+    }
+    Q_EMIT ringEnabledChanged();
+}
+
+FTraceRing *FTraceLogger::ring()
+{
+    if (t_ring.generation == m_generation) {
+        return t_ring.ring;
+    }
+
+    // First event on this thread, threads that have exited keep their events around
+    QMutexLocker lock(&m_ringsMutex);
+    const QThread *thread = QThread::currentThread();
+    m_rings.emplace_back(new FTraceRing(m_rings.size() + 1, thread ? thread->objectName() : QString()));
+    t_ring.generation = m_generation;
+    t_ring.ring = m_rings.back().get();
+    return t_ring.ring;
+}
+
+void FTraceLogger::record(FTraceEvent::Phase phase, const char *name, quint64 argument)
+{
+    FTraceEvent event;
+    event.timestamp = std::chrono::steady_clock::now().time_since_epoch();
+    event.name = name;
+    event.argument = argument;
+    event.phase = phase;
+    ring()->record(event);
+}
+
+QVector<FTraceEvent> FTraceLogger::recordedEvents() const
+{
+    QMutexLocker lock(&m_ringsMutex);
+    QVector<FTraceEvent> events;
+    for (const auto &ring : m_rings) {
+        ring->read(&events);
+    }
+    return events;
+}
+
+static QByteArray escapeJson(const char *string)
+{
+    QByteArray escaped;
+    for (const char *c = string; *c; ++c) {
+        if (*c == '"' || *c == '\\') {
+            escaped.append('\\');
+        }
+        if (uchar(*c) < 0x20) {
+            escaped.append(QByteArrayLiteral("\\u00") + QByteArray::number(uchar(*c), 16).rightJustified(2, '0'));
+        } else {
+            escaped.append(*c);
+        }
+    }
+    return escaped;
+}
+
+bool FTraceLogger::dumpTrace(const QString &fileName)
+{
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Could not open trace file" << fileName << file.errorString();
+        return false;
+    }
+
+    const qint64 pid = QCoreApplication::applicationPid();
+    QTextStream stream(&file);
+    stream << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+    bool first = true;
+    auto separator = [&first, &stream]() {
+        if (!first) {
+            stream << ",\n";
+        }
+        first = false;
+    };
+
+    // Names are interned string literals, escape each of them only once
+    QHash<const char *, QByteArray> names;
+
+    QMutexLocker lock(&m_ringsMutex);
+    for (const auto &ring : m_rings) {
+        if (!ring->threadName.isEmpty()) {
+            separator();
+            stream << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" << pid << ",\"tid\":" << ring->threadId
+                   << ",\"args\":{\"name\":\"" << escapeJson(ring->threadName.toUtf8().constData()) << "\"}}";
+        }
+
+        QVector<FTraceEvent> events;
+        events.reserve(ringCapacity);
+        ring->read(&events);
+        for (const FTraceEvent &event : qAsConst(events)) {
+            auto name = names.find(event.name);
+            if (name == names.end()) {
+                name = names.insert(event.name, escapeJson(event.name));
+            }
+
+            separator();
+            // Chrome traces use microseconds
+            stream << "{\"ph\":\"" << char(event.phase) << "\",\"name\":\"" << *name << "\",\"pid\":" << pid
+                   << ",\"tid\":" << ring->threadId << ",\"ts\":" << event.timestamp.count() / 1000 << '.'
+                   << QString::number(event.timestamp.count() % 1000).rightJustified(3, QLatin1Char('0'));
+            if (event.phase == FTraceEvent::Instant) {
+                stream << ",\"s\":\"t\"";
+            }
+            if (event.argument) {
+                stream << ",\"args\":{\"value\":" << event.argument << '}';
+            }
+            stream << '}';
+        }
+    }
+    lock.unlock();
+
+    stream << "]}\n";
+    stream.flush();
+    return file.commit();
+}
+
 FTraceDuration::~FTraceDuration()
 {
     FTraceLogger::self()->trace(m_message, " end_ctx=", m_context);
@@ -16,9 +16,37 @@
 #include <QMutexLocker>
 #include <QObject>
 #include <QTextStream>
+#include <QVector>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
 
 namespace KWin
 {
+class FTraceRing;
+
+/**
+ * The FTraceEvent struct is a fixed-size event recorded by the binary tracing backend.
+ */
+struct FTraceEvent
+{
+    enum Phase : quint32 {
+        Begin = 'B',
+        End = 'E',
+        Instant = 'i',
+    };
+
+    std::chrono::nanoseconds timestamp = std::chrono::nanoseconds::zero();
+    /**
+     * Must point to a string with static storage duration, usually a string literal.
+     */
+    const char *name = nullptr;
+    quint64 argument = 0;
+    Phase phase = Instant;
+};
+
 /**
  * FTraceLogger is a singleton utility for writing log messages using ftrace
  *
@@ -26,12 +54,20 @@ namespace KWin
  *  Set the KWIN_PERF_FTRACE environment variable before starting the application
  *  Calling on DBus /FTrace org.kde.kwin.FTrace.setEnabled true
  * After having created the ftrace mount
+ *
+ * Besides writing text to the ftrace marker file, events can be recorded in a binary
+ * ring buffer, which is cheap enough to be left on. Each thread records into its own
+ * ring without locking; the rings can be dumped as a Chrome trace (which can be opened
+ * with Perfetto) by calling org.kde.kwin.FTrace.dumpTrace on DBus. The ring is enabled
+ * by setting the KWIN_PERF_TRACE_RING environment variable or by calling
+ * org.kde.kwin.FTrace.setRingEnabled true.
  */
 class KWIN_EXPORT FTraceLogger : public QObject
 {
     Q_OBJECT
     Q_CLASSINFO("D-Bus Interface", "org.kde.kwin.FTrace");
     Q_PROPERTY(bool isEnabled READ isEnabled NOTIFY enabledChanged)
+    Q_PROPERTY(bool isRingEnabled READ isRingEnabled NOTIFY ringEnabledChanged)
 
 public:
     /**
@@ -39,6 +75,30 @@ public:
      */
     bool isEnabled() const;
 
+    /**
+     * Events are being recorded in the binary ring buffer
+     */
+    bool isRingEnabled() const
+    {
+        return m_ringEnabled.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Records an event in the ring buffer of the calling thread. @a name must have static
+     * storage duration, only the pointer is stored.
+     */
+    void record(FTraceEvent::Phase phase, const char *name, quint64 argument = 0);
+
+    /**
+     * Returns the events recorded by all threads, oldest first for each thread.
+     */
+    QVector<FTraceEvent> recordedEvents() const;
+
+    /**
+     * The maximum number of events kept per thread.
+     */
+    static constexpr int ringCapacity = 16384;
+
     /**
      * Main log function
      * Takes any number of arguments that can be written into QTextStream
@@ -56,15 +116,27 @@ public:
 
 Q_SIGNALS:
     void enabledChanged();
+    void ringEnabledChanged();
 
 public Q_SLOTS:
     Q_SCRIPTABLE void setEnabled(bool enabled);
+    Q_SCRIPTABLE void setRingEnabled(bool enabled);
+    /**
+     * Writes the events recorded in the ring buffers to @a fileName in the Chrome trace
+     * event format. Returns @c false if the file could not be written.
+     */
+    Q_SCRIPTABLE bool dumpTrace(const QString &fileName);
 
 private:
     static QString filePath();
     bool open();
+    FTraceRing *ring();
     QFile m_file;
     QMutex m_mutex;
+    std::atomic<bool> m_ringEnabled{false};
+    mutable QMutex m_ringsMutex;
+    std::vector<std::unique_ptr<FTraceRing>> m_rings;
+    quint64 m_generation;
     KWIN_SINGLETON(FTraceLogger)
 };
 
@@ -88,6 +160,30 @@ private:
     quint32 m_context;
 };
 
+class KWIN_EXPORT FTraceScope
+{
+public:
+    explicit FTraceScope(const char *name, quint64 argument = 0)
+        : m_name(FTraceLogger::self()->isRingEnabled() ? name : nullptr)
+        , m_argument(argument)
+    {
+        if (m_name) {
+            FTraceLogger::self()->record(FTraceEvent::Begin, m_name, m_argument);
+        }
+    }
+
+    ~FTraceScope()
+    {
+        if (m_name) {
+            FTraceLogger::self()->record(FTraceEvent::End, m_name, m_argument);
+        }
+    }
+
+private:
+    const char *m_name;
+    quint64 m_argument;
+};
+
 } // namespace KWin
 
 /**
@@ -103,3 +199,20 @@ private:
  */
 #define fTraceDuration(...)                                                                                                                                    \
     QScopedPointer<KWin::FTraceDuration> _duration(KWin::FTraceLogger::self()->isEnabled() ? new KWin::FTraceDuration(__VA_ARGS__) : nullptr);
+
+/**
+ * Records an instant event in the binary ring buffer. The name must be a string literal,
+ * an optional integer argument can be passed along.
+ */
+#define fTraceEvent(...)                                                                                                                                       \
+    do {                                                                                                                                                       \
+        if (KWin::FTraceLogger::self()->isRingEnabled()) {                                                                                                     \
+            KWin::FTraceLogger::self()->record(KWin::FTraceEvent::Instant, __VA_ARGS__);                                                                       \
+        }                                                                                                                                                      \
+    } while (0)
+
+/**
+ * Records the duration of the relevant block in the binary ring buffer. The name must be a
+ * string literal, an optional integer argument can be passed along.
+ */
+#define fTraceScope(...) KWin::FTraceScope _traceScope(__VA_ARGS__);
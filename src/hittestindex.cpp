@@ -0,0 +1,210 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2026 KWin contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "hittestindex.h"
+#include "abstract_client.h"
+#include "wayland_server.h"
+#include "workspace.h"
+
+#include <algorithm>
+
+namespace KWin
+{
+
+static int tileOf(int coordinate)
+{
+    // round towards negative infinity, windows may be partially outside of the screens
+    return coordinate >= 0 ? coordinate / HitTestIndex::tileSize
+                           : (coordinate - HitTestIndex::tileSize + 1) / HitTestIndex::tileSize;
+}
+
+static quint32 tileKey(int column, int row)
+{
+    return (quint32(quint16(column)) << 16) | quint16(row);
+}
+
+HitTestIndex::HitTestIndex(QObject *parent)
+    : QObject(parent)
+{
+    Workspace *ws = Workspace::self();
+    connect(ws, &Workspace::stackingOrderChanged, this, &HitTestIndex::invalidate);
+    connect(ws, &Workspace::currentDesktopChanged, this, &HitTestIndex::invalidate);
+    connect(ws, &Workspace::currentActivityChanged, this, &HitTestIndex::invalidate);
+}
+
+void HitTestIndex::invalidate()
+{
+    m_dirty = true;
+}
+
+bool HitTestIndex::isEligible(const Toplevel *toplevel)
+{
+    if (toplevel->isDeleted()) {
+        return false;
+    }
+    if (const AbstractClient *client = qobject_cast<const AbstractClient *>(toplevel)) {
+        return client->isOnCurrentActivity() && client->isOnCurrentDesktop() && !client->isMinimized();
+    }
+    return true;
+}
+
+QRect HitTestIndex::inputBounds(const Toplevel *toplevel)
+{
+    // The visible geometry covers subsurfaces that stick out of the main surface
+    return toplevel->inputGeometry() | toplevel->bufferGeometry() | toplevel->visibleGeometry();
+}
+
+void HitTestIndex::track(Toplevel *toplevel)
+{
+    if (m_tracked.contains(toplevel)) {
+        return;
+    }
+    m_tracked.insert(toplevel);
+
+    connect(toplevel, &Toplevel::frameGeometryChanged, this, [this, toplevel]() {
+        updateBounds(toplevel);
+    });
+    connect(toplevel, &Toplevel::bufferGeometryChanged, this, [this, toplevel]() {
+        updateBounds(toplevel);
+    });
+    connect(toplevel, &Toplevel::visibleGeometryChanged, this, [this, toplevel]() {
+        updateBounds(toplevel);
+    });
+    connect(toplevel, &Toplevel::windowClosed, this, &HitTestIndex::invalidate);
+    connect(toplevel, &QObject::destroyed, this, [this, toplevel]() {
+        m_tracked.remove(toplevel);
+        invalidate();
+    });
+
+    if (AbstractClient *client = qobject_cast<AbstractClient *>(toplevel)) {
+        connect(client, &AbstractClient::desktopChanged, this, &HitTestIndex::invalidate);
+        connect(client, &AbstractClient::activitiesChanged, this, &HitTestIndex::invalidate);
+        connect(client, &AbstractClient::minimizedChanged, this, &HitTestIndex::invalidate);
+        connect(client, &AbstractClient::decorationChanged, this, [this, toplevel]() {
+            updateBounds(toplevel);
+        });
+    }
+}
+
+void HitTestIndex::rebuild()
+{
+    m_entries.clear();
+    m_indices.clear();
+    m_tiles.clear();
+
+    const QList<Toplevel *> &stacking = Workspace::self()->stackingOrder();
+    for (auto it = stacking.crbegin(); it != stacking.crend(); ++it) {
+        Toplevel *toplevel = *it;
+        if (!isEligible(toplevel)) {
+            continue;
+        }
+        track(toplevel);
+        m_indices.insert(toplevel, m_entries.count());
+        m_entries.append(Entry{toplevel, inputBounds(toplevel)});
+        insertEntry(m_entries.count() - 1);
+    }
+
+    m_dirty = false;
+}
+
+void HitTestIndex::insertEntry(int index)
+{
+    const QRect bounds = m_entries[index].bounds;
+    if (bounds.isEmpty()) {
+        return;
+    }
+    for (int row = tileOf(bounds.top()); row <= tileOf(bounds.bottom()); ++row) {
+        for (int column = tileOf(bounds.left()); column <= tileOf(bounds.right()); ++column) {
+            QVector<int> &tile = m_tiles[tileKey(column, row)];
+            tile.insert(std::lower_bound(tile.begin(), tile.end(), index), index);
+        }
+    }
+}
+
+void HitTestIndex::removeEntry(int index)
+{
+    const QRect bounds = m_entries[index].bounds;
+    if (bounds.isEmpty()) {
+        return;
+    }
+    for (int row = tileOf(bounds.top()); row <= tileOf(bounds.bottom()); ++row) {
+        for (int column = tileOf(bounds.left()); column <= tileOf(bounds.right()); ++column) {
+            auto tile = m_tiles.find(tileKey(column, row));
+            if (tile == m_tiles.end()) {
+                continue;
+            }
+            auto it = std::lower_bound(tile->begin(), tile->end(), index);
+            if (it != tile->end() && *it == index) {
+                tile->erase(it);
+            }
+            if (tile->isEmpty()) {
+                m_tiles.erase(tile);
+            }
+        }
+    }
+}
+
+void HitTestIndex::updateBounds(Toplevel *toplevel)
+{
+    if (m_dirty) {
+        return;
+    }
+    const int index = m_indices.value(toplevel, -1);
+    if (index == -1) {
+        return;
+    }
+    const QRect bounds = inputBounds(toplevel);
+    if (m_entries[index].bounds == bounds) {
+        return;
+    }
+    removeEntry(index);
+    m_entries[index].bounds = bounds;
+    insertEntry(index);
+}
+
+Toplevel *HitTestIndex::findManagedToplevel(const QPoint &pos)
+{
+    if (m_dirty) {
+        rebuild();
+    }
+
+    const auto tile = m_tiles.constFind(tileKey(tileOf(pos.x()), tileOf(pos.y())));
+    if (tile == m_tiles.constEnd()) {
+        return nullptr;
+    }
+
+    const bool isScreenLocked = waylandServer() && waylandServer()->isScreenLocked();
+    for (int index : *tile) {
+        const Entry &entry = m_entries[index];
+        if (!entry.bounds.contains(pos)) {
+            continue;
+        }
+        Toplevel *t = entry.toplevel;
+        // Not every change of these properties is announced, so check them again
+        if (AbstractClient *c = qobject_cast<AbstractClient *>(t)) {
+            if (!c->isOnCurrentActivity() || !c->isOnCurrentDesktop() || c->isMinimized() || c->isHiddenInternal()) {
+                continue;
+            }
+        }
+        if (!t->readyForPainting()) {
+            continue;
+        }
+        if (isScreenLocked) {
+            if (!t->isLockScreen() && !t->isInputMethod()) {
+                continue;
+            }
+        }
+        if (t->hitTest(pos)) {
+            return t;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace KWin
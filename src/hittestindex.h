@@ -0,0 +1,81 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2026 KWin contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <kwin_export.h>
+
+#include <QHash>
+#include <QObject>
+#include <QPoint>
+#include <QRect>
+#include <QSet>
+#include <QVector>
+
+namespace KWin
+{
+
+class Toplevel;
+
+/**
+ * The HitTestIndex class finds the top-most toplevel that accepts input at a position
+ * without walking the whole stacking order.
+ *
+ * The index keeps the toplevels that can receive input, i.e. those that are on the current
+ * virtual desktop and activity and not minimized, in buckets of fixed-size tiles. A lookup
+ * only needs to hit-test the toplevels in the bucket of the tile under the position.
+ *
+ * Changes to the stacking order, the current desktop or activity invalidate the whole index,
+ * which is rebuilt on the next lookup. Geometry changes only move the affected toplevel
+ * to other buckets.
+ */
+class KWIN_EXPORT HitTestIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit HitTestIndex(QObject *parent = nullptr);
+
+    /**
+     * Returns the top-most toplevel that accepts input at @a pos or @c null if there's none.
+     */
+    Toplevel *findManagedToplevel(const QPoint &pos);
+
+    /**
+     * Marks the index as outdated. It will be rebuilt on the next lookup.
+     */
+    void invalidate();
+
+    static constexpr int tileSize = 256;
+
+private:
+    struct Entry
+    {
+        Toplevel *toplevel;
+        QRect bounds;
+    };
+
+    void rebuild();
+    void track(Toplevel *toplevel);
+    void updateBounds(Toplevel *toplevel);
+    void insertEntry(int index);
+    void removeEntry(int index);
+    static bool isEligible(const Toplevel *toplevel);
+    static QRect inputBounds(const Toplevel *toplevel);
+
+    // ordered from the top-most to the bottom-most toplevel
+    QVector<Entry> m_entries;
+    QHash<Toplevel *, int> m_indices;
+    // the entry indices of each tile, in ascending order
+    QHash<quint32, QVector<int>> m_tiles;
+    QSet<Toplevel *> m_tracked;
+    bool m_dirty = true;
+};
+
+} // namespace KWin
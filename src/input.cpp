@@ -25,6 +25,7 @@
 #include "session.h"
 #include "tablet_input.h"
 #include "hide_cursor_spy.h"
+#include "hittestindex.h"
 #include "touch_input.h"
 #include "x11client.h"
 #ifdef KWIN_BUILD_TABBOX
@@ -84,7 +85,10 @@ static KWaylandServer::PointerAxisSource kwinAxisSourceToKWaylandAxisSource(Inpu
     }
 }
 
-InputEventFilter::InputEventFilter() = default;
+InputEventFilter::InputEventFilter(EventTypes eventTypes)
+    : m_eventTypes(eventTypes)
+{
+}
 
 InputEventFilter::~InputEventFilter()
 {
@@ -295,6 +299,11 @@ bool InputEventFilter::passToInputMethod(QKeyEvent *event)
 
 class VirtualTerminalFilter : public InputEventFilter {
 public:
+    VirtualTerminalFilter()
+        : InputEventFilter(KeyEvents)
+    {
+    }
+
     bool keyEvent(QKeyEvent *event) override {
         // really on press and not on release? X11 switches on press.
         if (event->type() == QEvent::KeyPress && !event->isAutoRepeat()) {
@@ -310,6 +319,11 @@ public:
 
 class TerminateServerFilter : public InputEventFilter {
 public:
+    TerminateServerFilter()
+        : InputEventFilter(KeyEvents)
+    {
+    }
+
     bool keyEvent(QKeyEvent *event) override {
         if (event->type() == QEvent::KeyPress && !event->isAutoRepeat()) {
             if (event->nativeVirtualKey() == XKB_KEY_Terminate_Server) {
@@ -324,6 +338,11 @@ public:
 
 class LockScreenFilter : public InputEventFilter {
 public:
+    LockScreenFilter()
+        : InputEventFilter(PointerEvents | WheelEvents | KeyEvents | TouchEvents | GestureEvents)
+    {
+    }
+
     bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override {
         if (!waylandServer()->isScreenLocked()) {
             return false;
@@ -521,6 +540,11 @@ private:
 
 class EffectsFilter : public InputEventFilter {
 public:
+    EffectsFilter()
+        : InputEventFilter(PointerEvents | WheelEvents | KeyEvents | TouchEvents)
+    {
+    }
+
     bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override {
         Q_UNUSED(nativeButton)
         if (!effects) {
@@ -565,6 +589,11 @@ public:
 
 class MoveResizeFilter : public InputEventFilter {
 public:
+    MoveResizeFilter()
+        : InputEventFilter(PointerEvents | WheelEvents | KeyEvents | TouchEvents | TabletEvents)
+    {
+    }
+
     bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override {
         Q_UNUSED(nativeButton)
         AbstractClient *c = workspace()->moveResizeClient();
@@ -673,6 +702,11 @@ private:
 
 class WindowSelectorFilter : public InputEventFilter {
 public:
+    WindowSelectorFilter()
+        : InputEventFilter(PointerEvents | WheelEvents | KeyEvents | TouchEvents)
+    {
+    }
+
     bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override {
         Q_UNUSED(nativeButton)
         if (!m_active) {
@@ -834,7 +868,9 @@ private:
 
 class GlobalShortcutFilter : public InputEventFilter {
 public:
-    GlobalShortcutFilter() {
+    GlobalShortcutFilter()
+        : InputEventFilter(PointerEvents | WheelEvents | KeyEvents | GestureEvents)
+    {
         m_powerDown = new QTimer;
         m_powerDown->setSingleShot(true);
         m_powerDown->setInterval(1000);
@@ -979,6 +1015,13 @@ std::pair<bool, bool> performClientWheelAction(QWheelEvent *event, AbstractClien
 }
 
 class InternalWindowEventFilter : public InputEventFilter {
+public:
+    InternalWindowEventFilter()
+        : InputEventFilter(PointerEvents | WheelEvents | KeyEvents | TouchEvents)
+    {
+    }
+
+private:
     bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override {
         Q_UNUSED(nativeButton)
         if (!input()->pointer()->focus() || !input()->pointer()->focus()->isInternal()) {
@@ -1144,6 +1187,11 @@ private:
 
 class DecorationEventFilter : public InputEventFilter {
 public:
+    DecorationEventFilter()
+        : InputEventFilter(PointerEvents | WheelEvents | TouchEvents | TabletEvents)
+    {
+    }
+
     bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override {
         Q_UNUSED(nativeButton)
         auto decoration = input()->pointer()->decoration();
@@ -1352,6 +1400,11 @@ private:
 class TabBoxInputFilter : public InputEventFilter
 {
 public:
+    TabBoxInputFilter()
+        : InputEventFilter(PointerEvents | WheelEvents | KeyEvents)
+    {
+    }
+
     bool pointerEvent(QMouseEvent *event, quint32 button) override {
         Q_UNUSED(button)
         if (!TabBox::TabBox::self() || !TabBox::TabBox::self()->isGrabbed()) {
@@ -1389,6 +1442,11 @@ public:
 class ScreenEdgeInputFilter : public InputEventFilter
 {
 public:
+    ScreenEdgeInputFilter()
+        : InputEventFilter(PointerEvents | TouchEvents)
+    {
+    }
+
     bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override {
         Q_UNUSED(nativeButton)
         ScreenEdges::self()->isEntered(event);
@@ -1444,6 +1502,11 @@ private:
 class WindowActionInputFilter : public InputEventFilter
 {
 public:
+    WindowActionInputFilter()
+        : InputEventFilter(PointerEvents | WheelEvents | TouchEvents | TabletEvents)
+    {
+    }
+
     bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override {
         Q_UNUSED(nativeButton)
         if (event->type() != QEvent::MouseButtonPress) {
@@ -1512,6 +1575,11 @@ public:
 class InputKeyboardFilter : public InputEventFilter
 {
 public:
+    InputKeyboardFilter()
+        : InputEventFilter(KeyEvents)
+    {
+    }
+
     bool keyEvent(QKeyEvent *event) override
     {
         return passToInputMethod(event);
@@ -1524,6 +1592,11 @@ public:
 class ForwardInputFilter : public InputEventFilter
 {
 public:
+    ForwardInputFilter()
+        : InputEventFilter(PointerEvents | WheelEvents | KeyEvents | TouchEvents | GestureEvents)
+    {
+    }
+
     bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override {
         auto seat = waylandServer()->seat();
         seat->setTimestamp(event->timestamp());
@@ -1531,7 +1604,13 @@ public:
         case QEvent::MouseMove: {
             seat->notifyPointerMotion(event->globalPos());
             MouseEvent *e = static_cast<MouseEvent*>(event);
-            if (e->delta() != QSizeF()) {
+            const auto coalescedMotions = e->coalescedMotions();
+            if (!coalescedMotions.isEmpty()) {
+                // relative pointer clients get every motion of a batch, not the sum
+                for (const MouseEvent::RelativeMotion &motion : coalescedMotions) {
+                    seat->relativePointerMotion(motion.delta, motion.deltaNonAccelerated, motion.timestampMicroseconds);
+                }
+            } else if (e->delta() != QSizeF()) {
                 seat->relativePointerMotion(e->delta(), e->deltaUnaccelerated(), e->timestampMicroseconds());
             }
             seat->notifyPointerFrame();
@@ -1716,6 +1795,7 @@ class TabletInputFilter : public QObject, public InputEventFilter
 {
 public:
     TabletInputFilter()
+        : InputEventFilter(TabletEvents)
     {
         const auto devices = input()->devices();
         for (InputDevice *device : devices) {
@@ -2059,6 +2139,7 @@ class DragAndDropInputFilter : public QObject, public InputEventFilter
     Q_OBJECT
 public:
     DragAndDropInputFilter()
+        : InputEventFilter(PointerEvents | TouchEvents)
     {
         m_raiseTimer.setSingleShot(true);
         m_raiseTimer.setInterval(250);
@@ -2253,17 +2334,35 @@ void InputRedirection::installInputEventFilter(InputEventFilter *filter)
 {
     Q_ASSERT(!m_filters.contains(filter));
     m_filters << filter;
+    updateFilterDispatch();
 }
 
 void InputRedirection::prependInputEventFilter(InputEventFilter *filter)
 {
     Q_ASSERT(!m_filters.contains(filter));
     m_filters.prepend(filter);
+    updateFilterDispatch();
 }
 
 void InputRedirection::uninstallInputEventFilter(InputEventFilter *filter)
 {
-    m_filters.removeOne(filter);
+    if (m_filters.removeOne(filter)) {
+        updateFilterDispatch();
+    }
+}
+
+void InputRedirection::updateFilterDispatch()
+{
+    for (int i = 0; i < InputEventFilter::EventTypeCount; ++i) {
+        const InputEventFilter::EventType type = InputEventFilter::EventType(1 << i);
+        QVector<InputEventFilter *> &filters = m_filterDispatch[i];
+        filters.clear();
+        for (InputEventFilter *filter : qAsConst(m_filters)) {
+            if (filter->eventTypes() & type) {
+                filters.append(filter);
+            }
+        }
+    }
 }
 
 void InputRedirection::installInputEventSpy(InputEventSpy *spy)
@@ -2558,7 +2657,7 @@ void InputRedirection::handleInputDeviceAdded(InputDevice *device)
     auto handleSwitchEvent = [this] (SwitchEvent::State state, quint32 time, quint64 timeMicroseconds, InputDevice *device) {
         SwitchEvent event(state, time, timeMicroseconds, device);
         processSpies(std::bind(&InputEventSpy::switchEvent, std::placeholders::_1, &event));
-        processFilters(std::bind(&InputEventFilter::switchEvent, std::placeholders::_1, &event));
+        processFilters(InputEventFilter::SwitchEvents, std::bind(&InputEventFilter::switchEvent, std::placeholders::_1, &event));
     };
     connect(device, &InputDevice::switchToggledOn, this,
             std::bind(handleSwitchEvent, SwitchEvent::State::On, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
@@ -2783,37 +2882,10 @@ Toplevel *InputRedirection::findManagedToplevel(const QPoint &pos)
     if (!Workspace::self()) {
         return nullptr;
     }
-    const bool isScreenLocked = waylandServer() && waylandServer()->isScreenLocked();
-    const QList<Toplevel *> &stacking = Workspace::self()->stackingOrder();
-    if (stacking.isEmpty()) {
-        return nullptr;
+    if (!m_hitTestIndex) {
+        m_hitTestIndex = new HitTestIndex(this);
     }
-    auto it = stacking.end();
-    do {
-        --it;
-        Toplevel *t = (*it);
-        if (t->isDeleted()) {
-            // a deleted window doesn't get mouse events
-            continue;
-        }
-        if (AbstractClient *c = dynamic_cast<AbstractClient*>(t)) {
-            if (!c->isOnCurrentActivity() || !c->isOnCurrentDesktop() || c->isMinimized() || c->isHiddenInternal()) {
-                continue;
-            }
-        }
-        if (!t->readyForPainting()) {
-            continue;
-        }
-        if (isScreenLocked) {
-            if (!t->isLockScreen() && !t->isInputMethod()) {
-                continue;
-            }
-        }
-        if (t->hitTest(pos)) {
-            return t;
-        }
-    } while (it != stacking.begin());
-    return nullptr;
+    return m_hitTestIndex->findManagedToplevel(pos);
 }
 
 Qt::KeyboardModifiers InputRedirection::keyboardModifiers() const
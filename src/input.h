@@ -21,6 +21,7 @@
 #include <KSharedConfig>
 #include <QSet>
 
+#include <array>
 #include <functional>
 
 class KGlobalAccelInterface;
@@ -32,6 +33,7 @@ class QWheelEvent;
 namespace KWin
 {
 class GlobalShortcutsManager;
+class HitTestIndex;
 class Toplevel;
 class InputEventFilter;
 class InputEventSpy;
@@ -53,6 +55,118 @@ class DecoratedClientImpl;
 class InputBackend;
 class InputDevice;
 
+/**
+ * Base class for filtering input events inside InputRedirection.
+ *
+ * The idea behind the InputEventFilter is to have task oriented
+ * filters. E.g. there is one filter taking care of a locked screen,
+ * one to take care of interacting with window decorations, etc.
+ *
+ * A concrete subclass can reimplement the virtual methods and decide
+ * whether an event should be filtered out or not by returning either
+ * @c true or @c false. E.g. the lock screen filter can easily ensure
+ * that all events are filtered out.
+ *
+ * As soon as a filter returns @c true the processing is stopped. If
+ * a filter returns @c false the next one is invoked. This means a filter
+ * installed early gets to see more events than a filter installed later on.
+ *
+ * A filter declares the classes of events it is interested in when it is constructed.
+ * InputRedirection only passes events of these classes to the filter, which spares the
+ * other filters a virtual call for every pointer motion or key press.
+ *
+ * Deleting an instance of InputEventFilter automatically uninstalls it from
+ * InputRedirection.
+ */
+class KWIN_EXPORT InputEventFilter
+{
+public:
+    enum EventType {
+        PointerEvents = 1 << 0,
+        WheelEvents = 1 << 1,
+        KeyEvents = 1 << 2,
+        TouchEvents = 1 << 3,
+        GestureEvents = 1 << 4,
+        SwitchEvents = 1 << 5,
+        TabletEvents = 1 << 6,
+        AllEvents = (1 << 7) - 1,
+    };
+    Q_DECLARE_FLAGS(EventTypes, EventType)
+    static constexpr int EventTypeCount = 7;
+
+    explicit InputEventFilter(EventTypes eventTypes = AllEvents);
+    virtual ~InputEventFilter();
+
+    /**
+     * The classes of events passed to this filter.
+     */
+    EventTypes eventTypes() const {
+        return m_eventTypes;
+    }
+
+    /**
+     * Event filter for pointer events which can be described by a QMouseEvent.
+     *
+     * Please note that the button translation in QMouseEvent cannot cover all
+     * possible buttons. Because of that also the @p nativeButton code is passed
+     * through the filter. For internal areas it's fine to use @p event, but for
+     * passing to client windows the @p nativeButton should be used.
+     *
+     * @param event The event information about the move or button press/release
+     * @param nativeButton The native key code of the button, for move events 0
+     * @return @c true to stop further event processing, @c false to pass to next filter
+     */
+    virtual bool pointerEvent(QMouseEvent *event, quint32 nativeButton);
+    /**
+     * Event filter for pointer axis events.
+     *
+     * @param event The event information about the axis event
+     * @return @c true to stop further event processing, @c false to pass to next filter
+     */
+    virtual bool wheelEvent(QWheelEvent *event);
+    /**
+     * Event filter for keyboard events.
+     *
+     * @param event The event information about the key event
+     * @return @c tru to stop further event processing, @c false to pass to next filter.
+     */
+    virtual bool keyEvent(QKeyEvent *event);
+    virtual bool touchDown(qint32 id, const QPointF &pos, quint32 time);
+    virtual bool touchMotion(qint32 id, const QPointF &pos, quint32 time);
+    virtual bool touchUp(qint32 id, quint32 time);
+
+    virtual bool pinchGestureBegin(int fingerCount, quint32 time);
+    virtual bool pinchGestureUpdate(qreal scale, qreal angleDelta, const QSizeF &delta, quint32 time);
+    virtual bool pinchGestureEnd(quint32 time);
+    virtual bool pinchGestureCancelled(quint32 time);
+
+    virtual bool swipeGestureBegin(int fingerCount, quint32 time);
+    virtual bool swipeGestureUpdate(const QSizeF &delta, quint32 time);
+    virtual bool swipeGestureEnd(quint32 time);
+    virtual bool swipeGestureCancelled(quint32 time);
+
+    virtual bool holdGestureBegin(int fingerCount, quint32 time);
+    virtual bool holdGestureEnd(quint32 time);
+    virtual bool holdGestureCancelled(quint32 time);
+
+    virtual bool switchEvent(SwitchEvent *event);
+
+    virtual bool tabletToolEvent(TabletEvent *event);
+    virtual bool tabletToolButtonEvent(uint button, bool pressed, const TabletToolId &tabletToolId);
+    virtual bool tabletPadButtonEvent(uint button, bool pressed, const TabletPadId &tabletPadId);
+    virtual bool tabletPadStripEvent(int number, int position, bool isFinger, const TabletPadId &tabletPadId);
+    virtual bool tabletPadRingEvent(int number, int position, bool isFinger, const TabletPadId &tabletPadId);
+
+protected:
+    void passToWaylandServer(QKeyEvent *event);
+    bool passToInputMethod(QKeyEvent *event);
+
+private:
+    EventTypes m_eventTypes;
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(InputEventFilter::EventTypes)
+
 /**
  * @brief This class is responsible for redirecting incoming input to the surface which currently
  * has input or send enter/leave events.
@@ -168,7 +282,7 @@ public:
     }
 
     /**
-     * Sends an event through all InputFilters.
+     * Sends an event of the given @p type through all InputFilters interested in it.
      * The method @p function is invoked on each input filter. Processing is stopped if
      * a filter returns @c true for @p function.
      *
@@ -182,8 +296,10 @@ public:
      * bind.
      */
     template <class UnaryPredicate>
-    void processFilters(UnaryPredicate function) {
-        std::any_of(m_filters.constBegin(), m_filters.constEnd(), function);
+    void processFilters(InputEventFilter::EventType type, UnaryPredicate function) {
+        // a shallow copy, filters may get uninstalled while the event is processed
+        const QVector<InputEventFilter *> filters = m_filterDispatch[qCountTrailingZeroBits(quint32(type))];
+        std::any_of(filters.constBegin(), filters.constEnd(), function);
     }
 
     /**
@@ -296,6 +412,7 @@ private:
     void setupWorkspace();
     void setupInputFilters();
     void installInputEventFilter(InputEventFilter *filter);
+    void updateFilterDispatch();
     void updateLeds(LEDs leds);
     void updateAvailableInputDevices();
     void addInputBackend(InputBackend *inputBackend);
@@ -311,8 +428,11 @@ private:
     QList<InputDevice *> m_inputDevices;
 
     WindowSelectorFilter *m_windowSelector = nullptr;
+    HitTestIndex *m_hitTestIndex = nullptr;
 
     QVector<InputEventFilter*> m_filters;
+    // the installed filters interested in each event type, in processing order
+    std::array<QVector<InputEventFilter *>, InputEventFilter::EventTypeCount> m_filterDispatch;
     QVector<InputEventSpy*> m_spies;
     KConfigWatcher::Ptr m_inputConfigWatcher;
 
@@ -331,89 +451,6 @@ private:
     friend class ForwardInputFilter;
 };
 
-/**
- * Base class for filtering input events inside InputRedirection.
- *
- * The idea behind the InputEventFilter is to have task oriented
- * filters. E.g. there is one filter taking care of a locked screen,
- * one to take care of interacting with window decorations, etc.
- *
- * A concrete subclass can reimplement the virtual methods and decide
- * whether an event should be filtered out or not by returning either
- * @c true or @c false. E.g. the lock screen filter can easily ensure
- * that all events are filtered out.
- *
- * As soon as a filter returns @c true the processing is stopped. If
- * a filter returns @c false the next one is invoked. This means a filter
- * installed early gets to see more events than a filter installed later on.
- *
- * Deleting an instance of InputEventFilter automatically uninstalls it from
- * InputRedirection.
- */
-class KWIN_EXPORT InputEventFilter
-{
-public:
-    InputEventFilter();
-    virtual ~InputEventFilter();
-
-    /**
-     * Event filter for pointer events which can be described by a QMouseEvent.
-     *
-     * Please note that the button translation in QMouseEvent cannot cover all
-     * possible buttons. Because of that also the @p nativeButton code is passed
-     * through the filter. For internal areas it's fine to use @p event, but for
-     * passing to client windows the @p nativeButton should be used.
-     *
-     * @param event The event information about the move or button press/release
-     * @param nativeButton The native key code of the button, for move events 0
-     * @return @c true to stop further event processing, @c false to pass to next filter
-     */
-    virtual bool pointerEvent(QMouseEvent *event, quint32 nativeButton);
-    /**
-     * Event filter for pointer axis events.
-     *
-     * @param event The event information about the axis event
-     * @return @c true to stop further event processing, @c false to pass to next filter
-     */
-    virtual bool wheelEvent(QWheelEvent *event);
-    /**
-     * Event filter for keyboard events.
-     *
-     * @param event The event information about the key event
-     * @return @c tru to stop further event processing, @c false to pass to next filter.
-     */
-    virtual bool keyEvent(QKeyEvent *event);
-    virtual bool touchDown(qint32 id, const QPointF &pos, quint32 time);
-    virtual bool touchMotion(qint32 id, const QPointF &pos, quint32 time);
-    virtual bool touchUp(qint32 id, quint32 time);
-
-    virtual bool pinchGestureBegin(int fingerCount, quint32 time);
-    virtual bool pinchGestureUpdate(qreal scale, qreal angleDelta, const QSizeF &delta, quint32 time);
-    virtual bool pinchGestureEnd(quint32 time);
-    virtual bool pinchGestureCancelled(quint32 time);
-
-    virtual bool swipeGestureBegin(int fingerCount, quint32 time);
-    virtual bool swipeGestureUpdate(const QSizeF &delta, quint32 time);
-    virtual bool swipeGestureEnd(quint32 time);
-    virtual bool swipeGestureCancelled(quint32 time);
-
-    virtual bool holdGestureBegin(int fingerCount, quint32 time);
-    virtual bool holdGestureEnd(quint32 time);
-    virtual bool holdGestureCancelled(quint32 time);
-
-    virtual bool switchEvent(SwitchEvent *event);
-
-    virtual bool tabletToolEvent(TabletEvent *event);
-    virtual bool tabletToolButtonEvent(uint button, bool pressed, const TabletToolId &tabletToolId);
-    virtual bool tabletPadButtonEvent(uint button, bool pressed, const TabletPadId &tabletPadId);
-    virtual bool tabletPadStripEvent(int number, int position, bool isFinger, const TabletPadId &tabletPadId);
-    virtual bool tabletPadRingEvent(int number, int position, bool isFinger, const TabletPadId &tabletPadId);
-
-protected:
-    void passToWaylandServer(QKeyEvent *event);
-    bool passToInputMethod(QKeyEvent *event);
-};
-
 class KWIN_EXPORT InputDeviceHandler : public QObject
 {
     Q_OBJECT
@@ -12,6 +12,7 @@
 #include "input.h"
 
 #include <QInputEvent>
+#include <QVector>
 
 namespace KWin
 {
@@ -21,6 +22,16 @@ class InputDevice;
 class MouseEvent : public QMouseEvent
 {
 public:
+    /**
+     * A single relative motion of a pointer device, as reported by the device.
+     */
+    struct RelativeMotion
+    {
+        QSizeF delta;
+        QSizeF deltaNonAccelerated;
+        quint64 timestampMicroseconds;
+    };
+
     explicit MouseEvent(QEvent::Type type, const QPointF &pos, Qt::MouseButton button, Qt::MouseButtons buttons,
                         Qt::KeyboardModifiers modifiers, quint32 timestamp,
                         const QSizeF &delta, const QSizeF &deltaNonAccelerated, quint64 timestampMicroseconds,
@@ -58,6 +69,18 @@ public:
         m_nativeButton = button;
     }
 
+    /**
+     * The individual motions that have been coalesced into this event. Empty if the event
+     * corresponds to a single motion, in which case delta() is the device delta.
+     */
+    QVector<RelativeMotion> coalescedMotions() const {
+        return m_coalescedMotions;
+    }
+
+    void setCoalescedMotions(const QVector<RelativeMotion> &motions) {
+        m_coalescedMotions = motions;
+    }
+
 private:
     QSizeF m_delta;
     QSizeF m_deltaUnccelerated;
@@ -65,6 +88,7 @@ private:
     InputDevice *m_device;
     Qt::KeyboardModifiers m_modifiersRelevantForShortcuts = Qt::KeyboardModifiers();
     quint32 m_nativeButton = 0;
+    QVector<RelativeMotion> m_coalescedMotions;
 };
 
 // TODO: Don't derive from QWheelEvent, this event is quite domain specific.
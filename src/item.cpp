@@ -301,6 +301,12 @@ WindowQuadList Item::buildQuads() const
 void Item::discardQuads()
 {
     m_quads.reset();
+    m_quadsGeneration++;
+}
+
+quint64 Item::quadsGeneration() const
+{
+    return m_quadsGeneration;
 }
 
 WindowQuadList Item::quads() const
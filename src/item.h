@@ -91,6 +91,11 @@ public:
     void resetRepaints(AbstractOutput *output);
 
     WindowQuadList quads() const;
+    /**
+     * Returns a number that changes whenever the quads of the item are discarded. It allows
+     * renderers to keep data derived from the quads without comparing them.
+     */
+    quint64 quadsGeneration() const;
     virtual void preprocess();
 
 Q_SIGNALS:
@@ -135,6 +140,7 @@ private:
     bool m_effectiveVisible = true;
     QMap<AbstractOutput *, QRegion> m_repaints;
     mutable std::optional<WindowQuadList> m_quads;
+    quint64 m_quadsGeneration = 0;
     mutable std::optional<QList<Item *>> m_sortedChildItems;
 };
 
@@ -14,6 +14,7 @@
 #include "keyboard_layout.h"
 #include "keyboard_repeat.h"
 #include "modifier_only_shortcuts.h"
+#include "pointer_input.h"
 #include "screenlockerwatcher.h"
 #include "toplevel.h"
 #include "utils/common.h"
@@ -206,6 +207,9 @@ void KeyboardInputRedirection::update()
 
 void KeyboardInputRedirection::processKey(uint32_t key, InputRedirection::KeyboardKeyState state, uint32_t time, InputDevice *device)
 {
+    // keep the order of pointer motion and key events if pointer motion is batched
+    input()->pointer()->flushPendingMotion();
+
     QEvent::Type type;
     bool autoRepeat = false;
     switch (state) {
@@ -245,7 +249,7 @@ void KeyboardInputRedirection::processKey(uint32_t key, InputRedirection::Keyboa
         return;
     }
     input()->setLastInputHandler(this);
-    m_input->processFilters(std::bind(&InputEventFilter::keyEvent, std::placeholders::_1, &event));
+    m_input->processFilters(InputEventFilter::KeyEvents, std::bind(&InputEventFilter::keyEvent, std::placeholders::_1, &event));
 
     m_xkb->forwardModifiers();
     if (auto *inputmethod = InputMethod::self()) {
@@ -82,10 +82,7 @@
 #include "internal_client.h"
 #include "virtualdesktops.h"
 
-#include <array>
-
 #include <QDebug>
-#include <QQueue>
 
 namespace KWin
 {
@@ -512,57 +509,29 @@ static Layer computeLayer(const Toplevel *toplevel)
  */
 QList<Toplevel *> Workspace::constrainedStackingOrder()
 {
-    // Sort the windows based on their layers while preserving their relative order in the
-    // unconstrained stacking order.
-    std::array<QList<Toplevel *>, NumLayers> windows;
-    for (Toplevel *window : qAsConst(unconstrained_stacking_order)) {
-        const Layer layer = computeLayer(window);
-        windows[layer] << window;
-    }
-
-    QList<Toplevel *> stacking;
-    stacking.reserve(unconstrained_stacking_order.count());
-    for (uint layer = FirstLayer; layer < NumLayers; ++layer) {
-        stacking += windows[layer];
-    }
-
-    // Apply the stacking order constraints. First, we enqueue the root constraints, i.e.
-    // the ones that are not affected by other constraints.
-    QQueue<Constraint *> constraints;
-    constraints.reserve(m_constraints.count());
-    for (Constraint *constraint : qAsConst(m_constraints)) {
-        if (constraint->parents.isEmpty()) {
-            constraint->enqueued = true;
-            constraints.enqueue(constraint);
-        } else {
-            constraint->enqueued = false;
-        }
+    if (m_constrainedStackingOrder.restack(unconstrained_stacking_order)) {
+        return m_constrainedStackingOrder.windows();
     }
 
-    // Once we've enqueued all the root constraints, we traverse the constraints tree in
-    // the breadth-first search fashion. A constraint is applied only if its condition is
-    // not met.
-    while (!constraints.isEmpty()) {
-        Constraint *constraint = constraints.dequeue();
-
-        const int belowIndex = stacking.indexOf(constraint->below);
-        const int aboveIndex = stacking.indexOf(constraint->above);
-        if (belowIndex == -1 || aboveIndex == -1) {
-            continue;
-        } else if (aboveIndex < belowIndex) {
-            stacking.removeAt(aboveIndex);
-            stacking.insert(belowIndex, constraint->above);
-        }
-
-        for (Constraint *child : qAsConst(constraint->children)) {
-            if (!child->enqueued) {
-                child->enqueued = true;
-                constraints.enqueue(child);
-            }
+    bool groupLayers = false;
+    m_constrainedStackingOrder.update(unconstrained_stacking_order, [&groupLayers](const Toplevel *toplevel) {
+        if (auto client = qobject_cast<const X11Client *>(toplevel)) {
+            // The layer depends on the layers and outputs of the other group members, which
+            // don't invalidate the layer of the client when they change.
+            const Group *group = client->group();
+            groupLayers |= group && group->members().count() > 1;
         }
+        return computeLayer(toplevel);
+    }, m_constraints);
+    if (groupLayers) {
+        m_constrainedStackingOrder.invalidate();
     }
+    return m_constrainedStackingOrder.windows();
+}
 
-    return stacking;
+void Workspace::invalidateConstrainedStackingOrder()
+{
+    m_constrainedStackingOrder.invalidate();
 }
 
 void Workspace::blockStackingUpdates(bool block)
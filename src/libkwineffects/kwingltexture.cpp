@@ -16,6 +16,7 @@
 #include "kwinglutils.h"
 
 #include "kwingltexture_p.h"
+#include "logging_p.h"
 
 #include <QPixmap>
 #include <QImage>
@@ -23,9 +24,133 @@
 #include <QVector3D>
 #include <QVector4D>
 
+#include <array>
+#include <limits>
+
 namespace KWin
 {
 
+//****************************************
+// GLUploadRing
+//****************************************
+
+/**
+ * The GLUploadRing class is a ring of pixel unpack buffers that texture uploads are staged
+ * in. Every buffer is guarded by a fence, so it's written again only once the GPU has copied
+ * its previous contents into a texture. If the next buffer is still busy, map() fails rather
+ * than stalling, and the caller uploads the pixels directly.
+ */
+class GLUploadRing
+{
+public:
+    GLUploadRing();
+    ~GLUploadRing();
+
+    static bool isSupported();
+
+    /**
+     * Binds the next buffer to GL_PIXEL_UNPACK_BUFFER and maps @a size bytes of it, or
+     * returns @c nullptr if the buffer is still in use.
+     */
+    uchar *map(GLsizeiptr size);
+    /**
+     * Unmaps the current buffer, returns @c false if its contents have been lost.
+     */
+    bool unmap();
+    /**
+     * Fences the uploads issued from the current buffer and moves to the next one.
+     */
+    void fence();
+
+private:
+    struct Buffer
+    {
+        GLuint name = 0;
+        GLsizeiptr size = 0;
+        GLsync fence = 0;
+    };
+
+    std::array<Buffer, 4> m_buffers;
+    size_t m_current = 0;
+};
+
+// Uploads bigger than this aren't worth keeping a staging buffer around for.
+static const GLsizeiptr s_maxUploadBufferSize = 64 * 1024 * 1024;
+
+GLUploadRing::GLUploadRing()
+{
+    for (Buffer &buffer : m_buffers) {
+        glGenBuffers(1, &buffer.name);
+    }
+}
+
+GLUploadRing::~GLUploadRing()
+{
+    for (Buffer &buffer : m_buffers) {
+        if (buffer.fence) {
+            glDeleteSync(buffer.fence);
+        }
+        glDeleteBuffers(1, &buffer.name);
+    }
+}
+
+bool GLUploadRing::isSupported()
+{
+    if (GLPlatform::instance()->isGLES()) {
+        return hasGLVersion(3, 0);
+    }
+    const bool haveUnpackBuffers = hasGLVersion(2, 1) || hasGLExtension(QByteArrayLiteral("GL_ARB_pixel_buffer_object"));
+    const bool haveMapBufferRange = hasGLVersion(3, 0) || hasGLExtension(QByteArrayLiteral("GL_ARB_map_buffer_range"));
+    const bool haveSyncFences = hasGLVersion(3, 2) || hasGLExtension(QByteArrayLiteral("GL_ARB_sync"));
+    return haveUnpackBuffers && haveMapBufferRange && haveSyncFences;
+}
+
+uchar *GLUploadRing::map(GLsizeiptr size)
+{
+    if (size > s_maxUploadBufferSize) {
+        return nullptr;
+    }
+
+    Buffer &buffer = m_buffers[m_current];
+    if (buffer.fence) {
+        const GLenum status = glClientWaitSync(buffer.fence, 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED) {
+            return nullptr;
+        }
+        glDeleteSync(buffer.fence);
+        buffer.fence = 0;
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.name);
+    if (buffer.size < size) {
+        // Round the size up to 64 kb, so the buffer isn't reallocated for every bigger upload.
+        buffer.size = (size + 0xffff) & ~GLsizeiptr(0xffff);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, buffer.size, nullptr, GL_STREAM_DRAW);
+    }
+
+    // The buffer isn't in use by the GPU anymore, so there's no need to synchronize.
+    const GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+    uchar *map = static_cast<uchar *>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, access));
+    if (!map) {
+        qCWarning(LIBKWINGLUTILS) << "Failed to map a pixel unpack buffer";
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    return map;
+}
+
+bool GLUploadRing::unmap()
+{
+    return glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+}
+
+void GLUploadRing::fence()
+{
+    Buffer &buffer = m_buffers[m_current];
+    buffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    m_current = (m_current + 1) % m_buffers.size();
+}
+
 //****************************************
 // GLTexture
 //****************************************
@@ -37,6 +162,7 @@ bool GLTexturePrivate::s_supportsTextureStorage = false;
 bool GLTexturePrivate::s_supportsTextureSwizzle = false;
 bool GLTexturePrivate::s_supportsTextureFormatRG = false;
 uint GLTexturePrivate::s_fbo = 0;
+GLUploadRing *GLTexturePrivate::s_uploadRing = nullptr;
 
 // Table of GL formats/types associated with different values of QImage::Format.
 // Zero values indicate a direct upload is not feasible.
@@ -321,6 +447,10 @@ void GLTexturePrivate::initStatic()
 
         s_supportsUnpack = hasGLExtension(QByteArrayLiteral("GL_EXT_unpack_subimage"));
     }
+
+    if (GLUploadRing::isSupported() && qgetenv("KWIN_GL_PBO_UPLOADS") != QByteArrayLiteral("0")) {
+        s_uploadRing = new GLUploadRing();
+    }
 }
 
 void GLTexturePrivate::cleanup()
@@ -331,6 +461,8 @@ void GLTexturePrivate::cleanup()
         glDeleteFramebuffers(1, &s_fbo);
         s_fbo = 0;
     }
+    delete s_uploadRing;
+    s_uploadRing = nullptr;
 }
 
 bool GLTexture::isNull() const
@@ -355,6 +487,33 @@ void GLTexture::setSize(const QSize &size)
     d->updateMatrix();
 }
 
+/**
+ * Returns the format @a format has to be converted to before it can be uploaded, along with
+ * the matching GL format and type.
+ */
+static QImage::Format textureUploadFormat(QImage::Format format, GLenum *glFormat, GLenum *type)
+{
+    if (!GLPlatform::instance()->isGLES()) {
+        if (format < sizeof(formatTable) / sizeof(formatTable[0]) && formatTable[format].internalFormat) {
+            *glFormat = formatTable[format].format;
+            *type = formatTable[format].type;
+            return format;
+        }
+        *glFormat = GL_BGRA;
+        *type = GL_UNSIGNED_INT_8_8_8_8_REV;
+        return QImage::Format_ARGB32_Premultiplied;
+    }
+
+    if (GLTexturePrivate::s_supportsARGB32) {
+        *glFormat = GL_BGRA_EXT;
+        *type = GL_UNSIGNED_BYTE;
+        return QImage::Format_ARGB32_Premultiplied;
+    }
+    *glFormat = GL_RGBA;
+    *type = GL_UNSIGNED_BYTE;
+    return QImage::Format_RGBA8888_Premultiplied;
+}
+
 void GLTexture::update(const QImage &image, const QPoint &offset, const QRect &src)
 {
     if (image.isNull() || isNull())
@@ -365,30 +524,7 @@ void GLTexture::update(const QImage &image, const QPoint &offset, const QRect &s
 
     GLenum glFormat;
     GLenum type;
-    QImage::Format uploadFormat;
-    if (!GLPlatform::instance()->isGLES()) {
-        const QImage::Format index = image.format();
-
-        if (index < sizeof(formatTable) / sizeof(formatTable[0]) && formatTable[index].internalFormat) {
-            glFormat = formatTable[index].format;
-            type = formatTable[index].type;
-            uploadFormat = index;
-        } else {
-            glFormat = GL_BGRA;
-            type = GL_UNSIGNED_INT_8_8_8_8_REV;
-            uploadFormat = QImage::Format_ARGB32_Premultiplied;
-        }
-    } else {
-        if (d->s_supportsARGB32) {
-            glFormat = GL_BGRA_EXT;
-            type = GL_UNSIGNED_BYTE;
-            uploadFormat = QImage::Format_ARGB32_Premultiplied;
-        } else {
-            glFormat = GL_RGBA;
-            type = GL_UNSIGNED_BYTE;
-            uploadFormat = QImage::Format_RGBA8888_Premultiplied;
-        }
-    }
+    const QImage::Format uploadFormat = textureUploadFormat(image.format(), &glFormat, &type);
     bool useUnpack = d->s_supportsUnpack && image.format() == uploadFormat && !src.isNull();
 
     QImage im;
@@ -429,6 +565,168 @@ void GLTexture::update(const QImage &image, const QPoint &offset, const QRect &s
     }
 }
 
+// Damage is uploaded with at most this many rects.
+static const int s_maxUploadRects = 4;
+
+// Clusters are merged pairwise until at most this many are left, before the closest ones are
+// searched for. This bounds the cost of the search for damage made of many rects.
+static const int s_maxUploadClusters = 32;
+
+namespace
+{
+struct UploadCluster
+{
+    QRect bounds;
+    qint64 area;
+};
+}
+
+static qint64 rectArea(const QRect &rect)
+{
+    return qint64(rect.width()) * rect.height();
+}
+
+static bool isWorthMerging(const QRect &bounds, qint64 area)
+{
+    return rectArea(bounds) <= 2 * area;
+}
+
+/**
+ * Every upload has a fixed cost, so the rects of the damage are merged into clusters. Two
+ * clusters are merged if their bounding rect is mostly made of pixels that have changed, and
+ * the clusters that waste the fewest pixels are merged until there are few enough of them.
+ */
+static QVector<QRect> mergeUploadRects(const QRegion &region)
+{
+    if (region.rectCount() == 1) {
+        return {region.boundingRect()};
+    }
+
+    // The rects of a region are sorted by bands, so neighbours are usually close to each other.
+    QVector<UploadCluster> clusters;
+    clusters.reserve(region.rectCount());
+    for (const QRect &rect : region) {
+        if (!clusters.isEmpty()) {
+            UploadCluster &last = clusters.last();
+            const QRect bounds = last.bounds | rect;
+            const qint64 area = last.area + rectArea(rect);
+            if (isWorthMerging(bounds, area)) {
+                last = UploadCluster{bounds, area};
+                continue;
+            }
+        }
+        clusters.append(UploadCluster{rect, rectArea(rect)});
+    }
+
+    while (clusters.count() > s_maxUploadClusters) {
+        QVector<UploadCluster> merged;
+        merged.reserve((clusters.count() + 1) / 2);
+        for (int i = 0; i < clusters.count(); i += 2) {
+            if (i + 1 < clusters.count()) {
+                merged.append(UploadCluster{clusters[i].bounds | clusters[i + 1].bounds, clusters[i].area + clusters[i + 1].area});
+            } else {
+                merged.append(clusters[i]);
+            }
+        }
+        clusters = merged;
+    }
+
+    while (clusters.count() > 1) {
+        int first = -1;
+        int second = -1;
+        QRect bestBounds;
+        qint64 bestArea = 0;
+        qint64 bestWaste = std::numeric_limits<qint64>::max();
+        for (int i = 0; i < clusters.count(); ++i) {
+            for (int j = i + 1; j < clusters.count(); ++j) {
+                const QRect bounds = clusters[i].bounds | clusters[j].bounds;
+                const qint64 area = clusters[i].area + clusters[j].area;
+                const qint64 waste = rectArea(bounds) - area;
+                if (waste < bestWaste) {
+                    first = i;
+                    second = j;
+                    bestBounds = bounds;
+                    bestArea = area;
+                    bestWaste = waste;
+                }
+            }
+        }
+        if (clusters.count() <= s_maxUploadRects && !isWorthMerging(bestBounds, bestArea)) {
+            break;
+        }
+        clusters[first] = UploadCluster{bestBounds, bestArea};
+        clusters.remove(second);
+    }
+
+    QVector<QRect> rects;
+    rects.reserve(clusters.count());
+    for (const UploadCluster &cluster : qAsConst(clusters)) {
+        rects.append(cluster.bounds);
+    }
+    return rects;
+}
+
+void GLTexture::update(const QImage &image, const QRegion &region)
+{
+    if (image.isNull() || isNull()) {
+        return;
+    }
+
+    Q_D(GLTexture);
+    Q_ASSERT(!d->m_foreign);
+
+    const QRegion clipped = region & image.rect();
+    if (clipped.isEmpty()) {
+        return;
+    }
+    const QVector<QRect> rects = mergeUploadRects(clipped);
+
+    GLenum glFormat;
+    GLenum type;
+    const QImage::Format uploadFormat = textureUploadFormat(image.format(), &glFormat, &type);
+
+    // Rows are copied tightly packed, which matches the default unpack alignment only for
+    // 32 bit formats.
+    GLUploadRing *ring = GLTexturePrivate::s_uploadRing;
+    if (ring && image.format() == uploadFormat && image.depth() == 32) {
+        const int bytesPerPixel = image.depth() / 8;
+        GLsizeiptr size = 0;
+        for (const QRect &rect : rects) {
+            size += GLsizeiptr(rect.width()) * rect.height() * bytesPerPixel;
+        }
+
+        if (uchar *map = ring->map(size)) {
+            uchar *dst = map;
+            for (const QRect &rect : rects) {
+                const int rowSize = rect.width() * bytesPerPixel;
+                for (int y = rect.top(); y <= rect.bottom(); ++y) {
+                    memcpy(dst, image.constScanLine(y) + rect.x() * bytesPerPixel, rowSize);
+                    dst += rowSize;
+                }
+            }
+
+            if (ring->unmap()) {
+                bind();
+                intptr_t offset = 0;
+                for (const QRect &rect : rects) {
+                    glTexSubImage2D(d->m_target, 0, rect.x(), rect.y(), rect.width(), rect.height(),
+                                    glFormat, type, reinterpret_cast<const GLvoid *>(offset));
+                    offset += intptr_t(rect.width()) * rect.height() * bytesPerPixel;
+                }
+                unbind();
+                ring->fence();
+                return;
+            }
+            ring->fence();
+        }
+    }
+
+    // The staging buffers are busy or not supported, upload the pixels directly.
+    for (const QRect &rect : rects) {
+        update(image, rect.topLeft(), rect);
+    }
+}
+
 void GLTexture::discard()
 {
     d_ptr = new GLTexturePrivate();
@@ -100,6 +100,17 @@ public:
     QMatrix4x4 matrix(TextureCoordinateType type) const;
 
     void update(const QImage& image, const QPoint &offset = QPoint(0, 0), const QRect &src = QRect());
+    /**
+     * Uploads the given @a region of @a image to the same region of the texture.
+     *
+     * Damage made of many rects is merged into fewer, larger rects. If pixel unpack
+     * buffers are supported, the pixels are copied into a staging buffer and the GPU
+     * transfers them into the texture asynchronously; the image is not accessed anymore
+     * after this function returns.
+     *
+     * @since 5.25
+     */
+    void update(const QImage &image, const QRegion &region);
     virtual void discard();
     void bind();
     void unbind();
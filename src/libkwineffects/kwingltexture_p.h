@@ -25,6 +25,7 @@
 namespace KWin
 {
 // forward declarations
+class GLUploadRing;
 class GLVertexBuffer;
 
 class KWINGLUTILS_EXPORT GLTexturePrivate
@@ -69,6 +70,7 @@ public:
     static bool s_supportsTextureSwizzle;
     static bool s_supportsTextureFormatRG;
     static GLuint s_fbo;
+    static GLUploadRing *s_uploadRing;
 private:
     friend void KWin::cleanupGL();
     static void cleanup();
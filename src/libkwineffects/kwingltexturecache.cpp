@@ -0,0 +1,161 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2026 KWin contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "kwingltexturecache.h"
+#include "kwingltexture.h"
+#include "logging_p.h"
+
+#include <QCache>
+#include <QHash>
+#include <QImage>
+
+#include <limits>
+
+namespace KWin
+{
+
+// Enough for a few hundred icons, which is what a task switcher shows at most.
+static const qint64 s_defaultMemoryLimit = 16 * 1024 * 1024;
+
+struct GLTextureCacheKey
+{
+    uint hash;
+    QSize size;
+    QImage::Format format;
+};
+
+static bool operator==(const GLTextureCacheKey &a, const GLTextureCacheKey &b)
+{
+    return a.hash == b.hash && a.size == b.size && a.format == b.format;
+}
+
+static uint qHash(const GLTextureCacheKey &key, uint seed = 0)
+{
+    return ::qHash(key.hash, seed) ^ ::qHash(key.size.width(), seed) ^ ::qHash(int(key.format), seed);
+}
+
+static GLTextureCacheKey contentKey(const QImage &image)
+{
+    // Only hash the pixels, the padding at the end of the scanlines is undefined.
+    const int rowSize = image.width() * image.depth() / 8;
+    uint hash = ::qHash(image.height());
+    for (int y = 0; y < image.height(); ++y) {
+        hash = qHashBits(image.constScanLine(y), rowSize, hash);
+    }
+    return GLTextureCacheKey{hash, image.size(), image.format()};
+}
+
+struct GLTextureCacheEntry
+{
+    QImage image;
+    QSharedPointer<GLTexture> texture;
+};
+
+class GLTextureCachePrivate
+{
+public:
+    void pruneImageKeys();
+
+    QCache<GLTextureCacheKey, GLTextureCacheEntry> entries;
+    // Images that have been looked up before don't need to be hashed again.
+    QHash<qint64, GLTextureCacheKey> imageKeys;
+    quint64 hits = 0;
+    quint64 misses = 0;
+};
+
+void GLTextureCachePrivate::pruneImageKeys()
+{
+    for (auto it = imageKeys.begin(); it != imageKeys.end();) {
+        if (entries.contains(*it)) {
+            ++it;
+        } else {
+            it = imageKeys.erase(it);
+        }
+    }
+}
+
+GLTextureCache *GLTextureCache::s_instance = nullptr;
+
+GLTextureCache *GLTextureCache::instance()
+{
+    if (!s_instance) {
+        s_instance = new GLTextureCache();
+    }
+    return s_instance;
+}
+
+void GLTextureCache::cleanup()
+{
+    delete s_instance;
+    s_instance = nullptr;
+}
+
+GLTextureCache::GLTextureCache()
+    : d(new GLTextureCachePrivate)
+{
+    setMemoryLimit(s_defaultMemoryLimit);
+}
+
+GLTextureCache::~GLTextureCache()
+{
+    qCDebug(LIBKWINGLUTILS) << "Texture cache hits:" << d->hits << "misses:" << d->misses;
+}
+
+QSharedPointer<GLTexture> GLTextureCache::texture(const QImage &image)
+{
+    if (image.isNull()) {
+        return QSharedPointer<GLTexture>();
+    }
+
+    auto keyIt = d->imageKeys.constFind(image.cacheKey());
+    const GLTextureCacheKey key = keyIt != d->imageKeys.constEnd() ? *keyIt : contentKey(image);
+
+    // The image is compared as well, two different images may have the same hash.
+    if (GLTextureCacheEntry *entry = d->entries.object(key)) {
+        if (entry->image == image) {
+            d->hits++;
+            d->imageKeys.insert(image.cacheKey(), key);
+            return entry->texture;
+        }
+    }
+
+    d->misses++;
+    QSharedPointer<GLTexture> texture(new GLTexture(image));
+    texture->setWrapMode(GL_CLAMP_TO_EDGE);
+
+    // Images bigger than the whole cache aren't cached.
+    const qint64 cost = qint64(image.width()) * image.height() * 4;
+    if (cost <= d->entries.maxCost()) {
+        d->entries.insert(key, new GLTextureCacheEntry{image, texture}, int(cost));
+        d->imageKeys.insert(image.cacheKey(), key);
+        if (d->imageKeys.count() > 2 * d->entries.count()) {
+            d->pruneImageKeys();
+        }
+    }
+
+    return texture;
+}
+
+qint64 GLTextureCache::memoryUsage() const
+{
+    return d->entries.totalCost();
+}
+
+qint64 GLTextureCache::memoryLimit() const
+{
+    return d->entries.maxCost();
+}
+
+void GLTextureCache::setMemoryLimit(qint64 bytes)
+{
+    d->entries.setMaxCost(int(qBound<qint64>(0, bytes, std::numeric_limits<int>::max())));
+    d->pruneImageKeys();
+}
+
+} // namespace KWin
@@ -0,0 +1,68 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2026 KWin contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KWIN_GLTEXTURECACHE_H
+#define KWIN_GLTEXTURECACHE_H
+
+#include <kwinglutils_export.h>
+
+#include <QScopedPointer>
+#include <QSharedPointer>
+
+class QImage;
+
+namespace KWin
+{
+
+class GLTexture;
+class GLTextureCachePrivate;
+
+/**
+ * @short Content addressed cache of textures for small images.
+ *
+ * Images with the same size, format and pixels share one texture, no matter where they
+ * come from, so the same cursor or icon is uploaded only once for the scene, the effects
+ * and the screencasts. The least recently used textures are evicted when the cache
+ * grows beyond its memory limit; textures that are still referenced stay valid.
+ *
+ * The returned textures are shared, they must not be modified.
+ *
+ * @since 5.25
+ */
+class KWINGLUTILS_EXPORT GLTextureCache
+{
+public:
+    ~GLTextureCache();
+
+    static GLTextureCache *instance();
+    static void cleanup();
+
+    /**
+     * Returns a texture with the contents of @a image, uploading it only if the cache
+     * doesn't have a texture with the same contents yet.
+     */
+    QSharedPointer<GLTexture> texture(const QImage &image);
+
+    /**
+     * Returns the number of bytes used by the cached textures.
+     */
+    qint64 memoryUsage() const;
+
+    qint64 memoryLimit() const;
+    void setMemoryLimit(qint64 bytes);
+
+private:
+    GLTextureCache();
+    QScopedPointer<GLTextureCachePrivate> d;
+    static GLTextureCache *s_instance;
+};
+
+} // namespace KWin
+
+#endif
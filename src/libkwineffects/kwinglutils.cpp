@@ -12,6 +12,7 @@
 
 // need to call GLTexturePrivate::initStatic()
 #include "kwingltexture_p.h"
+#include "kwingltexturecache.h"
 
 #include "kwineffects.h"
 #include "kwinglplatform.h"
@@ -157,6 +158,7 @@ void initGL(const std::function<resolveFuncPtr(const char*)> &resolveFunction)
 void cleanupGL()
 {
     ShaderManager::cleanup();
+    GLTextureCache::cleanup();
     GLTexturePrivate::cleanup();
     GLRenderTarget::cleanup();
     GLVertexBuffer::cleanup();
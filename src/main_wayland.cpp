@@ -14,7 +14,11 @@
 // kwin
 #include "platform.h"
 #include "effects.h"
+#include "pointer_input.h"
+#include "scene.h"
+#include "startuptimeline.h"
 #include "tabletmodemanager.h"
+#include "xkb.h"
 
 #include "wayland_server.h"
 #include "xwl/xwayland.h"
@@ -143,26 +147,53 @@ void ApplicationWayland::performStartup()
     if (m_startXWayland) {
         setOperationMode(OperationModeXwayland);
     }
+    // compile the keymap while the rest of the startup is going on
+    Xkb::prefetchKeymap(kxkbConfig());
+
+    StartupPhase optionsPhase(QStringLiteral("options"));
     // first load options - done internally by a different thread
     createOptions();
+    optionsPhase.end();
 
+    StartupPhase platformPhase(QStringLiteral("platform"));
     if (!platform()->initialize()) {
         std::exit(1);
     }
+    platformPhase.end();
 
+    StartupPhase serverPlatformPhase(QStringLiteral("wayland server platform"));
     waylandServer()->initPlatform();
+    serverPlatformPhase.end();
+
+    StartupPhase colorManagerPhase(QStringLiteral("color manager"));
     createColorManager();
+    colorManagerPhase.end();
 
     // try creating the Wayland Backend
+    StartupPhase inputPhase(QStringLiteral("input"));
     createInput();
+    inputPhase.end();
     // now libinput thread has been created, adjust scheduler to not leak into other processes
     gainRealTime(RealTimeFlags::ResetOnFork);
 
+    StartupPhase inputMethodPhase(QStringLiteral("input method"));
     createInputMethod();
+    inputMethodPhase.end();
     TabletModeManager::create(this);
+
+    StartupPhase pluginsPhase(QStringLiteral("plugins"));
     createPlugins();
+    pluginsPhase.end();
 
+    StartupPhase screensPhase(QStringLiteral("screens"));
     createScreens();
+    screensPhase.end();
+    WaylandCursorImage::prefetchCursorTheme();
+
+    // the compositor phase lasts until the scene has been created
+    if (StartupTimeline *timeline = StartupTimeline::self()) {
+        timeline->begin(QStringLiteral("compositor"));
+    }
     WaylandCompositor::create();
 
     connect(Compositor::self(), &Compositor::sceneCreated, platform(), &Platform::sceneInitialized);
@@ -173,18 +204,34 @@ void ApplicationWayland::continueStartupWithScene()
 {
     disconnect(Compositor::self(), &Compositor::sceneCreated, this, &ApplicationWayland::continueStartupWithScene);
 
+    if (StartupTimeline *timeline = StartupTimeline::self()) {
+        timeline->end(QStringLiteral("compositor"));
+        m_firstFrameConnection = connect(Compositor::self()->scene(), &Scene::frameRendered, this, [this, timeline]() {
+            disconnect(m_firstFrameConnection);
+            timeline->mark(QStringLiteral("first frame"));
+        });
+    }
+
     // Note that we start accepting client connections after creating the Workspace.
+    StartupPhase workspacePhase(QStringLiteral("workspace"));
     createWorkspace();
+    workspacePhase.end();
 
+    StartupPhase serverPhase(QStringLiteral("wayland server"));
     if (!waylandServer()->start()) {
         qFatal("Failed to initialze the Wayland server, exiting now");
     }
+    serverPhase.end();
 
     if (operationMode() == OperationModeWaylandOnly) {
         finalizeStartup();
         return;
     }
 
+    // the Xwayland phase lasts until Xwayland has started or failed to start
+    if (StartupTimeline *timeline = StartupTimeline::self()) {
+        timeline->begin(QStringLiteral("Xwayland"));
+    }
     m_xwayland = new Xwl::Xwayland(this);
     m_xwayland->setListenFDs(m_xwaylandListenFds);
     m_xwayland->setDisplayName(m_xwaylandDisplay);
@@ -199,9 +246,17 @@ void ApplicationWayland::finalizeStartup()
     if (m_xwayland) {
         disconnect(m_xwayland, &Xwl::Xwayland::errorOccurred, this, &ApplicationWayland::finalizeStartup);
         disconnect(m_xwayland, &Xwl::Xwayland::started, this, &ApplicationWayland::finalizeStartup);
+        if (StartupTimeline *timeline = StartupTimeline::self()) {
+            timeline->end(QStringLiteral("Xwayland"));
+        }
     }
     startSession();
     notifyStarted();
+
+    if (StartupTimeline *timeline = StartupTimeline::self()) {
+        timeline->mark(QStringLiteral("startup finished"));
+        timeline->finish();
+    }
 }
 
 void ApplicationWayland::refreshSettings(const KConfigGroup &group, const QByteArrayList &names)
@@ -395,6 +450,7 @@ int main(int argc, char * argv[])
     qputenv("QSG_RENDER_LOOP", "basic");
     QCoreApplication::setAttribute(Qt::AA_UseHighDpiPixmaps);
     KWin::ApplicationWayland a(argc, argv);
+    KWin::StartupTimeline::create(&a);
     a.setupTranslator();
     // reset QT_QPA_PLATFORM so we don't propagate it to our children (e.g. apps launched from the overview effect)
     qunsetenv("QT_QPA_PLATFORM");
@@ -690,12 +746,16 @@ int main(int argc, char * argv[])
         }
     }
 
+    KWin::StartupPhase serverPhase(QStringLiteral("wayland server init"));
     if (!server->init(flags)) {
         std::cerr << "FATAL ERROR: could not create Wayland server" << std::endl;
         return 1;
     }
+    serverPhase.end();
 
+    KWin::StartupPhase platformPhase(QStringLiteral("platform plugin"));
     a.initPlatform(*pluginIt);
+    platformPhase.end();
     if (!a.platform()) {
         std::cerr << "FATAL ERROR: could not instantiate a backend" << std::endl;
         return 1;
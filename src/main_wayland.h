@@ -76,6 +76,7 @@ private:
     QString m_xwaylandDisplay;
     QString m_xwaylandXauthority;
     KConfigWatcher::Ptr m_settingsWatcher;
+    QMetaObject::Connection m_firstFrameConnection;
 };
 
 }
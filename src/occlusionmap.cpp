@@ -0,0 +1,201 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2026 KWin contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "occlusionmap.h"
+
+#include <algorithm>
+
+namespace KWin
+{
+
+static const int s_bitsPerWord = 64;
+
+// Returns a mask with the bits from @p first to @p last (inclusive) set
+static inline quint64 bitRange(int first, int last)
+{
+    const quint64 upper = last == s_bitsPerWord - 1 ? ~quint64(0) : (quint64(1) << (last + 1)) - 1;
+    const quint64 lower = (quint64(1) << first) - 1;
+    return upper & ~lower;
+}
+
+OcclusionMap::OcclusionMap(const QRect &area, int tileSize)
+    : m_tileSize(tileSize)
+{
+    Q_ASSERT(tileSize > 0);
+    reset(area);
+}
+
+QRect OcclusionMap::area() const
+{
+    return m_area;
+}
+
+void OcclusionMap::reset(const QRect &area)
+{
+    if (m_area != area) {
+        m_area = area;
+        m_columns = (area.width() + m_tileSize - 1) / m_tileSize;
+        m_rows = (area.height() + m_tileSize - 1) / m_tileSize;
+        m_wordsPerRow = (m_columns + s_bitsPerWord - 1) / s_bitsPerWord;
+        m_tiles.resize(m_rows * m_wordsPerRow);
+    }
+    if (m_hasOccludedTiles) {
+        m_tiles.fill(0);
+        m_hasOccludedTiles = false;
+    }
+}
+
+/**
+ * Returns the range of tiles, as columns and rows, that are either fully contained
+ * in @p rect or merely intersect it. The returned rect is empty if there are none.
+ */
+QRect OcclusionMap::tileRange(const QRect &rect, bool contained) const
+{
+    const QRect clipped = rect.intersected(m_area).translated(-m_area.topLeft());
+    if (clipped.isEmpty()) {
+        return QRect();
+    }
+
+    int firstColumn, lastColumn, firstRow, lastRow;
+    if (contained) {
+        // Tiles in the last column and row may be smaller than the tile size
+        firstColumn = (clipped.left() + m_tileSize - 1) / m_tileSize;
+        firstRow = (clipped.top() + m_tileSize - 1) / m_tileSize;
+        lastColumn = clipped.right() + 1 == m_area.width() ? m_columns - 1 : (clipped.right() + 1) / m_tileSize - 1;
+        lastRow = clipped.bottom() + 1 == m_area.height() ? m_rows - 1 : (clipped.bottom() + 1) / m_tileSize - 1;
+    } else {
+        firstColumn = clipped.left() / m_tileSize;
+        firstRow = clipped.top() / m_tileSize;
+        lastColumn = clipped.right() / m_tileSize;
+        lastRow = clipped.bottom() / m_tileSize;
+    }
+
+    return QRect(QPoint(firstColumn, firstRow), QPoint(lastColumn, lastRow));
+}
+
+bool OcclusionMap::isTileOccluded(int column, int row) const
+{
+    const quint64 word = m_tiles[row * m_wordsPerRow + column / s_bitsPerWord];
+    return word & (quint64(1) << (column % s_bitsPerWord));
+}
+
+void OcclusionMap::add(const QRegion &region)
+{
+    for (const QRect &rect : region) {
+        const QRect range = tileRange(rect, true);
+        if (range.isEmpty()) {
+            continue;
+        }
+        for (int row = range.top(); row <= range.bottom(); ++row) {
+            quint64 *words = m_tiles.data() + row * m_wordsPerRow;
+            for (int column = range.left(); column <= range.right();) {
+                const int bit = column % s_bitsPerWord;
+                const int last = std::min(range.right(), column - bit + s_bitsPerWord - 1);
+                words[column / s_bitsPerWord] |= bitRange(bit, last % s_bitsPerWord);
+                column = last + 1;
+            }
+        }
+        m_hasOccludedTiles = true;
+    }
+}
+
+bool OcclusionMap::isOccluded(const QRect &rect) const
+{
+    const QRect range = tileRange(rect, false);
+    if (range.isEmpty()) {
+        return true;
+    }
+    if (!m_hasOccludedTiles) {
+        return false;
+    }
+    for (int row = range.top(); row <= range.bottom(); ++row) {
+        const quint64 *words = m_tiles.constData() + row * m_wordsPerRow;
+        for (int column = range.left(); column <= range.right();) {
+            const int bit = column % s_bitsPerWord;
+            const int last = std::min(range.right(), column - bit + s_bitsPerWord - 1);
+            const quint64 mask = bitRange(bit, last % s_bitsPerWord);
+            if ((words[column / s_bitsPerWord] & mask) != mask) {
+                return false;
+            }
+            column = last + 1;
+        }
+    }
+    return true;
+}
+
+QRegion OcclusionMap::occludedRegion(const QRect &rect) const
+{
+    const QRect range = tileRange(rect, false);
+    if (range.isEmpty() || !m_hasOccludedTiles) {
+        return QRegion();
+    }
+
+    // Build the region directly as y-x banded rectangles, one band per run of rows
+    // with the same occlusion pattern, instead of uniting rectangles one by one.
+    QVector<QRect> rects;
+    int bandStart = 0;
+    int bandRow = -1;
+    for (int row = range.top(); row <= range.bottom(); ++row) {
+        const int top = m_area.y() + row * m_tileSize;
+        const int bottom = std::min(top + m_tileSize, m_area.y() + m_area.height()) - 1;
+
+        const int rowStart = rects.count();
+        for (int column = range.left(); column <= range.right(); ++column) {
+            if (!isTileOccluded(column, row)) {
+                continue;
+            }
+            const int firstColumn = column;
+            while (column < range.right() && isTileOccluded(column + 1, row)) {
+                ++column;
+            }
+            const int left = m_area.x() + firstColumn * m_tileSize;
+            const int right = std::min(m_area.x() + (column + 1) * m_tileSize, m_area.x() + m_area.width()) - 1;
+            rects.append(QRect(QPoint(left, top), QPoint(right, bottom)));
+        }
+
+        // Merge the row into the previous band if the spans are identical
+        const int count = rects.count() - rowStart;
+        if (bandRow == row - 1 && count == rowStart - bandStart && count > 0) {
+            bool identical = true;
+            for (int i = 0; i < count; ++i) {
+                if (rects[bandStart + i].left() != rects[rowStart + i].left()
+                    || rects[bandStart + i].right() != rects[rowStart + i].right()) {
+                    identical = false;
+                    break;
+                }
+            }
+            if (identical) {
+                for (int i = 0; i < count; ++i) {
+                    rects[bandStart + i].setBottom(bottom);
+                }
+                rects.resize(rowStart);
+                bandRow = row;
+                continue;
+            }
+        }
+        if (count > 0) {
+            bandStart = rowStart;
+            bandRow = row;
+        }
+    }
+
+    QRegion region;
+    region.setRects(rects.constData(), rects.count());
+    return region;
+}
+
+QRegion OcclusionMap::subtracted(const QRegion &region) const
+{
+    if (!m_hasOccludedTiles || region.isEmpty()) {
+        return region;
+    }
+    return region - occludedRegion(region.boundingRect());
+}
+
+} // namespace KWin
@@ -0,0 +1,77 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2026 KWin contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <kwin_export.h>
+
+#include <QRect>
+#include <QRegion>
+#include <QVector>
+
+namespace KWin
+{
+
+/**
+ * The OcclusionMap class tracks which parts of an area are covered by opaque content.
+ *
+ * Rather than accumulating the opaque regions in a QRegion, which gets expensive with many
+ * shaped windows, the area is split in tiles and a tile is marked occluded as soon as one
+ * opaque rectangle covers it completely. The map is conservative: partially covered tiles
+ * are never reported as occluded, so anything it culls is guaranteed to be hidden.
+ */
+class KWIN_EXPORT OcclusionMap
+{
+public:
+    explicit OcclusionMap(const QRect &area = QRect(), int tileSize = 64);
+
+    /**
+     * Returns the area covered by the map.
+     */
+    QRect area() const;
+
+    /**
+     * Resets the map to cover the given @a area with nothing occluded.
+     */
+    void reset(const QRect &area);
+
+    /**
+     * Marks all tiles that are fully covered by a rectangle of @a region as occluded.
+     */
+    void add(const QRegion &region);
+
+    /**
+     * Returns @c true if every part of @a rect inside the area is occluded.
+     */
+    bool isOccluded(const QRect &rect) const;
+
+    /**
+     * Returns @a region minus the occluded tiles it overlaps.
+     */
+    QRegion subtracted(const QRegion &region) const;
+
+    /**
+     * Returns the occluded tiles that intersect @a rect, as a region.
+     */
+    QRegion occludedRegion(const QRect &rect) const;
+
+private:
+    QRect tileRange(const QRect &rect, bool contained) const;
+    bool isTileOccluded(int column, int row) const;
+
+    QRect m_area;
+    int m_tileSize;
+    int m_columns = 0;
+    int m_rows = 0;
+    int m_wordsPerRow = 0;
+    bool m_hasOccludedTiles = false;
+    QVector<quint64> m_tiles;
+};
+
+} // namespace KWin
@@ -54,8 +54,10 @@ Options::Options(QObject *parent)
     , m_hideUtilityWindowsForInactive(false)
     , m_xwaylandCrashPolicy(Options::defaultXwaylandCrashPolicy())
     , m_xwaylandMaxCrashCount(Options::defaultXwaylandMaxCrashCount())
+    , m_pointerMotionBatching(Options::defaultPointerMotionBatching())
     , m_latencyPolicy(Options::defaultLatencyPolicy())
     , m_renderTimeEstimator(Options::defaultRenderTimeEstimator())
+    , m_missedFrameTarget(Options::defaultMissedFrameTarget())
     , m_compositingMode(Options::defaultCompositingMode())
     , m_useCompositing(Options::defaultUseCompositing())
     , m_hiddenPreviews(Options::defaultHiddenPreviews())
@@ -145,6 +147,15 @@ void Options::setXwaylandMaxCrashCount(int maxCrashCount)
     Q_EMIT xwaylandMaxCrashCountChanged();
 }
 
+void Options::setPointerMotionBatching(bool batching)
+{
+    if (m_pointerMotionBatching == batching) {
+        return;
+    }
+    m_pointerMotionBatching = batching;
+    Q_EMIT pointerMotionBatchingChanged();
+}
+
 void Options::setClickRaise(bool clickRaise)
 {
     if (m_autoRaise) {
@@ -643,6 +654,20 @@ void Options::setRenderTimeEstimator(RenderTimeEstimator estimator)
     Q_EMIT renderTimeEstimatorChanged();
 }
 
+qreal Options::missedFrameTarget() const
+{
+    return m_missedFrameTarget;
+}
+
+void Options::setMissedFrameTarget(qreal target)
+{
+    if (qFuzzyCompare(m_missedFrameTarget, target)) {
+        return;
+    }
+    m_missedFrameTarget = target;
+    Q_EMIT missedFrameTargetChanged();
+}
+
 void Options::setGlPlatformInterface(OpenGLPlatformInterface interface)
 {
     // check environment variable
@@ -765,6 +790,7 @@ void Options::syncFromKcfgc()
     setFocusStealingPreventionLevel(m_settings->focusStealingPreventionLevel());
     setXwaylandCrashPolicy(m_settings->xwaylandCrashPolicy());
     setXwaylandMaxCrashCount(m_settings->xwaylandMaxCrashCount());
+    setPointerMotionBatching(m_settings->pointerMotionBatching());
 
 #ifdef KWIN_BUILD_DECORATIONS
     setPlacement(m_settings->placement());
@@ -792,6 +818,7 @@ void Options::syncFromKcfgc()
     setMoveMinimizedWindowsToEndOfTabBoxFocusChain(m_settings->moveMinimizedWindowsToEndOfTabBoxFocusChain());
     setLatencyPolicy(m_settings->latencyPolicy());
     setRenderTimeEstimator(m_settings->renderTimeEstimator());
+    setMissedFrameTarget(m_settings->missedFrameTarget());
 }
 
 bool Options::loadCompositingConfig (bool force)
@@ -60,6 +60,12 @@ enum RenderTimeEstimator {
     RenderTimeEstimatorMinimum,
     RenderTimeEstimatorMaximum,
     RenderTimeEstimatorAverage,
+    /**
+     * Estimates the render time from a high percentile of the recent CPU and GPU render
+     * times and adjusts the safety margin so that the missed frame rate stays below
+     * the configured target.
+     */
+    RenderTimeEstimatorAdaptive,
 };
 
 class Settings;
@@ -72,6 +78,7 @@ class KWIN_EXPORT Options : public QObject
     Q_ENUM(RenderTimeEstimator)
     Q_PROPERTY(FocusPolicy focusPolicy READ focusPolicy WRITE setFocusPolicy NOTIFY focusPolicyChanged)
     Q_PROPERTY(XwaylandCrashPolicy xwaylandCrashPolicy READ xwaylandCrashPolicy WRITE setXwaylandCrashPolicy NOTIFY xwaylandCrashPolicyChanged)
+    Q_PROPERTY(bool pointerMotionBatching READ pointerMotionBatching WRITE setPointerMotionBatching NOTIFY pointerMotionBatchingChanged)
     Q_PROPERTY(int xwaylandMaxCrashCount READ xwaylandMaxCrashCount WRITE setXwaylandMaxCrashCount NOTIFY xwaylandMaxCrashCountChanged)
     Q_PROPERTY(bool nextFocusPrefersMouse READ isNextFocusPrefersMouse WRITE setNextFocusPrefersMouse NOTIFY nextFocusPrefersMouseChanged)
     /**
@@ -194,6 +201,7 @@ class KWIN_EXPORT Options : public QObject
     Q_PROPERTY(bool windowsBlockCompositing READ windowsBlockCompositing WRITE setWindowsBlockCompositing NOTIFY windowsBlockCompositingChanged)
     Q_PROPERTY(LatencyPolicy latencyPolicy READ latencyPolicy WRITE setLatencyPolicy NOTIFY latencyPolicyChanged)
     Q_PROPERTY(RenderTimeEstimator renderTimeEstimator READ renderTimeEstimator WRITE setRenderTimeEstimator NOTIFY renderTimeEstimatorChanged)
+    Q_PROPERTY(qreal missedFrameTarget READ missedFrameTarget WRITE setMissedFrameTarget NOTIFY missedFrameTargetChanged)
 public:
 
     explicit Options(QObject *parent = nullptr);
@@ -252,6 +260,13 @@ public:
         return m_xwaylandMaxCrashCount;
     }
 
+    /**
+     * Whether pointer motion is coalesced and delivered once per compositor frame.
+     */
+    bool pointerMotionBatching() const {
+        return m_pointerMotionBatching;
+    }
+
     /**
      * Whether clicking on a window raises it in FocusFollowsMouse
      * mode or not.
@@ -600,11 +615,17 @@ public:
     QStringList modifierOnlyDBusShortcut(Qt::KeyboardModifier mod) const;
     LatencyPolicy latencyPolicy() const;
     RenderTimeEstimator renderTimeEstimator() const;
+    /**
+     * The percentage of frames that the adaptive render time estimator allows to miss
+     * their vblank.
+     */
+    qreal missedFrameTarget() const;
 
     // setters
     void setFocusPolicy(FocusPolicy focusPolicy);
     void setXwaylandCrashPolicy(XwaylandCrashPolicy crashPolicy);
     void setXwaylandMaxCrashCount(int maxCrashCount);
+    void setPointerMotionBatching(bool batching);
     void setNextFocusPrefersMouse(bool nextFocusPrefersMouse);
     void setClickRaise(bool clickRaise);
     void setAutoRaise(bool autoRaise);
@@ -658,6 +679,7 @@ public:
     void setMoveMinimizedWindowsToEndOfTabBoxFocusChain(bool set);
     void setLatencyPolicy(LatencyPolicy policy);
     void setRenderTimeEstimator(RenderTimeEstimator estimator);
+    void setMissedFrameTarget(qreal target);
 
     // default values
     static WindowOperation defaultOperationTitlebarDblClick() {
@@ -750,12 +772,18 @@ public:
     static int defaultXwaylandMaxCrashCount() {
         return 3;
     }
+    static bool defaultPointerMotionBatching() {
+        return false;
+    }
     static LatencyPolicy defaultLatencyPolicy() {
         return LatencyMedium;
     }
     static RenderTimeEstimator defaultRenderTimeEstimator() {
         return RenderTimeEstimatorMaximum;
     }
+    static qreal defaultMissedFrameTarget() {
+        return 1.0;
+    }
     /**
      * Performs loading all settings except compositing related.
      */
@@ -773,6 +801,7 @@ Q_SIGNALS:
     void focusPolicyIsResonableChanged();
     void xwaylandCrashPolicyChanged();
     void xwaylandMaxCrashCountChanged();
+    void pointerMotionBatchingChanged();
     void nextFocusPrefersMouseChanged();
     void clickRaiseChanged();
     void autoRaiseChanged();
@@ -827,6 +856,7 @@ Q_SIGNALS:
     void latencyPolicyChanged();
     void configChanged();
     void renderTimeEstimatorChanged();
+    void missedFrameTargetChanged();
 
 private:
     void setElectricBorders(int borders);
@@ -855,8 +885,10 @@ private:
     bool m_hideUtilityWindowsForInactive;
     XwaylandCrashPolicy m_xwaylandCrashPolicy;
     int m_xwaylandMaxCrashCount;
+    bool m_pointerMotionBatching;
     LatencyPolicy m_latencyPolicy;
     RenderTimeEstimator m_renderTimeEstimator;
+    qreal m_missedFrameTarget;
 
     CompositingType m_compositingMode;
     bool m_useCompositing;
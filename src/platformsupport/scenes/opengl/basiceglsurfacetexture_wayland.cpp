@@ -97,10 +97,10 @@ void BasicEGLSurfaceTextureWayland::updateShmTexture(KWaylandServer::ShmClientBu
         return;
     }
 
+    // The pixels are staged before update() returns, so the buffer can be released as soon
+    // as the client attaches a new one.
     const QRegion damage = mapRegion(m_pixmap->item()->surfaceToBufferMatrix(), region);
-    for (const QRect &rect : damage) {
-        m_texture->update(image, rect.topLeft(), rect);
-    }
+    m_texture->update(image, damage);
 }
 
 bool BasicEGLSurfaceTextureWayland::loadEglTexture(KWaylandServer::DrmClientBuffer *buffer)
@@ -50,6 +50,13 @@ bool OpenGLBackend::scanout(AbstractOutput *output, SurfaceItem *surfaceItem)
     return false;
 }
 
+QVector<SurfaceItem *> OpenGLBackend::assignOverlays(AbstractOutput *output, const QVector<SurfaceItem *> &candidates)
+{
+    Q_UNUSED(output)
+    Q_UNUSED(candidates)
+    return {};
+}
+
 void OpenGLBackend::copyPixels(const QRegion &region)
 {
     const int height = screens()->size().height();
@@ -68,6 +68,15 @@ public:
      * @return if the scanout fails (or is not supported on the specified screen)
      */
     virtual bool scanout(AbstractOutput *output, SurfaceItem *surfaceItem);
+    /**
+     * Tries to show the given @p candidates on hardware overlay planes of @p output. The
+     * candidates are sorted by priority and must not overlap each other or anything that is
+     * stacked above them. The overlays are shown with the next frame of the output.
+     *
+     * @returns the surface items that got a plane; they must not be painted in the next frame
+     * @since 5.25
+     */
+    virtual QVector<SurfaceItem *> assignOverlays(AbstractOutput *output, const QVector<SurfaceItem *> &candidates);
 
     /**
      * @brief Whether the creation of the Backend failed.
@@ -33,15 +33,15 @@ QSize OutputScreenCastSource::textureSize() const
     return m_output->pixelSize();
 }
 
-void OutputScreenCastSource::render(QImage *image)
+void OutputScreenCastSource::render(QImage *image, const QRegion &region)
 {
     const QSharedPointer<GLTexture> outputTexture = Compositor::self()->scene()->textureForOutput(m_output);
     if (outputTexture) {
-        grabTexture(outputTexture.data(), image);
+        grabTexture(outputTexture.data(), image, region);
     }
 }
 
-void OutputScreenCastSource::render(GLRenderTarget *target)
+void OutputScreenCastSource::render(GLRenderTarget *target, const QRegion &region)
 {
     const QSharedPointer<GLTexture> outputTexture = Compositor::self()->scene()->textureForOutput(m_output);
     if (!outputTexture) {
@@ -57,7 +57,16 @@ void OutputScreenCastSource::render(GLRenderTarget *target)
 
     GLRenderTarget::pushRenderTarget(target);
     outputTexture->bind();
-    outputTexture->render(geometry, geometry, true);
+    if (region.contains(geometry)) {
+        outputTexture->render(geometry, geometry, true);
+    } else {
+        glEnable(GL_SCISSOR_TEST);
+        for (const QRect &rect : region.intersected(geometry)) {
+            glScissor(rect.x(), rect.y(), rect.width(), rect.height());
+            outputTexture->render(geometry, geometry, true);
+        }
+        glDisable(GL_SCISSOR_TEST);
+    }
     outputTexture->unbind();
     GLRenderTarget::popRenderTarget();
 }
@@ -25,8 +25,8 @@ public:
     bool hasAlphaChannel() const override;
     QSize textureSize() const override;
 
-    void render(GLRenderTarget *target) override;
-    void render(QImage *image) override;
+    void render(GLRenderTarget *target, const QRegion &region) override;
+    void render(QImage *image, const QRegion &region) override;
 
 private:
     QPointer<AbstractOutput> m_output;
@@ -43,8 +43,15 @@ class WindowStream : public ScreenCastStream
 {
 public:
     WindowStream(Toplevel *toplevel, QObject *parent)
-        : ScreenCastStream(new WindowScreenCastSource(toplevel), parent)
+        : WindowStream(toplevel, new WindowScreenCastSource(toplevel), parent)
+    {
+    }
+
+private:
+    WindowStream(Toplevel *toplevel, WindowScreenCastSource *source, QObject *parent)
+        : ScreenCastStream(source, parent)
         , m_toplevel(toplevel)
+        , m_source(source)
     {
         if (AbstractClient *client = qobject_cast<AbstractClient *>(toplevel)) {
             setObjectName(client->desktopFileName());
@@ -53,22 +60,32 @@ public:
         connect(this, &ScreenCastStream::stopStreaming, this, &WindowStream::stopFeeding);
     }
 
-private:
     void startFeeding() {
         connect(Compositor::self()->scene(), &Scene::frameRendered, this, &WindowStream::bufferToStream);
 
         connect(m_toplevel, &Toplevel::damaged, this, &WindowStream::includeDamage);
-        m_damagedRegion = m_toplevel->visibleGeometry();
+        connect(m_toplevel, &Toplevel::clientGeometryChanged, this, &WindowStream::includeResize);
+        m_damagedRegion = QRect(QPoint(0, 0), m_source->textureSize());
         m_toplevel->addRepaintFull();
     }
 
     void stopFeeding() {
         disconnect(Compositor::self()->scene(), &Scene::frameRendered, this, &WindowStream::bufferToStream);
+        disconnect(m_toplevel, &Toplevel::damaged, this, &WindowStream::includeDamage);
+        disconnect(m_toplevel, &Toplevel::clientGeometryChanged, this, &WindowStream::includeResize);
     }
 
     void includeDamage(Toplevel *toplevel, const QRegion &damage) {
         Q_ASSERT(m_toplevel == toplevel);
-        m_damagedRegion |= damage;
+        m_damagedRegion |= m_source->mapDamage(damage);
+    }
+
+    void includeResize(Toplevel *toplevel, const QRect &oldGeometry) {
+        Q_ASSERT(m_toplevel == toplevel);
+        // Moving the window doesn't change the frames, but resizing it changes all of them.
+        if (toplevel->clientGeometry().size() != oldGeometry.size()) {
+            m_damagedRegion = QRect(QPoint(0, 0), m_source->textureSize());
+        }
     }
 
     void bufferToStream () {
@@ -80,6 +97,7 @@ private:
 
     QRegion m_damagedRegion;
     Toplevel *m_toplevel;
+    WindowScreenCastSource *m_source;
 };
 
 void ScreencastManager::streamWindow(KWaylandServer::ScreencastStreamV1Interface *waylandStream, const QString &winid)
@@ -7,6 +7,7 @@
 #pragma once
 
 #include <QObject>
+#include <QRegion>
 
 namespace KWin
 {
@@ -23,8 +24,15 @@ public:
     virtual bool hasAlphaChannel() const = 0;
     virtual QSize textureSize() const = 0;
 
-    virtual void render(GLRenderTarget *target) = 0;
-    virtual void render(QImage *image) = 0;
+    /**
+     * Renders the source into @a target. Only the pixels inside @a region, specified
+     * in texture coordinates, need to be updated; the rest of the target is preserved.
+     */
+    virtual void render(GLRenderTarget *target, const QRegion &region) = 0;
+    /**
+     * Copies the pixels inside @a region of the source into @a image.
+     */
+    virtual void render(QImage *image, const QRegion &region) = 0;
 
 Q_SIGNALS:
     void closed();
@@ -13,6 +13,7 @@
 #include "eglnativefence.h"
 #include "kwinglplatform.h"
 #include "kwingltexture.h"
+#include "kwingltexturecache.h"
 #include "kwinglutils.h"
 #include "kwinscreencast_logging.h"
 #include "main.h"
@@ -70,6 +71,8 @@ void ScreenCastStream::onStreamStateChanged(void *data, pw_stream_state old, pw_
 #define CURSOR_META_SIZE(w,h)	(sizeof(struct spa_meta_cursor) + \
 				 sizeof(struct spa_meta_bitmap) + w * h * CURSOR_BPP)
 static const int videoDamageRegionCount = 16;
+static const int maxBufferCount = 16;
+static const int readbackRingSize = 3;
 
 void ScreenCastStream::newStreamParams()
 {
@@ -91,7 +94,7 @@ void ScreenCastStream::newStreamParams()
         (spa_pod*) spa_pod_builder_add_object(&pod_builder,
                                               SPA_TYPE_OBJECT_ParamBuffers, SPA_PARAM_Buffers,
                                               SPA_FORMAT_VIDEO_size, SPA_POD_Rectangle(&resolution),
-                                              SPA_PARAM_BUFFERS_buffers, SPA_POD_CHOICE_RANGE_Int(16, 2, 16),
+                                              SPA_PARAM_BUFFERS_buffers, SPA_POD_CHOICE_RANGE_Int(maxBufferCount, 2, maxBufferCount),
                                               SPA_PARAM_BUFFERS_blocks, SPA_POD_Int (1),
                                               // TODO[no_use_linear]: stride, size and align should be dropped for dmabufs,
                                               // or queried via test allocation
@@ -195,6 +198,12 @@ void ScreenCastStream::onStreamRemoveBuffer(void *data, pw_buffer *buffer)
 {
     ScreenCastStream *stream = static_cast<ScreenCastStream *>(data);
     stream->m_dmabufDataForPwBuffer.remove(buffer);
+    stream->m_bufferHistory.remove(buffer);
+    for (ScreenCastStream::PendingReadback &readback : stream->m_readbacks) {
+        if (readback.buffer == buffer) {
+            readback.buffer = nullptr;
+        }
+    }
 
     struct spa_buffer *spa_buffer = buffer->buffer;
     struct spa_data *spa_data = spa_buffer->datas;
@@ -216,11 +225,31 @@ ScreenCastStream::ScreenCastStream(ScreenCastSource *source, QObject *parent)
     pwStreamEvents.remove_buffer = &ScreenCastStream::onStreamRemoveBuffer;
     pwStreamEvents.state_changed = &ScreenCastStream::onStreamStateChanged;
     pwStreamEvents.param_changed = &ScreenCastStream::onStreamParamChanged;
+
+    m_damageJournal.setCapacity(maxBufferCount);
+
+    m_readbacks.resize(readbackRingSize);
+    m_readbackTimer = new QTimer(this);
+    m_readbackTimer->setSingleShot(true);
+    m_readbackTimer->setInterval(1);
+    connect(m_readbackTimer, &QTimer::timeout, this, [this]() {
+        if (auto scene = Compositor::self()->scene()) {
+            scene->makeOpenGLContextCurrent();
+            finishReadbacks(false);
+        }
+    });
 }
 
 ScreenCastStream::~ScreenCastStream()
 {
     m_stopped = true;
+    releaseReadbacks();
+    if (m_readbackStatistics.frameCount) {
+        qCDebug(KWIN_SCREENCAST) << "Asynchronous readback:" << m_readbackStatistics.frameCount << "frames,"
+                                 << m_readbackStatistics.averageLatency().count() << "ns average latency,"
+                                 << m_readbackStatistics.maximumLatency.count() << "ns maximum latency,"
+                                 << m_readbackStatistics.throughput() << "bytes/s";
+    }
     if (pwStream) {
         pw_stream_destroy(pwStream);
     }
@@ -331,13 +360,18 @@ void ScreenCastStream::recordFrame(const QRegion &damagedRegion)
 {
     Q_ASSERT(!m_stopped);
 
+    // Queue the buffers whose readback has completed since the last frame
+    finishReadbacks(false);
+
     if (m_pendingBuffer) {
         qCWarning(KWIN_SCREENCAST) << "Dropping a screencast frame because the compositor is slow";
+        skipFrame(damagedRegion);
         return;
     }
 
     if (m_source->textureSize() != m_resolution) {
         m_resolution = m_source->textureSize();
+        resetDamageHistory();
         newStreamParams();
         return;
     }
@@ -348,12 +382,14 @@ void ScreenCastStream::recordFrame(const QRegion &damagedRegion)
         if (error) {
             qCWarning(KWIN_SCREENCAST) << "Failed to record frame: stream is not active" << error;
         }
+        skipFrame(damagedRegion);
         return;
     }
 
     struct pw_buffer *buffer = pw_stream_dequeue_buffer(pwStream);
 
     if (!buffer) {
+        skipFrame(damagedRegion);
         return;
     }
 
@@ -364,10 +400,23 @@ void ScreenCastStream::recordFrame(const QRegion &damagedRegion)
     if (!data && spa_buffer->datas->type != SPA_DATA_DmaBuf) {
         qCWarning(KWIN_SCREENCAST) << "Failed to record frame: invalid buffer data";
         pw_stream_queue_buffer(pwStream, buffer);
+        skipFrame(damagedRegion);
         return;
     }
 
     const auto size = m_source->textureSize();
+    const QRect frame(QPoint(), size);
+
+    // Only repaint what changed since the contents of this buffer were last produced
+    QRegion repaintRegion = frame;
+    BufferHistory &history = m_bufferHistory[buffer];
+    if (history.sequence) {
+        const int bufferAge = m_frameSequence - history.sequence;
+        repaintRegion = (m_damageJournal.accumulate(bufferAge, frame) | damagedRegion | history.cursorRect) & frame;
+    }
+    QRect cursorRect;
+    bool deferred = false;
+
     spa_data->chunk->offset = 0;
     if (data || spa_data[0].type == SPA_DATA_MemFd) {
         const bool hasAlpha = m_source->hasAlphaChannel();
@@ -378,19 +427,29 @@ void ScreenCastStream::recordFrame(const QRegion &damagedRegion)
         if (dest.sizeInBytes() > spa_data->maxsize) {
             qCDebug(KWIN_SCREENCAST) << "Failed to record frame: frame is too big";
             pw_stream_queue_buffer(pwStream, buffer);
+            skipFrame(damagedRegion);
             return;
         }
 
         spa_data->chunk->size = dest.sizeInBytes();
         spa_data->chunk->stride = dest.bytesPerLine();
 
-        m_source->render(&dest);
-
         auto cursor = Cursors::self()->currentCursor();
         if (m_cursor.mode == KWaylandServer::ScreencastV1Interface::Embedded && m_cursor.viewport.contains(cursor->pos())) {
-            QPainter painter(&dest);
             const auto position = (cursor->pos() - m_cursor.viewport.topLeft() - cursor->hotspot()) * m_cursor.scale;
-            painter.drawImage(QRect{position, cursor->image().size()}, cursor->image());
+            cursorRect = QRect{position, cursor->image().size()};
+        }
+
+        if (useAsyncReadback()) {
+            beginReadback(buffer, dest, repaintRegion, cursorRect);
+            deferred = true;
+        } else {
+            m_source->render(&dest, repaintRegion);
+
+            if (cursorRect.isValid()) {
+                QPainter painter(&dest);
+                painter.drawImage(cursorRect, cursor->image());
+            }
         }
     } else {
         auto &buf = m_dmabufDataForPwBuffer[buffer];
@@ -398,7 +457,7 @@ void ScreenCastStream::recordFrame(const QRegion &damagedRegion)
         spa_data->chunk->stride = buf->stride();
         spa_data->chunk->size = spa_data->maxsize;
 
-        m_source->render(buf->framebuffer());
+        m_source->render(buf->framebuffer(), repaintRegion);
 
         auto cursor = Cursors::self()->currentCursor();
         if (m_cursor.mode == KWaylandServer::ScreencastV1Interface::Embedded && m_cursor.viewport.contains(cursor->pos())) {
@@ -411,12 +470,13 @@ void ScreenCastStream::recordFrame(const QRegion &damagedRegion)
             mvp.ortho(r);
             shader->setUniform(GLShader::ModelViewProjectionMatrix, mvp);
 
-            if (!m_cursor.texture || m_cursor.lastKey != cursor->image().cacheKey())
-                m_cursor.texture.reset(new GLTexture(cursor->image()));
+            m_cursor.texture = GLTextureCache::instance()->texture(cursor->image());
 
+            // The texture is shared with the scene, flip it only while it's rendered here.
+            const bool yInverted = m_cursor.texture->isYInverted();
             m_cursor.texture->setYInverted(false);
             m_cursor.texture->bind();
-            const auto cursorRect = cursorGeometry(cursor);
+            cursorRect = cursorGeometry(cursor);
             mvp.translate(cursorRect.left(), r.height() - cursorRect.top() - cursor->image().height() * m_cursor.scale);
             shader->setUniform(GLShader::ModelViewProjectionMatrix, mvp);
 
@@ -425,6 +485,7 @@ void ScreenCastStream::recordFrame(const QRegion &damagedRegion)
             m_cursor.texture->render(cursorRect, cursorRect, true);
             glDisable(GL_BLEND);
             m_cursor.texture->unbind();
+            m_cursor.texture->setYInverted(yInverted);
             m_cursor.lastRect = cursorRect;
 
             ShaderManager::instance()->popShader();
@@ -461,7 +522,221 @@ void ScreenCastStream::recordFrame(const QRegion &damagedRegion)
         }
     }
 
-    tryEnqueue(buffer);
+    history.sequence = m_frameSequence;
+    history.cursorRect = cursorRect;
+    m_damageJournal.add(damagedRegion);
+    ++m_frameSequence;
+
+    if (!deferred) {
+        tryEnqueue(buffer);
+    }
+}
+
+void ScreenCastStream::skipFrame(const QRegion &damagedRegion)
+{
+    // No buffer received the damage of this frame, remember it so that the next buffer
+    // to be filled picks it up.
+    m_damageJournal.add(damagedRegion);
+    ++m_frameSequence;
+}
+
+void ScreenCastStream::resetDamageHistory()
+{
+    m_bufferHistory.clear();
+    m_damageJournal.clear();
+}
+
+bool ScreenCastStream::useAsyncReadback() const
+{
+    // Pixel pack buffers and sync objects are core in GLES 3.0, desktop GL needs GL_ARB_sync
+    if (GLPlatform::instance()->isGLES()) {
+        return hasGLVersion(3, 0);
+    }
+    return hasGLVersion(3, 2) || hasGLExtension(QByteArrayLiteral("GL_ARB_sync"));
+}
+
+void ScreenCastStream::beginReadback(pw_buffer *buffer, const QImage &dest, const QRegion &region, const QRect &cursorRect)
+{
+    // Wait for the oldest readback if the GPU is more than a ring's worth of frames behind
+    if (m_readbackCount == m_readbacks.count()) {
+        finishReadbacks(true);
+    }
+
+    const QSize size = dest.size();
+    if (!m_readbackTexture || m_readbackTexture->size() != size) {
+        m_readbackTarget.reset();
+        m_readbackTexture.reset(new GLTexture(GL_RGBA8, size));
+        m_readbackTarget.reset(new GLRenderTarget(*m_readbackTexture));
+    }
+
+    // Render only the stale parts, the readback target keeps whatever it had elsewhere but
+    // nothing outside of the region is read back
+    m_source->render(m_readbackTarget.data(), region);
+
+    PendingReadback &readback = m_readbacks[(m_readbackHead + m_readbackCount) % m_readbacks.count()];
+    readback.buffer = buffer;
+    readback.region = region;
+    readback.size = size;
+    readback.stride = dest.bytesPerLine();
+    readback.bytesPerPixel = dest.depth() / 8;
+    readback.cursorRect = cursorRect;
+    readback.cursorImage = cursorRect.isValid() ? Cursors::self()->currentCursor()->image() : QImage();
+    readback.timestamp = std::chrono::steady_clock::now().time_since_epoch();
+
+    const GLsizeiptr pboSize = dest.sizeInBytes();
+    if (!readback.pbo) {
+        glGenBuffers(1, &readback.pbo);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+    if (readback.pboSize != pboSize) {
+        glBufferData(GL_PIXEL_PACK_BUFFER, pboSize, nullptr, GL_STREAM_READ);
+        readback.pboSize = pboSize;
+    }
+
+    // The pixel buffer has the same layout as the destination image, so rects can be
+    // copied to the same offsets once the data has arrived
+    const GLenum format = dest.hasAlphaChannel() ? GL_BGRA : GL_BGR;
+    GLRenderTarget::pushRenderTarget(m_readbackTarget.data());
+    glPixelStorei(GL_PACK_ROW_LENGTH, size.width());
+    for (const QRect &rect : region) {
+        const intptr_t offset = rect.y() * readback.stride + rect.x() * readback.bytesPerPixel;
+        glReadPixels(rect.x(), rect.y(), rect.width(), rect.height(), format, GL_UNSIGNED_BYTE, reinterpret_cast<GLvoid *>(offset));
+    }
+    glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+    GLRenderTarget::popRenderTarget();
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+    ++m_readbackCount;
+
+    m_readbackTimer->start();
+}
+
+void ScreenCastStream::finishReadbacks(bool wait)
+{
+    while (m_readbackCount) {
+        PendingReadback &readback = m_readbacks[m_readbackHead];
+
+        const GLenum status = glClientWaitSync(readback.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0,
+                                               wait ? GL_TIMEOUT_IGNORED : 0);
+        if (status == GL_TIMEOUT_EXPIRED) {
+            break;
+        }
+        if (status == GL_WAIT_FAILED) {
+            qCWarning(KWIN_SCREENCAST) << "Failed to wait for a screencast readback";
+        }
+        glDeleteSync(readback.fence);
+        readback.fence = nullptr;
+
+        // The buffer may have been removed while the readback was in flight
+        if (readback.buffer) {
+            uchar *dest = static_cast<uchar *>(readback.buffer->buffer->datas[0].data);
+
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+            const uchar *src = static_cast<const uchar *>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, readback.pboSize, GL_MAP_READ_BIT));
+            if (src) {
+                for (const QRect &rect : qAsConst(readback.region)) {
+                    const int rowSize = rect.width() * readback.bytesPerPixel;
+                    for (int y = rect.top(); y <= rect.bottom(); ++y) {
+                        const int offset = y * readback.stride + rect.x() * readback.bytesPerPixel;
+                        memcpy(dest + offset, src + offset, rowSize);
+                    }
+                    m_readbackStatistics.byteCount += rowSize * rect.height();
+                }
+                glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            } else {
+                qCWarning(KWIN_SCREENCAST) << "Failed to map a screencast readback buffer";
+            }
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+            if (!readback.cursorImage.isNull()) {
+                QImage image(dest, readback.size.width(), readback.size.height(), readback.stride,
+                             readback.bytesPerPixel == 4 ? QImage::Format_RGBA8888_Premultiplied : QImage::Format_RGB888);
+                QPainter painter(&image);
+                painter.drawImage(readback.cursorRect, readback.cursorImage);
+            }
+
+            pw_stream_queue_buffer(pwStream, readback.buffer);
+
+            const std::chrono::nanoseconds now = std::chrono::steady_clock::now().time_since_epoch();
+            const std::chrono::nanoseconds latency = now - readback.timestamp;
+            if (!m_readbackStatistics.frameCount) {
+                m_readbackStatistics.firstFrameTimestamp = now;
+            }
+            m_readbackStatistics.lastFrameTimestamp = now;
+            m_readbackStatistics.totalLatency += latency;
+            m_readbackStatistics.maximumLatency = std::max(m_readbackStatistics.maximumLatency, latency);
+            ++m_readbackStatistics.frameCount;
+        }
+
+        readback.buffer = nullptr;
+        readback.cursorImage = QImage();
+        m_readbackHead = (m_readbackHead + 1) % m_readbacks.count();
+        --m_readbackCount;
+
+        // Only ever block on the oldest readback
+        wait = false;
+    }
+
+    if (m_readbackCount) {
+        m_readbackTimer->start();
+    }
+}
+
+void ScreenCastStream::releaseReadbacks()
+{
+    m_readbackTimer->stop();
+
+    bool hasResources = !m_readbackTexture.isNull();
+    for (const PendingReadback &readback : qAsConst(m_readbacks)) {
+        hasResources |= readback.pbo != 0;
+    }
+    if (!hasResources) {
+        return;
+    }
+
+    Compositor *compositor = Compositor::self();
+    if (!compositor || !compositor->scene()) {
+        return;
+    }
+    compositor->scene()->makeOpenGLContextCurrent();
+
+    for (PendingReadback &readback : m_readbacks) {
+        if (readback.fence) {
+            glDeleteSync(readback.fence);
+        }
+        if (readback.pbo) {
+            glDeleteBuffers(1, &readback.pbo);
+        }
+        readback = PendingReadback();
+    }
+    m_readbackHead = 0;
+    m_readbackCount = 0;
+    m_readbackTarget.reset();
+    m_readbackTexture.reset();
+}
+
+ScreenCastStream::ReadbackStatistics ScreenCastStream::readbackStatistics() const
+{
+    return m_readbackStatistics;
+}
+
+std::chrono::nanoseconds ScreenCastStream::ReadbackStatistics::averageLatency() const
+{
+    if (!frameCount) {
+        return std::chrono::nanoseconds::zero();
+    }
+    return totalLatency / frameCount;
+}
+
+qreal ScreenCastStream::ReadbackStatistics::throughput() const
+{
+    const std::chrono::duration<qreal> elapsed = lastFrameTimestamp - firstFrameTimestamp;
+    if (elapsed.count() <= 0) {
+        return 0;
+    }
+    return byteCount / elapsed.count();
 }
 
 void ScreenCastStream::recordCursor()
@@ -10,14 +10,21 @@
 
 #include "config-kwin.h"
 #include "kwinglobals.h"
+#include "utils/common.h"
 
 #include <KWaylandServer/screencast_v1_interface.h>
 
 #include <QHash>
+#include <QImage>
 #include <QObject>
 #include <QSharedPointer>
 #include <QSize>
 #include <QSocketNotifier>
+#include <QTimer>
+#include <QVector>
+
+#include <chrono>
+#include <epoxy/gl.h>
 
 #include <pipewire/pipewire.h>
 #include <spa/param/format-utils.h>
@@ -30,6 +37,7 @@ namespace KWin
 class Cursor;
 class DmaBufTexture;
 class EGLNativeFence;
+class GLRenderTarget;
 class GLTexture;
 class PipeWireCore;
 class ScreenCastSource;
@@ -55,6 +63,32 @@ public:
 
     void setCursorMode(KWaylandServer::ScreencastV1Interface::CursorMode mode, qreal scale, const QRect &viewport);
 
+    /**
+     * Statistics about the asynchronous readback of MemFd buffers.
+     */
+    struct ReadbackStatistics {
+        quint64 frameCount = 0;
+        quint64 byteCount = 0;
+        std::chrono::nanoseconds totalLatency = std::chrono::nanoseconds::zero();
+        std::chrono::nanoseconds maximumLatency = std::chrono::nanoseconds::zero();
+        std::chrono::nanoseconds firstFrameTimestamp = std::chrono::nanoseconds::zero();
+        std::chrono::nanoseconds lastFrameTimestamp = std::chrono::nanoseconds::zero();
+
+        /**
+         * Returns the average time between issuing a readback and the frame being queued.
+         */
+        std::chrono::nanoseconds averageLatency() const;
+        /**
+         * Returns the number of bytes copied into the stream per second.
+         */
+        qreal throughput() const;
+    };
+
+    /**
+     * Returns the statistics of the MemFd frames that have been read back and queued so far.
+     */
+    ReadbackStatistics readbackStatistics() const;
+
 public Q_SLOTS:
      void recordCursor();
 
@@ -75,6 +109,12 @@ private:
     void sendCursorData(Cursor *cursor, spa_meta_cursor *spa_cursor);
     void newStreamParams();
     void tryEnqueue(pw_buffer *buffer);
+    void skipFrame(const QRegion &damagedRegion);
+    void resetDamageHistory();
+    bool useAsyncReadback() const;
+    void beginReadback(pw_buffer *buffer, const QImage &dest, const QRegion &region, const QRect &cursorRect);
+    void finishReadbacks(bool wait);
+    void releaseReadbacks();
     void enqueue();
     spa_pod* buildFormat(struct spa_pod_builder *b, enum spa_video_format format, struct spa_rectangle *resolution,
                          struct spa_fraction *defaultFramerate, struct spa_fraction *minFramerate, struct spa_fraction *maxFramerate,
@@ -102,12 +142,49 @@ private:
         QRect viewport;
         qint64 lastKey = 0;
         QRect lastRect;
-        QScopedPointer<GLTexture> texture;
+        QSharedPointer<GLTexture> texture;
     } m_cursor;
     QRect cursorGeometry(Cursor *cursor) const;
 
     QHash<struct pw_buffer *, QSharedPointer<DmaBufTexture>> m_dmabufDataForPwBuffer;
 
+    /**
+     * Tracks what a pipewire buffer holds so only the regions that changed since it was
+     * last filled have to be re-rendered. Buffers without an entry must be fully repainted.
+     */
+    struct BufferHistory {
+        quint64 sequence = 0;
+        QRect cursorRect;
+    };
+    QHash<struct pw_buffer *, BufferHistory> m_bufferHistory;
+    DamageJournal m_damageJournal;
+    quint64 m_frameSequence = 1;
+
+    /**
+     * A MemFd buffer whose contents are being read back into a pixel buffer object. The
+     * pixels are copied into the buffer and the buffer is queued once the fence signals.
+     */
+    struct PendingReadback {
+        pw_buffer *buffer = nullptr;
+        GLuint pbo = 0;
+        GLsizeiptr pboSize = 0;
+        GLsync fence = nullptr;
+        QRegion region;
+        QSize size;
+        int stride = 0;
+        int bytesPerPixel = 4;
+        QImage cursorImage;
+        QRect cursorRect;
+        std::chrono::nanoseconds timestamp = std::chrono::nanoseconds::zero();
+    };
+    QVector<PendingReadback> m_readbacks;
+    int m_readbackHead = 0;
+    int m_readbackCount = 0;
+    QScopedPointer<GLTexture> m_readbackTexture;
+    QScopedPointer<GLRenderTarget> m_readbackTarget;
+    QTimer *m_readbackTimer = nullptr;
+    ReadbackStatistics m_readbackStatistics;
+
     pw_buffer *m_pendingBuffer = nullptr;
     QSocketNotifier *m_pendingNotifier = nullptr;
     EGLNativeFence *m_pendingFence = nullptr;
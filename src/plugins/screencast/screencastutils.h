@@ -8,23 +8,37 @@
 
 #include "kwinglplatform.h"
 #include "kwingltexture.h"
+#include "kwinglutils.h"
+
+#include <QRegion>
 
 namespace KWin
 {
 
-// in-place vertical mirroring
-static void mirrorVertically(uchar *data, int height, int stride)
+// in-place vertical mirroring of @p height rows, each @p rowSize bytes long
+static void mirrorVertically(uchar *data, int height, int stride, int rowSize)
 {
     const int halfHeight = height / 2;
-    std::vector<uchar> temp(stride);
+    std::vector<uchar> temp(rowSize);
     for (int y = 0; y < halfHeight; ++y) {
         auto cur = &data[y * stride], dest = &data[(height - y - 1) * stride];
-        memcpy(temp.data(), cur, stride);
-        memcpy(cur, dest, stride);
-        memcpy(dest, temp.data(), stride);
+        memcpy(temp.data(), cur, rowSize);
+        memcpy(cur, dest, rowSize);
+        memcpy(dest, temp.data(), rowSize);
     }
 }
 
+static void mirrorVertically(uchar *data, int height, int stride)
+{
+    mirrorVertically(data, height, stride, stride);
+}
+
+// GL_PACK_ROW_LENGTH is needed to read back a sub-rectangle straight into the destination
+static bool supportsPartialReadback()
+{
+    return !GLPlatform::instance()->isGLES() || GLPlatform::instance()->glVersion() >= kVersionNumber(3, 0);
+}
+
 static void grabTexture(GLTexture *texture, QImage *image)
 {
     Q_ASSERT(texture->size() == image->size());
@@ -53,4 +67,41 @@ static void grabTexture(GLTexture *texture, QImage *image)
     }
 }
 
+// Reads back only the pixels of @p texture inside @p region, the rest of @p image is left untouched
+static void grabTexture(GLTexture *texture, QImage *image, const QRegion &region)
+{
+    Q_ASSERT(texture->size() == image->size());
+    const QRect frame(QPoint(), image->size());
+    if (region.isEmpty()) {
+        return;
+    }
+    if (region.contains(frame) || !supportsPartialReadback()) {
+        grabTexture(texture, image);
+        return;
+    }
+
+    GLRenderTarget renderTarget(*texture);
+    if (!renderTarget.valid()) {
+        grabTexture(texture, image);
+        return;
+    }
+
+    const int bytesPerPixel = image->depth() / 8;
+    const GLenum format = image->hasAlphaChannel() ? GL_BGRA : GL_BGR;
+
+    GLRenderTarget::pushRenderTarget(&renderTarget);
+    glPixelStorei(GL_PACK_ROW_LENGTH, image->width());
+    for (const QRect &rect : region.intersected(frame)) {
+        uchar *data = image->bits() + rect.y() * image->bytesPerLine() + rect.x() * bytesPerPixel;
+        if (texture->isYInverted()) {
+            glReadPixels(rect.x(), image->height() - rect.y() - rect.height(), rect.width(), rect.height(), format, GL_UNSIGNED_BYTE, data);
+            mirrorVertically(data, rect.height(), image->bytesPerLine(), rect.width() * bytesPerPixel);
+        } else {
+            glReadPixels(rect.x(), rect.y(), rect.width(), rect.height(), format, GL_UNSIGNED_BYTE, data);
+        }
+    }
+    glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+    GLRenderTarget::popRenderTarget();
+}
+
 } // namespace KWin
@@ -13,6 +13,7 @@
 #include "kwingltexture.h"
 #include "kwinglutils.h"
 #include "scene.h"
+#include "surfaceitem.h"
 #include "toplevel.h"
 
 namespace KWin
@@ -35,16 +36,32 @@ QSize WindowScreenCastSource::textureSize() const
     return m_window->clientGeometry().size();
 }
 
-void WindowScreenCastSource::render(QImage *image)
+QRegion WindowScreenCastSource::mapDamage(const QRegion &damage) const
+{
+    const QRect frame(QPoint(0, 0), textureSize());
+
+    // The damage is relative to the surface it has been reported for, and there's no telling
+    // whether that is the main surface or one of its subsurfaces, so windows with subsurfaces
+    // are updated as a whole.
+    const SurfaceItem *surfaceItem = m_window->surfaceItem();
+    if (!surfaceItem || !surfaceItem->childItems().isEmpty()) {
+        return frame;
+    }
+
+    const QPoint offset = m_window->bufferGeometry().topLeft() - m_window->clientGeometry().topLeft();
+    return damage.translated(offset) & frame;
+}
+
+void WindowScreenCastSource::render(QImage *image, const QRegion &region)
 {
     GLTexture offscreenTexture(hasAlphaChannel() ? GL_RGBA8 : GL_RGB8, textureSize());
     GLRenderTarget offscreenTarget(offscreenTexture);
 
-    render(&offscreenTarget);
-    grabTexture(&offscreenTexture, image);
+    render(&offscreenTarget, region);
+    grabTexture(&offscreenTexture, image, region);
 }
 
-void WindowScreenCastSource::render(GLRenderTarget *target)
+void WindowScreenCastSource::render(GLRenderTarget *target, const QRegion &region)
 {
     const QRect geometry = m_window->clientGeometry();
     QMatrix4x4 projectionMatrix;
@@ -55,10 +72,22 @@ void WindowScreenCastSource::render(GLRenderTarget *target)
     WindowPaintData data(effectWindow);
     data.setProjectionMatrix(projectionMatrix);
 
+    // The window is painted as a whole, restrict it to the bounding rect of the damage
+    const QRect frame(QPoint(), geometry.size());
+    const QRect damagedRect = region.boundingRect().intersected(frame);
+    const bool scissored = damagedRect != frame;
+
     GLRenderTarget::pushRenderTarget(target);
+    if (scissored) {
+        glEnable(GL_SCISSOR_TEST);
+        glScissor(damagedRect.x(), damagedRect.y(), damagedRect.width(), damagedRect.height());
+    }
     glClearColor(0.0, 0.0, 0.0, 0.0);
     glClear(GL_COLOR_BUFFER_BIT);
     effectWindow->sceneWindow()->performPaint(Scene::PAINT_WINDOW_TRANSFORMED, infiniteRegion(), data);
+    if (scissored) {
+        glDisable(GL_SCISSOR_TEST);
+    }
     GLRenderTarget::popRenderTarget();
 }
 
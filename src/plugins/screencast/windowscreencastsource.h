@@ -25,8 +25,13 @@ public:
     bool hasAlphaChannel() const override;
     QSize textureSize() const override;
 
-    void render(GLRenderTarget *target) override;
-    void render(QImage *image) override;
+    void render(GLRenderTarget *target, const QRegion &region) override;
+    void render(QImage *image, const QRegion &region) override;
+
+    /**
+     * Maps the @a damage reported by Toplevel::damaged() to texture coordinates.
+     */
+    QRegion mapDamage(const QRegion &damage) const;
 
 private:
     QPointer<Toplevel> m_window;
@@ -15,8 +15,11 @@
 #include "effects.h"
 #include "input_event.h"
 #include "input_event_spy.h"
+#include "options.h"
 #include "osd.h"
+#include "renderloop.h"
 #include "screens.h"
+#include "startuptimeline.h"
 #include "wayland_server.h"
 #include "workspace.h"
 #include "decorations/decoratedclient.h"
@@ -36,6 +39,7 @@
 #include <KLocalizedString>
 
 #include <QHoverEvent>
+#include <QtConcurrentRun>
 #include <QWindow>
 #include <QPainter>
 
@@ -105,6 +109,9 @@ PointerInputRedirection::PointerInputRedirection(InputRedirection* parent)
     : InputDeviceHandler(parent)
     , m_cursor(nullptr)
 {
+    m_motionFlushTimer.setSingleShot(true);
+    m_motionFlushTimer.setTimerType(Qt::PreciseTimer);
+    connect(&m_motionFlushTimer, &QTimer::timeout, this, &PointerInputRedirection::flushPendingMotion);
 }
 
 PointerInputRedirection::~PointerInputRedirection() = default;
@@ -120,6 +127,14 @@ void PointerInputRedirection::init()
     setInited(true);
     InputDeviceHandler::init();
 
+    connect(options, &Options::pointerMotionBatchingChanged, this, &PointerInputRedirection::flushPendingMotion);
+    connect(input(), &InputRedirection::deviceRemoved, this, [this](InputDevice *device) {
+        // The held back motion refers to the device, send it while the device still exists
+        if (m_pendingMotion && m_pendingMotion->device == device) {
+            flushPendingMotion();
+        }
+    });
+
     if (!input()->hasPointer()) {
         Cursors::self()->hideCursor();
     }
@@ -247,15 +262,101 @@ QVector<PositionUpdateBlocker::ScheduledPosition> PositionUpdateBlocker::s_sched
 
 void PointerInputRedirection::processMotionAbsolute(const QPointF &pos, uint32_t time, InputDevice *device)
 {
+    if (batchMotion(pos, QSizeF(), QSizeF(), time, 0, device)) {
+        return;
+    }
     processMotionInternal(pos, QSizeF(), QSizeF(), time, 0, device);
 }
 
 void PointerInputRedirection::processMotion(const QSizeF &delta, const QSizeF &deltaNonAccelerated, uint32_t time, quint64 timeUsec, InputDevice *device)
 {
-    processMotionInternal(m_pos + QPointF(delta.width(), delta.height()), delta, deltaNonAccelerated, time, timeUsec, device);
+    const QPointF origin = m_pendingMotion ? m_pendingMotion->pos : m_pos;
+    const QPointF pos = origin + QPointF(delta.width(), delta.height());
+    if (batchMotion(pos, delta, deltaNonAccelerated, time, timeUsec, device)) {
+        return;
+    }
+    processMotionInternal(pos, delta, deltaNonAccelerated, time, timeUsec, device);
+}
+
+/**
+ * Holds back the motion until the next frame if pointer motion batching is enabled,
+ * merging it with the motion that has been held back already. Returns @c false if the
+ * motion has to be processed right away, in which case held back motion is flushed first
+ * so the order of events is kept.
+ */
+bool PointerInputRedirection::batchMotion(const QPointF &pos, const QSizeF &delta, const QSizeF &deltaNonAccelerated, uint32_t time, quint64 timeUsec, InputDevice *device)
+{
+    // Warps don't come from a device. Constraints depend on the path the pointer takes,
+    // so constrained motion is processed step by step.
+    const bool batch = device && options->pointerMotionBatching() && inited()
+        && !isConstrained() && !PositionUpdateBlocker::isPositionBlocked();
+    if (!batch || (m_pendingMotion && m_pendingMotion->device != device)) {
+        flushPendingMotion();
+        if (!batch) {
+            return false;
+        }
+    }
+
+    input()->setLastInputHandler(this);
+    if (!m_pendingMotion) {
+        m_pendingMotion = PendingMotion();
+        m_pendingMotion->pos = m_pos;
+        m_pendingMotion->device = device;
+        scheduleMotionFlush();
+    }
+
+    // Clamp every step to the screens, like processing the motions one by one would
+    m_pendingMotion->pos = confineToScreens(pos, m_pendingMotion->pos);
+    m_pendingMotion->delta += delta;
+    m_pendingMotion->deltaNonAccelerated += deltaNonAccelerated;
+    m_pendingMotion->time = time;
+    m_pendingMotion->timeUsec = timeUsec;
+    if (!delta.isNull() || !deltaNonAccelerated.isNull()) {
+        m_pendingMotion->relativeMotions.append({delta, deltaNonAccelerated, timeUsec});
+    }
+    return true;
 }
 
-void PointerInputRedirection::processMotionInternal(const QPointF &pos, const QSizeF &delta, const QSizeF &deltaNonAccelerated, uint32_t time, quint64 timeUsec, InputDevice *device)
+void PointerInputRedirection::scheduleMotionFlush()
+{
+    const AbstractOutput *output = kwinApp()->platform()->outputAt(m_pos.toPoint());
+    RenderLoop *renderLoop = output ? output->renderLoop() : kwinApp()->platform()->renderLoop();
+    if (!renderLoop) {
+        m_motionFlushTimer.start(0);
+        return;
+    }
+
+    // The best moment is right before the next frame is composited
+    m_motionFlushConnection = connect(renderLoop, &RenderLoop::aboutToRequestFrame, this, &PointerInputRedirection::flushPendingMotion);
+
+    // Nothing might be repainted though, e.g. with a hardware cursor, so flush half a refresh
+    // cycle before the next vblank at the latest, in time for the cursor to move in that frame.
+    const std::chrono::nanoseconds vblankInterval(1'000'000'000'000ull / renderLoop->refreshRate());
+    const std::chrono::nanoseconds currentTime(std::chrono::steady_clock::now().time_since_epoch());
+    std::chrono::nanoseconds deadline = renderLoop->lastPresentationTimestamp() + vblankInterval / 2;
+    if (deadline <= currentTime) {
+        deadline += ((currentTime - deadline) / vblankInterval + 1) * vblankInterval;
+    }
+    m_motionFlushTimer.start(std::chrono::ceil<std::chrono::milliseconds>(deadline - currentTime));
+}
+
+void PointerInputRedirection::flushPendingMotion()
+{
+    if (!m_pendingMotion) {
+        return;
+    }
+    m_motionFlushTimer.stop();
+    disconnect(m_motionFlushConnection);
+    m_motionFlushConnection = QMetaObject::Connection();
+
+    const PendingMotion motion = std::move(*m_pendingMotion);
+    m_pendingMotion.reset();
+    processMotionInternal(motion.pos, motion.delta, motion.deltaNonAccelerated, motion.time, motion.timeUsec,
+                          motion.device, motion.relativeMotions);
+}
+
+void PointerInputRedirection::processMotionInternal(const QPointF &pos, const QSizeF &delta, const QSizeF &deltaNonAccelerated, uint32_t time, quint64 timeUsec, InputDevice *device,
+                                                    const QVector<MouseEvent::RelativeMotion> &coalescedMotions)
 {
     input()->setLastInputHandler(this);
     if (!inited()) {
@@ -272,14 +373,16 @@ void PointerInputRedirection::processMotionInternal(const QPointF &pos, const QS
                      input()->keyboardModifiers(), time,
                      delta, deltaNonAccelerated, timeUsec, device);
     event.setModifiersRelevantForGlobalShortcuts(input()->modifiersRelevantForGlobalShortcuts());
+    event.setCoalescedMotions(coalescedMotions);
 
     update();
     input()->processSpies(std::bind(&InputEventSpy::pointerEvent, std::placeholders::_1, &event));
-    input()->processFilters(std::bind(&InputEventFilter::pointerEvent, std::placeholders::_1, &event, 0));
+    input()->processFilters(InputEventFilter::PointerEvents, std::bind(&InputEventFilter::pointerEvent, std::placeholders::_1, &event, 0));
 }
 
 void PointerInputRedirection::processButton(uint32_t button, InputRedirection::PointerButtonState state, uint32_t time, InputDevice *device)
 {
+    flushPendingMotion();
     input()->setLastInputHandler(this);
     QEvent::Type type;
     switch (state) {
@@ -308,7 +411,7 @@ void PointerInputRedirection::processButton(uint32_t button, InputRedirection::P
         return;
     }
 
-    input()->processFilters(std::bind(&InputEventFilter::pointerEvent, std::placeholders::_1, &event, button));
+    input()->processFilters(InputEventFilter::PointerEvents, std::bind(&InputEventFilter::pointerEvent, std::placeholders::_1, &event, button));
 
     if (state == InputRedirection::PointerButtonReleased) {
         update();
@@ -318,6 +421,7 @@ void PointerInputRedirection::processButton(uint32_t button, InputRedirection::P
 void PointerInputRedirection::processAxis(InputRedirection::PointerAxis axis, qreal delta, qint32 discreteDelta,
     InputRedirection::PointerAxisSource source, uint32_t time, InputDevice *device)
 {
+    flushPendingMotion();
     input()->setLastInputHandler(this);
     update();
 
@@ -333,11 +437,12 @@ void PointerInputRedirection::processAxis(InputRedirection::PointerAxis axis, qr
     if (!inited()) {
         return;
     }
-    input()->processFilters(std::bind(&InputEventFilter::wheelEvent, std::placeholders::_1, &wheelEvent));
+    input()->processFilters(InputEventFilter::WheelEvents, std::bind(&InputEventFilter::wheelEvent, std::placeholders::_1, &wheelEvent));
 }
 
 void PointerInputRedirection::processSwipeGestureBegin(int fingerCount, quint32 time, KWin::InputDevice *device)
 {
+    flushPendingMotion();
     input()->setLastInputHandler(this);
     Q_UNUSED(device)
     if (!inited()) {
@@ -345,11 +450,12 @@ void PointerInputRedirection::processSwipeGestureBegin(int fingerCount, quint32
     }
 
     input()->processSpies(std::bind(&InputEventSpy::swipeGestureBegin, std::placeholders::_1, fingerCount, time));
-    input()->processFilters(std::bind(&InputEventFilter::swipeGestureBegin, std::placeholders::_1, fingerCount, time));
+    input()->processFilters(InputEventFilter::GestureEvents, std::bind(&InputEventFilter::swipeGestureBegin, std::placeholders::_1, fingerCount, time));
 }
 
 void PointerInputRedirection::processSwipeGestureUpdate(const QSizeF &delta, quint32 time, KWin::InputDevice *device)
 {
+    flushPendingMotion();
     input()->setLastInputHandler(this);
     Q_UNUSED(device)
     if (!inited()) {
@@ -358,11 +464,12 @@ void PointerInputRedirection::processSwipeGestureUpdate(const QSizeF &delta, qui
     update();
 
     input()->processSpies(std::bind(&InputEventSpy::swipeGestureUpdate, std::placeholders::_1, delta, time));
-    input()->processFilters(std::bind(&InputEventFilter::swipeGestureUpdate, std::placeholders::_1, delta, time));
+    input()->processFilters(InputEventFilter::GestureEvents, std::bind(&InputEventFilter::swipeGestureUpdate, std::placeholders::_1, delta, time));
 }
 
 void PointerInputRedirection::processSwipeGestureEnd(quint32 time, KWin::InputDevice *device)
 {
+    flushPendingMotion();
     input()->setLastInputHandler(this);
     Q_UNUSED(device)
     if (!inited()) {
@@ -371,11 +478,12 @@ void PointerInputRedirection::processSwipeGestureEnd(quint32 time, KWin::InputDe
     update();
 
     input()->processSpies(std::bind(&InputEventSpy::swipeGestureEnd, std::placeholders::_1, time));
-    input()->processFilters(std::bind(&InputEventFilter::swipeGestureEnd, std::placeholders::_1, time));
+    input()->processFilters(InputEventFilter::GestureEvents, std::bind(&InputEventFilter::swipeGestureEnd, std::placeholders::_1, time));
 }
 
 void PointerInputRedirection::processSwipeGestureCancelled(quint32 time, KWin::InputDevice *device)
 {
+    flushPendingMotion();
     input()->setLastInputHandler(this);
     Q_UNUSED(device)
     if (!inited()) {
@@ -384,11 +492,12 @@ void PointerInputRedirection::processSwipeGestureCancelled(quint32 time, KWin::I
     update();
 
     input()->processSpies(std::bind(&InputEventSpy::swipeGestureCancelled, std::placeholders::_1, time));
-    input()->processFilters(std::bind(&InputEventFilter::swipeGestureCancelled, std::placeholders::_1, time));
+    input()->processFilters(InputEventFilter::GestureEvents, std::bind(&InputEventFilter::swipeGestureCancelled, std::placeholders::_1, time));
 }
 
 void PointerInputRedirection::processPinchGestureBegin(int fingerCount, quint32 time, KWin::InputDevice *device)
 {
+    flushPendingMotion();
     input()->setLastInputHandler(this);
     Q_UNUSED(device)
     if (!inited()) {
@@ -397,11 +506,12 @@ void PointerInputRedirection::processPinchGestureBegin(int fingerCount, quint32
     update();
 
     input()->processSpies(std::bind(&InputEventSpy::pinchGestureBegin, std::placeholders::_1, fingerCount, time));
-    input()->processFilters(std::bind(&InputEventFilter::pinchGestureBegin, std::placeholders::_1, fingerCount, time));
+    input()->processFilters(InputEventFilter::GestureEvents, std::bind(&InputEventFilter::pinchGestureBegin, std::placeholders::_1, fingerCount, time));
 }
 
 void PointerInputRedirection::processPinchGestureUpdate(qreal scale, qreal angleDelta, const QSizeF &delta, quint32 time, KWin::InputDevice *device)
 {
+    flushPendingMotion();
     input()->setLastInputHandler(this);
     Q_UNUSED(device)
     if (!inited()) {
@@ -410,11 +520,12 @@ void PointerInputRedirection::processPinchGestureUpdate(qreal scale, qreal angle
     update();
 
     input()->processSpies(std::bind(&InputEventSpy::pinchGestureUpdate, std::placeholders::_1, scale, angleDelta, delta, time));
-    input()->processFilters(std::bind(&InputEventFilter::pinchGestureUpdate, std::placeholders::_1, scale, angleDelta, delta, time));
+    input()->processFilters(InputEventFilter::GestureEvents, std::bind(&InputEventFilter::pinchGestureUpdate, std::placeholders::_1, scale, angleDelta, delta, time));
 }
 
 void PointerInputRedirection::processPinchGestureEnd(quint32 time, KWin::InputDevice *device)
 {
+    flushPendingMotion();
     input()->setLastInputHandler(this);
     Q_UNUSED(device)
     if (!inited()) {
@@ -423,11 +534,12 @@ void PointerInputRedirection::processPinchGestureEnd(quint32 time, KWin::InputDe
     update();
 
     input()->processSpies(std::bind(&InputEventSpy::pinchGestureEnd, std::placeholders::_1, time));
-    input()->processFilters(std::bind(&InputEventFilter::pinchGestureEnd, std::placeholders::_1, time));
+    input()->processFilters(InputEventFilter::GestureEvents, std::bind(&InputEventFilter::pinchGestureEnd, std::placeholders::_1, time));
 }
 
 void PointerInputRedirection::processPinchGestureCancelled(quint32 time, KWin::InputDevice *device)
 {
+    flushPendingMotion();
     input()->setLastInputHandler(this);
     Q_UNUSED(device)
     if (!inited()) {
@@ -436,11 +548,12 @@ void PointerInputRedirection::processPinchGestureCancelled(quint32 time, KWin::I
     update();
 
     input()->processSpies(std::bind(&InputEventSpy::pinchGestureCancelled, std::placeholders::_1, time));
-    input()->processFilters(std::bind(&InputEventFilter::pinchGestureCancelled, std::placeholders::_1, time));
+    input()->processFilters(InputEventFilter::GestureEvents, std::bind(&InputEventFilter::pinchGestureCancelled, std::placeholders::_1, time));
 }
 
 void PointerInputRedirection::processHoldGestureBegin(int fingerCount, quint32 time, KWin::InputDevice *device)
 {
+    flushPendingMotion();
     Q_UNUSED(device)
     if (!inited()) {
         return;
@@ -448,11 +561,12 @@ void PointerInputRedirection::processHoldGestureBegin(int fingerCount, quint32 t
     update();
 
     input()->processSpies(std::bind(&InputEventSpy::holdGestureBegin, std::placeholders::_1, fingerCount, time));
-    input()->processFilters(std::bind(&InputEventFilter::holdGestureBegin, std::placeholders::_1, fingerCount, time));
+    input()->processFilters(InputEventFilter::GestureEvents, std::bind(&InputEventFilter::holdGestureBegin, std::placeholders::_1, fingerCount, time));
 }
 
 void PointerInputRedirection::processHoldGestureEnd(quint32 time, KWin::InputDevice *device)
 {
+    flushPendingMotion();
     Q_UNUSED(device)
     if (!inited()) {
         return;
@@ -460,11 +574,12 @@ void PointerInputRedirection::processHoldGestureEnd(quint32 time, KWin::InputDev
     update();
 
     input()->processSpies(std::bind(&InputEventSpy::holdGestureEnd, std::placeholders::_1, time));
-    input()->processFilters(std::bind(&InputEventFilter::holdGestureEnd, std::placeholders::_1, time));
+    input()->processFilters(InputEventFilter::GestureEvents, std::bind(&InputEventFilter::holdGestureEnd, std::placeholders::_1, time));
 }
 
 void PointerInputRedirection::processHoldGestureCancelled(quint32 time, KWin::InputDevice *device)
 {
+    flushPendingMotion();
     Q_UNUSED(device)
     if (!inited()) {
         return;
@@ -472,7 +587,7 @@ void PointerInputRedirection::processHoldGestureCancelled(quint32 time, KWin::In
     update();
 
     input()->processSpies(std::bind(&InputEventSpy::holdGestureCancelled, std::placeholders::_1, time));
-    input()->processFilters(std::bind(&InputEventFilter::holdGestureCancelled, std::placeholders::_1, time));
+    input()->processFilters(InputEventFilter::GestureEvents, std::bind(&InputEventFilter::holdGestureCancelled, std::placeholders::_1, time));
 }
 
 bool PointerInputRedirection::areButtonsPressed() const
@@ -803,16 +918,7 @@ void PointerInputRedirection::updatePosition(const QPointF &pos)
         // locked pointer should not move
         return;
     }
-    // verify that at least one screen contains the pointer position
-    QPointF p = pos;
-    if (!screenContainsPos(p)) {
-        const QRectF unitedScreensGeometry = workspace()->geometry();
-        p = confineToBoundingBox(p, unitedScreensGeometry);
-        if (!screenContainsPos(p)) {
-            const AbstractOutput *currentOutput = kwinApp()->platform()->outputAt(m_pos.toPoint());
-            p = confineToBoundingBox(p, currentOutput->geometry());
-        }
-    }
+    QPointF p = confineToScreens(pos, m_pos);
     p = applyPointerConfinement(p);
     if (p == m_pos) {
         // didn't change due to confinement
@@ -830,6 +936,21 @@ void PointerInputRedirection::updatePosition(const QPointF &pos)
     Q_EMIT input()->globalPointerChanged(m_pos);
 }
 
+QPointF PointerInputRedirection::confineToScreens(const QPointF &pos, const QPointF &current) const
+{
+    // verify that at least one screen contains the pointer position
+    QPointF p = pos;
+    if (!screenContainsPos(p)) {
+        const QRectF unitedScreensGeometry = workspace()->geometry();
+        p = confineToBoundingBox(p, unitedScreensGeometry);
+        if (!screenContainsPos(p)) {
+            const AbstractOutput *currentOutput = kwinApp()->platform()->outputAt(current.toPoint());
+            p = confineToBoundingBox(p, currentOutput->geometry());
+        }
+    }
+    return p;
+}
+
 void PointerInputRedirection::updateCursorOutputs()
 {
     KWaylandServer::PointerInterface *pointer = waylandServer()->seat()->pointer();
@@ -1255,6 +1376,41 @@ void CursorImage::loadThemeCursor(const QByteArray &shape, WaylandCursorImage::I
     m_waylandImage.loadThemeCursor(shape, image);
 }
 
+/**
+ * The cursor theme that has been loaded ahead of time, it's only used if the theme, its size
+ * and the scale are still the same when the theme is needed.
+ */
+struct CursorThemePrefetch
+{
+    QString themeName;
+    int themeSize = 0;
+    qreal devicePixelRatio = 1;
+    QFuture<KXcursorTheme> theme;
+    bool pending = false;
+};
+static CursorThemePrefetch s_cursorThemePrefetch;
+
+void WaylandCursorImage::prefetchCursorTheme()
+{
+    const Cursor *pointerCursor = Cursors::self()->mouse();
+    if (!pointerCursor) {
+        return;
+    }
+
+    const QString themeName = pointerCursor->themeName();
+    const int themeSize = pointerCursor->themeSize();
+    const qreal devicePixelRatio = screens()->maxScale();
+
+    s_cursorThemePrefetch.themeName = themeName;
+    s_cursorThemePrefetch.themeSize = themeSize;
+    s_cursorThemePrefetch.devicePixelRatio = devicePixelRatio;
+    s_cursorThemePrefetch.theme = QtConcurrent::run([themeName, themeSize, devicePixelRatio]() {
+        StartupPhase phase(QStringLiteral("cursor theme prefetch"));
+        return KXcursorTheme::fromTheme(themeName, themeSize, devicePixelRatio);
+    });
+    s_cursorThemePrefetch.pending = true;
+}
+
 WaylandCursorImage::WaylandCursorImage(QObject *parent)
     : QObject(parent)
 {
@@ -1273,6 +1429,19 @@ bool WaylandCursorImage::ensureCursorTheme()
     const Cursor *pointerCursor = Cursors::self()->mouse();
     const qreal targetDevicePixelRatio = screens()->maxScale();
 
+    if (s_cursorThemePrefetch.pending) {
+        const CursorThemePrefetch prefetch = s_cursorThemePrefetch;
+        s_cursorThemePrefetch = CursorThemePrefetch();
+        if (prefetch.themeName == pointerCursor->themeName()
+                && prefetch.themeSize == pointerCursor->themeSize()
+                && qFuzzyCompare(prefetch.devicePixelRatio, targetDevicePixelRatio)) {
+            m_cursorTheme = prefetch.theme.result();
+            if (!m_cursorTheme.isEmpty()) {
+                return true;
+            }
+        }
+    }
+
     m_cursorTheme = KXcursorTheme::fromTheme(pointerCursor->themeName(), pointerCursor->themeSize(),
                                              targetDevicePixelRatio);
     if (!m_cursorTheme.isEmpty()) {
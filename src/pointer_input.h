@@ -12,6 +12,7 @@
 #define KWIN_POINTER_INPUT_H
 
 #include "input.h"
+#include "input_event.h"
 #include "cursor.h"
 #include "xcursortheme.h"
 
@@ -19,6 +20,9 @@
 #include <QObject>
 #include <QPointer>
 #include <QPointF>
+#include <QTimer>
+
+#include <optional>
 
 class QWindow;
 
@@ -79,6 +83,11 @@ public:
 
     bool focusUpdatesBlocked() override;
 
+    /**
+     * Processes the motion that has been held back by pointer motion batching, if any.
+     */
+    void flushPendingMotion();
+
     /**
      * @internal
      */
@@ -141,7 +150,10 @@ public:
     void processHoldGestureCancelled(quint32 time, KWin::InputDevice *device = nullptr);
 
 private:
-    void processMotionInternal(const QPointF &pos, const QSizeF &delta, const QSizeF &deltaNonAccelerated, uint32_t time, quint64 timeUsec, InputDevice *device);
+    void processMotionInternal(const QPointF &pos, const QSizeF &delta, const QSizeF &deltaNonAccelerated, uint32_t time, quint64 timeUsec, InputDevice *device,
+                               const QVector<MouseEvent::RelativeMotion> &coalescedMotions = {});
+    bool batchMotion(const QPointF &pos, const QSizeF &delta, const QSizeF &deltaNonAccelerated, uint32_t time, quint64 timeUsec, InputDevice *device);
+    void scheduleMotionFlush();
     void cleanupDecoration(Decoration::DecoratedClientImpl *old, Decoration::DecoratedClientImpl *now) override;
 
     void focusUpdate(Toplevel *focusOld, Toplevel *focusNow) override;
@@ -151,6 +163,7 @@ private:
     void updateOnStartMoveResize();
     void updateToReset();
     void updatePosition(const QPointF &pos);
+    QPointF confineToScreens(const QPointF &pos, const QPointF &current) const;
     void updateButton(uint32_t button, InputRedirection::PointerButtonState state);
     QPointF applyPointerConfinement(const QPointF &pos) const;
     void disconnectConfinedPointerRegionConnection();
@@ -171,6 +184,21 @@ private:
     bool m_confined = false;
     bool m_locked = false;
     bool m_enableConstraints = true;
+
+    struct PendingMotion
+    {
+        QPointF pos;
+        QSizeF delta;
+        QSizeF deltaNonAccelerated;
+        uint32_t time = 0;
+        quint64 timeUsec = 0;
+        InputDevice *device = nullptr;
+        QVector<MouseEvent::RelativeMotion> relativeMotions;
+    };
+    std::optional<PendingMotion> m_pendingMotion;
+    QTimer m_motionFlushTimer;
+    QMetaObject::Connection m_motionFlushConnection;
+
     friend class PositionUpdateBlocker;
 };
 
@@ -188,6 +216,12 @@ public:
     void loadThemeCursor(const CursorShape &shape, Image *cursorImage);
     void loadThemeCursor(const QByteArray &name, Image *cursorImage);
 
+    /**
+     * Starts loading the current cursor theme in a thread, so it is ready by the time
+     * the first cursor is shown.
+     */
+    static void prefetchCursorTheme();
+
 Q_SIGNALS:
     void themeChanged();
 
@@ -19,6 +19,7 @@ namespace KWin
 
 PopupInputFilter::PopupInputFilter()
     : QObject()
+    , InputEventFilter(PointerEvents | KeyEvents | TouchEvents)
 {
     connect(workspace(), &Workspace::clientAdded, this, &PopupInputFilter::handleClientAdded);
     connect(workspace(), &Workspace::internalClientAdded, this, &PopupInputFilter::handleClientAdded);
@@ -6,16 +6,30 @@
 
 #include "renderjournal.h"
 
+#include <algorithm>
+#include <cmath>
+
 namespace KWin
 {
 
+// Frames that are never presented or discarded must not pile up
+static const int s_maxPendingFrames = 8;
+
+static std::chrono::nanoseconds currentTimestamp()
+{
+    return std::chrono::steady_clock::now().time_since_epoch();
+}
+
 RenderJournal::RenderJournal()
 {
 }
 
-void RenderJournal::beginFrame()
+void RenderJournal::beginFrame(std::chrono::nanoseconds expectedPresentationTimestamp)
 {
     m_timer.start();
+    m_currentFrame = FrameTiming();
+    m_currentFrame.renderBegin = currentTimestamp();
+    m_currentFrame.expectedPresentation = expectedPresentationTimestamp;
 }
 
 void RenderJournal::endFrame()
@@ -25,6 +39,182 @@ void RenderJournal::endFrame()
         m_log.dequeue();
     }
     m_log.enqueue(duration);
+
+    if (m_renderTimeLog.count() >= estimateWindow) {
+        m_renderTimeLog.dequeue();
+    }
+    m_renderTimeLog.enqueue(duration);
+
+    m_currentFrame.renderEnd = m_currentFrame.renderBegin + duration;
+    if (m_pendingFrames.count() >= s_maxPendingFrames) {
+        m_pendingFrames.dequeue();
+    }
+    m_pendingFrames.enqueue(m_currentFrame);
+}
+
+bool RenderJournal::presentFrame(std::chrono::nanoseconds timestamp, std::chrono::nanoseconds vblankInterval)
+{
+    if (m_pendingFrames.isEmpty()) {
+        return false;
+    }
+
+    FrameTiming timing = m_pendingFrames.dequeue();
+    timing.presentation = timestamp;
+
+    // A frame that shows up more than half a refresh cycle after the predicted
+    // presentation time has missed at least one vblank.
+    bool late = false;
+    if (timing.expectedPresentation.count() && vblankInterval.count()) {
+        const std::chrono::nanoseconds delay = timestamp - timing.expectedPresentation;
+        if (delay > vblankInterval / 2) {
+            m_missedVblankCount.fetch_add((delay + vblankInterval / 2) / vblankInterval, std::memory_order_relaxed);
+            m_lateFrameCount.fetch_add(1, std::memory_order_relaxed);
+            late = true;
+        }
+    }
+
+    record(timing);
+    return late;
+}
+
+void RenderJournal::addGpuRenderTime(std::chrono::nanoseconds duration)
+{
+    if (m_gpuTimeLog.count() >= estimateWindow) {
+        m_gpuTimeLog.dequeue();
+    }
+    m_gpuTimeLog.enqueue(duration);
+}
+
+void RenderJournal::discardFrame()
+{
+    if (!m_pendingFrames.isEmpty()) {
+        m_pendingFrames.dequeue();
+    }
+}
+
+void RenderJournal::record(const FrameTiming &timing)
+{
+    const quint64 index = m_timingCount.load(std::memory_order_relaxed);
+    TimingSlot &slot = m_timings[index % timingCapacity];
+
+    slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.renderBegin.store(timing.renderBegin.count(), std::memory_order_relaxed);
+    slot.renderEnd.store(timing.renderEnd.count(), std::memory_order_relaxed);
+    slot.expectedPresentation.store(timing.expectedPresentation.count(), std::memory_order_relaxed);
+    slot.presentation.store(timing.presentation.count(), std::memory_order_relaxed);
+    slot.sequence.store(2 * index + 2, std::memory_order_release);
+
+    m_timingCount.store(index + 1, std::memory_order_release);
+}
+
+QVector<FrameTiming> RenderJournal::timings() const
+{
+    const quint64 count = m_timingCount.load(std::memory_order_acquire);
+    const quint64 first = count > quint64(timingCapacity) ? count - timingCapacity : 0;
+
+    QVector<FrameTiming> result;
+    result.reserve(count - first);
+    for (quint64 index = first; index < count; ++index) {
+        const TimingSlot &slot = m_timings[index % timingCapacity];
+
+        // Skip slots that are overwritten by the writer while they are being read
+        const quint64 sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence != 2 * index + 2) {
+            continue;
+        }
+        FrameTiming timing;
+        timing.renderBegin = std::chrono::nanoseconds(slot.renderBegin.load(std::memory_order_relaxed));
+        timing.renderEnd = std::chrono::nanoseconds(slot.renderEnd.load(std::memory_order_relaxed));
+        timing.expectedPresentation = std::chrono::nanoseconds(slot.expectedPresentation.load(std::memory_order_relaxed));
+        timing.presentation = std::chrono::nanoseconds(slot.presentation.load(std::memory_order_relaxed));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != sequence) {
+            continue;
+        }
+        result.append(timing);
+    }
+
+    return result;
+}
+
+static std::chrono::nanoseconds percentileOf(QVector<std::chrono::nanoseconds> &values, qreal percentile)
+{
+    if (values.isEmpty()) {
+        return std::chrono::nanoseconds::zero();
+    }
+
+    // Nearest-rank percentile
+    const qreal clamped = std::clamp(percentile, qreal(0), qreal(100));
+    const int rank = std::max(1, int(std::ceil(clamped / 100 * values.count())));
+    auto nth = values.begin() + (rank - 1);
+    std::nth_element(values.begin(), nth, values.end());
+    return *nth;
+}
+
+std::chrono::nanoseconds RenderJournal::renderTimePercentile(qreal percentile) const
+{
+    const QVector<FrameTiming> frames = timings();
+
+    QVector<std::chrono::nanoseconds> values;
+    values.reserve(frames.count());
+    for (const FrameTiming &timing : frames) {
+        values.append(timing.renderTime());
+    }
+
+    return percentileOf(values, percentile);
+}
+
+std::chrono::nanoseconds RenderJournal::latencyPercentile(qreal percentile) const
+{
+    const QVector<FrameTiming> frames = timings();
+
+    QVector<std::chrono::nanoseconds> values;
+    values.reserve(frames.count());
+    for (const FrameTiming &timing : frames) {
+        values.append(timing.latency());
+    }
+
+    return percentileOf(values, percentile);
+}
+
+std::chrono::nanoseconds RenderJournal::estimate(qreal percentile) const
+{
+    QVector<std::chrono::nanoseconds> renderTimes(m_renderTimeLog.constBegin(), m_renderTimeLog.constEnd());
+    QVector<std::chrono::nanoseconds> gpuTimes(m_gpuTimeLog.constBegin(), m_gpuTimeLog.constEnd());
+
+    // The GPU starts executing the frame only after the CPU has submitted some of it, so
+    // the slower of the two bounds how long the frame takes to complete.
+    return std::max(percentileOf(renderTimes, percentile), percentileOf(gpuTimes, percentile));
+}
+
+quint64 RenderJournal::presentedFrameCount() const
+{
+    return m_timingCount.load(std::memory_order_relaxed);
+}
+
+quint64 RenderJournal::missedVblankCount() const
+{
+    return m_missedVblankCount.load(std::memory_order_relaxed);
+}
+
+quint64 RenderJournal::lateFrameCount() const
+{
+    return m_lateFrameCount.load(std::memory_order_relaxed);
+}
+
+void RenderJournal::reset()
+{
+    // The sequence numbers are derived from the frame index, so they have to be
+    // invalidated along with the counter.
+    for (TimingSlot &slot : m_timings) {
+        slot.sequence.store(0, std::memory_order_relaxed);
+    }
+    m_timingCount.store(0, std::memory_order_release);
+    m_renderTimeLog.clear();
+    m_gpuTimeLog.clear();
+    m_missedVblankCount.store(0, std::memory_order_relaxed);
+    m_lateFrameCount.store(0, std::memory_order_relaxed);
 }
 
 std::chrono::nanoseconds RenderJournal::minimum() const
@@ -10,13 +10,43 @@
 
 #include <QElapsedTimer>
 #include <QQueue>
+#include <QVector>
+
+#include <array>
+#include <atomic>
+#include <chrono>
 
 namespace KWin
 {
 
+/**
+ * The FrameTiming struct describes when a frame was rendered and presented.
+ */
+struct FrameTiming
+{
+    std::chrono::nanoseconds renderBegin = std::chrono::nanoseconds::zero();
+    std::chrono::nanoseconds renderEnd = std::chrono::nanoseconds::zero();
+    std::chrono::nanoseconds expectedPresentation = std::chrono::nanoseconds::zero();
+    std::chrono::nanoseconds presentation = std::chrono::nanoseconds::zero();
+
+    std::chrono::nanoseconds renderTime() const
+    {
+        return renderEnd - renderBegin;
+    }
+
+    std::chrono::nanoseconds latency() const
+    {
+        return presentation - renderBegin;
+    }
+};
+
 /**
  * The RenderJournal class measures how long it takes to render frames and estimates how
  * long it will take to render the next frame.
+ *
+ * Besides the short log used for the estimates, the journal records the timings of the
+ * last presented frames in a fixed-size ring. There is a single writer, the render loop,
+ * but the ring can be inspected from any thread without locking.
  */
 class KWIN_EXPORT RenderJournal
 {
@@ -24,15 +54,77 @@ public:
     RenderJournal();
 
     /**
-     * This function must be called before starting rendering a new frame.
+     * This function must be called before starting rendering a new frame that is expected
+     * to be presented at @a expectedPresentationTimestamp.
      */
-    void beginFrame();
+    void beginFrame(std::chrono::nanoseconds expectedPresentationTimestamp = std::chrono::nanoseconds::zero());
 
     /**
      * This function must be called after finishing rendering a frame.
      */
     void endFrame();
 
+    /**
+     * This function must be called when the oldest rendered frame has been presented at
+     * @a timestamp. @a vblankInterval is used to determine how many vblanks were missed.
+     *
+     * Returns @c true if the frame has been presented later than predicted.
+     */
+    bool presentFrame(std::chrono::nanoseconds timestamp, std::chrono::nanoseconds vblankInterval);
+
+    /**
+     * Records how long the GPU took to execute the commands of a frame. The GPU time is
+     * usually known only a frame or two after the frame has been submitted.
+     */
+    void addGpuRenderTime(std::chrono::nanoseconds duration);
+
+    /**
+     * This function must be called when the oldest rendered frame has failed to be presented.
+     */
+    void discardFrame();
+
+    /**
+     * Returns the number of frames that have been presented.
+     */
+    quint64 presentedFrameCount() const;
+
+    /**
+     * Returns the total number of vblanks that frames have been presented later than predicted.
+     */
+    quint64 missedVblankCount() const;
+
+    /**
+     * Returns the number of frames that have been presented at least one vblank late.
+     */
+    quint64 lateFrameCount() const;
+
+    /**
+     * Returns the timings of the recorded frames, oldest first.
+     */
+    QVector<FrameTiming> timings() const;
+
+    /**
+     * Returns the render time below which @a percentile percent of the recorded frames fall.
+     */
+    std::chrono::nanoseconds renderTimePercentile(qreal percentile) const;
+
+    /**
+     * Returns the time from the start of rendering to presentation below which @a percentile
+     * percent of the recorded frames fall.
+     */
+    std::chrono::nanoseconds latencyPercentile(qreal percentile) const;
+
+    /**
+     * Returns the time needed to render a frame with a probability of @a percentile percent,
+     * based on the CPU and GPU render times of the last estimateWindow frames.
+     */
+    std::chrono::nanoseconds estimate(qreal percentile) const;
+
+    /**
+     * Clears the recorded frame timings and counters.
+     */
+    void reset();
+
     /**
      * Returns the maximum estimated amount of time that it takes to render a single frame.
      */
@@ -48,10 +140,42 @@ public:
      */
     std::chrono::nanoseconds average() const;
 
+    /**
+     * The maximum number of frame timings kept by the journal.
+     */
+    static constexpr int timingCapacity = 512;
+
+    /**
+     * The number of recent frames used by estimate().
+     */
+    static constexpr int estimateWindow = 120;
+
 private:
+    struct TimingSlot
+    {
+        // odd while the slot is being written
+        std::atomic<quint64> sequence{0};
+        std::atomic<qint64> renderBegin{0};
+        std::atomic<qint64> renderEnd{0};
+        std::atomic<qint64> expectedPresentation{0};
+        std::atomic<qint64> presentation{0};
+    };
+
+    void record(const FrameTiming &timing);
+
     QElapsedTimer m_timer;
     QQueue<std::chrono::nanoseconds> m_log;
     int m_size = 15;
+    QQueue<std::chrono::nanoseconds> m_renderTimeLog;
+    QQueue<std::chrono::nanoseconds> m_gpuTimeLog;
+
+    FrameTiming m_currentFrame;
+    QQueue<FrameTiming> m_pendingFrames;
+
+    std::array<TimingSlot, timingCapacity> m_timings;
+    std::atomic<quint64> m_timingCount{0};
+    std::atomic<quint64> m_missedVblankCount{0};
+    std::atomic<quint64> m_lateFrameCount{0};
 };
 
 } // namespace KWin
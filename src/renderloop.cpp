@@ -10,6 +10,8 @@
 #include "surfaceitem.h"
 #include "utils/common.h"
 
+#include <algorithm>
+
 namespace KWin
 {
 
@@ -52,7 +54,7 @@ void RenderLoopPrivate::scheduleRepaint()
     }
 
     // Estimate when it's a good time to perform the next compositing cycle.
-    const std::chrono::nanoseconds safetyMargin = std::chrono::milliseconds(3);
+    std::chrono::nanoseconds safetyMargin = std::chrono::milliseconds(3);
 
     std::chrono::nanoseconds renderTime;
     switch (options->latencyPolicy()) {
@@ -83,6 +85,13 @@ void RenderLoopPrivate::scheduleRepaint()
     case RenderTimeEstimatorAverage:
         renderTime = std::max(renderTime, renderJournal.average());
         break;
+    case RenderTimeEstimatorAdaptive:
+        // Start as late as the recent frames allow instead of reserving a fixed fraction
+        // of the refresh cycle. The margin covers what the percentile misses and is tuned
+        // by the missed frame rate, see updateAdaptiveMargin().
+        renderTime = renderJournal.estimate(100 - options->missedFrameTarget());
+        safetyMargin = adaptiveMargin;
+        break;
     }
 
     std::chrono::nanoseconds nextRenderTimestamp = nextPresentationTimestamp - renderTime - safetyMargin;
@@ -113,6 +122,7 @@ void RenderLoopPrivate::notifyFrameFailed()
 {
     Q_ASSERT(pendingFrameCount > 0);
     pendingFrameCount--;
+    renderJournal.discardFrame();
 
     if (!inhibitCount) {
         maybeScheduleRepaint();
@@ -134,6 +144,12 @@ void RenderLoopPrivate::notifyFrameCompleted(std::chrono::nanoseconds timestamp)
         lastPresentationTimestamp = std::chrono::steady_clock::now().time_since_epoch();
     }
 
+    const std::chrono::nanoseconds vblankInterval(1'000'000'000'000ull / refreshRate);
+    const bool late = renderJournal.presentFrame(lastPresentationTimestamp, vblankInterval);
+    if (options->renderTimeEstimator() == RenderTimeEstimatorAdaptive) {
+        updateAdaptiveMargin(late, vblankInterval);
+    }
+
     if (!inhibitCount) {
         maybeScheduleRepaint();
     }
@@ -141,12 +157,31 @@ void RenderLoopPrivate::notifyFrameCompleted(std::chrono::nanoseconds timestamp)
     Q_EMIT q->framePresented(q, timestamp);
 }
 
+void RenderLoopPrivate::updateAdaptiveMargin(bool late, std::chrono::nanoseconds vblankInterval)
+{
+    // Exponential moving average over roughly the last two seconds at 60Hz
+    const qreal smoothing = 1.0 / 120;
+    missedFrameRate += smoothing * ((late ? 100 : 0) - missedFrameRate);
+
+    // Back off quickly after a missed frame and creep closer to the deadline again
+    // while the missed frame rate stays below the target.
+    if (late) {
+        adaptiveMargin += vblankInterval / 16;
+    } else if (missedFrameRate < options->missedFrameTarget()) {
+        adaptiveMargin -= std::chrono::microseconds(50);
+    }
+
+    const std::chrono::nanoseconds minimumMargin = std::chrono::microseconds(500);
+    adaptiveMargin = std::clamp(adaptiveMargin, minimumMargin, std::max(minimumMargin, vblankInterval / 2));
+}
+
 void RenderLoopPrivate::dispatch()
 {
     // On X11, we want to ignore repaints that are scheduled by windows right before
     // the Compositor starts repainting.
     pendingRepaint = true;
 
+    Q_EMIT q->aboutToRequestFrame(q);
     Q_EMIT q->frameRequested(q);
 
     // The Compositor may decide to not repaint when the frameRequested() signal is
@@ -194,7 +229,7 @@ void RenderLoop::beginFrame()
 {
     d->pendingRepaint = false;
     d->pendingFrameCount++;
-    d->renderJournal.beginFrame();
+    d->renderJournal.beginFrame(d->nextPresentationTimestamp);
 }
 
 void RenderLoop::endFrame()
@@ -202,6 +237,11 @@ void RenderLoop::endFrame()
     d->renderJournal.endFrame();
 }
 
+void RenderLoop::addGpuRenderTime(std::chrono::nanoseconds duration)
+{
+    d->renderJournal.addGpuRenderTime(duration);
+}
+
 int RenderLoop::refreshRate() const
 {
     return d->refreshRate;
@@ -238,6 +278,11 @@ std::chrono::nanoseconds RenderLoop::nextPresentationTimestamp() const
     return d->nextPresentationTimestamp;
 }
 
+const RenderJournal *RenderLoop::renderJournal() const
+{
+    return &d->renderJournal;
+}
+
 void RenderLoop::setFullscreenSurface(Item *surfaceItem)
 {
     d->fullscreenItem = surfaceItem;
@@ -14,6 +14,7 @@ namespace KWin
 {
 
 class RenderLoopPrivate;
+class RenderJournal;
 class Item;
 
 /**
@@ -58,6 +59,11 @@ public:
      */
     void endFrame();
 
+    /**
+     * Reports that the GPU took @a duration to execute the commands of a previous frame.
+     */
+    void addGpuRenderTime(std::chrono::nanoseconds duration);
+
     /**
      * Returns the refresh rate at which the output is being updated, in millihertz.
      */
@@ -86,6 +92,11 @@ public:
      */
     std::chrono::nanoseconds nextPresentationTimestamp() const;
 
+    /**
+     * Returns the journal with the render and presentation timings of recent frames.
+     */
+    const RenderJournal *renderJournal() const;
+
     /**
      * Sets the surface that currently gets scanned out,
      * so that this RenderLoop can adjust its timing behavior to that surface
@@ -120,6 +131,12 @@ Q_SIGNALS:
      */
     void framePresented(RenderLoop *loop, std::chrono::nanoseconds timestamp);
 
+    /**
+     * This signal is emitted right before frameRequested(). State that should make it
+     * into the next frame, e.g. batched input, can be flushed in response to it.
+     */
+    void aboutToRequestFrame(RenderLoop *loop);
+
     /**
      * This signal is emitted when the render loop wants a new frame to be composited.
      *
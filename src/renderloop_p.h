@@ -29,12 +29,15 @@ public:
 
     void notifyFrameFailed();
     void notifyFrameCompleted(std::chrono::nanoseconds timestamp);
+    void updateAdaptiveMargin(bool late, std::chrono::nanoseconds vblankInterval);
 
     RenderLoop *q;
     std::chrono::nanoseconds lastPresentationTimestamp = std::chrono::nanoseconds::zero();
     std::chrono::nanoseconds nextPresentationTimestamp = std::chrono::nanoseconds::zero();
     QTimer compositeTimer;
     RenderJournal renderJournal;
+    std::chrono::nanoseconds adaptiveMargin = std::chrono::milliseconds(3);
+    qreal missedFrameRate = 0;
     int refreshRate = 60000;
     int pendingFrameCount = 0;
     int inhibitCount = 0;
@@ -18,6 +18,8 @@
 #include <QDebug>
 #include <QDir>
 
+#include <algorithm>
+
 #ifndef KCMRULES
 #include "x11client.h"
 #include "client_machine.h"
@@ -127,6 +129,14 @@ void Rules::readFromSettings(const RuleSettings *settings)
     READ_MATCH_STRING(windowrole, .toLower().toLatin1());
     READ_MATCH_STRING(title,);
     READ_MATCH_STRING(clientmachine, .toLower().toLatin1());
+    if (wmclassmatch == RegExpMatch)
+        wmclassregexp = compileRegExp(QString::fromUtf8(wmclass));
+    if (windowrolematch == RegExpMatch)
+        windowroleregexp = compileRegExp(QString::fromUtf8(windowrole));
+    if (titlematch == RegExpMatch)
+        titleregexp = compileRegExp(title);
+    if (clientmachinematch == RegExpMatch)
+        clientmachineregexp = compileRegExp(QString::fromUtf8(clientmachine));
     types = NET::WindowTypeMask(settings->types());
     READ_FORCE_RULE(placement,);
     READ_SET_RULE(position);
@@ -304,6 +314,14 @@ bool Rules::isEmpty() const
            && desktopfilerule == UnusedSetRule);
 }
 
+QRegularExpression Rules::compileRegExp(const QString &pattern)
+{
+    // rules are matched whenever a window changes its caption, don't parse the pattern each time
+    QRegularExpression regExp(pattern);
+    regExp.optimize();
+    return regExp;
+}
+
 Rules::ForceRule Rules::convertForceRule(int v)
 {
     if (v == DontAffect || v == Force || v == ForceTemporarily)
@@ -335,10 +353,9 @@ bool Rules::matchType(NET::WindowType match_type) const
 bool Rules::matchWMClass(const QByteArray& match_class, const QByteArray& match_name) const
 {
     if (wmclassmatch != UnimportantMatch) {
-        // TODO optimize?
         QByteArray cwmclass = wmclasscomplete
                               ? match_name + ' ' + match_class : match_class;
-        if (wmclassmatch == RegExpMatch && !QRegularExpression(QString::fromUtf8(wmclass)).match(QString::fromUtf8(cwmclass)).hasMatch())
+        if (wmclassmatch == RegExpMatch && !wmclassregexp.match(QString::fromUtf8(cwmclass)).hasMatch())
             return false;
         if (wmclassmatch == ExactMatch && wmclass != cwmclass)
             return false;
@@ -351,7 +368,7 @@ bool Rules::matchWMClass(const QByteArray& match_class, const QByteArray& match_
 bool Rules::matchRole(const QByteArray& match_role) const
 {
     if (windowrolematch != UnimportantMatch) {
-        if (windowrolematch == RegExpMatch && !QRegularExpression(QString::fromUtf8(windowrole)).match(QString::fromUtf8(match_role)).hasMatch())
+        if (windowrolematch == RegExpMatch && !windowroleregexp.match(QString::fromUtf8(match_role)).hasMatch())
             return false;
         if (windowrolematch == ExactMatch && windowrole != match_role)
             return false;
@@ -364,7 +381,7 @@ bool Rules::matchRole(const QByteArray& match_role) const
 bool Rules::matchTitle(const QString& match_title) const
 {
     if (titlematch != UnimportantMatch) {
-        if (titlematch == RegExpMatch && !QRegularExpression(title).match(match_title).hasMatch())
+        if (titlematch == RegExpMatch && !titleregexp.match(match_title).hasMatch())
             return false;
         if (titlematch == ExactMatch && title != match_title)
             return false;
@@ -382,7 +399,7 @@ bool Rules::matchClientMachine(const QByteArray& match_machine, bool local) cons
                 && matchClientMachine("localhost", true))
             return true;
         if (clientmachinematch == RegExpMatch
-                && !QRegularExpression(QString::fromUtf8(clientmachine)).match(QString::fromUtf8(match_machine)).hasMatch())
+                && !clientmachineregexp.match(QString::fromUtf8(match_machine)).hasMatch())
             return false;
         if (clientmachinematch == ExactMatch
                 && clientmachine != match_machine)
@@ -969,29 +986,85 @@ void RuleBook::deleteAll()
 {
     qDeleteAll(m_rules);
     m_rules.clear();
+    invalidateIndex();
+}
+
+void RuleBook::invalidateIndex()
+{
+    m_indexValid = false;
+    m_classRules.clear();
+    m_completeClassRules.clear();
+    m_unindexedRules.clear();
+    m_candidates.clear();
+}
+
+void RuleBook::rebuildIndex()
+{
+    invalidateIndex();
+    for (int i = 0; i < m_rules.count(); ++i) {
+        const Rules *rule = m_rules[i];
+        if (rule->wmclassmatch != Rules::ExactMatch) {
+            m_unindexedRules.append(i);
+        } else if (rule->wmclasscomplete) {
+            m_completeClassRules[rule->wmclass].append(i);
+        } else {
+            m_classRules[rule->wmclass].append(i);
+        }
+    }
+    m_indexValid = true;
+}
+
+/**
+ * Returns the positions in m_rules of the rules whose window class matches @p c, in the
+ * order of their priority.
+ */
+QVector<int> RuleBook::candidates(const AbstractClient *c)
+{
+    if (!m_indexValid) {
+        rebuildIndex();
+    }
+
+    const QPair<QByteArray, QByteArray> key(c->resourceName(), c->resourceClass());
+    auto it = m_candidates.constFind(key);
+    if (it != m_candidates.constEnd()) {
+        return *it;
+    }
+
+    QVector<int> ret;
+    for (int i : qAsConst(m_unindexedRules)) {
+        if (m_rules[i]->matchWMClass(key.second, key.first)) {
+            ret.append(i);
+        }
+    }
+    ret += m_classRules.value(key.second);
+    ret += m_completeClassRules.value(key.first + ' ' + key.second);
+    std::sort(ret.begin(), ret.end());
+
+    m_candidates.insert(key, ret);
+    return ret;
 }
 
 WindowRules RuleBook::find(const AbstractClient* c, bool ignore_temporary)
 {
     QVector< Rules* > ret;
-    for (QList< Rules* >::Iterator it = m_rules.begin();
-            it != m_rules.end();
-       ) {
-        if (ignore_temporary && (*it)->isTemporary()) {
-            ++it;
+    QVector< Rules* > used_temporary;
+    const QVector<int> indexes = candidates(c);
+    for (int i : indexes) {
+        Rules* rule = m_rules[i];
+        if (ignore_temporary && rule->isTemporary()) {
             continue;
         }
-        if ((*it)->match(c)) {
-            Rules* rule = *it;
+        if (rule->match(c)) {
             qCDebug(KWIN_CORE) << "Rule found:" << rule << ":" << c;
             if (rule->isTemporary())
-                it = m_rules.erase(it);
-            else
-                ++it;
+                used_temporary.append(rule);
             ret.append(rule);
-            continue;
         }
-        ++it;
+    }
+    if (!used_temporary.isEmpty()) {
+        for (Rules* rule : qAsConst(used_temporary))
+            m_rules.removeOne(rule);
+        invalidateIndex();
     }
     return WindowRules(ret);
 }
@@ -1029,6 +1102,7 @@ void RuleBook::load()
     RuleBookSettings book(m_config);
     book.load();
     m_rules = book.rules().toList();
+    invalidateIndex();
 }
 
 void RuleBook::save()
@@ -1059,6 +1133,7 @@ void RuleBook::temporaryRulesMessage(const QString& message)
             was_temporary = true;
     Rules* rule = new Rules(message, true);
     m_rules.prepend(rule);   // highest priority first
+    invalidateIndex();
     if (!was_temporary)
         QTimer::singleShot(60000, this, &RuleBook::cleanupTemporaryRules);
 }
@@ -1071,6 +1146,7 @@ void RuleBook::cleanupTemporaryRules()
        ) {
         if ((*it)->discardTemporary(false)) { // deletes (*it)
             it = m_rules.erase(it);
+            invalidateIndex();
         } else {
             if ((*it)->isTemporary())
                 has_temporary = true;
@@ -1096,6 +1172,7 @@ void RuleBook::discardUsed(AbstractClient* c, bool withdrawn)
                 Rules* r = *it;
                 it = m_rules.erase(it);
                 delete r;
+                invalidateIndex();
                 continue;
             }
         }
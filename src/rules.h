@@ -12,7 +12,9 @@
 
 
 #include <netwm_def.h>
+#include <QHash>
 #include <QRect>
+#include <QRegularExpression>
 #include <QVector>
 
 #include "placement.h"
@@ -186,6 +188,7 @@ private:
 private:
 #endif
     void readFromSettings(const RuleSettings *settings);
+    static QRegularExpression compileRegExp(const QString &pattern);
     static ForceRule convertForceRule(int v);
     static QString getDecoColor(const QString &themeName);
 #ifndef KCMRULES
@@ -205,6 +208,11 @@ private:
     StringMatch titlematch;
     QByteArray clientmachine;
     StringMatch clientmachinematch;
+    // compiled patterns of the RegExpMatch strings above
+    QRegularExpression wmclassregexp;
+    QRegularExpression windowroleregexp;
+    QRegularExpression titleregexp;
+    QRegularExpression clientmachineregexp;
     NET::WindowTypes types; // types for matching
     Placement::Policy placement;
     ForceRule placementrule;
@@ -279,6 +287,7 @@ private:
     QString desktopfile;
     SetRule desktopfilerule;
     friend QDebug& operator<<(QDebug& stream, const Rules*);
+    friend class RuleBook;
 };
 
 #ifndef KCMRULES
@@ -308,9 +317,21 @@ private:
     void deleteAll();
     void initializeX11();
     void cleanupX11();
+    void invalidateIndex();
+    void rebuildIndex();
+    QVector<int> candidates(const AbstractClient *c);
     QTimer *m_updateTimer;
     bool m_updatesDisabled;
     QList<Rules*> m_rules;
+    // Positions in m_rules of the rules that match a window class exactly, keyed by the
+    // window class or by the resource name and window class if the whole class must match
+    QHash<QByteArray, QVector<int>> m_classRules;
+    QHash<QByteArray, QVector<int>> m_completeClassRules;
+    // Positions of all the other rules, which have to be matched one by one
+    QVector<int> m_unindexedRules;
+    // Positions of the rules whose window class matches, keyed by resource name and class
+    QHash<QPair<QByteArray, QByteArray>, QVector<int>> m_candidates;
+    bool m_indexValid = false;
     QScopedPointer<KXMessages> m_temporaryRulesMessages;
     KSharedConfig::Ptr m_config;
 
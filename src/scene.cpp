@@ -286,6 +286,7 @@ void Scene::paintScreen(const QRegion &damage, const QRegion &repaint,
     }
 
     effects->postPaintScreen();
+    effectsImpl->endPaint();
 
     // make sure not to go outside of the screen area
     *updateRegion = damaged_region;
@@ -359,14 +360,19 @@ void Scene::paintGenericScreen(int orig_mask, const ScreenPaintData &)
     }
 }
 
-static void accumulateRepaints(Item *item, AbstractOutput *output, QRegion *repaints)
+static void accumulateRepaints(const Scene *scene, Item *item, AbstractOutput *output, QRegion *repaints)
 {
-    *repaints += item->repaints(output);
+    if (scene->isOnHardwarePlane(item)) {
+        // Only the parts that the item doesn't cover anymore have to be composited
+        *repaints += item->repaints(output) - item->mapToGlobal(item->rect());
+    } else {
+        *repaints += item->repaints(output);
+    }
     item->resetRepaints(output);
 
     const auto childItems = item->childItems();
     for (Item *childItem : childItems) {
-        accumulateRepaints(childItem, output, repaints);
+        accumulateRepaints(scene, childItem, output, repaints);
     }
 }
 
@@ -391,7 +397,7 @@ void Scene::paintSimpleScreen(int orig_mask, const QRegion &region)
         data.mask = orig_mask | (window->isOpaque() ? PAINT_WINDOW_OPAQUE : PAINT_WINDOW_TRANSLUCENT);
         window->resetPaintingEnabled();
         data.paint = region;
-        accumulateRepaints(window->windowItem(), painted_screen, &data.paint);
+        accumulateRepaints(this, window->windowItem(), painted_screen, &data.paint);
 
         // Clip out the decoration for opaque windows; the decoration is drawn in the second pass
         opaqueFullscreen = false; // TODO: do we care about unmanged windows here (maybe input windows?)
@@ -447,10 +453,14 @@ void Scene::paintSimpleScreen(int orig_mask, const QRegion &region)
         fullRepaint = (dirtyArea == displayRegion);
     }
 
-    QRegion allclips, upperTranslucentDamage;
+    QRegion upperTranslucentDamage;
     upperTranslucentDamage = repaint_region;
+    m_occlusionMap.reset(geometry());
 
-    // This is the occlusion culling pass
+    // This is the occlusion culling pass. The opaque regions are tracked in a tile
+    // map rather than in a QRegion, which only culls what is covered by whole tiles
+    // but keeps the cost linear in the number of windows. Anything that should have
+    // been culled but wasn't gets painted over by the windows above it.
     for (int i = phase2data.count() - 1; i >= 0; --i) {
         Phase2Data *data = &phase2data[i];
 
@@ -462,13 +472,17 @@ void Scene::paintSimpleScreen(int orig_mask, const QRegion &region)
 
         // subtract the parts which will possibly been drawn as part of
         // a higher opaque window
-        data->region -= allclips;
+        if (m_occlusionMap.isOccluded(data->region.boundingRect())) {
+            data->region = QRegion();
+        } else {
+            data->region = m_occlusionMap.subtracted(data->region);
+        }
 
         // Here we rely on WindowPrePaintData::setTranslucent() to remove
         // the clip if needed.
         if (!data->clip.isEmpty() && !(data->mask & PAINT_WINDOW_TRANSLUCENT)) {
             // clip away the opaque regions for all windows below this one
-            allclips |= data->clip;
+            m_occlusionMap.add(data->clip);
             // extend the translucent damage for windows below this by remaining (translucent) regions
             if (!fullRepaint) {
                 upperTranslucentDamage |= data->region - data->clip;
@@ -488,7 +502,7 @@ void Scene::paintSimpleScreen(int orig_mask, const QRegion &region)
         }
     }
     if (!(orig_mask & PAINT_SCREEN_BACKGROUND_FIRST)) {
-        paintedArea = dirtyArea - allclips;
+        paintedArea = m_occlusionMap.subtracted(dirtyArea);
         paintBackground(paintedArea);
     }
 
@@ -642,6 +656,17 @@ QVector<QByteArray> Scene::openGLPlatformInterfaceExtensions() const
     return QVector<QByteArray>{};
 }
 
+QString Scene::supportInformation() const
+{
+    return QString();
+}
+
+bool Scene::isOnHardwarePlane(const Item *item) const
+{
+    Q_UNUSED(item)
+    return false;
+}
+
 SurfaceTexture *Scene::createSurfaceTextureInternal(SurfacePixmapInternal *pixmap)
 {
     Q_UNUSED(pixmap)
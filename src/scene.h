@@ -11,6 +11,7 @@
 #define KWIN_SCENE_H
 
 #include "toplevel.h"
+#include "occlusionmap.h"
 #include "utils/common.h"
 #include "kwineffects.h"
 
@@ -178,6 +179,19 @@ public:
      */
     virtual QVector<QByteArray> openGLPlatformInterfaceExtensions() const;
 
+    /**
+     * Renderer specific information for the support information, e.g. statistics about
+     * the last rendered frame.
+     *
+     * Default implementation returns an empty string
+     */
+    virtual QString supportInformation() const;
+    /**
+     * Returns @c true if @a item is shown on a hardware plane of the output that is being
+     * painted. Such items are not composited, and neither are their repaints.
+     */
+    virtual bool isOnHardwarePlane(const Item *item) const;
+
     virtual QSharedPointer<GLTexture> textureForOutput(AbstractOutput *output) const {
         Q_UNUSED(output);
         return {};
@@ -269,6 +283,8 @@ private:
     // how many times finalPaintScreen() has been called
     int m_paintScreenCount = 0;
     QRect m_lastCursorGeometry;
+    // opaque areas of the windows above the one being culled in paintSimpleScreen()
+    OcclusionMap m_occlusionMap;
 };
 
 // The base class for windows representations in composite backends
@@ -0,0 +1,320 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2026 KWin contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "decorationatlas.h"
+
+#include <kwingltexture.h>
+#include <kwinglutils.h>
+
+#include <QMap>
+#include <QScopedPointer>
+#include <QThread>
+
+#include <algorithm>
+#include <iterator>
+
+namespace KWin
+{
+
+// The size of a shared texture. Decorations that don't fit get a texture of their own.
+static const QSize s_pageSize(2048, 1024);
+
+// A shelf also takes parts that are up to this many pixels shorter than the shelf.
+static const int s_shelfSlack = 4;
+
+// Rasterising a decoration is mostly CPU bound, a few threads are enough to keep up with
+// a burst of new windows without competing with the clients for all cores.
+static const int s_maxThreadCount = 4;
+
+struct OpenGLDecorationAtlas::Page
+{
+    struct Shelf
+    {
+        int y;
+        int height;
+        QMap<int, int> freeRanges;
+    };
+
+    QScopedPointer<GLTexture> texture;
+    QVector<Shelf> shelves;
+    int usedHeight = 0;
+    int entryCount = 0;
+};
+
+static int takeRange(QMap<int, int> &ranges, int count)
+{
+    for (auto it = ranges.begin(); it != ranges.end(); ++it) {
+        if (it.value() < count) {
+            continue;
+        }
+        const int first = it.key();
+        const int remaining = it.value() - count;
+        ranges.erase(it);
+        if (remaining) {
+            ranges.insert(first + count, remaining);
+        }
+        return first;
+    }
+    return -1;
+}
+
+static void giveBackRange(QMap<int, int> &ranges, int first, int count)
+{
+    auto next = ranges.lowerBound(first);
+    if (next != ranges.end() && first + count == next.key()) {
+        count += next.value();
+        next = ranges.erase(next);
+    }
+    if (next != ranges.begin()) {
+        auto previous = std::prev(next);
+        if (previous.key() + previous.value() == first) {
+            previous.value() += count;
+            return;
+        }
+    }
+    ranges.insert(first, count);
+}
+
+static QRect allocateRect(OpenGLDecorationAtlas::Page *page, const QSize &size)
+{
+    const int pageWidth = page->texture->width();
+    const int pageHeight = page->texture->height();
+    if (size.width() > pageWidth) {
+        return QRect();
+    }
+
+    for (auto &shelf : page->shelves) {
+        if (shelf.height < size.height() || shelf.height > size.height() + s_shelfSlack) {
+            continue;
+        }
+        const int x = takeRange(shelf.freeRanges, size.width());
+        if (x != -1) {
+            return QRect(QPoint(x, shelf.y), size);
+        }
+    }
+
+    if (page->usedHeight + size.height() > pageHeight) {
+        return QRect();
+    }
+    OpenGLDecorationAtlas::Page::Shelf shelf;
+    shelf.y = page->usedHeight;
+    shelf.height = size.height();
+    if (size.width() < pageWidth) {
+        shelf.freeRanges.insert(size.width(), pageWidth - size.width());
+    }
+    page->shelves.append(shelf);
+    page->usedHeight += size.height();
+    return QRect(QPoint(0, shelf.y), size);
+}
+
+static void releaseRect(OpenGLDecorationAtlas::Page *page, const QRect &rect)
+{
+    for (auto &shelf : page->shelves) {
+        if (shelf.y == rect.y()) {
+            giveBackRange(shelf.freeRanges, rect.x(), rect.width());
+            break;
+        }
+    }
+
+    // Drop empty shelves at the bottom so the space can be used for parts of any height.
+    const int pageWidth = page->texture->width();
+    while (!page->shelves.isEmpty()) {
+        const auto &shelf = page->shelves.constLast();
+        if (shelf.freeRanges.count() != 1 || shelf.freeRanges.firstKey() != 0 || shelf.freeRanges.first() != pageWidth) {
+            break;
+        }
+        page->usedHeight = shelf.y;
+        page->shelves.removeLast();
+    }
+}
+
+OpenGLDecorationAtlas::OpenGLDecorationAtlas()
+{
+    m_threadPool.setMaxThreadCount(qBound(1, QThread::idealThreadCount() - 1, s_maxThreadCount));
+}
+
+OpenGLDecorationAtlas::~OpenGLDecorationAtlas()
+{
+    m_threadPool.waitForDone();
+    qDeleteAll(m_entries);
+    qDeleteAll(m_pages);
+}
+
+uint OpenGLDecorationAtlas::hash(const QImage &image)
+{
+    return qHashBits(image.constBits(), image.sizeInBytes(), uint(image.width()) * 31 + uint(image.height()));
+}
+
+QThreadPool *OpenGLDecorationAtlas::threadPool()
+{
+    return &m_threadPool;
+}
+
+QVector<OpenGLDecorationAtlas::Entry *> OpenGLDecorationAtlas::acquire(const QVector<QImage> &images, const QVector<uint> &hashes)
+{
+    Q_ASSERT(images.count() == hashes.count());
+    const bool empty = std::all_of(images.constBegin(), images.constEnd(), [](const QImage &image) {
+        return image.isNull();
+    });
+    if (empty) {
+        return QVector<Entry *>(images.count(), nullptr);
+    }
+
+    for (Page *page : qAsConst(m_pages)) {
+        const QVector<Entry *> entries = place(page, images, hashes);
+        if (!entries.isEmpty()) {
+            return entries;
+        }
+    }
+
+    Page *page = createPage(images);
+    if (!page) {
+        return {};
+    }
+    const QVector<Entry *> entries = place(page, images, hashes);
+    if (entries.isEmpty()) {
+        destroyPage(page);
+    }
+    return entries;
+}
+
+void OpenGLDecorationAtlas::release(Entry *entry)
+{
+    Q_ASSERT(entry->refCount > 0);
+    if (--entry->refCount) {
+        return;
+    }
+
+    m_entries.remove(entry->hash, entry);
+    Page *page = entry->page;
+    releaseRect(page, entry->rect);
+    delete entry;
+
+    if (!--page->entryCount) {
+        destroyPage(page);
+    }
+}
+
+OpenGLDecorationAtlas::Entry *OpenGLDecorationAtlas::find(Page *page, const QImage &image, uint hash) const
+{
+    for (auto it = m_entries.constFind(hash); it != m_entries.constEnd() && it.key() == hash; ++it) {
+        Entry *entry = it.value();
+        if (entry->page == page && entry->image == image) {
+            return entry;
+        }
+    }
+    return nullptr;
+}
+
+QVector<OpenGLDecorationAtlas::Entry *> OpenGLDecorationAtlas::place(Page *page, const QVector<QImage> &images, const QVector<uint> &hashes)
+{
+    QVector<Entry *> entries(images.count(), nullptr);
+    QVector<Entry *> created;
+
+    for (int i = 0; i < images.count(); ++i) {
+        const QImage &image = images[i];
+        if (image.isNull()) {
+            continue;
+        }
+
+        Entry *entry = find(page, image, hashes[i]);
+        if (!entry) {
+            auto it = std::find_if(created.constBegin(), created.constEnd(), [&](const Entry *candidate) {
+                return candidate->hash == hashes[i] && candidate->image == image;
+            });
+            if (it != created.constEnd()) {
+                entry = *it;
+            }
+        }
+        if (!entry) {
+            const QRect rect = allocateRect(page, image.size());
+            if (rect.isNull()) {
+                for (Entry *candidate : qAsConst(created)) {
+                    releaseRect(page, candidate->rect);
+                    delete candidate;
+                }
+                return {};
+            }
+            entry = new Entry;
+            entry->page = page;
+            entry->texture = page->texture.data();
+            entry->rect = rect;
+            entry->image = image;
+            entry->hash = hashes[i];
+            created.append(entry);
+        }
+        entries[i] = entry;
+    }
+
+    for (Entry *entry : qAsConst(created)) {
+        page->texture->update(entry->image, entry->rect.topLeft());
+        m_entries.insert(entry->hash, entry);
+        page->entryCount++;
+    }
+    for (Entry *entry : qAsConst(entries)) {
+        if (entry) {
+            entry->refCount++;
+        }
+    }
+    return entries;
+}
+
+OpenGLDecorationAtlas::Page *OpenGLDecorationAtlas::createPage(const QVector<QImage> &images)
+{
+    // In the worst case every part ends up on a shelf of its own.
+    QSize size;
+    for (const QImage &image : images) {
+        size.rwidth() = std::max(size.width(), image.width());
+        size.rheight() += image.height();
+    }
+
+    GLint maxTextureSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+    const QSize pageSize = s_pageSize.boundedTo(QSize(maxTextureSize, maxTextureSize));
+    if (size.width() <= pageSize.width() && size.height() <= pageSize.height()) {
+        size = pageSize;
+    } else if (size.width() > maxTextureSize || size.height() > maxTextureSize) {
+        return nullptr;
+    }
+
+    Page *page = new Page;
+    page->texture.reset(new GLTexture(GL_RGBA8, size));
+    page->texture->setYInverted(true);
+    page->texture->setWrapMode(GL_CLAMP_TO_EDGE);
+    page->texture->clear();
+    m_pages.append(page);
+    return page;
+}
+
+void OpenGLDecorationAtlas::destroyPage(Page *page)
+{
+    m_pages.removeOne(page);
+    delete page;
+}
+
+int OpenGLDecorationAtlas::textureCount() const
+{
+    return m_pages.count();
+}
+
+int OpenGLDecorationAtlas::entryCount() const
+{
+    return m_entries.count();
+}
+
+qint64 OpenGLDecorationAtlas::memoryUsage() const
+{
+    qint64 usage = 0;
+    for (const Page *page : m_pages) {
+        usage += qint64(page->texture->width()) * page->texture->height() * 4;
+    }
+    return usage;
+}
+
+} // namespace KWin
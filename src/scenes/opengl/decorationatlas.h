@@ -0,0 +1,83 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2026 KWin contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QImage>
+#include <QMultiHash>
+#include <QRect>
+#include <QThreadPool>
+#include <QVector>
+
+namespace KWin
+{
+
+class GLTexture;
+
+/**
+ * The OpenGLDecorationAtlas class keeps the rasterised decoration parts of all windows in a
+ * few shared textures.
+ *
+ * Parts are looked up by their contents, so identical parts, e.g. the borders of inactive
+ * windows of the same size, are stored and uploaded only once. All parts of a decoration are
+ * placed in the same texture, so a decoration can still be drawn with a single texture.
+ *
+ * The atlas also owns the thread pool in which the decoration parts are rasterised.
+ */
+class OpenGLDecorationAtlas
+{
+public:
+    struct Page;
+
+    struct Entry
+    {
+        Page *page = nullptr;
+        GLTexture *texture = nullptr;
+        QRect rect;
+        QImage image;
+        uint hash = 0;
+        int refCount = 0;
+    };
+
+    OpenGLDecorationAtlas();
+    ~OpenGLDecorationAtlas();
+
+    /**
+     * Places the @a images with the given content @a hashes in one texture and uploads the
+     * ones that are not in that texture yet. The returned list has an entry for every image,
+     * or @c nullptr for null images. Returns an empty list if the images don't fit in a texture.
+     *
+     * Every returned entry has to be given back with release().
+     */
+    QVector<Entry *> acquire(const QVector<QImage> &images, const QVector<uint> &hashes);
+    void release(Entry *entry);
+
+    /**
+     * Returns the content hash of @a image. This can be called from any thread.
+     */
+    static uint hash(const QImage &image);
+
+    QThreadPool *threadPool();
+
+    int textureCount() const;
+    int entryCount() const;
+    qint64 memoryUsage() const;
+
+private:
+    QVector<Entry *> place(Page *page, const QVector<QImage> &images, const QVector<uint> &hashes);
+    Entry *find(Page *page, const QImage &image, uint hash) const;
+    Page *createPage(const QVector<QImage> &images);
+    void destroyPage(Page *page);
+
+    QVector<Page *> m_pages;
+    QMultiHash<uint, Entry *> m_entries;
+    QThreadPool m_threadPool;
+};
+
+} // namespace KWin
@@ -0,0 +1,516 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2026 KWin contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "framebatch.h"
+#include "item.h"
+
+#include <algorithm>
+#include <cstddef>
+
+namespace KWin
+{
+
+// How many groups are searched for one with the same state, and how many runs of a group
+// for one with the same texture. Going further back rarely finds a match because the windows
+// below tend to overlap the new node anyway.
+static const int s_maxGroupLookback = 32;
+
+// The batch is clipped with one scissor rect after the other, each drawing all groups. Paint
+// regions with more rects than this are clipped on the CPU instead.
+static const int s_maxScissorRects = 8;
+
+static bool translationFromMatrix(const QMatrix4x4 &matrix, QPoint *translation)
+{
+    const QPointF offset = matrix.map(QPointF(0, 0));
+    QMatrix4x4 expected;
+    expected.translate(offset.x(), offset.y());
+    if (!qFuzzyCompare(matrix, expected)) {
+        return false;
+    }
+    // The cached vertices use integer positions.
+    *translation = offset.toPoint();
+    return QPointF(*translation) == offset;
+}
+
+static QRectF quadsBoundingRect(const WindowQuadList &quads)
+{
+    if (quads.isEmpty()) {
+        return QRectF();
+    }
+    double left = quads.first().left();
+    double top = quads.first().top();
+    double right = quads.first().right();
+    double bottom = quads.first().bottom();
+    for (const WindowQuad &quad : quads) {
+        left = std::min(left, quad.left());
+        top = std::min(top, quad.top());
+        right = std::max(right, quad.right());
+        bottom = std::max(bottom, quad.bottom());
+    }
+    return QRectF(QPointF(left, top), QPointF(right, bottom));
+}
+
+static WindowQuadList translateQuads(const WindowQuadList &quads, const QPoint &translation)
+{
+    WindowQuadList translated;
+    translated.reserve(quads.count());
+    for (WindowQuad quad : quads) {
+        for (int i = 0; i < 4; ++i) {
+            quad[i].move(quad[i].x() + translation.x(), quad[i].y() + translation.y());
+        }
+        translated.append(quad);
+    }
+    return translated;
+}
+
+static WindowQuadList clipQuads(const WindowQuadList &quads, const QRegion &clip)
+{
+    WindowQuadList ret;
+    ret.reserve(quads.count());
+
+    // split all quads in bounding rect with the actual rects in the region
+    for (const WindowQuad &quad : quads) {
+        const QRectF quadRect(QPointF(quad.left(), quad.top()), QPointF(quad.right(), quad.bottom()));
+        for (const QRect &r : clip) {
+            const QRectF intersected = QRectF(r).intersected(quadRect);
+            if (intersected.isValid()) {
+                if (quadRect == intersected) {
+                    ret << quad;
+                    break;
+                }
+                ret << quad.makeSubQuad(intersected.left(), intersected.top(), intersected.right(), intersected.bottom());
+            }
+        }
+    }
+    return ret;
+}
+
+static void setScissor(const QRect &rect)
+{
+    const QRect screen = GLRenderTarget::virtualScreenGeometry();
+    const qreal scale = GLRenderTarget::virtualScreenScale();
+    glScissor((rect.x() - screen.x()) * scale,
+              (screen.height() + screen.y() - rect.y() - rect.height()) * scale,
+              rect.width() * scale,
+              rect.height() * scale);
+}
+
+static QMatrix4x4 textureMatrixFromKey(const OpenGLVertexCache::Key &key)
+{
+    QMatrix4x4 matrix;
+    matrix(0, 0) = key.textureScale.x();
+    matrix(1, 1) = key.textureScale.y();
+    matrix(0, 3) = key.textureOffset.x();
+    matrix(1, 3) = key.textureOffset.y();
+    return matrix;
+}
+
+OpenGLFrameBatch::OpenGLFrameBatch()
+    : m_vertexCache(new OpenGLVertexCache)
+{
+}
+
+OpenGLFrameBatch::~OpenGLFrameBatch()
+{
+}
+
+void OpenGLFrameBatch::begin()
+{
+    Q_ASSERT(m_groups.isEmpty());
+    m_recording = true;
+    m_clip = QRegion();
+    m_windowCount = 0;
+    m_uploadedItemCount = 0;
+}
+
+bool OpenGLFrameBatch::isRecording() const
+{
+    return m_recording;
+}
+
+int OpenGLFrameBatch::windowCount() const
+{
+    return m_windowCount;
+}
+
+int OpenGLFrameBatch::uploadedItemCount() const
+{
+    return m_uploadedItemCount;
+}
+
+const OpenGLVertexCache *OpenGLFrameBatch::vertexCache() const
+{
+    return m_vertexCache.data();
+}
+
+bool OpenGLFrameBatch::addWindow(const QVector<OpenGLWindow::RenderNode> &nodes, const QRegion &clip)
+{
+    Q_ASSERT(m_recording);
+
+    struct PendingNode
+    {
+        Node node;
+        GLTexture *texture;
+        qreal opacity;
+        bool blend;
+    };
+
+    QVector<PendingNode> pendingNodes;
+    pendingNodes.reserve(nodes.count());
+
+    for (const OpenGLWindow::RenderNode &renderNode : nodes) {
+        if (!renderNode.texture || !renderNode.item) {
+            continue;
+        }
+
+        // The nodes share one model-view-projection matrix, so the translation is part
+        // of the vertices instead.
+        QPoint translation;
+        if (!translationFromMatrix(renderNode.transformMatrix, &translation)) {
+            return false;
+        }
+
+        const QMatrix4x4 textureMatrix = renderNode.texture->matrix(renderNode.coordinateType);
+        Node node{
+            .item = renderNode.item,
+            .key = OpenGLVertexCache::Key{
+                .generation = renderNode.item->quadsGeneration(),
+                .translation = translation,
+                .textureScale = QVector2D(textureMatrix(0, 0), textureMatrix(1, 1)),
+                .textureOffset = QVector2D(textureMatrix(0, 3), textureMatrix(1, 3)),
+            },
+        };
+
+        if (const OpenGLVertexCache::Entry *entry = m_vertexCache->lookup(node.item, node.key)) {
+            node.first = entry->first;
+            node.vertexCount = entry->vertexCount;
+            node.bounds = entry->bounds;
+            node.cached = true;
+        } else {
+            node.quads = translateQuads(renderNode.item->quads(), translation);
+            if (!OpenGLVertexCache::canStore(node.quads)) {
+                return false;
+            }
+            node.vertexCount = node.quads.count() * 4;
+            node.bounds = quadsBoundingRect(node.quads);
+        }
+
+        pendingNodes.append(PendingNode{
+            .node = node,
+            .texture = renderNode.texture,
+            .opacity = renderNode.opacity,
+            .blend = renderNode.hasAlpha || renderNode.opacity < 1.0,
+        });
+    }
+
+    for (const PendingNode &pending : qAsConst(pendingNodes)) {
+        Group *group = nullptr;
+        const int lastGroup = std::max(0, m_groups.count() - s_maxGroupLookback);
+        for (int j = m_groups.count() - 1; j >= lastGroup; --j) {
+            Group &candidate = m_groups[j];
+            if (candidate.opacity == pending.opacity && candidate.blend == pending.blend) {
+                group = &candidate;
+                break;
+            }
+            if (candidate.bounds.intersects(pending.node.bounds)) {
+                break;
+            }
+        }
+        if (!group) {
+            m_groups.append(Group{
+                .opacity = pending.opacity,
+                .blend = pending.blend,
+            });
+            group = &m_groups.last();
+        }
+
+        // The same applies to the runs of the group, a node may join an earlier run with
+        // the same texture only if none of the later runs overlaps it.
+        Run *run = nullptr;
+        const int lastRun = std::max(0, group->runs.count() - s_maxGroupLookback);
+        for (int j = group->runs.count() - 1; j >= lastRun; --j) {
+            Run &candidate = group->runs[j];
+            if (candidate.texture == pending.texture) {
+                run = &candidate;
+                break;
+            }
+            if (candidate.bounds.intersects(pending.node.bounds)) {
+                break;
+            }
+        }
+        if (!run) {
+            group->runs.append(Run{
+                .texture = pending.texture,
+            });
+            run = &group->runs.last();
+        }
+
+        run->bounds |= pending.node.bounds;
+        run->nodes.append(pending.node);
+        group->bounds |= pending.node.bounds;
+    }
+
+    // The vertices are not clipped to the paint region of the window, but to the paint
+    // region of the whole batch. The parts of a window that are in the latter but not the
+    // former are covered by opaque windows stacked above it, which are drawn later.
+    if (clip == infiniteRegion() || m_clip == infiniteRegion()) {
+        m_clip = infiniteRegion();
+    } else {
+        m_clip |= clip;
+    }
+
+    ++m_windowCount;
+    return true;
+}
+
+int OpenGLFrameBatch::end(const QMatrix4x4 &projectionMatrix)
+{
+    const int drawCalls = flush(projectionMatrix);
+    m_recording = false;
+    return drawCalls;
+}
+
+int OpenGLFrameBatch::flush(const QMatrix4x4 &projectionMatrix)
+{
+    if (m_groups.isEmpty()) {
+        return 0;
+    }
+
+    int drawCalls;
+    if (m_clip != infiniteRegion() && m_clip.rectCount() > s_maxScissorRects) {
+        drawCalls = drawStreamed(projectionMatrix, false);
+    } else if (uploadVertices()) {
+        drawCalls = drawCached(projectionMatrix);
+    } else {
+        drawCalls = drawStreamed(projectionMatrix, true);
+    }
+
+    m_groups.clear();
+    m_clip = QRegion();
+    return drawCalls;
+}
+
+/**
+ * Uploads the vertices of the nodes that are not in the cache yet. If the cache is full, it
+ * is started from scratch with all nodes of the batch. Returns @c false if the nodes don't
+ * fit into the cache at all.
+ */
+bool OpenGLFrameBatch::uploadVertices()
+{
+    int vertexCount = 0;
+    bool full = false;
+    forEachNode([&](Node &node) {
+        vertexCount += node.vertexCount;
+        if (node.cached || full) {
+            return;
+        }
+        if (const OpenGLVertexCache::Entry *entry = m_vertexCache->store(node.item, node.key, node.quads, node.bounds)) {
+            node.first = entry->first;
+            node.cached = true;
+            ++m_uploadedItemCount;
+        } else {
+            full = true;
+        }
+    });
+    if (!full) {
+        return true;
+    }
+
+    // Leave room for the items that change their vertices in the next frames.
+    if (!m_vertexCache->reset(vertexCount * 2) && !m_vertexCache->reset(vertexCount)) {
+        return false;
+    }
+    bool stored = true;
+    forEachNode([&](Node &node) {
+        if (!stored) {
+            return;
+        }
+        if (node.quads.isEmpty() && node.vertexCount) {
+            node.quads = translateQuads(node.item->quads(), node.key.translation);
+        }
+        const OpenGLVertexCache::Entry *entry = m_vertexCache->store(node.item, node.key, node.quads, node.bounds);
+        if (!entry) {
+            stored = false;
+            return;
+        }
+        node.first = entry->first;
+        node.cached = true;
+        ++m_uploadedItemCount;
+    });
+    return stored;
+}
+
+int OpenGLFrameBatch::drawCached(const QMatrix4x4 &projectionMatrix)
+{
+    QVector<QPair<int, int>> ranges;
+    int indexCount = 0;
+    bool translucent = false;
+    for (Group &group : m_groups) {
+        for (Run &run : group.runs) {
+            run.firstIndex = indexCount;
+            for (const Node &node : qAsConst(run.nodes)) {
+                if (node.vertexCount) {
+                    ranges.append(qMakePair(node.first, node.vertexCount));
+                    indexCount += node.vertexCount / 4 * 6;
+                }
+            }
+            run.indexCount = indexCount - run.firstIndex;
+        }
+        translucent |= group.opacity != 1.0;
+    }
+
+    m_vertexCache->bindArrays();
+    m_vertexCache->uploadIndices(ranges);
+
+    const int drawCalls = drawGroups(projectionMatrix, translucent, m_clip, [this](const Run &run) {
+        m_vertexCache->drawIndices(run.firstIndex, run.indexCount);
+    });
+
+    m_vertexCache->unbindArrays();
+    return drawCalls;
+}
+
+/**
+ * Sets up the state of every group and calls @a draw for each of its runs with the texture
+ * of the run bound. If @a clip is not infinite,
+ * the groups are drawn once per rect of @a clip, with the rect as scissor. Returns the number
+ * of issued draw calls.
+ */
+int OpenGLFrameBatch::drawGroups(const QMatrix4x4 &projectionMatrix, bool translucent, const QRegion &clip,
+                                 const std::function<void(const Run &)> &draw)
+{
+    ShaderTraits traits = ShaderTrait::MapTexture;
+    if (translucent) {
+        traits |= ShaderTrait::Modulate;
+    }
+    GLShader *shader = ShaderManager::instance()->pushShader(traits);
+    shader->setUniform(GLShader::ModelViewProjectionMatrix, projectionMatrix);
+
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+    const bool scissor = clip != infiniteRegion();
+    if (scissor) {
+        glEnable(GL_SCISSOR_TEST);
+    }
+
+    bool blendEnabled = false;
+    qreal opacity = -1.0;
+    GLTexture *texture = nullptr;
+    int drawCalls = 0;
+    const int passCount = scissor ? clip.rectCount() : 1;
+    for (int pass = 0; pass < passCount; ++pass) {
+        if (scissor) {
+            setScissor(*(clip.begin() + pass));
+        }
+        for (const Group &group : qAsConst(m_groups)) {
+            if (group.blend != blendEnabled) {
+                if (group.blend) {
+                    glEnable(GL_BLEND);
+                } else {
+                    glDisable(GL_BLEND);
+                }
+                blendEnabled = group.blend;
+            }
+            if (translucent && opacity != group.opacity) {
+                shader->setUniform(GLShader::ModulationConstant,
+                                   QVector4D(group.opacity, group.opacity, group.opacity, group.opacity));
+                opacity = group.opacity;
+            }
+            for (const Run &run : group.runs) {
+                if (!run.indexCount) {
+                    continue;
+                }
+                if (run.texture != texture) {
+                    run.texture->setFilter(GL_LINEAR);
+                    run.texture->setWrapMode(GL_CLAMP_TO_EDGE);
+                    run.texture->bind();
+                    texture = run.texture;
+                }
+
+                draw(run);
+                ++drawCalls;
+            }
+        }
+    }
+
+    if (scissor) {
+        glDisable(GL_SCISSOR_TEST);
+    }
+    if (blendEnabled) {
+        glDisable(GL_BLEND);
+    }
+    ShaderManager::instance()->popShader();
+
+    return drawCalls;
+}
+
+/**
+ * Draws the nodes from the streaming buffer, used if they don't fit into the vertex cache or
+ * the batch is clipped to too many rects to scissor them. Unless @a scissor is @c true, the
+ * quads are clipped on the CPU.
+ */
+int OpenGLFrameBatch::drawStreamed(const QMatrix4x4 &projectionMatrix, bool scissor)
+{
+    const bool clip = !scissor && m_clip != infiniteRegion();
+    int quadCount = 0;
+    forEachNode([&](Node &node) {
+        if (node.quads.isEmpty() && node.vertexCount) {
+            node.quads = translateQuads(node.item->quads(), node.key.translation);
+        }
+        if (clip) {
+            node.quads = clipQuads(node.quads, m_clip);
+        }
+        quadCount += node.quads.count();
+    });
+    if (!quadCount) {
+        return 0;
+    }
+
+    const bool indexedQuads = GLVertexBuffer::supportsIndexedQuads();
+    const GLenum primitiveType = indexedQuads ? GL_QUADS : GL_TRIANGLES;
+    const int verticesPerQuad = indexedQuads ? 4 : 6;
+    const size_t size = verticesPerQuad * quadCount * sizeof(GLVertex2D);
+
+    const GLVertexAttrib attribs[] = {
+        { VA_Position, 2, GL_FLOAT, offsetof(GLVertex2D, position) },
+        { VA_TexCoord, 2, GL_FLOAT, offsetof(GLVertex2D, texcoord) },
+    };
+
+    GLVertexBuffer *vbo = GLVertexBuffer::streamingBuffer();
+    vbo->reset();
+    vbo->setAttribLayout(attribs, 2, sizeof(GLVertex2D));
+
+    GLVertex2D *map = static_cast<GLVertex2D *>(vbo->map(size));
+    bool translucent = false;
+    int first = 0;
+    for (Group &group : m_groups) {
+        for (Run &run : group.runs) {
+            run.firstIndex = first;
+            for (const Node &node : qAsConst(run.nodes)) {
+                node.quads.makeInterleavedArrays(primitiveType, map, textureMatrixFromKey(node.key));
+                map += node.quads.count() * verticesPerQuad;
+                first += node.quads.count() * verticesPerQuad;
+            }
+            run.indexCount = first - run.firstIndex;
+        }
+        translucent |= group.opacity != 1.0;
+    }
+    vbo->unmap();
+    vbo->bindArrays();
+
+    const QRegion scissorRegion = scissor ? m_clip : infiniteRegion();
+    const int drawCalls = drawGroups(projectionMatrix, translucent, scissorRegion, [vbo, primitiveType](const Run &run) {
+        vbo->draw(primitiveType, run.firstIndex, run.indexCount);
+    });
+
+    vbo->unbindArrays();
+    return drawCalls;
+}
+
+} // namespace KWin
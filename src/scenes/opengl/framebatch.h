@@ -0,0 +1,132 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2026 KWin contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "scene_opengl.h"
+#include "vertexcache.h"
+
+#include <QRectF>
+#include <QScopedPointer>
+#include <QVector>
+
+#include <functional>
+
+namespace KWin
+{
+
+/**
+ * The OpenGLFrameBatch class collects the render nodes of several windows and draws them
+ * with as few draw calls as possible.
+ *
+ * While recording, every node is placed in a group of nodes that share the opacity and the
+ * blend state, and within the group in a run of nodes that share the texture. A node may join
+ * an existing group only if it doesn't overlap any group that has been recorded after it,
+ * otherwise it would end up below windows that it is stacked above. The same applies to the
+ * runs of a group. The state is set up once per group, each run is drawn with a single draw
+ * call.
+ *
+ * Windows usually have textures of their own, so most runs hold the nodes of one window.
+ * Nodes are merged into one draw call mostly when they share a texture atlas, like the
+ * decorations do.
+ *
+ * The vertices are taken from an OpenGLVertexCache, so only items whose geometry, position
+ * or texture has changed since they were drawn last are uploaded again. The cached vertices
+ * are not clipped, instead the batch is drawn with the union of the paint regions of its
+ * windows as scissor.
+ *
+ * Batching requires that nothing else is drawn between the recorded windows, and that all
+ * nodes are drawn with the same projection and without hardware clipping.
+ */
+class OpenGLFrameBatch
+{
+public:
+    OpenGLFrameBatch();
+    ~OpenGLFrameBatch();
+
+    void begin();
+    bool isRecording() const;
+
+    /**
+     * Adds the render @a nodes of a window to the batch, which is painted in @a clip. The quads
+     * of the nodes are ignored, they are built from the items. Returns @c false without adding
+     * anything if the nodes can't be batched, e.g. because a node is not just translated.
+     */
+    bool addWindow(const QVector<OpenGLWindow::RenderNode> &nodes, const QRegion &clip);
+
+    /**
+     * Draws the recorded nodes and stops recording. Returns the number of issued draw calls.
+     */
+    int end(const QMatrix4x4 &projectionMatrix);
+
+    /**
+     * Draws the recorded nodes, but keeps recording.
+     */
+    int flush(const QMatrix4x4 &projectionMatrix);
+
+    int windowCount() const;
+    int uploadedItemCount() const;
+    const OpenGLVertexCache *vertexCache() const;
+
+private:
+    struct Node
+    {
+        Item *item;
+        OpenGLVertexCache::Key key;
+        WindowQuadList quads;
+        QRectF bounds;
+        int first = 0;
+        int vertexCount = 0;
+        bool cached = false;
+    };
+
+    struct Run
+    {
+        GLTexture *texture;
+        QRectF bounds;
+        QVector<Node> nodes;
+        int firstIndex = 0;
+        int indexCount = 0;
+    };
+
+    struct Group
+    {
+        qreal opacity;
+        bool blend;
+        QRectF bounds;
+        QVector<Run> runs;
+    };
+
+    template<typename Function>
+    void forEachNode(Function function)
+    {
+        for (Group &group : m_groups) {
+            for (Run &run : group.runs) {
+                for (Node &node : run.nodes) {
+                    function(node);
+                }
+            }
+        }
+    }
+
+    bool uploadVertices();
+    int drawCached(const QMatrix4x4 &projectionMatrix);
+    int drawStreamed(const QMatrix4x4 &projectionMatrix, bool scissor);
+    int drawGroups(const QMatrix4x4 &projectionMatrix, bool translucent, const QRegion &clip,
+                   const std::function<void(const Run &)> &draw);
+
+    QScopedPointer<OpenGLVertexCache> m_vertexCache;
+    QVector<Group> m_groups;
+    QRegion m_clip;
+    int m_windowCount = 0;
+    int m_uploadedItemCount = 0;
+    bool m_recording = false;
+};
+
+} // namespace KWin
@@ -12,12 +12,14 @@
     SPDX-License-Identifier: GPL-2.0-or-later
 */
 #include "scene_opengl.h"
+#include "framebatch.h"
 #include "openglsurfacetexture.h"
 
 #include "platform.h"
 #include "wayland_server.h"
 
 #include <kwinglplatform.h>
+#include <kwingltexturecache.h>
 #include <kwinoffscreenquickview.h>
 
 #include "utils/common.h"
@@ -35,6 +37,7 @@
 #include "windowitem.h"
 #include "abstract_output.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstddef>
 
@@ -44,6 +47,7 @@
 #include <QVector2D>
 #include <QVector4D>
 #include <QMatrix4x4>
+#include <QtConcurrentRun>
 #include <QtMath>
 
 namespace KWin
@@ -69,6 +73,14 @@ SceneOpenGL::SceneOpenGL(OpenGLBackend *backend, QObject *parent)
         glGenVertexArrays(1, &vao);
         glBindVertexArray(vao);
     }
+
+    // Used to measure how long the GPU takes to render a frame
+    m_supportsTimerQueries = !GLPlatform::instance()->isGLES()
+        && (hasGLVersion(3, 3) || hasGLExtension(QByteArrayLiteral("GL_ARB_timer_query")));
+
+    m_frameBatch.reset(new OpenGLFrameBatch);
+    m_frameBatchingEnabled = !qEnvironmentVariableIntValue("KWIN_GL_NO_FRAME_BATCHING");
+    m_decorationAtlas.reset(new OpenGLDecorationAtlas);
 }
 
 SceneOpenGL::~SceneOpenGL()
@@ -76,6 +88,9 @@ SceneOpenGL::~SceneOpenGL()
     if (init_ok) {
         makeOpenGLContextCurrent();
     }
+    for (const GpuTimer &timer : qAsConst(m_gpuTimers)) {
+        glDeleteQueries(2, timer.queries);
+    }
     if (m_lanczosFilter) {
         delete m_lanczosFilter;
         m_lanczosFilter = nullptr;
@@ -129,8 +144,7 @@ void SceneOpenGL::paintCursor(AbstractOutput *output, const QRegion &rendered)
             m_cursorTextureDirty = false;
             return;
         }
-        m_cursorTexture.reset(new GLTexture(img));
-        m_cursorTexture->setWrapMode(GL_CLAMP_TO_EDGE);
+        m_cursorTexture = GLTextureCache::instance()->texture(img);
         m_cursorTextureDirty = false;
     };
 
@@ -143,13 +157,9 @@ void SceneOpenGL::paintCursor(AbstractOutput *output, const QRegion &rendered)
             m_cursorTextureDirty = true;
         });
     } else if (m_cursorTextureDirty) {
-        const QImage image = Cursors::self()->currentCursor()->image();
-        if (image.size() == m_cursorTexture->size()) {
-            m_cursorTexture->update(image);
-            m_cursorTextureDirty = false;
-        } else {
-            newTexture();
-        }
+        // Cursor textures are shared with the effects and screencasts, so they can't be
+        // updated in place.
+        newTexture();
     }
 
     // get cursor position in projection coordinates
@@ -245,9 +255,13 @@ void SceneOpenGL::paint(AbstractOutput *output, const QRegion &damage, const QLi
     if (directScanout) {
         renderLoop->endFrame();
     } else {
+        const QRegion overlayDamage = assignOverlays(output);
+
         // prepare rendering makescontext current on the output
         repaint = m_backend->beginFrame(output);
         GLVertexBuffer::streamingBuffer()->beginFrame();
+        const bool gpuTimerStarted = beginGpuTimer(renderLoop);
+        m_currentFrame = FrameStatistics();
 
         GLVertexBuffer::setVirtualScreenGeometry(geo);
         GLRenderTarget::setVirtualScreenGeometry(geo);
@@ -256,10 +270,14 @@ void SceneOpenGL::paint(AbstractOutput *output, const QRegion &damage, const QLi
 
         updateProjectionMatrix(geo);
 
-        paintScreen(damage.intersected(geo), repaint, &update, &valid,
+        paintScreen((damage | overlayDamage).intersected(geo), repaint, &update, &valid,
                     renderLoop, projectionMatrix());   // call generic implementation
         paintCursor(output, valid);
+        m_lastFrame = m_currentFrame;
 
+        if (gpuTimerStarted) {
+            endGpuTimer(renderLoop);
+        }
         renderLoop->endFrame();
 
         GLVertexBuffer::streamingBuffer()->endOfFrame();
@@ -270,6 +288,169 @@ void SceneOpenGL::paint(AbstractOutput *output, const QRegion &damage, const QLi
     clearStackingOrder();
 }
 
+// Every candidate costs an atomic test commit per frame, and there are rarely more planes.
+static const int s_maxOverlayCandidates = 4;
+
+static bool containsItem(const QVector<QPointer<SurfaceItem>> &items, const Item *item)
+{
+    return std::any_of(items.constBegin(), items.constEnd(), [item](const QPointer<SurfaceItem> &candidate) {
+        return candidate.data() == item;
+    });
+}
+
+static void collectOverlayCandidates(Item *item, const QRect &outputGeometry, QRegion *covered, QVector<SurfaceItem *> *candidates)
+{
+    if (!item->isVisible()) {
+        return;
+    }
+
+    // Walk the items from top to bottom, the opposite of the painting order.
+    const QList<Item *> sortedChildItems = item->sortedChildItems();
+    for (auto it = sortedChildItems.crbegin(); it != sortedChildItems.crend(); ++it) {
+        if ((*it)->z() >= 0) {
+            collectOverlayCandidates(*it, outputGeometry, covered, candidates);
+        }
+    }
+
+    const QRect rect = item->mapToGlobal(item->rect());
+    if (auto surfaceItem = qobject_cast<SurfaceItem *>(item)) {
+        if (outputGeometry.contains(rect) && !covered->intersects(rect)) {
+            candidates->append(surfaceItem);
+        }
+    }
+    *covered += rect;
+
+    for (auto it = sortedChildItems.crbegin(); it != sortedChildItems.crend(); ++it) {
+        if ((*it)->z() < 0) {
+            collectOverlayCandidates(*it, outputGeometry, covered, candidates);
+        }
+    }
+}
+
+/**
+ * Returns the surfaces on @a output that nothing is painted on top of, so they could be shown
+ * on overlay planes. The surfaces that are on a plane already come first, then larger ones.
+ */
+QVector<SurfaceItem *> SceneOpenGL::overlayCandidates(AbstractOutput *output) const
+{
+    const QRect outputGeometry = output->geometry();
+    QVector<SurfaceItem *> candidates;
+    QRegion covered;
+    for (int i = stacking_order.count() - 1; i >= 0; --i) {
+        Window *window = stacking_order[i];
+        Toplevel *toplevel = window->window();
+        if (!toplevel->isOnOutput(output) || !window->isVisible()) {
+            continue;
+        }
+        if (toplevel->opacity() == 1.0) {
+            collectOverlayCandidates(window->windowItem(), outputGeometry, &covered, &candidates);
+        } else {
+            covered += window->windowItem()->mapToGlobal(window->windowItem()->boundingRect());
+        }
+    }
+
+    const QVector<QPointer<SurfaceItem>> current = m_overlayItems.value(output);
+    std::stable_sort(candidates.begin(), candidates.end(), [&current](const SurfaceItem *a, const SurfaceItem *b) {
+        const bool aCurrent = containsItem(current, a);
+        const bool bCurrent = containsItem(current, b);
+        if (aCurrent != bCurrent) {
+            return aCurrent;
+        }
+        return a->size().width() * a->size().height() > b->size().width() * b->size().height();
+    });
+    if (candidates.count() > s_maxOverlayCandidates) {
+        candidates.resize(s_maxOverlayCandidates);
+    }
+    return candidates;
+}
+
+/**
+ * Hands the surfaces that can be shown on overlay planes to the backend, they are left out
+ * of the composited frame. Returns the area of the surfaces that have to be composited again.
+ */
+QRegion SceneOpenGL::assignOverlays(AbstractOutput *output)
+{
+    if (!output) {
+        return QRegion();
+    }
+
+    QVector<SurfaceItem *> candidates;
+    // Effects may transform the windows or paint on top of them
+    if (m_backend->directScanoutAllowed(output) && !static_cast<EffectsHandlerImpl *>(effects)->hasActiveEffects()) {
+        candidates = overlayCandidates(output);
+    }
+    const QVector<SurfaceItem *> assigned = m_backend->assignOverlays(output, candidates);
+
+    QRegion damage;
+    QVector<QPointer<SurfaceItem>> &items = m_overlayItems[output];
+    for (const QPointer<SurfaceItem> &item : qAsConst(items)) {
+        if (item && !assigned.contains(item)) {
+            damage += item->mapToGlobal(item->rect());
+        }
+    }
+    items.clear();
+    for (SurfaceItem *item : assigned) {
+        items.append(item);
+    }
+    return damage;
+}
+
+bool SceneOpenGL::isOnHardwarePlane(const Item *item) const
+{
+    return containsItem(m_overlayItems.value(painted_screen), item);
+}
+
+/**
+ * Collects the GPU time of a previous frame, if it is available, and starts timing the
+ * current frame. Returns @c false if the current frame is not timed, e.g. because the
+ * GPU hasn't finished the previous timed frame yet; querying the result must never stall.
+ */
+bool SceneOpenGL::beginGpuTimer(RenderLoop *renderLoop)
+{
+    if (!m_supportsTimerQueries) {
+        return false;
+    }
+
+    auto it = m_gpuTimers.find(renderLoop);
+    if (it == m_gpuTimers.end()) {
+        it = m_gpuTimers.insert(renderLoop, GpuTimer());
+        glGenQueries(2, it->queries);
+        connect(renderLoop, &QObject::destroyed, this, [this, renderLoop]() {
+            const GpuTimer timer = m_gpuTimers.take(renderLoop);
+            if (makeOpenGLContextCurrent()) {
+                glDeleteQueries(2, timer.queries);
+            }
+        });
+    }
+
+    GpuTimer &timer = *it;
+    if (timer.pending) {
+        GLint available = 0;
+        glGetQueryObjectiv(timer.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            return false;
+        }
+        GLuint64 begin = 0;
+        GLuint64 end = 0;
+        glGetQueryObjectui64v(timer.queries[0], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(timer.queries[1], GL_QUERY_RESULT, &end);
+        if (end > begin) {
+            renderLoop->addGpuRenderTime(std::chrono::nanoseconds(end - begin));
+        }
+        timer.pending = false;
+    }
+
+    glQueryCounter(timer.queries[0], GL_TIMESTAMP);
+    return true;
+}
+
+void SceneOpenGL::endGpuTimer(RenderLoop *renderLoop)
+{
+    GpuTimer &timer = m_gpuTimers[renderLoop];
+    glQueryCounter(timer.queries[1], GL_TIMESTAMP);
+    timer.pending = true;
+}
+
 QMatrix4x4 SceneOpenGL::transformation(int mask, const ScreenPaintData &data) const
 {
     QMatrix4x4 matrix;
@@ -403,7 +584,7 @@ Shadow *SceneOpenGL::createShadow(Toplevel *toplevel)
 
 DecorationRenderer *SceneOpenGL::createDecorationRenderer(Decoration::DecoratedClientImpl *impl)
 {
-    return new SceneOpenGLDecorationRenderer(impl);
+    return new SceneOpenGLDecorationRenderer(impl, m_decorationAtlas);
 }
 
 bool SceneOpenGL::animationsSupported() const
@@ -467,7 +648,54 @@ void SceneOpenGL::paintSimpleScreen(int mask, const QRegion &region)
 {
     m_screenProjectionMatrix = m_projectionMatrix;
 
+    // Without active effects nothing else is drawn between the windows, so they can be
+    // collected and drawn together once all of them have been painted.
+    const bool batching = m_frameBatchingEnabled && !static_cast<EffectsHandlerImpl *>(effects)->hasActiveEffects();
+    if (batching) {
+        m_frameBatch->begin();
+    }
+
     Scene::paintSimpleScreen(mask, region);
+
+    if (batching) {
+        addDrawCalls(m_frameBatch->end(m_projectionMatrix));
+        m_currentFrame.batchedWindows += m_frameBatch->windowCount();
+        m_currentFrame.uploadedItems += m_frameBatch->uploadedItemCount();
+    }
+}
+
+OpenGLFrameBatch *SceneOpenGL::frameBatch() const
+{
+    return m_frameBatch->isRecording() ? m_frameBatch.data() : nullptr;
+}
+
+void SceneOpenGL::flushFrameBatch()
+{
+    if (m_frameBatch->isRecording()) {
+        addDrawCalls(m_frameBatch->flush(m_projectionMatrix));
+    }
+}
+
+void SceneOpenGL::addDrawCalls(int count)
+{
+    m_currentFrame.drawCalls += count;
+}
+
+QString SceneOpenGL::supportInformation() const
+{
+    QString support;
+    support.append(QStringLiteral("Frame batching: "));
+    support.append(m_frameBatchingEnabled ? QStringLiteral("yes\n") : QStringLiteral("no\n"));
+    support.append(QStringLiteral("Draw calls in the last frame: %1\n").arg(m_lastFrame.drawCalls));
+    support.append(QStringLiteral("Batched windows in the last frame: %1\n").arg(m_lastFrame.batchedWindows));
+    support.append(QStringLiteral("Items uploaded to the vertex cache in the last frame: %1\n").arg(m_lastFrame.uploadedItems));
+    const OpenGLVertexCache *cache = m_frameBatch->vertexCache();
+    support.append(QStringLiteral("Vertex cache: %1 items, %2 vertices\n").arg(cache->itemCount()).arg(cache->vertexCount()));
+    support.append(QStringLiteral("Decoration atlas: %1 parts in %2 textures, %3 KiB\n")
+                       .arg(m_decorationAtlas->entryCount())
+                       .arg(m_decorationAtlas->textureCount())
+                       .arg(m_decorationAtlas->memoryUsage() / 1024));
+    return support;
 }
 
 void SceneOpenGL::paintGenericScreen(int mask, const ScreenPaintData &data)
@@ -490,6 +718,7 @@ void SceneOpenGL::doPaintBackground(const QVector< float >& vertices)
     binder.shader()->setUniform(GLShader::ModelViewProjectionMatrix, m_projectionMatrix);
 
     vbo->render(GL_TRIANGLES);
+    addDrawCalls(1);
 }
 
 Scene::Window *SceneOpenGL::createWindow(Toplevel *t)
@@ -508,6 +737,7 @@ void SceneOpenGL::finalDrawWindow(EffectWindowImpl* w, int mask, const QRegion &
 void SceneOpenGL::performPaintWindow(EffectWindowImpl* w, int mask, const QRegion &region, WindowPaintData& data)
 {
     if (mask & PAINT_WINDOW_LANCZOS) {
+        flushFrameBatch();
         if (!m_lanczosFilter) {
             m_lanczosFilter = new LanczosFilter(this);
         }
@@ -577,11 +807,11 @@ static GLTexture *bindSurfaceTexture(SurfaceItem *surfaceItem)
     return platformSurfaceTexture->texture();
 }
 
-static WindowQuadList clipQuads(const Item *item, const OpenGLWindow::RenderContext *context)
+static WindowQuadList clipQuads(const Item *item, const QMatrix4x4 &transform, const OpenGLWindow::RenderContext *context)
 {
     const WindowQuadList quads = item->quads();
     if (context->clip != infiniteRegion() && !context->hardwareClipping) {
-        const QPoint offset = context->transforms.top().map(QPoint(0, 0));
+        const QPoint offset = transform.map(QPoint(0, 0));
 
         WindowQuadList ret;
         ret.reserve(quads.count());
@@ -608,6 +838,18 @@ static WindowQuadList clipQuads(const Item *item, const OpenGLWindow::RenderCont
     return quads;
 }
 
+static bool shouldRenderItem(const Item *item, const OpenGLWindow::RenderContext *context, WindowQuadList *quads)
+{
+    if (context->batching) {
+        // The frame batch clips the whole batch with scissors, the cached vertices of
+        // the item are not clipped.
+        return context->clip == infiniteRegion()
+            || context->clip.intersects(context->transforms.top().mapRect(item->boundingRect()));
+    }
+    *quads = clipQuads(item, context->transforms.top(), context);
+    return !quads->isEmpty();
+}
+
 void OpenGLWindow::createRenderNode(Item *item, RenderContext *context)
 {
     const QList<Item *> sortedChildItems = item->sortedChildItems();
@@ -628,10 +870,11 @@ void OpenGLWindow::createRenderNode(Item *item, RenderContext *context)
 
     item->preprocess();
     if (auto shadowItem = qobject_cast<ShadowItem *>(item)) {
-        WindowQuadList quads = clipQuads(item, context);
-        if (!quads.isEmpty()) {
+        WindowQuadList quads;
+        if (shouldRenderItem(item, context, &quads)) {
             SceneOpenGLShadow *shadow = static_cast<SceneOpenGLShadow *>(shadowItem->shadow());
             context->renderNodes.append(RenderNode{
+                .item = item,
                 .texture = shadow->shadowTexture(),
                 .quads = quads,
                 .transformMatrix = context->transforms.top(),
@@ -641,10 +884,11 @@ void OpenGLWindow::createRenderNode(Item *item, RenderContext *context)
             });
         }
     } else if (auto decorationItem = qobject_cast<DecorationItem *>(item)) {
-        WindowQuadList quads = clipQuads(item, context);
-        if (!quads.isEmpty()) {
+        WindowQuadList quads;
+        if (shouldRenderItem(item, context, &quads)) {
             auto renderer = static_cast<const SceneOpenGLDecorationRenderer *>(decorationItem->renderer());
             context->renderNodes.append(RenderNode{
+                .item = item,
                 .texture = renderer->texture(),
                 .quads = quads,
                 .transformMatrix = context->transforms.top(),
@@ -653,14 +897,15 @@ void OpenGLWindow::createRenderNode(Item *item, RenderContext *context)
                 .coordinateType = UnnormalizedCoordinates,
             });
         }
-    } else if (auto surfaceItem = qobject_cast<SurfaceItem *>(item)) {
-        WindowQuadList quads = clipQuads(item, context);
-        if (!quads.isEmpty()) {
+    } else if (auto surfaceItem = qobject_cast<SurfaceItem *>(item); surfaceItem && !m_scene->isOnHardwarePlane(surfaceItem)) {
+        WindowQuadList quads;
+        if (shouldRenderItem(item, context, &quads)) {
             SurfacePixmap *pixmap = surfaceItem->pixmap();
             if (pixmap) {
                 // Don't bother with blending if the entire surface is opaque
                 bool hasAlpha = pixmap->hasAlphaChannel() && !surfaceItem->shape().subtracted(surfaceItem->opaque()).isEmpty();
                 context->renderNodes.append(RenderNode{
+                    .item = item,
                     .texture = bindSurfaceTexture(surfaceItem),
                     .quads = quads,
                     .transformMatrix = context->transforms.top(),
@@ -733,16 +978,36 @@ static QMatrix4x4 transformForPaintData(int mask, const WindowPaintData &data)
     return matrix;
 }
 
+bool OpenGLWindow::canBatch(int mask, const WindowPaintData &data) const
+{
+    // The batch draws with the plain projection matrix and without any of the per-window
+    // shader adjustments; only the opacity is kept per node.
+    if (mask & (Scene::PAINT_WINDOW_TRANSFORMED | Scene::PAINT_SCREEN_TRANSFORMED | Scene::PAINT_WINDOW_LANCZOS)) {
+        return false;
+    }
+    if (data.shader) {
+        return false;
+    }
+    if (data.brightness() != 1.0 || data.saturation() != 1.0 || data.crossFadeProgress() != 1.0) {
+        return false;
+    }
+    return data.projectionMatrix().isIdentity() && data.modelViewMatrix().isIdentity();
+}
+
 void OpenGLWindow::performPaint(int mask, const QRegion &region, const WindowPaintData &data)
 {
     if (region.isEmpty()) {
         return;
     }
 
+    OpenGLFrameBatch *batch = m_scene->frameBatch();
+    const bool hardwareClipping = region != infiniteRegion() && ((mask & Scene::PAINT_WINDOW_TRANSFORMED) || (mask & Scene::PAINT_SCREEN_TRANSFORMED));
+
     RenderContext renderContext {
         .clip = region,
         .paintData = data,
-        .hardwareClipping = region != infiniteRegion() && ((mask & Scene::PAINT_WINDOW_TRANSFORMED) || (mask & Scene::PAINT_SCREEN_TRANSFORMED)),
+        .hardwareClipping = hardwareClipping,
+        .batching = batch && !hardwareClipping && canBatch(mask, data),
     };
 
     renderContext.transforms.push(QMatrix4x4());
@@ -751,6 +1016,20 @@ void OpenGLWindow::performPaint(int mask, const QRegion &region, const WindowPai
 
     createRenderNode(windowItem(), &renderContext);
 
+    if (batch) {
+        if (renderContext.batching) {
+            if (batch->addWindow(renderContext.renderNodes, region)) {
+                return;
+            }
+            // The quads were left to the batch, so they haven't been clipped yet.
+            for (RenderNode &renderNode : renderContext.renderNodes) {
+                renderNode.quads = clipQuads(renderNode.item, renderNode.transformMatrix, &renderContext);
+            }
+        }
+        // The windows below have to be drawn first.
+        m_scene->flushFrameBatch();
+    }
+
     int quadCount = 0;
     for (const RenderNode &node : qAsConst(renderContext.renderNodes)) {
         quadCount += node.quads.count();
@@ -837,6 +1116,7 @@ void OpenGLWindow::performPaint(int mask, const QRegion &region, const WindowPai
 
         vbo->draw(region, primitiveType, renderNode.firstVertex,
                   renderNode.vertexCount, renderContext.hardwareClipping);
+        m_scene->addDrawCalls(renderContext.hardwareClipping ? region.rectCount() : 1);
     }
 
     vbo->unbindArrays();
@@ -864,8 +1144,6 @@ SceneOpenGL::EffectFrame::EffectFrame(EffectFrameImpl* frame, SceneOpenGL *scene
     , m_textTexture(nullptr)
     , m_oldTextTexture(nullptr)
     , m_textPixmap(nullptr)
-    , m_iconTexture(nullptr)
-    , m_oldIconTexture(nullptr)
     , m_selectionTexture(nullptr)
     , m_unstyledVBO(nullptr)
     , m_scene(scene)
@@ -878,8 +1156,6 @@ SceneOpenGL::EffectFrame::~EffectFrame()
     delete m_textTexture;
     delete m_textPixmap;
     delete m_oldTextTexture;
-    delete m_iconTexture;
-    delete m_oldIconTexture;
     delete m_selectionTexture;
     delete m_unstyledVBO;
 }
@@ -893,22 +1169,19 @@ void SceneOpenGL::EffectFrame::free()
     m_textTexture = nullptr;
     delete m_textPixmap;
     m_textPixmap = nullptr;
-    delete m_iconTexture;
-    m_iconTexture = nullptr;
+    m_iconTexture.reset();
     delete m_selectionTexture;
     m_selectionTexture = nullptr;
     delete m_unstyledVBO;
     m_unstyledVBO = nullptr;
-    delete m_oldIconTexture;
-    m_oldIconTexture = nullptr;
+    m_oldIconTexture.reset();
     delete m_oldTextTexture;
     m_oldTextTexture = nullptr;
 }
 
 void SceneOpenGL::EffectFrame::freeIconFrame()
 {
-    delete m_iconTexture;
-    m_iconTexture = nullptr;
+    m_iconTexture.reset();
 }
 
 void SceneOpenGL::EffectFrame::freeTextFrame()
@@ -927,9 +1200,8 @@ void SceneOpenGL::EffectFrame::freeSelection()
 
 void SceneOpenGL::EffectFrame::crossFadeIcon()
 {
-    delete m_oldIconTexture;
     m_oldIconTexture = m_iconTexture;
-    m_iconTexture = nullptr;
+    m_iconTexture.reset();
 }
 
 void SceneOpenGL::EffectFrame::crossFadeText()
@@ -1162,7 +1434,7 @@ void SceneOpenGL::EffectFrame::render(const QRegion &_region, double opacity, do
         }
 
         if (!m_iconTexture) { // lazy creation
-            m_iconTexture = new GLTexture(m_effectFrame->icon().pixmap(m_effectFrame->iconSize()));
+            m_iconTexture = GLTextureCache::instance()->texture(m_effectFrame->icon().pixmap(m_effectFrame->iconSize()).toImage());
         }
         m_iconTexture->bind();
         m_iconTexture->render(region, QRect(topLeft, m_effectFrame->iconSize()));
@@ -1458,10 +1730,53 @@ bool SceneOpenGLShadow::prepareBackend()
     return true;
 }
 
-SceneOpenGLDecorationRenderer::SceneOpenGLDecorationRenderer(Decoration::DecoratedClientImpl *client)
+/**
+ * The DecorationPicture class records the painting commands of a decoration, so they can be
+ * played back in a worker thread. It reports the device pixel ratio of the output, so the
+ * decoration picks icons that match the resolution it will be rasterised at.
+ */
+class DecorationPicture : public QPicture
+{
+public:
+    explicit DecorationPicture(qreal devicePixelRatio)
+        : m_devicePixelRatio(devicePixelRatio)
+    {
+    }
+
+protected:
+    int metric(PaintDeviceMetric metric) const override
+    {
+        switch (metric) {
+        case PdmDevicePixelRatio:
+            return int(m_devicePixelRatio);
+        case PdmDevicePixelRatioScaled:
+            return m_devicePixelRatio * devicePixelRatioFScale();
+        default:
+            return QPicture::metric(metric);
+        }
+    }
+
+private:
+    qreal m_devicePixelRatio;
+};
+
+SceneOpenGLDecorationRenderer::SceneOpenGLDecorationRenderer(Decoration::DecoratedClientImpl *client,
+                                                             const QSharedPointer<OpenGLDecorationAtlas> &atlas)
     : DecorationRenderer(client)
-    , m_texture()
+    , m_atlas(atlas)
+    , m_watcher(new QFutureWatcher<RenderedParts>(this))
+    , m_images(int(DecorationPart::Count))
+    , m_hashes(int(DecorationPart::Count))
+    , m_rects(int(DecorationPart::Count))
 {
+    connect(m_watcher, &QFutureWatcher<RenderedParts>::finished,
+            this, &SceneOpenGLDecorationRenderer::handleRenderingFinished);
+
+    // Start rasterising as soon as the decoration is damaged rather than when the next frame
+    // is painted, so the result is usually ready by then.
+    connect(this, &DecorationRenderer::damaged,
+            this, &SceneOpenGLDecorationRenderer::scheduleRendering);
+    scheduleRendering();
 }
 
 SceneOpenGLDecorationRenderer::~SceneOpenGLDecorationRenderer()
@@ -1469,6 +1784,7 @@ SceneOpenGLDecorationRenderer::~SceneOpenGLDecorationRenderer()
     if (Scene *scene = Compositor::self()->scene()) {
         scene->makeOpenGLContextCurrent();
     }
+    releaseEntries();
 }
 
 static void clamp_row(int left, int width, int right, const uint32_t *src, uint32_t *dest)
@@ -1521,145 +1837,260 @@ static void clamp(QImage &image, const QRect &viewport)
     }
 }
 
-void SceneOpenGLDecorationRenderer::render(const QRegion &region)
+static QSize paddedPartSize(const QRect &partRect, qreal devicePixelRatio, bool rotated)
 {
-    if (areImageSizesDirty()) {
-        resizeTexture();
-        resetImageSizesDirty();
+    QSize size = partRect.size() * devicePixelRatio;
+    if (rotated) {
+        size.transpose();
     }
+    return size + QSize(2 * DecorationRenderer::TexturePad, 2 * DecorationRenderer::TexturePad);
+}
 
-    if (!m_texture) {
-        // for invalid sizes we get no texture, see BUG 361551
+static QVector<QRect> layoutDecorationParts(Decoration::DecoratedClientImpl *client)
+{
+    QRect left, top, right, bottom;
+    client->client()->layoutDecorationRects(left, top, right, bottom);
+
+    QVector<QRect> rects(int(SceneOpenGLDecorationRenderer::DecorationPart::Count));
+    rects[int(SceneOpenGLDecorationRenderer::DecorationPart::Left)] = left;
+    rects[int(SceneOpenGLDecorationRenderer::DecorationPart::Top)] = top;
+    rects[int(SceneOpenGLDecorationRenderer::DecorationPart::Right)] = right;
+    rects[int(SceneOpenGLDecorationRenderer::DecorationPart::Bottom)] = bottom;
+    return rects;
+}
+
+void SceneOpenGLDecorationRenderer::render(const QRegion &region)
+{
+    m_queuedRegion += region;
+    startRendering();
+}
+
+void SceneOpenGLDecorationRenderer::scheduleRendering()
+{
+    if (m_renderingScheduled) {
         return;
     }
+    m_renderingScheduled = true;
+    QMetaObject::invokeMethod(this, [this]() {
+        m_renderingScheduled = false;
+        const QRegion region = damage();
+        if (!region.isEmpty()) {
+            render(region);
+            resetDamage();
+        }
+    }, Qt::QueuedConnection);
+}
 
-    QRect left, top, right, bottom;
-    client()->client()->layoutDecorationRects(left, top, right, bottom);
+void SceneOpenGLDecorationRenderer::startRendering()
+{
+    // The parts are rasterised on top of the result of the previous job, so only one job
+    // can be in flight. Damage that arrives meanwhile is rendered once it has finished.
+    if (m_rendering || m_queuedRegion.isEmpty() || !client()) {
+        return;
+    }
 
+    const QVector<QRect> rects = layoutDecorationParts(client());
     const qreal devicePixelRatio = effectiveDevicePixelRatio();
-    const int topHeight = std::ceil(top.height() * devicePixelRatio);
-    const int bottomHeight = std::ceil(bottom.height() * devicePixelRatio);
-    const int leftWidth = std::ceil(left.width() * devicePixelRatio);
+    const QRect dirtyRect = m_queuedRegion.boundingRect();
+
+    QVector<PartJob> jobs(int(DecorationPart::Count));
+    for (int i = 0; i < jobs.count(); ++i) {
+        PartJob &job = jobs[i];
+        job.partRect = rects[i];
+        job.rotated = i == int(DecorationPart::Left) || i == int(DecorationPart::Right);
+        if (!job.partRect.isValid()) {
+            continue;
+        }
 
-    const QPoint topPosition(0, 0);
-    const QPoint bottomPosition(0, topPosition.y() + topHeight + (2 * TexturePad));
-    const QPoint leftPosition(0, bottomPosition.y() + bottomHeight + (2 * TexturePad));
-    const QPoint rightPosition(0, leftPosition.y() + leftWidth + (2 * TexturePad));
+        // We allow partial decoration updates as long as the part keeps its size, otherwise
+        // the part is rendered from scratch.
+        if (m_rects[i] == job.partRect && m_devicePixelRatio == devicePixelRatio
+                && m_images[i].size() == paddedPartSize(job.partRect, devicePixelRatio, job.rotated)) {
+            job.image = m_images[i];
+            job.hash = m_hashes[i];
+            job.rect = job.partRect.intersected(dirtyRect);
+        } else {
+            job.rect = job.partRect;
+        }
+        if (!job.rect.isValid()) {
+            continue;
+        }
 
-    const QRect dirtyRect = region.boundingRect();
+        // The decoration lives in the main thread, only its painting commands can be replayed
+        // in a worker thread.
+        DecorationPicture picture(devicePixelRatio);
+        QPainter painter(&picture);
+        painter.setRenderHint(QPainter::Antialiasing);
+        painter.setClipRect(job.rect);
+        renderToPainter(&painter, job.rect);
+        painter.end();
+        job.picture = picture;
+    }
 
-    renderPart(top.intersected(dirtyRect), top, topPosition, devicePixelRatio);
-    renderPart(bottom.intersected(dirtyRect), bottom, bottomPosition, devicePixelRatio);
-    renderPart(left.intersected(dirtyRect), left, leftPosition, devicePixelRatio, true);
-    renderPart(right.intersected(dirtyRect), right, rightPosition, devicePixelRatio, true);
+    m_renderingRegion = m_queuedRegion;
+    m_renderingRects = rects;
+    m_renderingDevicePixelRatio = devicePixelRatio;
+    m_queuedRegion = QRegion();
+    m_rendering = true;
+    m_watcher->setFuture(QtConcurrent::run(m_atlas->threadPool(), &SceneOpenGLDecorationRenderer::rasterise,
+                                           jobs, devicePixelRatio));
 }
 
-void SceneOpenGLDecorationRenderer::renderPart(const QRect &rect, const QRect &partRect,
-                                               const QPoint &textureOffset,
-                                               qreal devicePixelRatio, bool rotated)
+SceneOpenGLDecorationRenderer::RenderedParts SceneOpenGLDecorationRenderer::rasterise(const QVector<PartJob> &jobs, qreal devicePixelRatio)
 {
-    if (!rect.isValid()) {
-        return;
-    }
-    // We allow partial decoration updates and it might just so happen that the
-    // dirty region is completely contained inside the decoration part, i.e.
-    // the dirty region doesn't touch any of the decoration's edges. In that
-    // case, we should **not** pad the dirty region.
-    const QMargins padding = texturePadForPart(rect, partRect);
-    int verticalPadding = padding.top() + padding.bottom();
-    int horizontalPadding = padding.left() + padding.right();
+    RenderedParts parts;
+    parts.images.reserve(jobs.count());
+    parts.hashes.reserve(jobs.count());
 
-    QSize imageSize = rect.size() * devicePixelRatio;
-    if (rotated) {
-        imageSize = QSize(imageSize.height(), imageSize.width());
-    }
-    QSize paddedImageSize = imageSize;
-    paddedImageSize.rheight() += verticalPadding;
-    paddedImageSize.rwidth() += horizontalPadding;
-    QImage image(paddedImageSize, QImage::Format_ARGB32_Premultiplied);
-    image.setDevicePixelRatio(devicePixelRatio);
-    image.fill(Qt::transparent);
+    for (const PartJob &job : jobs) {
+        if (!job.partRect.isValid()) {
+            parts.images.append(QImage());
+            parts.hashes.append(0);
+            continue;
+        }
+        if (!job.rect.isValid()) {
+            parts.images.append(job.image);
+            parts.hashes.append(job.hash);
+            continue;
+        }
 
-    QRect padClip = QRect(padding.left(), padding.top(), imageSize.width(), imageSize.height());
-    QPainter painter(&image);
-    const qreal inverseScale = 1.0 / devicePixelRatio;
-    painter.scale(inverseScale, inverseScale);
-    painter.setRenderHint(QPainter::Antialiasing);
-    painter.setClipRect(padClip);
-    painter.translate(padding.left(), padding.top());
-    if (rotated) {
-        painter.translate(0, imageSize.height());
-        painter.rotate(-90);
-    }
-    painter.scale(devicePixelRatio, devicePixelRatio);
-    painter.translate(-rect.topLeft());
-    renderToPainter(&painter, rect);
-    painter.end();
+        const QSize paddedSize = paddedPartSize(job.partRect, devicePixelRatio, job.rotated);
+        const QSize imageSize = paddedSize - QSize(2 * TexturePad, 2 * TexturePad);
 
-    // fill padding pixels by copying from the neighbour row
-    clamp(image, padClip);
+        QImage image = job.image;
+        if (image.isNull()) {
+            image = QImage(paddedSize, QImage::Format_ARGB32_Premultiplied);
+            image.fill(Qt::transparent);
+        }
 
-    QPoint dirtyOffset = (rect.topLeft() - partRect.topLeft()) * devicePixelRatio;
-    if (padding.top() == 0) {
-        dirtyOffset.ry() += TexturePad;
-    }
-    if (padding.left() == 0) {
-        dirtyOffset.rx() += TexturePad;
+        // The recorded commands are already scaled by the device pixel ratio.
+        QPainter painter(&image);
+        painter.translate(TexturePad, TexturePad);
+        if (job.rotated) {
+            painter.translate(0, imageSize.height());
+            painter.rotate(-90);
+        }
+        painter.translate(-QPointF(job.partRect.topLeft()) * devicePixelRatio);
+
+        const QRect dirtyRect = QRectF(QPointF(job.rect.topLeft()) * devicePixelRatio,
+                                       QSizeF(job.rect.size()) * devicePixelRatio).toAlignedRect();
+        painter.setClipRect(dirtyRect);
+        painter.setCompositionMode(QPainter::CompositionMode_Source);
+        painter.fillRect(dirtyRect, Qt::transparent);
+        painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+        painter.drawPicture(QPointF(0, 0), job.picture);
+        painter.end();
+
+        // fill padding pixels by copying from the neighbour row
+        clamp(image, QRect(QPoint(TexturePad, TexturePad), imageSize));
+
+        parts.images.append(image);
+        parts.hashes.append(OpenGLDecorationAtlas::hash(image));
     }
-    m_texture->update(image, textureOffset + dirtyOffset);
+
+    return parts;
 }
 
-const QMargins SceneOpenGLDecorationRenderer::texturePadForPart(
-        const QRect &rect, const QRect &partRect)
+void SceneOpenGLDecorationRenderer::handleRenderingFinished()
 {
-    QMargins result = QMargins(0, 0, 0, 0);
-    if (rect.top() == partRect.top()) {
-        result.setTop(TexturePad);
-    }
-    if (rect.bottom() == partRect.bottom()) {
-        result.setBottom(TexturePad);
-    }
-    if (rect.left() == partRect.left()) {
-        result.setLeft(TexturePad);
+    const QRegion region = m_renderingRegion;
+    if (takeRenderingResult()) {
+        // Repaint the decoration once more, the frame that was painted for the damage may
+        // have shown the previous contents.
+        Q_EMIT damaged(region);
+        startRendering();
     }
-    if (rect.right() == partRect.right()) {
-        result.setRight(TexturePad);
+}
+
+bool SceneOpenGLDecorationRenderer::takeRenderingResult()
+{
+    if (!m_rendering || !m_watcher->isFinished()) {
+        return false;
     }
-    return result;
+    m_rendering = false;
+
+    const RenderedParts parts = m_watcher->result();
+    m_images = parts.images;
+    m_hashes = parts.hashes;
+    m_rects = m_renderingRects;
+    m_devicePixelRatio = m_renderingDevicePixelRatio;
+    m_renderingRegion = QRegion();
+    m_imagesChanged = true;
+    return true;
 }
 
-static int align(int value, int align)
+bool SceneOpenGLDecorationRenderer::isLayoutCurrent() const
 {
-    return (value + align - 1) & ~(align - 1);
+    if (!client()) {
+        return true;
+    }
+    return m_rects == layoutDecorationParts(client()) && m_devicePixelRatio == effectiveDevicePixelRatio();
 }
 
-void SceneOpenGLDecorationRenderer::resizeTexture()
+void SceneOpenGLDecorationRenderer::finish()
 {
-    QRect left, top, right, bottom;
-    client()->client()->layoutDecorationRects(left, top, right, bottom);
-    QSize size;
+    // A decoration that has been resized, or has not been rendered yet, can't be painted
+    // with the previous contents, so wait until it has been rasterised with the current layout.
+    while (m_rendering && !isLayoutCurrent()) {
+        m_watcher->waitForFinished();
+        takeRenderingResult();
+        startRendering();
+    }
 
-    size.rwidth() = qMax(qMax(top.width(), bottom.width()),
-                         qMax(left.height(), right.height()));
-    size.rheight() = top.height() + bottom.height() +
-                     left.width() + right.width();
-    size *= effectiveDevicePixelRatio();
+    if (!m_imagesChanged) {
+        return;
+    }
+    m_imagesChanged = false;
 
-    size.rheight() += 4 * (2 * TexturePad);
-    size.rwidth() += 2 * TexturePad;
-    size.rwidth() = align(size.width(), 128);
+    // Acquire the new entries before releasing the old ones, so unchanged parts are not uploaded again.
+    const QVector<OpenGLDecorationAtlas::Entry *> entries = m_atlas->acquire(m_images, m_hashes);
+    releaseEntries();
+    m_entries = entries;
+    Q_EMIT texturePositionsChanged();
+}
 
-    if (m_texture && m_texture->size() == size)
-        return;
+void SceneOpenGLDecorationRenderer::releaseEntries()
+{
+    for (OpenGLDecorationAtlas::Entry *entry : qAsConst(m_entries)) {
+        if (entry) {
+            m_atlas->release(entry);
+        }
+    }
+    m_entries.clear();
+}
 
-    if (!size.isEmpty()) {
-        m_texture.reset(new GLTexture(GL_RGBA8, size.width(), size.height()));
-        m_texture->setYInverted(true);
-        m_texture->setWrapMode(GL_CLAMP_TO_EDGE);
-        m_texture->clear();
-    } else {
-        m_texture.reset();
+GLTexture *SceneOpenGLDecorationRenderer::texture() const
+{
+    // for invalid sizes we get no texture, see BUG 361551
+    for (const OpenGLDecorationAtlas::Entry *entry : m_entries) {
+        if (entry) {
+            return entry->texture;
+        }
     }
+    return nullptr;
+}
+
+QPoint SceneOpenGLDecorationRenderer::texturePosition(Qt::Edge edge) const
+{
+    DecorationPart part;
+    switch (edge) {
+    case Qt::LeftEdge:
+        part = DecorationPart::Left;
+        break;
+    case Qt::TopEdge:
+        part = DecorationPart::Top;
+        break;
+    case Qt::RightEdge:
+        part = DecorationPart::Right;
+        break;
+    case Qt::BottomEdge:
+    default:
+        part = DecorationPart::Bottom;
+        break;
+    }
+
+    const OpenGLDecorationAtlas::Entry *entry = m_entries.value(int(part));
+    return entry ? entry->rect.topLeft() : QPoint();
 }
 
 } // namespace
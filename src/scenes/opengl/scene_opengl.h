@@ -17,12 +17,18 @@
 #include "scene.h"
 #include "shadow.h"
 
+#include "decorationatlas.h"
 #include "kwinglutils.h"
 
+#include <QFutureWatcher>
+#include <QPicture>
+#include <QPointer>
+
 namespace KWin
 {
 class LanczosFilter;
 class OpenGLBackend;
+class OpenGLFrameBatch;
 
 class KWIN_EXPORT SceneOpenGL
     : public Scene
@@ -56,6 +62,20 @@ public:
     QMatrix4x4 projectionMatrix() const { return m_projectionMatrix; }
     QMatrix4x4 screenProjectionMatrix() const override { return m_screenProjectionMatrix; }
 
+    /**
+     * Returns the batch that windows are recorded into, or @c nullptr if windows have to
+     * be drawn right away.
+     */
+    OpenGLFrameBatch *frameBatch() const;
+    /**
+     * Draws the windows recorded so far, so something else can be drawn on top of them.
+     */
+    void flushFrameBatch();
+    void addDrawCalls(int count);
+
+    QString supportInformation() const override;
+    bool isOnHardwarePlane(const Item *item) const override;
+
     static SceneOpenGL *createScene(OpenGLBackend *backend, QObject *parent);
     static bool supported(OpenGLBackend *backend);
 
@@ -77,15 +97,40 @@ private:
     void doPaintBackground(const QVector< float >& vertices);
     void updateProjectionMatrix(const QRect &geometry);
     void performPaintWindow(EffectWindowImpl* w, int mask, const QRegion &region, WindowPaintData& data);
+    QVector<SurfaceItem *> overlayCandidates(AbstractOutput *output) const;
+    QRegion assignOverlays(AbstractOutput *output);
+    bool beginGpuTimer(RenderLoop *renderLoop);
+    void endGpuTimer(RenderLoop *renderLoop);
+
+    struct GpuTimer
+    {
+        GLuint queries[2] = {0, 0};
+        bool pending = false;
+    };
+
+    struct FrameStatistics
+    {
+        int drawCalls = 0;
+        int batchedWindows = 0;
+        int uploadedItems = 0;
+    };
 
     bool init_ok = true;
     OpenGLBackend *m_backend;
     LanczosFilter *m_lanczosFilter = nullptr;
-    QScopedPointer<GLTexture> m_cursorTexture;
+    QSharedPointer<GLTexture> m_cursorTexture;
     bool m_cursorTextureDirty = false;
     QMatrix4x4 m_projectionMatrix;
     QMatrix4x4 m_screenProjectionMatrix;
     GLuint vao = 0;
+    bool m_supportsTimerQueries = false;
+    QHash<RenderLoop *, GpuTimer> m_gpuTimers;
+    QScopedPointer<OpenGLFrameBatch> m_frameBatch;
+    bool m_frameBatchingEnabled = true;
+    FrameStatistics m_currentFrame;
+    FrameStatistics m_lastFrame;
+    QHash<AbstractOutput *, QVector<QPointer<SurfaceItem>>> m_overlayItems;
+    QSharedPointer<OpenGLDecorationAtlas> m_decorationAtlas;
 };
 
 class OpenGLWindow final : public Scene::Window
@@ -95,6 +140,7 @@ class OpenGLWindow final : public Scene::Window
 public:
     struct RenderNode
     {
+        Item *item = nullptr;
         GLTexture *texture = nullptr;
         WindowQuadList quads;
         QMatrix4x4 transformMatrix;
@@ -112,6 +158,7 @@ public:
         const QRegion clip;
         const WindowPaintData &paintData;
         const bool hardwareClipping;
+        const bool batching;
     };
 
     OpenGLWindow(Toplevel *toplevel, SceneOpenGL *scene);
@@ -124,6 +171,7 @@ private:
     QVector4D modulate(float opacity, float brightness) const;
     void setBlendEnabled(bool enabled);
     void createRenderNode(Item *item, RenderContext *context);
+    bool canBatch(int mask, const WindowPaintData &data) const;
 
     SceneOpenGL *m_scene;
     bool m_blendingEnabled = false;
@@ -156,8 +204,8 @@ private:
     GLTexture *m_textTexture;
     GLTexture *m_oldTextTexture;
     QPixmap *m_textPixmap; // need to keep the pixmap around to workaround some driver problems
-    GLTexture *m_iconTexture;
-    GLTexture *m_oldIconTexture;
+    QSharedPointer<GLTexture> m_iconTexture;
+    QSharedPointer<GLTexture> m_oldIconTexture;
     GLTexture *m_selectionTexture;
     GLVertexBuffer *m_unstyledVBO;
     SceneOpenGL *m_scene;
@@ -200,23 +248,57 @@ public:
         Bottom,
         Count
     };
-    explicit SceneOpenGLDecorationRenderer(Decoration::DecoratedClientImpl *client);
+    SceneOpenGLDecorationRenderer(Decoration::DecoratedClientImpl *client, const QSharedPointer<OpenGLDecorationAtlas> &atlas);
     ~SceneOpenGLDecorationRenderer() override;
 
     void render(const QRegion &region) override;
+    void finish() override;
+    QPoint texturePosition(Qt::Edge edge) const override;
 
-    GLTexture *texture() {
-        return m_texture.data();
-    }
-    GLTexture *texture() const {
-        return m_texture.data();
-    }
+    GLTexture *texture() const;
 
 private:
-    void renderPart(const QRect &rect, const QRect &partRect, const QPoint &textureOffset, qreal devicePixelRatio, bool rotated = false);
-    static const QMargins texturePadForPart(const QRect &rect, const QRect &partRect);
-    void resizeTexture();
-    QScopedPointer<GLTexture> m_texture;
+    struct PartJob
+    {
+        QImage image;
+        uint hash = 0;
+        QPicture picture;
+        QRect rect;
+        QRect partRect;
+        bool rotated = false;
+    };
+
+    struct RenderedParts
+    {
+        QVector<QImage> images;
+        QVector<uint> hashes;
+    };
+
+    static RenderedParts rasterise(const QVector<PartJob> &jobs, qreal devicePixelRatio);
+    void scheduleRendering();
+    void startRendering();
+    void handleRenderingFinished();
+    bool takeRenderingResult();
+    bool isLayoutCurrent() const;
+    void releaseEntries();
+
+    QSharedPointer<OpenGLDecorationAtlas> m_atlas;
+    QFutureWatcher<RenderedParts> *m_watcher;
+    QRegion m_queuedRegion;
+    QRegion m_renderingRegion;
+    QVector<QRect> m_renderingRects;
+    qreal m_renderingDevicePixelRatio = 0;
+    bool m_rendering = false;
+    bool m_renderingScheduled = false;
+
+    // The latest rasterised parts, they are uploaded right before the decoration is painted.
+    QVector<QImage> m_images;
+    QVector<uint> m_hashes;
+    QVector<QRect> m_rects;
+    qreal m_devicePixelRatio = 0;
+    bool m_imagesChanged = false;
+
+    QVector<OpenGLDecorationAtlas::Entry *> m_entries;
 };
 
 } // namespace
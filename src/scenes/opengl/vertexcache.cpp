@@ -0,0 +1,287 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2026 KWin contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "vertexcache.h"
+#include "item.h"
+
+#include <kwinglplatform.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iterator>
+#include <limits>
+
+namespace KWin
+{
+
+struct CachedVertex
+{
+    qint16 position[2];
+    float texcoord[2];
+};
+
+static_assert(sizeof(CachedVertex) == 12, "CachedVertex must be tightly packed");
+
+// The buffer starts small, most desktops need a few thousand vertices at most.
+static const int s_initialVertexCount = 4096;
+
+bool OpenGLVertexCache::Key::operator==(const Key &other) const
+{
+    return generation == other.generation
+        && translation == other.translation
+        && textureScale == other.textureScale
+        && textureOffset == other.textureOffset;
+}
+
+OpenGLVertexCache::OpenGLVertexCache()
+{
+    const bool uintIndices = !GLPlatform::instance()->isGLES()
+        || hasGLVersion(3, 0)
+        || hasGLExtension(QByteArrayLiteral("GL_OES_element_index_uint"));
+    m_indexType = uintIndices ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
+    m_maxVertexCount = uintIndices ? 4 * 1024 * 1024 : std::numeric_limits<GLushort>::max() + 1;
+
+    glGenBuffers(1, &m_vertexBuffer);
+    glGenBuffers(1, &m_indexBuffer);
+}
+
+OpenGLVertexCache::~OpenGLVertexCache()
+{
+    glDeleteBuffers(1, &m_vertexBuffer);
+    glDeleteBuffers(1, &m_indexBuffer);
+}
+
+const OpenGLVertexCache::Entry *OpenGLVertexCache::lookup(Item *item, const Key &key) const
+{
+    auto it = m_entries.constFind(item);
+    if (it == m_entries.constEnd() || !it->valid || !(it->key == key)) {
+        return nullptr;
+    }
+    return &(*it);
+}
+
+bool OpenGLVertexCache::canStore(const WindowQuadList &quads)
+{
+    for (const WindowQuad &quad : quads) {
+        for (int i = 0; i < 4; ++i) {
+            const double x = quad[i].x();
+            const double y = quad[i].y();
+            if (x != std::floor(x) || y != std::floor(y)) {
+                return false;
+            }
+            if (x < std::numeric_limits<qint16>::min() || x > std::numeric_limits<qint16>::max()
+                || y < std::numeric_limits<qint16>::min() || y > std::numeric_limits<qint16>::max()) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+const OpenGLVertexCache::Entry *OpenGLVertexCache::store(Item *item, const Key &key, const WindowQuadList &quads, const QRectF &bounds)
+{
+    auto it = m_entries.find(item);
+    if (it == m_entries.end()) {
+        it = m_entries.insert(item, Entry());
+        QObject::connect(item, &QObject::destroyed, &m_itemWatcher, [this, item]() {
+            remove(item);
+        });
+    }
+
+    Entry &entry = *it;
+    const int vertexCount = quads.count() * 4;
+    if (entry.capacity < vertexCount) {
+        if (entry.capacity) {
+            release(entry.first, entry.capacity);
+            entry.capacity = 0;
+        }
+        const int first = allocate(vertexCount);
+        if (first == -1) {
+            entry.valid = false;
+            return nullptr;
+        }
+        entry.first = first;
+        entry.capacity = vertexCount;
+    }
+
+    if (vertexCount) {
+        const float scaleX = key.textureScale.x();
+        const float scaleY = key.textureScale.y();
+        const float offsetX = key.textureOffset.x();
+        const float offsetY = key.textureOffset.y();
+
+        QVector<CachedVertex> vertices(vertexCount);
+        CachedVertex *vertex = vertices.data();
+        for (const WindowQuad &quad : quads) {
+            for (int i = 0; i < 4; ++i) {
+                const WindowVertex &windowVertex = quad[i];
+                vertex->position[0] = qint16(windowVertex.x());
+                vertex->position[1] = qint16(windowVertex.y());
+                vertex->texcoord[0] = windowVertex.u() * scaleX + offsetX;
+                vertex->texcoord[1] = windowVertex.v() * scaleY + offsetY;
+                ++vertex;
+            }
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+        glBufferSubData(GL_ARRAY_BUFFER, entry.first * sizeof(CachedVertex),
+                        vertexCount * sizeof(CachedVertex), vertices.constData());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    entry.key = key;
+    entry.vertexCount = vertexCount;
+    entry.bounds = bounds;
+    entry.valid = true;
+    return &entry;
+}
+
+bool OpenGLVertexCache::reset(int vertexCount)
+{
+    if (vertexCount > m_maxVertexCount) {
+        return false;
+    }
+
+    int capacity = std::max(m_capacity, s_initialVertexCount);
+    while (capacity < vertexCount) {
+        capacity *= 2;
+    }
+    capacity = std::min(capacity, m_maxVertexCount);
+
+    if (capacity != m_capacity) {
+        glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(CachedVertex), nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        m_capacity = capacity;
+    }
+
+    for (Entry &entry : m_entries) {
+        entry.valid = false;
+        entry.capacity = 0;
+    }
+    m_freeRanges.clear();
+    m_freeRanges.insert(0, m_capacity);
+    m_usedVertexCount = 0;
+    return true;
+}
+
+int OpenGLVertexCache::allocate(int count)
+{
+    for (auto it = m_freeRanges.begin(); it != m_freeRanges.end(); ++it) {
+        if (it.value() < count) {
+            continue;
+        }
+        const int first = it.key();
+        const int remaining = it.value() - count;
+        m_freeRanges.erase(it);
+        if (remaining) {
+            m_freeRanges.insert(first + count, remaining);
+        }
+        m_usedVertexCount += count;
+        return first;
+    }
+    return -1;
+}
+
+void OpenGLVertexCache::release(int first, int count)
+{
+    m_usedVertexCount -= count;
+
+    auto next = m_freeRanges.lowerBound(first);
+    if (next != m_freeRanges.end() && first + count == next.key()) {
+        count += next.value();
+        next = m_freeRanges.erase(next);
+    }
+    if (next != m_freeRanges.begin()) {
+        auto previous = std::prev(next);
+        if (previous.key() + previous.value() == first) {
+            previous.value() += count;
+            return;
+        }
+    }
+    m_freeRanges.insert(first, count);
+}
+
+void OpenGLVertexCache::remove(Item *item)
+{
+    const Entry entry = m_entries.take(item);
+    if (entry.capacity) {
+        release(entry.first, entry.capacity);
+    }
+}
+
+void OpenGLVertexCache::bindArrays()
+{
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+    glVertexAttribPointer(VA_Position, 2, GL_SHORT, GL_FALSE, sizeof(CachedVertex),
+                          reinterpret_cast<const GLvoid *>(offsetof(CachedVertex, position)));
+    glEnableVertexAttribArray(VA_Position);
+    glVertexAttribPointer(VA_TexCoord, 2, GL_FLOAT, GL_FALSE, sizeof(CachedVertex),
+                          reinterpret_cast<const GLvoid *>(offsetof(CachedVertex, texcoord)));
+    glEnableVertexAttribArray(VA_TexCoord);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+}
+
+void OpenGLVertexCache::unbindArrays()
+{
+    glDisableVertexAttribArray(VA_Position);
+    glDisableVertexAttribArray(VA_TexCoord);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+template<typename T>
+static QVector<T> buildIndices(const QVector<QPair<int, int>> &ranges)
+{
+    int indexCount = 0;
+    for (const auto &range : ranges) {
+        indexCount += range.second / 4 * 6;
+    }
+
+    QVector<T> indices;
+    indices.reserve(indexCount);
+    for (const auto &range : ranges) {
+        for (int vertex = range.first; vertex < range.first + range.second; vertex += 4) {
+            indices << T(vertex) << T(vertex + 1) << T(vertex + 2)
+                    << T(vertex) << T(vertex + 2) << T(vertex + 3);
+        }
+    }
+    return indices;
+}
+
+void OpenGLVertexCache::uploadIndices(const QVector<QPair<int, int>> &ranges)
+{
+    // The index buffer has to be bound through bindArrays() already.
+    if (m_indexType == GL_UNSIGNED_INT) {
+        const QVector<GLuint> indices = buildIndices<GLuint>(ranges);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.count() * sizeof(GLuint), indices.constData(), GL_STREAM_DRAW);
+    } else {
+        const QVector<GLushort> indices = buildIndices<GLushort>(ranges);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.count() * sizeof(GLushort), indices.constData(), GL_STREAM_DRAW);
+    }
+}
+
+void OpenGLVertexCache::drawIndices(int firstIndex, int indexCount)
+{
+    const size_t indexSize = m_indexType == GL_UNSIGNED_INT ? sizeof(GLuint) : sizeof(GLushort);
+    glDrawElements(GL_TRIANGLES, indexCount, m_indexType, reinterpret_cast<const GLvoid *>(firstIndex * indexSize));
+}
+
+int OpenGLVertexCache::itemCount() const
+{
+    return m_entries.count();
+}
+
+int OpenGLVertexCache::vertexCount() const
+{
+    return m_usedVertexCount;
+}
+
+} // namespace KWin
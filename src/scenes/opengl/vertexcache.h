@@ -0,0 +1,115 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2026 KWin contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "kwinglutils.h"
+
+#include <QHash>
+#include <QMap>
+#include <QObject>
+#include <QRectF>
+#include <QRegion>
+#include <QVector2D>
+
+namespace KWin
+{
+
+class Item;
+
+/**
+ * The OpenGLVertexCache class keeps the vertices of items in a persistent buffer object.
+ *
+ * The vertices of an item are uploaded once and stay valid until the quads of the item, its
+ * position or the texture matrix change. They are not clipped to the paint region, which
+ * changes with every frame. Windows that are repainted because of damage elsewhere, e.g. the
+ * windows above a blinking cursor or a ticking clock, are drawn without building any
+ * vertices on the CPU.
+ *
+ * Positions are stored as 16 bit integers and texture coordinates as floats, every quad uses
+ * four vertices and is drawn as two indexed triangles.
+ */
+class OpenGLVertexCache
+{
+public:
+    struct Key
+    {
+        quint64 generation = 0;
+        QPoint translation;
+        QVector2D textureScale;
+        QVector2D textureOffset;
+
+        bool operator==(const Key &other) const;
+    };
+
+    struct Entry
+    {
+        Key key;
+        int first = 0;
+        int capacity = 0;
+        int vertexCount = 0;
+        QRectF bounds;
+        bool valid = false;
+    };
+
+    OpenGLVertexCache();
+    ~OpenGLVertexCache();
+
+    /**
+     * Returns the vertices of @a item if they were stored with the same @a key.
+     */
+    const Entry *lookup(Item *item, const Key &key) const;
+
+    /**
+     * Uploads the @a quads of @a item. The quads must already be translated.
+     * Returns @c nullptr if the buffer is full.
+     */
+    const Entry *store(Item *item, const Key &key, const WindowQuadList &quads, const QRectF &bounds);
+
+    /**
+     * Returns @c true if the positions of all @a quads can be stored.
+     */
+    static bool canStore(const WindowQuadList &quads);
+
+    /**
+     * Drops all entries and makes room for at least @a vertexCount vertices. Returns
+     * @c false if the buffer can't be that large.
+     */
+    bool reset(int vertexCount);
+
+    void bindArrays();
+    void unbindArrays();
+
+    /**
+     * Uploads the indices for the vertex @a ranges, each given by its first vertex and its
+     * vertex count. Every range adds six indices per quad, in the order of @a ranges.
+     */
+    void uploadIndices(const QVector<QPair<int, int>> &ranges);
+    void drawIndices(int firstIndex, int indexCount);
+
+    int itemCount() const;
+    int vertexCount() const;
+
+private:
+    int allocate(int count);
+    void release(int first, int count);
+    void remove(Item *item);
+
+    QObject m_itemWatcher;
+    GLuint m_vertexBuffer = 0;
+    GLuint m_indexBuffer = 0;
+    GLenum m_indexType;
+    int m_maxVertexCount;
+    int m_capacity = 0;
+    int m_usedVertexCount = 0;
+    QHash<Item *, Entry> m_entries;
+    QMap<int, int> m_freeRanges;
+};
+
+} // namespace KWin
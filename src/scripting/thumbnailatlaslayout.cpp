@@ -0,0 +1,170 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2026 KWin contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "thumbnailatlaslayout.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace KWin
+{
+
+// Cells are rounded up to a multiple of this many pixels.
+static const int s_cellGranularity = 32;
+
+// Thumbnails are separated by a transparent border so linear filtering doesn't sample
+// the thumbnails next to them.
+static const int s_cellPadding = 1;
+
+static int takeRange(QMap<int, int> &ranges, int count)
+{
+    for (auto it = ranges.begin(); it != ranges.end(); ++it) {
+        if (it.value() < count) {
+            continue;
+        }
+        const int first = it.key();
+        const int remaining = it.value() - count;
+        ranges.erase(it);
+        if (remaining) {
+            ranges.insert(first + count, remaining);
+        }
+        return first;
+    }
+    return -1;
+}
+
+static void giveBackRange(QMap<int, int> &ranges, int first, int count)
+{
+    auto next = ranges.lowerBound(first);
+    if (next != ranges.end() && first + count == next.key()) {
+        count += next.value();
+        next = ranges.erase(next);
+    }
+    if (next != ranges.begin()) {
+        auto previous = std::prev(next);
+        if (previous.key() + previous.value() == first) {
+            previous.value() += count;
+            return;
+        }
+    }
+    ranges.insert(first, count);
+}
+
+static int roundUp(int value)
+{
+    return (value + s_cellGranularity - 1) / s_cellGranularity * s_cellGranularity;
+}
+
+ThumbnailAtlasLayout::ThumbnailAtlasLayout(const QSize &size)
+    : m_size(size)
+{
+}
+
+QSize ThumbnailAtlasLayout::size() const
+{
+    return m_size;
+}
+
+bool ThumbnailAtlasLayout::isEmpty() const
+{
+    return !m_cellCount;
+}
+
+QSize ThumbnailAtlasLayout::cellSize(const QSize &size)
+{
+    return QSize(roundUp(size.width() + 2 * s_cellPadding), roundUp(size.height() + 2 * s_cellPadding));
+}
+
+QRect ThumbnailAtlasLayout::contentsRect(const QRect &cell, const QSize &size)
+{
+    Q_ASSERT(size.width() + 2 * s_cellPadding <= cell.width());
+    Q_ASSERT(size.height() + 2 * s_cellPadding <= cell.height());
+    return QRect(cell.topLeft() + QPoint(s_cellPadding, s_cellPadding), size);
+}
+
+QRect ThumbnailAtlasLayout::allocateOnShelf(Shelf &shelf, const QSize &size)
+{
+    const int x = takeRange(shelf.freeRanges, size.width());
+    if (x == -1) {
+        return QRect();
+    }
+    m_cellCount++;
+    return QRect(x, shelf.y, size.width(), size.height());
+}
+
+bool ThumbnailAtlasLayout::isFree(const Shelf &shelf) const
+{
+    return shelf.freeRanges.count() == 1
+        && shelf.freeRanges.firstKey() == 0
+        && shelf.freeRanges.first() == m_size.width();
+}
+
+QRect ThumbnailAtlasLayout::allocate(const QSize &size)
+{
+    Q_ASSERT(size.width() % s_cellGranularity == 0 && size.height() % s_cellGranularity == 0);
+    if (size.width() > m_size.width() || size.height() > m_size.height()) {
+        return QRect();
+    }
+
+    for (Shelf &shelf : m_shelves) {
+        if (shelf.height == size.height()) {
+            const QRect cell = allocateOnShelf(shelf, size);
+            if (!cell.isNull()) {
+                return cell;
+            }
+        }
+    }
+
+    if (m_usedHeight + size.height() <= m_size.height()) {
+        Shelf shelf;
+        shelf.y = m_usedHeight;
+        shelf.height = size.height();
+        shelf.freeRanges.insert(0, m_size.width());
+        m_shelves.append(shelf);
+        m_usedHeight += size.height();
+        return allocateOnShelf(m_shelves.last(), size);
+    }
+
+    // There's no room for a new shelf, so the cell goes to the shortest shelf it fits on.
+    Shelf *best = nullptr;
+    for (Shelf &shelf : m_shelves) {
+        if (shelf.height < size.height() || (best && best->height <= shelf.height)) {
+            continue;
+        }
+        auto it = std::find_if(shelf.freeRanges.cbegin(), shelf.freeRanges.cend(), [&size](int count) {
+            return count >= size.width();
+        });
+        if (it != shelf.freeRanges.cend()) {
+            best = &shelf;
+        }
+    }
+    if (best) {
+        return allocateOnShelf(*best, size);
+    }
+    return QRect();
+}
+
+void ThumbnailAtlasLayout::release(const QRect &cell)
+{
+    for (Shelf &shelf : m_shelves) {
+        if (shelf.y == cell.y()) {
+            giveBackRange(shelf.freeRanges, cell.x(), cell.width());
+            m_cellCount--;
+            break;
+        }
+    }
+
+    // Drop empty shelves at the bottom so the space can be used for cells of any height.
+    while (!m_shelves.isEmpty() && isFree(m_shelves.constLast())) {
+        m_usedHeight = m_shelves.constLast().y;
+        m_shelves.removeLast();
+    }
+}
+
+} // namespace KWin
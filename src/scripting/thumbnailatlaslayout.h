@@ -0,0 +1,71 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2026 KWin contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <kwin_export.h>
+
+#include <QMap>
+#include <QRect>
+#include <QVector>
+
+namespace KWin
+{
+
+/**
+ * The ThumbnailAtlasLayout class decides where thumbnails of any size are placed in an atlas.
+ *
+ * The atlas is split in shelves, rows of cells with the same height, and every shelf keeps
+ * track of the horizontal ranges that are still free. Cells are bucketed with cellSize(), so
+ * thumbnails of similar size share shelves and a thumbnail that is resized a little can
+ * keep its cell.
+ */
+class KWIN_EXPORT ThumbnailAtlasLayout
+{
+public:
+    explicit ThumbnailAtlasLayout(const QSize &size);
+
+    QSize size() const;
+    bool isEmpty() const;
+
+    /**
+     * Reserves a cell of the given @a size, which has to be a size returned by cellSize().
+     * Returns a null rect if there's no room for it.
+     */
+    QRect allocate(const QSize &size);
+    void release(const QRect &cell);
+
+    /**
+     * Returns the size of the cell that holds a thumbnail of the given @a size, including
+     * the border that keeps linear filtering from sampling the neighbouring thumbnails.
+     */
+    static QSize cellSize(const QSize &size);
+    /**
+     * Returns the part of @a cell that holds a thumbnail of the given @a size.
+     */
+    static QRect contentsRect(const QRect &cell, const QSize &size);
+
+private:
+    struct Shelf
+    {
+        int y;
+        int height;
+        QMap<int, int> freeRanges;
+    };
+
+    QRect allocateOnShelf(Shelf &shelf, const QSize &size);
+    bool isFree(const Shelf &shelf) const;
+
+    QSize m_size;
+    QVector<Shelf> m_shelves;
+    int m_usedHeight = 0;
+    int m_cellCount = 0;
+};
+
+} // namespace KWin
@@ -8,7 +8,10 @@
 
 #include "thumbnailitem.h"
 #include "abstract_client.h"
+#include "abstract_output.h"
 #include "composite.h"
+#include "main.h"
+#include "platform.h"
 #include "effects.h"
 #include "renderbackend.h"
 #include "scene.h"
@@ -25,21 +28,148 @@
 #include <QQuickWindow>
 #include <QSGTextureProvider>
 
+#include <algorithm>
+
 namespace KWin
 {
+/**
+ * The ThumbnailAtlasTexture class exposes the slot of a thumbnail atlas as a texture of
+ * its own to the Qt Quick scene graph.
+ */
+class ThumbnailAtlasTexture : public QSGTexture
+{
+public:
+    ThumbnailAtlasTexture(QQuickWindow *window, QSGTexture *atlas,
+                          const QSharedPointer<GLTexture> &nativeTexture, const QRect &rect);
+
+    void setRect(const QRect &rect);
+
+    int textureId() const override;
+    QSize textureSize() const override;
+    bool hasAlphaChannel() const override;
+    bool hasMipmaps() const override;
+    void bind() override;
+
+    bool isAtlasTexture() const override;
+    QRectF normalizedTextureSubRect() const override;
+    QSGTexture *removedFromAtlas() const override;
+
+private:
+    QQuickWindow *m_window;
+    QSGTexture *m_atlas;
+    QSharedPointer<GLTexture> m_nativeTexture;
+    QRect m_rect;
+    mutable QSharedPointer<GLTexture> m_standaloneNativeTexture;
+    mutable QScopedPointer<QSGTexture> m_standaloneTexture;
+};
+
+ThumbnailAtlasTexture::ThumbnailAtlasTexture(QQuickWindow *window, QSGTexture *atlas,
+                                             const QSharedPointer<GLTexture> &nativeTexture,
+                                             const QRect &rect)
+    : m_window(window)
+    , m_atlas(atlas)
+    , m_nativeTexture(nativeTexture)
+    , m_rect(rect)
+{
+}
+
+void ThumbnailAtlasTexture::setRect(const QRect &rect)
+{
+    m_rect = rect;
+}
+
+int ThumbnailAtlasTexture::textureId() const
+{
+    return m_atlas->textureId();
+}
+
+QSize ThumbnailAtlasTexture::textureSize() const
+{
+    return m_rect.size();
+}
+
+bool ThumbnailAtlasTexture::hasAlphaChannel() const
+{
+    return true;
+}
+
+bool ThumbnailAtlasTexture::hasMipmaps() const
+{
+    return false;
+}
+
+void ThumbnailAtlasTexture::bind()
+{
+    m_atlas->setFiltering(filtering());
+    m_atlas->bind();
+}
+
+bool ThumbnailAtlasTexture::isAtlasTexture() const
+{
+    return true;
+}
+
+QRectF ThumbnailAtlasTexture::normalizedTextureSubRect() const
+{
+    const QSize atlasSize = m_nativeTexture->size();
+    return QRectF(qreal(m_rect.x()) / atlasSize.width(),
+                  qreal(m_rect.y()) / atlasSize.height(),
+                  qreal(m_rect.width()) / atlasSize.width(),
+                  qreal(m_rect.height()) / atlasSize.height());
+}
+
+QSGTexture *ThumbnailAtlasTexture::removedFromAtlas() const
+{
+    // The scene graph asks for a texture of its own if it needs to repeat the thumbnail or
+    // to map it with texture coordinates outside the slot. The copy is taken every time it
+    // is requested because the slot is rendered again whenever the window changes.
+    if (!m_standaloneNativeTexture || m_standaloneNativeTexture->size() != m_rect.size()) {
+        m_standaloneNativeTexture.reset(new GLTexture(GL_RGBA8, m_rect.size()));
+        m_standaloneNativeTexture->setFilter(GL_LINEAR);
+        m_standaloneNativeTexture->setWrapMode(GL_CLAMP_TO_EDGE);
+
+        const GLuint textureId = m_standaloneNativeTexture->texture();
+        m_standaloneTexture.reset(m_window->createTextureFromNativeObject(QQuickWindow::NativeObjectTexture,
+                                                                          &textureId, 0,
+                                                                          m_rect.size(),
+                                                                          QQuickWindow::TextureHasAlphaChannel));
+    }
+
+    GLint previousFramebuffer = 0;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+
+    GLuint framebuffer = 0;
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_nativeTexture->texture(), 0);
+
+    m_standaloneNativeTexture->bind();
+    glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_rect.x(), m_rect.y(), m_rect.width(), m_rect.height());
+    m_standaloneNativeTexture->unbind();
+
+    glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+    glDeleteFramebuffers(1, &framebuffer);
+
+    m_standaloneTexture->setFiltering(filtering());
+    m_standaloneTexture->setHorizontalWrapMode(horizontalWrapMode());
+    m_standaloneTexture->setVerticalWrapMode(verticalWrapMode());
+    return m_standaloneTexture.data();
+}
+
 class ThumbnailTextureProvider : public QSGTextureProvider
 {
 public:
     explicit ThumbnailTextureProvider(QQuickWindow *window);
 
     QSGTexture *texture() const override;
-    void setTexture(const QSharedPointer<GLTexture> &nativeTexture);
+    void setTexture(const QSharedPointer<GLTexture> &nativeTexture, const QRect &rect);
     void setTexture(QSGTexture *texture);
 
 private:
     QQuickWindow *m_window;
     QSharedPointer<GLTexture> m_nativeTexture;
     QScopedPointer<QSGTexture> m_texture;
+    QScopedPointer<ThumbnailAtlasTexture> m_atlasTexture;
 };
 
 ThumbnailTextureProvider::ThumbnailTextureProvider(QQuickWindow *window)
@@ -49,13 +179,17 @@ ThumbnailTextureProvider::ThumbnailTextureProvider(QQuickWindow *window)
 
 QSGTexture *ThumbnailTextureProvider::texture() const
 {
+    if (m_atlasTexture) {
+        return m_atlasTexture.data();
+    }
     return m_texture.data();
 }
 
-void ThumbnailTextureProvider::setTexture(const QSharedPointer<GLTexture> &nativeTexture)
+void ThumbnailTextureProvider::setTexture(const QSharedPointer<GLTexture> &nativeTexture, const QRect &rect)
 {
     if (m_nativeTexture != nativeTexture) {
         const GLuint textureId = nativeTexture->texture();
+        m_atlasTexture.reset();
         m_nativeTexture = nativeTexture;
         m_texture.reset(m_window->createTextureFromNativeObject(QQuickWindow::NativeObjectTexture,
                                                                 &textureId, 0,
@@ -66,12 +200,21 @@ void ThumbnailTextureProvider::setTexture(const QSharedPointer<GLTexture> &nativ
         m_texture->setVerticalWrapMode(QSGTexture::ClampToEdge);
     }
 
+    if (rect == QRect(QPoint(0, 0), nativeTexture->size())) {
+        m_atlasTexture.reset();
+    } else if (m_atlasTexture) {
+        m_atlasTexture->setRect(rect);
+    } else {
+        m_atlasTexture.reset(new ThumbnailAtlasTexture(m_window, m_texture.data(), nativeTexture, rect));
+    }
+
     // The textureChanged signal must be emitted also if only texture data changes.
     Q_EMIT textureChanged();
 }
 
 void ThumbnailTextureProvider::setTexture(QSGTexture *texture)
 {
+    m_atlasTexture.reset();
     m_nativeTexture = nullptr;
     m_texture.reset(texture);
     Q_EMIT textureChanged();
@@ -98,14 +241,17 @@ ThumbnailItemBase::ThumbnailItemBase(QQuickItem *parent)
     : QQuickItem(parent)
 {
     setFlag(ItemHasContents);
-    updateFrameRenderingConnection();
 
     connect(Compositor::self(), &Compositor::aboutToToggleCompositing,
             this, &ThumbnailItemBase::destroyOffscreenTexture);
     connect(Compositor::self(), &Compositor::compositingToggled,
-            this, &ThumbnailItemBase::updateFrameRenderingConnection);
+            this, [this]() { invalidateOffscreenTexture(); });
     connect(this, &QQuickItem::windowChanged,
-            this, &ThumbnailItemBase::updateFrameRenderingConnection);
+            this, [this]() { invalidateOffscreenTexture(); });
+    connect(this, &QQuickItem::widthChanged,
+            this, [this]() { invalidateOffscreenTexture(); });
+    connect(this, &QQuickItem::heightChanged,
+            this, [this]() { invalidateOffscreenTexture(); });
 }
 
 ThumbnailItemBase::~ThumbnailItemBase()
@@ -147,10 +293,8 @@ QSGTextureProvider *ThumbnailItemBase::textureProvider() const
     return m_provider;
 }
 
-void ThumbnailItemBase::updateFrameRenderingConnection()
+void ThumbnailItemBase::scheduleOffscreenTextureUpdate()
 {
-    disconnect(m_frameRenderingConnection);
-
     if (!Compositor::compositing()) {
         return;
     }
@@ -158,8 +302,10 @@ void ThumbnailItemBase::updateFrameRenderingConnection()
         return;
     }
 
+    // The offscreen texture is rendered by the thumbnail pool, which spreads the work of
+    // many dirty thumbnails over several frames.
     if (Compositor::self()->backend()->compositingType() == OpenGLCompositing) {
-        m_frameRenderingConnection = connect(Compositor::self()->scene(), &Scene::frameRendered, this, &ThumbnailItemBase::updateOffscreenTexture);
+        ThumbnailPool::self()->scheduleUpdate(this);
     }
 }
 
@@ -189,8 +335,10 @@ void ThumbnailItemBase::destroyOffscreenTexture()
     if (m_offscreenTexture) {
         Scene *scene = Compositor::self()->scene();
         scene->makeOpenGLContextCurrent();
+        ThumbnailPool::self()->release(m_slot);
         m_offscreenTarget.reset();
         m_offscreenTexture.reset();
+        m_offscreenRect = QRect();
 
         if (m_acquireFence) {
             glDeleteSync(m_acquireFence);
@@ -202,7 +350,7 @@ void ThumbnailItemBase::destroyOffscreenTexture()
 
 QSGNode *ThumbnailItemBase::updatePaintNode(QSGNode *oldNode, QQuickItem::UpdatePaintNodeData *)
 {
-    if (Compositor::compositing() && !m_offscreenTexture) {
+    if (Compositor::compositing() && !m_offscreenTexture && !m_showFallback) {
         return oldNode;
     }
 
@@ -218,7 +366,7 @@ QSGNode *ThumbnailItemBase::updatePaintNode(QSGNode *oldNode, QQuickItem::Update
     }
 
     if (m_offscreenTexture) {
-        m_provider->setTexture(m_offscreenTexture);
+        m_provider->setTexture(m_offscreenTexture, m_offscreenRect);
     } else {
         const QImage placeholderImage = fallbackImage();
         m_provider->setTexture(window()->createTextureFromImage(placeholderImage));
@@ -379,6 +527,7 @@ void WindowThumbnailItem::invalidateOffscreenTexture()
 {
     m_dirty = true;
     update();
+    scheduleOffscreenTextureUpdate();
 }
 
 void WindowThumbnailItem::updateOffscreenTexture()
@@ -400,14 +549,34 @@ void WindowThumbnailItem::updateOffscreenTexture()
     m_devicePixelRatio = window()->devicePixelRatio();
     textureSize *= m_devicePixelRatio;
 
-    if (!m_offscreenTexture || m_offscreenTexture->size() != textureSize) {
-        m_offscreenTexture.reset(new GLTexture(GL_RGBA8, textureSize));
-        m_offscreenTexture->setFilter(GL_LINEAR);
-        m_offscreenTexture->setWrapMode(GL_CLAMP_TO_EDGE);
-        m_offscreenTarget.reset(new GLRenderTarget(*m_offscreenTexture));
+    // There's no point in rendering the thumbnail at a higher resolution than it's shown at.
+    const QSizeF frameSize = m_client->frameGeometry().size();
+    if (!frameSize.isEmpty()) {
+        const qreal scale = std::min(width() / frameSize.width(), height() / frameSize.height());
+        const QSize paintedSize = (QSizeF(geometry.size()) * scale * m_devicePixelRatio).toSize();
+        if (textureSize.width() > paintedSize.width() || textureSize.height() > paintedSize.height()) {
+            textureSize = textureSize.scaled(paintedSize, Qt::KeepAspectRatio);
+        }
     }
 
-    GLRenderTarget::pushRenderTarget(m_offscreenTarget.data());
+    // The memory of the thumbnail is accounted to the output it is shown on.
+    ThumbnailPool *pool = ThumbnailPool::self();
+    AbstractOutput *output = kwinApp()->platform()->outputAt(window()->geometry().center());
+    if (textureSize.isEmpty() || !pool->allocate(m_slot, textureSize, output)) {
+        pool->release(m_slot);
+        m_offscreenTexture.reset();
+        m_offscreenRect = QRect();
+        m_showFallback = true;
+        m_dirty = false;
+        update();
+        return;
+    }
+    m_showFallback = false;
+    m_offscreenTexture = m_slot.atlas->texture();
+    m_offscreenRect = m_slot.rect;
+
+    const qreal sourceScale = output ? output->scale() : 1;
+    GLRenderTarget::pushRenderTarget(pool->renderTarget(m_slot, geometry.size() * sourceScale));
     glClearColor(0.0, 0.0, 0.0, 0.0);
     glClear(GL_COLOR_BUFFER_BIT);
 
@@ -425,6 +594,7 @@ void WindowThumbnailItem::updateOffscreenTexture()
     const int mask = Scene::PAINT_WINDOW_TRANSFORMED;
     effectWindow->sceneWindow()->performPaint(mask, infiniteRegion(), data);
     GLRenderTarget::popRenderTarget();
+    pool->copyToSlot(m_slot);
 
     // The fence is needed to avoid the case where qtquick renderer starts using
     // the texture while all rendering commands to it haven't completed yet.
@@ -468,6 +638,7 @@ QRectF DesktopThumbnailItem::paintedRect() const
 void DesktopThumbnailItem::invalidateOffscreenTexture()
 {
     update();
+    scheduleOffscreenTextureUpdate();
 }
 
 void DesktopThumbnailItem::updateOffscreenTexture()
@@ -494,6 +665,7 @@ void DesktopThumbnailItem::updateOffscreenTexture()
         m_offscreenTexture->setWrapMode(GL_CLAMP_TO_EDGE);
         m_offscreenTexture->setYInverted(true);
         m_offscreenTarget.reset(new GLRenderTarget(*m_offscreenTexture));
+        m_offscreenRect = QRect(QPoint(0, 0), textureSize);
     }
 
     GLRenderTarget::pushRenderTarget(m_offscreenTarget.data());
@@ -518,6 +690,9 @@ void DesktopThumbnailItem::updateOffscreenTexture()
 
     // We know that the texture has changed, so schedule an item update.
     update();
+
+    // The desktop is rendered again after every frame, as any of its windows may have changed.
+    scheduleOffscreenTextureUpdate();
 }
 
 } // namespace KWin
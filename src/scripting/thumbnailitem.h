@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include "thumbnailpool.h"
+
 #include <QQuickItem>
 #include <QUuid>
 
@@ -73,18 +75,27 @@ protected:
     virtual void invalidateOffscreenTexture() = 0;
     virtual void updateOffscreenTexture() = 0;
     void destroyOffscreenTexture();
+    void scheduleOffscreenTextureUpdate();
 
     mutable ThumbnailTextureProvider *m_provider = nullptr;
     QSharedPointer<GLTexture> m_offscreenTexture;
     QScopedPointer<GLRenderTarget> m_offscreenTarget;
+    /**
+     * The part of m_offscreenTexture that contains the thumbnail.
+     */
+    QRect m_offscreenRect;
+    ThumbnailSlot m_slot;
     GLsync m_acquireFence = 0;
     qreal m_devicePixelRatio = 1;
+    /**
+     * Whether the fallback image is shown because the thumbnail can't be rendered.
+     */
+    bool m_showFallback = false;
 
 private:
-    void updateFrameRenderingConnection();
-    QMetaObject::Connection m_frameRenderingConnection;
-
     QSize m_sourceSize;
+
+    friend class ThumbnailPool;
 };
 
 class WindowThumbnailItem : public ThumbnailItemBase
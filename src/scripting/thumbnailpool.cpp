@@ -0,0 +1,402 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2026 KWin contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "thumbnailpool.h"
+#include "abstract_output.h"
+#include "composite.h"
+#include "main.h"
+#include "platform.h"
+#include "renderbackend.h"
+#include "scene.h"
+#include "scripting_logging.h"
+#include "thumbnailitem.h"
+
+#include <kwingltexture.h>
+#include <kwinglutils.h>
+
+#include <QElapsedTimer>
+
+#include <algorithm>
+#include <limits>
+
+namespace KWin
+{
+
+// Thumbnails are rendered after a frame until this much time is spent on them.
+static const qint64 s_frameBudget = 2000000; // in nanoseconds
+
+// The size of an atlas texture.
+static const QSize s_atlasSize(2048, 2048);
+
+// Thumbnails are never larger than this, no matter how large they're shown.
+static const QSize s_maximumThumbnailSize(1024, 1024);
+
+// Thumbnails are not made smaller than this to stay within the memory budget of an output.
+static const int s_minimumThumbnailSize = 32;
+
+// The thumbnails shown on an output may use this many times the memory of the output.
+static const int s_outputBudgetFactor = 2;
+
+static qint64 bytesPerCell(const QSize &cell)
+{
+    return qint64(cell.width()) * cell.height() * 4;
+}
+
+ThumbnailAtlas::ThumbnailAtlas(const QSize &size)
+    : m_layout(size)
+    , m_texture(new GLTexture(GL_RGBA8, size))
+{
+    m_texture->setFilter(GL_LINEAR);
+    m_texture->setWrapMode(GL_CLAMP_TO_EDGE);
+    m_texture->clear();
+    m_renderTarget.reset(new GLRenderTarget(*m_texture));
+}
+
+ThumbnailAtlas::~ThumbnailAtlas()
+{
+}
+
+QSharedPointer<GLTexture> ThumbnailAtlas::texture() const
+{
+    return m_texture;
+}
+
+GLRenderTarget *ThumbnailAtlas::renderTarget() const
+{
+    return m_renderTarget.data();
+}
+
+qint64 ThumbnailAtlas::memoryUsage() const
+{
+    return bytesPerCell(m_texture->size());
+}
+
+bool ThumbnailAtlas::isEmpty() const
+{
+    return m_layout.isEmpty();
+}
+
+QRect ThumbnailAtlas::allocate(const QSize &size)
+{
+    const QRect cell = m_layout.allocate(size);
+    if (!cell.isNull()) {
+        clear(cell);
+    }
+    return cell;
+}
+
+void ThumbnailAtlas::release(const QRect &cell)
+{
+    m_layout.release(cell);
+}
+
+void ThumbnailAtlas::clear(const QRect &cell)
+{
+    const bool scissorTest = glIsEnabled(GL_SCISSOR_TEST);
+    GLRenderTarget::pushRenderTarget(m_renderTarget.data());
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(cell.x(), cell.y(), cell.width(), cell.height());
+    glClearColor(0, 0, 0, 0);
+    glClear(GL_COLOR_BUFFER_BIT);
+    if (!scissorTest) {
+        glDisable(GL_SCISSOR_TEST);
+    }
+    GLRenderTarget::popRenderTarget();
+}
+
+bool ThumbnailSlot::isValid() const
+{
+    return atlas && !cell.isNull();
+}
+
+struct ThumbnailPool::ScratchTarget
+{
+    QScopedPointer<GLTexture> texture;
+    QScopedPointer<GLRenderTarget> renderTarget;
+    bool used = false;
+};
+
+ThumbnailPool *ThumbnailPool::s_self = nullptr;
+
+ThumbnailPool *ThumbnailPool::self()
+{
+    if (!s_self) {
+        s_self = new ThumbnailPool(Compositor::self());
+    }
+    return s_self;
+}
+
+ThumbnailPool::ThumbnailPool(QObject *parent)
+    : QObject(parent)
+{
+    connect(Compositor::self(), &Compositor::aboutToToggleCompositing,
+            this, &ThumbnailPool::destroyTextures);
+    connect(Compositor::self(), &Compositor::compositingToggled,
+            this, &ThumbnailPool::handleCompositingToggled);
+    connect(kwinApp()->platform(), &Platform::outputDisabled, this, [this](AbstractOutput *output) {
+        m_outputMemoryUsage.remove(output);
+    });
+
+    handleCompositingToggled();
+}
+
+ThumbnailPool::~ThumbnailPool()
+{
+    destroyTextures();
+    qDeleteAll(m_scratchTargets);
+    s_self = nullptr;
+}
+
+void ThumbnailPool::handleCompositingToggled()
+{
+    disconnect(m_frameRenderedConnection);
+
+    if (!Compositor::compositing()) {
+        return;
+    }
+    if (Compositor::self()->backend()->compositingType() == OpenGLCompositing) {
+        m_frameRenderedConnection = connect(Compositor::self()->scene(), &Scene::frameRendered,
+                                            this, &ThumbnailPool::updateThumbnails);
+    }
+}
+
+void ThumbnailPool::destroyTextures()
+{
+    if (!Compositor::compositing()) {
+        return;
+    }
+    if (Compositor::self()->backend()->compositingType() != OpenGLCompositing) {
+        return;
+    }
+
+    Scene *scene = Compositor::self()->scene();
+    scene->makeOpenGLContextCurrent();
+    m_atlases.clear();
+    m_outputMemoryUsage.clear();
+    qDeleteAll(m_scratchTargets);
+    m_scratchTargets.clear();
+    m_currentScratchTarget = nullptr;
+    scene->doneOpenGLContextCurrent();
+}
+
+qint64 ThumbnailPool::memoryBudget(AbstractOutput *output) const
+{
+    if (!output) {
+        return std::numeric_limits<qint64>::max();
+    }
+    return s_outputBudgetFactor * bytesPerCell(output->pixelSize());
+}
+
+bool ThumbnailPool::allocate(ThumbnailSlot &slot, const QSize &requestedSize, AbstractOutput *output)
+{
+    QSize size = requestedSize;
+    if (size.width() > s_maximumThumbnailSize.width() || size.height() > s_maximumThumbnailSize.height()) {
+        size = size.scaled(s_maximumThumbnailSize, Qt::KeepAspectRatio);
+    }
+
+    qint64 available = memoryBudget(output) - memoryUsage(output);
+    if (slot.isValid() && slot.output == output) {
+        available += bytesPerCell(slot.cell.size());
+    }
+    while (bytesPerCell(ThumbnailAtlasLayout::cellSize(size)) > available) {
+        if (size.width() <= s_minimumThumbnailSize || size.height() <= s_minimumThumbnailSize) {
+            qCDebug(KWIN_SCRIPTING) << "No memory left for thumbnails on" << output;
+            release(slot);
+            return false;
+        }
+        size = size * 3 / 4;
+    }
+
+    const QSize cellSize = ThumbnailAtlasLayout::cellSize(size);
+    if (slot.isValid() && slot.output == output && slot.cell.size() == cellSize) {
+        const QRect rect = ThumbnailAtlasLayout::contentsRect(slot.cell, size);
+        if (slot.rect != rect) {
+            // The previous thumbnail may have covered what is padding now.
+            slot.atlas->clear(slot.cell);
+            slot.rect = rect;
+        }
+        return true;
+    }
+    release(slot);
+
+    QSharedPointer<ThumbnailAtlas> atlas;
+    QRect cell;
+    for (const QSharedPointer<ThumbnailAtlas> &candidate : qAsConst(m_atlases)) {
+        cell = candidate->allocate(cellSize);
+        if (!cell.isNull()) {
+            atlas = candidate;
+            break;
+        }
+    }
+
+    if (!atlas) {
+        GLint maxTextureSize = 0;
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+        atlas.reset(new ThumbnailAtlas(s_atlasSize.boundedTo(QSize(maxTextureSize, maxTextureSize))));
+        cell = atlas->allocate(cellSize);
+        if (cell.isNull()) {
+            return false;
+        }
+        m_atlases.append(atlas);
+        qCDebug(KWIN_SCRIPTING) << "Created a thumbnail atlas, using" << memoryUsage() << "bytes for thumbnails";
+    }
+
+    slot.atlas = atlas;
+    slot.cell = cell;
+    slot.rect = ThumbnailAtlasLayout::contentsRect(cell, size);
+    slot.output = output;
+    m_outputMemoryUsage[output] += bytesPerCell(cellSize);
+    return true;
+}
+
+void ThumbnailPool::release(ThumbnailSlot &slot)
+{
+    if (!slot.isValid()) {
+        return;
+    }
+
+    // The atlas may already be gone from the pool if compositing has been restarted.
+    if (m_atlases.contains(slot.atlas)) {
+        slot.atlas->release(slot.cell);
+        auto it = m_outputMemoryUsage.find(slot.output);
+        if (it != m_outputMemoryUsage.end()) {
+            *it -= bytesPerCell(slot.cell.size());
+            if (*it <= 0) {
+                m_outputMemoryUsage.erase(it);
+            }
+        }
+        if (slot.atlas->isEmpty()) {
+            m_atlases.removeOne(slot.atlas);
+        }
+    }
+
+    slot = ThumbnailSlot();
+}
+
+GLRenderTarget *ThumbnailPool::renderTarget(const ThumbnailSlot &slot, const QSize &sourceSize)
+{
+    // Rendering a window directly into a much smaller thumbnail skips most of its pixels,
+    // which makes the thumbnail look noisy. Such windows are rendered at twice the thumbnail
+    // size instead and then scaled down with a bilinear sample in the middle of every 2x2 block.
+    QSize size = slot.rect.size();
+    if (sourceSize.width() >= 2 * size.width() || sourceSize.height() >= 2 * size.height()) {
+        size *= 2;
+    }
+
+    auto it = std::find_if(m_scratchTargets.constBegin(), m_scratchTargets.constEnd(), [&size](const ScratchTarget *target) {
+        return target->texture->size() == size;
+    });
+    if (it != m_scratchTargets.constEnd()) {
+        m_currentScratchTarget = *it;
+    } else {
+        m_currentScratchTarget = new ScratchTarget;
+        m_currentScratchTarget->texture.reset(new GLTexture(GL_RGBA8, size));
+        m_currentScratchTarget->texture->setFilter(GL_LINEAR);
+        m_currentScratchTarget->texture->setWrapMode(GL_CLAMP_TO_EDGE);
+        m_currentScratchTarget->texture->setYInverted(true);
+        m_currentScratchTarget->renderTarget.reset(new GLRenderTarget(*m_currentScratchTarget->texture));
+        m_scratchTargets.append(m_currentScratchTarget);
+    }
+    m_currentScratchTarget->used = true;
+    return m_currentScratchTarget->renderTarget.data();
+}
+
+void ThumbnailPool::copyToSlot(const ThumbnailSlot &slot)
+{
+    Q_ASSERT(m_currentScratchTarget);
+
+    const QRect &rect = slot.rect;
+    GLRenderTarget::pushRenderTarget(slot.atlas->renderTarget());
+    glViewport(rect.x(), rect.y(), rect.width(), rect.height());
+    glDisable(GL_BLEND);
+
+    QMatrix4x4 mvp;
+    mvp.ortho(0, rect.width(), 0, rect.height(), -1, 1);
+
+    GLTexture *texture = m_currentScratchTarget->texture.data();
+    ShaderBinder binder(ShaderTrait::MapTexture);
+    binder.shader()->setUniform(GLShader::ModelViewProjectionMatrix, mvp);
+    texture->bind();
+    texture->render(infiniteRegion(), QRect(QPoint(0, 0), rect.size()));
+    texture->unbind();
+
+    GLRenderTarget::popRenderTarget();
+}
+
+qint64 ThumbnailPool::memoryUsage(AbstractOutput *output) const
+{
+    return m_outputMemoryUsage.value(output);
+}
+
+qint64 ThumbnailPool::memoryUsage() const
+{
+    qint64 usage = 0;
+    for (const QSharedPointer<ThumbnailAtlas> &atlas : m_atlases) {
+        usage += atlas->memoryUsage();
+    }
+    return usage;
+}
+
+void ThumbnailPool::scheduleUpdate(ThumbnailItemBase *item)
+{
+    if (!m_dirtyItems.contains(item)) {
+        m_dirtyItems.append(item);
+    }
+}
+
+void ThumbnailPool::updateThumbnails()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    // Items that schedule themselves again while being updated wait for the next frame.
+    int remaining = m_dirtyItems.count();
+    while (remaining > 0) {
+        QPointer<ThumbnailItemBase> item = m_dirtyItems.takeFirst();
+        remaining--;
+
+        if (!item || !item->window()) {
+            continue;
+        }
+        // Qt Quick hasn't picked up the last contents of the thumbnail yet.
+        if (item->m_acquireFence) {
+            m_dirtyItems.append(item);
+            continue;
+        }
+
+        item->updateOffscreenTexture();
+
+        // At least one thumbnail is rendered per frame so they can't starve.
+        if (timer.nsecsElapsed() >= s_frameBudget) {
+            break;
+        }
+    }
+
+    if (remaining > 0) {
+        Compositor::self()->scheduleRepaint();
+    }
+
+    // Thumbnails are usually of a few sizes only. Once thumbnails have been rendered, the
+    // render targets of sizes that weren't needed are dropped.
+    const bool rendered = std::any_of(m_scratchTargets.constBegin(), m_scratchTargets.constEnd(), [](const ScratchTarget *target) {
+        return target->used;
+    });
+    for (auto it = m_scratchTargets.begin(); rendered && it != m_scratchTargets.end();) {
+        if ((*it)->used) {
+            (*it)->used = false;
+            ++it;
+        } else {
+            delete *it;
+            it = m_scratchTargets.erase(it);
+        }
+    }
+    m_currentScratchTarget = nullptr;
+}
+
+} // namespace KWin
@@ -0,0 +1,161 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2026 KWin contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "thumbnailatlaslayout.h"
+
+#include <QHash>
+#include <QObject>
+#include <QPointer>
+#include <QRect>
+#include <QScopedPointer>
+#include <QSharedPointer>
+#include <QVector>
+
+namespace KWin
+{
+class AbstractOutput;
+class GLRenderTarget;
+class GLTexture;
+class ThumbnailItemBase;
+
+/**
+ * The ThumbnailAtlas class is a texture that holds the thumbnails of several windows.
+ */
+class ThumbnailAtlas
+{
+public:
+    explicit ThumbnailAtlas(const QSize &size);
+    ~ThumbnailAtlas();
+
+    QSharedPointer<GLTexture> texture() const;
+    GLRenderTarget *renderTarget() const;
+
+    /**
+     * Returns the number of bytes the texture occupies.
+     */
+    qint64 memoryUsage() const;
+
+    bool isEmpty() const;
+
+    /**
+     * Reserves a cell of the given @a size, see ThumbnailAtlasLayout::allocate(). The cell is
+     * cleared, so its padding doesn't hold pixels of the thumbnail that used it before.
+     */
+    QRect allocate(const QSize &size);
+    void release(const QRect &cell);
+
+    /**
+     * Fills @a cell with transparent pixels.
+     */
+    void clear(const QRect &cell);
+
+private:
+    ThumbnailAtlasLayout m_layout;
+    QSharedPointer<GLTexture> m_texture;
+    QScopedPointer<GLRenderTarget> m_renderTarget;
+};
+
+/**
+ * The ThumbnailSlot class is a handle to the part of an atlas a thumbnail is rendered into.
+ */
+class ThumbnailSlot
+{
+public:
+    bool isValid() const;
+
+    QSharedPointer<ThumbnailAtlas> atlas;
+    /**
+     * The part of the atlas that is reserved for the thumbnail.
+     */
+    QRect cell;
+    /**
+     * The part of the cell that holds the thumbnail.
+     */
+    QRect rect;
+    AbstractOutput *output = nullptr;
+};
+
+/**
+ * The ThumbnailPool class owns the textures of the window thumbnails and decides which
+ * thumbnails are rendered in a frame.
+ *
+ * All thumbnails share a few atlases. The thumbnails shown on an output may use at most
+ * about twice the memory of the output's framebuffer; thumbnails that exceed the budget are
+ * rendered at a lower resolution. Dirty thumbnails are rendered after a frame has been
+ * painted, in the order they became dirty, until the time budget of the frame is used up;
+ * the rest is rendered after the next frames.
+ */
+class ThumbnailPool : public QObject
+{
+    Q_OBJECT
+
+public:
+    ~ThumbnailPool() override;
+
+    static ThumbnailPool *self();
+
+    /**
+     * Makes @a slot hold a thumbnail of the given @a size shown on @a output. The slot keeps
+     * its cell if the thumbnail still fits in it. The thumbnail gets smaller than requested
+     * if it's larger than the maximum thumbnail size or if the output has no memory left for
+     * it. Returns @c false and releases the slot if there's no room for the thumbnail at all.
+     */
+    bool allocate(ThumbnailSlot &slot, const QSize &size, AbstractOutput *output);
+    void release(ThumbnailSlot &slot);
+
+    /**
+     * Returns the render target that the thumbnail for @a slot of a window with the given
+     * @a sourceSize is rendered to. Its viewport covers exactly the thumbnail, so it's not
+     * affected by render targets that are pushed while the window is painted. Windows that
+     * are much larger than the thumbnail are rendered at twice its size.
+     */
+    GLRenderTarget *renderTarget(const ThumbnailSlot &slot, const QSize &sourceSize);
+
+    /**
+     * Scales the contents of the last renderTarget() down into the given @a slot.
+     */
+    void copyToSlot(const ThumbnailSlot &slot);
+
+    /**
+     * Returns the number of bytes used by the thumbnails shown on @a output.
+     */
+    qint64 memoryUsage(AbstractOutput *output) const;
+
+    /**
+     * Returns the number of bytes used by all atlases, including unused cells.
+     */
+    qint64 memoryUsage() const;
+
+    /**
+     * Schedules @a item to render its offscreen texture after one of the next frames.
+     */
+    void scheduleUpdate(ThumbnailItemBase *item);
+
+private:
+    struct ScratchTarget;
+
+    explicit ThumbnailPool(QObject *parent);
+    void handleCompositingToggled();
+    void updateThumbnails();
+    void destroyTextures();
+    qint64 memoryBudget(AbstractOutput *output) const;
+
+    QVector<QSharedPointer<ThumbnailAtlas>> m_atlases;
+    QHash<AbstractOutput *, qint64> m_outputMemoryUsage;
+    QList<QPointer<ThumbnailItemBase>> m_dirtyItems;
+    QVector<ScratchTarget *> m_scratchTargets;
+    ScratchTarget *m_currentScratchTarget = nullptr;
+    QMetaObject::Connection m_frameRenderedConnection;
+
+    static ThumbnailPool *s_self;
+};
+
+} // namespace KWin
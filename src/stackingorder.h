@@ -0,0 +1,387 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2026 KWin contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "utils/common.h"
+
+#include <QHash>
+#include <QList>
+#include <QQueue>
+#include <QSet>
+#include <QVector>
+
+#include <array>
+
+namespace KWin
+{
+
+/**
+ * A stacking order constraint, the @c above window must be stacked above the @c below window.
+ */
+template <typename Window>
+struct StackingConstraint
+{
+    Window *below;
+    Window *above;
+    // All constraints above our "below" window
+    QList<StackingConstraint *> parents;
+    // All constraints below our "above" window
+    QList<StackingConstraint *> children;
+    // Used to prevent cycles.
+    bool enqueued = false;
+};
+
+/**
+ * The StackingList class is a doubly linked list of windows that can tell the relative
+ * order of two windows and move a window in constant time.
+ *
+ * Every window carries a label that grows from the bottom to the top of the stack. Moving
+ * a window picks a label between its new neighbours, the labels of the whole list are only
+ * spread out again if there's no free label left between the neighbours.
+ */
+template <typename Window>
+class StackingList
+{
+public:
+    explicit StackingList(int capacity)
+    {
+        m_nodes.reserve(capacity);
+        m_positions.reserve(capacity);
+    }
+
+    void append(Window *window)
+    {
+        const int index = m_nodes.count();
+        const quint64 label = m_last == -1 ? spacing : m_nodes[m_last].label + spacing;
+        m_nodes.append(Node{window, m_last, -1, label});
+        if (m_last != -1) {
+            m_nodes[m_last].next = index;
+        } else {
+            m_first = index;
+        }
+        m_last = index;
+        if (!m_positions.contains(window)) {
+            m_positions.insert(window, index);
+        }
+    }
+
+    int indexOf(Window *window) const
+    {
+        return m_positions.value(window, -1);
+    }
+
+    bool isBelow(int node, int other) const
+    {
+        return m_nodes[node].label < m_nodes[other].label;
+    }
+
+    /**
+     * Moves @a node directly above @a below.
+     */
+    void moveAbove(int node, int below)
+    {
+        unlink(node);
+
+        const int next = m_nodes[below].next;
+        quint64 label;
+        if (next == -1) {
+            label = m_nodes[below].label + spacing;
+        } else if (m_nodes[next].label - m_nodes[below].label > 1) {
+            label = m_nodes[below].label + (m_nodes[next].label - m_nodes[below].label) / 2;
+        } else {
+            relabel();
+            label = m_nodes[below].label + spacing / 2;
+        }
+
+        Node &n = m_nodes[node];
+        n.label = label;
+        n.prev = below;
+        n.next = next;
+        m_nodes[below].next = node;
+        if (next != -1) {
+            m_nodes[next].prev = node;
+        } else {
+            m_last = node;
+        }
+    }
+
+    QList<Window *> toList() const
+    {
+        QList<Window *> list;
+        list.reserve(m_nodes.count());
+        for (int node = m_first; node != -1; node = m_nodes[node].next) {
+            list.append(m_nodes[node].window);
+        }
+        return list;
+    }
+
+private:
+    static constexpr quint64 spacing = quint64(1) << 32;
+
+    struct Node
+    {
+        Window *window;
+        int prev;
+        int next;
+        quint64 label;
+    };
+
+    void unlink(int node)
+    {
+        const Node &n = m_nodes[node];
+        if (n.prev != -1) {
+            m_nodes[n.prev].next = n.next;
+        } else {
+            m_first = n.next;
+        }
+        if (n.next != -1) {
+            m_nodes[n.next].prev = n.prev;
+        } else {
+            m_last = n.prev;
+        }
+    }
+
+    void relabel()
+    {
+        quint64 label = spacing;
+        for (int node = m_first; node != -1; node = m_nodes[node].next) {
+            m_nodes[node].label = label;
+            label += spacing;
+        }
+    }
+
+    QVector<Node> m_nodes;
+    QHash<Window *, int> m_positions;
+    int m_first = -1;
+    int m_last = -1;
+};
+
+/**
+ * Returns the stacking order that results from sorting @a windows by the layers returned
+ * by @a layerOf, while preserving their relative order in each layer, and then moving every
+ * window that violates a constraint directly above the window it has to be stacked above.
+ *
+ * The constraints are applied in breadth-first order, starting with the ones that don't have
+ * parents. Applying a constraint and checking whether it is met takes constant time, so the
+ * whole order is computed in linear time of the number of windows and constraints.
+ *
+ * If @a moves is not null, every window that is moved is recorded in it together with the
+ * window it's moved above, in the order the moves are made.
+ */
+template <typename Window, typename LayerFunction>
+QList<Window *> constrainStackingOrder(const QList<Window *> &windows, LayerFunction layerOf,
+                                       const QList<StackingConstraint<Window> *> &constraints,
+                                       QVector<QPair<Window *, Window *>> *moves = nullptr)
+{
+    // Sort the windows based on their layers while preserving their relative order in the
+    // unconstrained stacking order.
+    std::array<QVector<Window *>, NumLayers> layers;
+    for (Window *window : windows) {
+        layers[layerOf(window)].append(window);
+    }
+
+    StackingList<Window> stacking(windows.count());
+    for (const QVector<Window *> &layer : layers) {
+        for (Window *window : layer) {
+            stacking.append(window);
+        }
+    }
+
+    // Apply the stacking order constraints. First, we enqueue the root constraints, i.e.
+    // the ones that are not affected by other constraints.
+    QQueue<StackingConstraint<Window> *> queue;
+    queue.reserve(constraints.count());
+    for (StackingConstraint<Window> *constraint : constraints) {
+        if (constraint->parents.isEmpty()) {
+            constraint->enqueued = true;
+            queue.enqueue(constraint);
+        } else {
+            constraint->enqueued = false;
+        }
+    }
+
+    // Once we've enqueued all the root constraints, we traverse the constraints tree in
+    // the breadth-first search fashion. A constraint is applied only if its condition is
+    // not met.
+    while (!queue.isEmpty()) {
+        StackingConstraint<Window> *constraint = queue.dequeue();
+
+        const int below = stacking.indexOf(constraint->below);
+        const int above = stacking.indexOf(constraint->above);
+        if (below == -1 || above == -1) {
+            continue;
+        } else if (stacking.isBelow(above, below)) {
+            stacking.moveAbove(above, below);
+            if (moves) {
+                moves->append(qMakePair(constraint->above, constraint->below));
+            }
+        }
+
+        for (StackingConstraint<Window> *child : qAsConst(constraint->children)) {
+            if (!child->enqueued) {
+                child->enqueued = true;
+                queue.enqueue(child);
+            }
+        }
+    }
+
+    return stacking.toList();
+}
+
+/**
+ * The ConstrainedStackingOrder class keeps the result of constrainStackingOrder(), so that
+ * raising or lowering a single window doesn't compute the whole stacking order again.
+ *
+ * If the restacked window takes part in no constraint, the constraints move the same windows
+ * as before, because the restacked window is never compared with any of them. The other
+ * windows keep their order, and the restacked window is inserted at the boundary between the
+ * windows that end up below and above it. A window that is not moved is above the restacked
+ * window if it's in a higher layer, or in the same layer when the window has been lowered.
+ * A window that is moved ends up on the same side as the window it's moved above.
+ *
+ * The order has to be invalidated whenever a layer or a constraint changes, or a window is
+ * added to or removed from the stack.
+ */
+template <typename Window>
+class ConstrainedStackingOrder
+{
+public:
+    const QList<Window *> &windows() const
+    {
+        return m_stackingOrder;
+    }
+
+    void invalidate()
+    {
+        m_valid = false;
+    }
+
+    /**
+     * Computes the constrained stacking order of @a windows from scratch.
+     */
+    template <typename LayerFunction>
+    void update(const QList<Window *> &windows, LayerFunction layerOf,
+                const QList<StackingConstraint<Window> *> &constraints)
+    {
+        m_layers.clear();
+        m_layers.reserve(windows.count());
+        m_moves.clear();
+        m_stackingOrder = constrainStackingOrder(windows, [this, &layerOf](Window *window) {
+            const Layer layer = layerOf(window);
+            m_layers.insert(window, layer);
+            return layer;
+        }, constraints, &m_moves);
+
+        m_constrained.clear();
+        for (const StackingConstraint<Window> *constraint : constraints) {
+            m_constrained.insert(constraint->below);
+            m_constrained.insert(constraint->above);
+        }
+
+        m_windows = windows;
+        m_valid = true;
+    }
+
+    /**
+     * Updates the constrained stacking order if @a windows only differs from the windows of
+     * the last update in that a window that takes part in no constraint has been raised to
+     * the top or lowered to the bottom. Returns @c false if the order has to be computed from
+     * scratch instead.
+     */
+    bool restack(const QList<Window *> &windows)
+    {
+        if (!m_valid || windows.count() != m_windows.count()) {
+            return false;
+        }
+        if (windows == m_windows) {
+            return true;
+        }
+
+        Window *window;
+        bool raised;
+        if (windows.constLast() != m_windows.constLast() && isOnlyMoved(windows, windows.constLast())) {
+            window = windows.constLast();
+            raised = true;
+        } else if (windows.constFirst() != m_windows.constFirst() && isOnlyMoved(windows, windows.constFirst())) {
+            window = windows.constFirst();
+            raised = false;
+        } else {
+            return false;
+        }
+        if (m_constrained.contains(window)) {
+            return false;
+        }
+        const auto layer = m_layers.constFind(window);
+        if (layer == m_layers.constEnd()) {
+            return false;
+        }
+
+        QHash<Window *, bool> moved;
+        moved.reserve(m_moves.count());
+        const auto isAbove = [&](Window *other) {
+            const auto it = moved.constFind(other);
+            if (it != moved.constEnd()) {
+                return *it;
+            }
+            const Layer otherLayer = m_layers.value(other);
+            return raised ? otherLayer > *layer : otherLayer >= *layer;
+        };
+        for (const auto &move : qAsConst(m_moves)) {
+            moved.insert(move.first, isAbove(move.second));
+        }
+
+        // The windows below the restacked window come first, so the boundary can be bisected.
+        m_stackingOrder.removeOne(window);
+        int first = 0;
+        int last = m_stackingOrder.count();
+        while (first < last) {
+            const int middle = first + (last - first) / 2;
+            if (isAbove(m_stackingOrder.at(middle))) {
+                last = middle;
+            } else {
+                first = middle + 1;
+            }
+        }
+        m_stackingOrder.insert(first, window);
+
+        m_windows = windows;
+        return true;
+    }
+
+private:
+    /**
+     * Returns @c true if the windows other than @a window are in the same order in
+     * @a windows as in the last update.
+     */
+    bool isOnlyMoved(const QList<Window *> &windows, Window *window) const
+    {
+        int i = 0;
+        int j = 0;
+        while (i < windows.count() && j < m_windows.count()) {
+            if (windows[i] == window) {
+                ++i;
+            } else if (m_windows[j] == window) {
+                ++j;
+            } else if (windows[i++] != m_windows[j++]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool m_valid = false;
+    QList<Window *> m_windows;
+    QList<Window *> m_stackingOrder;
+    QHash<Window *, Layer> m_layers;
+    QSet<Window *> m_constrained;
+    QVector<QPair<Window *, Window *>> m_moves;
+};
+
+} // namespace KWin
@@ -0,0 +1,170 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2026 KWin contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "startuptimeline.h"
+#include "utils/common.h"
+
+#include <QDBusConnection>
+#include <QTextStream>
+
+namespace KWin
+{
+
+KWIN_SINGLETON_FACTORY(StartupTimeline)
+
+StartupTimeline::StartupTimeline(QObject *parent)
+    : QObject(parent)
+{
+    m_timer.start();
+    QDBusConnection::sessionBus().registerObject(QStringLiteral("/StartupTimeline"), this, QDBusConnection::ExportScriptableContents);
+}
+
+StartupTimeline::~StartupTimeline()
+{
+    s_self = nullptr;
+}
+
+void StartupTimeline::begin(const QString &name)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_finished) {
+        return;
+    }
+    Phase phase;
+    phase.name = name;
+    phase.start = std::chrono::nanoseconds(m_timer.nsecsElapsed());
+    m_phases.append(phase);
+}
+
+void StartupTimeline::end(const QString &name)
+{
+    QMutexLocker locker(&m_mutex);
+    for (int i = m_phases.count() - 1; i >= 0; --i) {
+        Phase &phase = m_phases[i];
+        if (phase.name == name && !phase.finished) {
+            phase.duration = std::chrono::nanoseconds(m_timer.nsecsElapsed()) - phase.start;
+            phase.finished = true;
+            return;
+        }
+    }
+    if (m_finished) {
+        return;
+    }
+    qCWarning(KWIN_CORE) << "Startup phase" << name << "has ended without having begun";
+}
+
+void StartupTimeline::mark(const QString &name)
+{
+    QMutexLocker locker(&m_mutex);
+    Phase phase;
+    phase.name = name;
+    phase.start = std::chrono::nanoseconds(m_timer.nsecsElapsed());
+    phase.finished = true;
+    m_phases.append(phase);
+}
+
+void StartupTimeline::finish()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_finished = true;
+    }
+    const QStringList lines = report().split(QLatin1Char('\n'), Qt::SkipEmptyParts);
+    for (const QString &line : lines) {
+        qCInfo(KWIN_CORE).noquote() << line;
+    }
+}
+
+QVector<StartupTimeline::Phase> StartupTimeline::phases() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_phases;
+}
+
+QStringList StartupTimeline::phaseNames() const
+{
+    QStringList names;
+    const QVector<Phase> recorded = phases();
+    for (const Phase &phase : recorded) {
+        names.append(phase.name);
+    }
+    return names;
+}
+
+QVariantMap StartupTimeline::startTimes() const
+{
+    QVariantMap times;
+    const QVector<Phase> recorded = phases();
+    for (const Phase &phase : recorded) {
+        times.insert(phase.name, qlonglong(std::chrono::duration_cast<std::chrono::microseconds>(phase.start).count()));
+    }
+    return times;
+}
+
+QVariantMap StartupTimeline::durations() const
+{
+    QVariantMap times;
+    const QVector<Phase> recorded = phases();
+    for (const Phase &phase : recorded) {
+        if (phase.finished) {
+            times.insert(phase.name, qlonglong(std::chrono::duration_cast<std::chrono::microseconds>(phase.duration).count()));
+        }
+    }
+    return times;
+}
+
+QString StartupTimeline::report() const
+{
+    using namespace std::chrono;
+
+    QString text;
+    QTextStream stream(&text);
+    stream << "Startup timeline:\n";
+    const QVector<Phase> recorded = phases();
+    for (const Phase &phase : recorded) {
+        const double start = duration_cast<microseconds>(phase.start).count() / 1000.0;
+        stream << "  " << qSetFieldWidth(9) << qSetRealNumberPrecision(1) << Qt::fixed << start
+               << qSetFieldWidth(0) << " ms  " << phase.name;
+        if (!phase.finished) {
+            stream << " (running)";
+        } else if (phase.duration > nanoseconds::zero()) {
+            stream << ": " << duration_cast<microseconds>(phase.duration).count() / 1000.0 << " ms";
+        }
+        stream << '\n';
+    }
+    return text;
+}
+
+StartupPhase::StartupPhase(const QString &name)
+    : m_name(name)
+{
+    if (StartupTimeline *timeline = StartupTimeline::self()) {
+        timeline->begin(m_name);
+    } else {
+        m_name.clear();
+    }
+}
+
+StartupPhase::~StartupPhase()
+{
+    end();
+}
+
+void StartupPhase::end()
+{
+    if (m_name.isEmpty()) {
+        return;
+    }
+    if (StartupTimeline *timeline = StartupTimeline::self()) {
+        timeline->end(m_name);
+    }
+    m_name.clear();
+}
+
+} // namespace KWin
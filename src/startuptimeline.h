@@ -0,0 +1,100 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2026 KWin contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <kwinglobals.h>
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QObject>
+#include <QVariantMap>
+#include <QVector>
+
+#include <chrono>
+
+namespace KWin
+{
+
+/**
+ * The StartupTimeline class records how long the phases of the startup take.
+ *
+ * Phases are named and may overlap, e.g. if they run on worker threads. The timeline is
+ * logged once the startup has finished and it can be queried on DBus at /StartupTimeline
+ * with the org.kde.KWin.StartupTimeline interface; all times are in microseconds since
+ * the timeline has been created.
+ */
+class KWIN_EXPORT StartupTimeline : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.kde.KWin.StartupTimeline")
+
+public:
+    struct Phase
+    {
+        QString name;
+        std::chrono::nanoseconds start = std::chrono::nanoseconds::zero();
+        std::chrono::nanoseconds duration = std::chrono::nanoseconds::zero();
+        bool finished = false;
+    };
+
+    ~StartupTimeline() override;
+
+    /**
+     * Starts the phase with the given @a name. This function is thread safe.
+     */
+    void begin(const QString &name);
+    /**
+     * Ends the phase with the given @a name. This function is thread safe.
+     */
+    void end(const QString &name);
+    /**
+     * Records a phase without duration, e.g. the first frame.
+     */
+    void mark(const QString &name);
+
+    /**
+     * Logs the timeline. Phases that begin afterwards are ignored, phases that are still
+     * running and marks are recorded until the timeline is destroyed.
+     */
+    void finish();
+
+    QVector<Phase> phases() const;
+
+public Q_SLOTS:
+    Q_SCRIPTABLE QStringList phaseNames() const;
+    Q_SCRIPTABLE QVariantMap startTimes() const;
+    Q_SCRIPTABLE QVariantMap durations() const;
+    Q_SCRIPTABLE QString report() const;
+
+private:
+    QElapsedTimer m_timer;
+    mutable QMutex m_mutex;
+    QVector<Phase> m_phases;
+    bool m_finished = false;
+    KWIN_SINGLETON(StartupTimeline)
+};
+
+/**
+ * The StartupPhase class records a phase of the startup timeline for the lifetime of the
+ * object. It does nothing if there's no startup timeline.
+ */
+class KWIN_EXPORT StartupPhase
+{
+public:
+    explicit StartupPhase(const QString &name);
+    ~StartupPhase();
+
+    void end();
+
+private:
+    QString m_name;
+};
+
+} // namespace KWin
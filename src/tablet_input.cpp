@@ -50,6 +50,8 @@ void TabletInputRedirection::tabletToolEvent(KWin::InputRedirection::TabletEvent
                                              bool tipNear, const TabletToolId &tabletToolId,
                                              quint32 time)
 {
+    // keep the order of pointer motion and tablet events if pointer motion is batched
+    input()->pointer()->flushPendingMotion();
     if (!inited()) {
         return;
     }
@@ -81,7 +83,7 @@ void TabletInputRedirection::tabletToolEvent(KWin::InputRedirection::TabletEvent
 
     ev.setTimestamp(time);
     input()->processSpies(std::bind(&InputEventSpy::tabletToolEvent, std::placeholders::_1, &ev));
-    input()->processFilters(
+    input()->processFilters(InputEventFilter::TabletEvents,
         std::bind(&InputEventFilter::tabletToolEvent, std::placeholders::_1, &ev));
 
     m_tipDown = tipDown;
@@ -91,40 +93,48 @@ void TabletInputRedirection::tabletToolEvent(KWin::InputRedirection::TabletEvent
 void KWin::TabletInputRedirection::tabletToolButtonEvent(uint button, bool isPressed,
                                                          const TabletToolId &tabletToolId)
 {
+    // keep the order of pointer motion and tablet events if pointer motion is batched
+    input()->pointer()->flushPendingMotion();
     input()->processSpies(std::bind(&InputEventSpy::tabletToolButtonEvent,
                                     std::placeholders::_1, button, isPressed, tabletToolId));
-    input()->processFilters(std::bind( &InputEventFilter::tabletToolButtonEvent,
-                                      std::placeholders::_1, button, isPressed, tabletToolId));
+    input()->processFilters(InputEventFilter::TabletEvents, std::bind( &InputEventFilter::tabletToolButtonEvent,
+                                                                       std::placeholders::_1, button, isPressed, tabletToolId));
     input()->setLastInputHandler(this);
 }
 
 void KWin::TabletInputRedirection::tabletPadButtonEvent(uint button, bool isPressed,
                                                         const TabletPadId &tabletPadId)
 {
+    // keep the order of pointer motion and tablet events if pointer motion is batched
+    input()->pointer()->flushPendingMotion();
     input()->processSpies(std::bind( &InputEventSpy::tabletPadButtonEvent,
                                      std::placeholders::_1, button, isPressed, tabletPadId));
-    input()->processFilters(std::bind( &InputEventFilter::tabletPadButtonEvent,
-                                       std::placeholders::_1, button, isPressed, tabletPadId));
+    input()->processFilters(InputEventFilter::TabletEvents, std::bind( &InputEventFilter::tabletPadButtonEvent,
+                                                                       std::placeholders::_1, button, isPressed, tabletPadId));
     input()->setLastInputHandler(this);
 }
 
 void KWin::TabletInputRedirection::tabletPadStripEvent(int number, int position, bool isFinger,
                                                        const TabletPadId &tabletPadId)
 {
+    // keep the order of pointer motion and tablet events if pointer motion is batched
+    input()->pointer()->flushPendingMotion();
     input()->processSpies(std::bind( &InputEventSpy::tabletPadStripEvent,
                                      std::placeholders::_1, number, position, isFinger, tabletPadId));
-    input()->processFilters(std::bind( &InputEventFilter::tabletPadStripEvent,
-                                       std::placeholders::_1, number, position, isFinger, tabletPadId));
+    input()->processFilters(InputEventFilter::TabletEvents, std::bind( &InputEventFilter::tabletPadStripEvent,
+                                                                       std::placeholders::_1, number, position, isFinger, tabletPadId));
     input()->setLastInputHandler(this);
 }
 
 void KWin::TabletInputRedirection::tabletPadRingEvent(int number, int position, bool isFinger,
                                                       const TabletPadId &tabletPadId)
 {
+    // keep the order of pointer motion and tablet events if pointer motion is batched
+    input()->pointer()->flushPendingMotion();
     input()->processSpies(std::bind( &InputEventSpy::tabletPadRingEvent,
                                      std::placeholders::_1, number, position, isFinger, tabletPadId));
-    input()->processFilters(std::bind( &InputEventFilter::tabletPadRingEvent,
-                                       std::placeholders::_1, number, position, isFinger, tabletPadId));
+    input()->processFilters(InputEventFilter::TabletEvents, std::bind( &InputEventFilter::tabletPadRingEvent,
+                                                                       std::placeholders::_1, number, position, isFinger, tabletPadId));
     input()->setLastInputHandler(this);
 }
 
@@ -129,6 +129,8 @@ void TouchInputRedirection::cleanupDecoration(Decoration::DecoratedClientImpl *o
 void TouchInputRedirection::processDown(qint32 id, const QPointF &pos, quint32 time, InputDevice *device)
 {
     Q_UNUSED(device)
+    // keep the order of pointer motion and touch events if pointer motion is batched
+    input()->pointer()->flushPendingMotion();
     if (!inited()) {
         return;
     }
@@ -140,13 +142,15 @@ void TouchInputRedirection::processDown(qint32 id, const QPointF &pos, quint32 t
     }
     input()->setLastInputHandler(this);
     input()->processSpies(std::bind(&InputEventSpy::touchDown, std::placeholders::_1, id, pos, time));
-    input()->processFilters(std::bind(&InputEventFilter::touchDown, std::placeholders::_1, id, pos, time));
+    input()->processFilters(InputEventFilter::TouchEvents, std::bind(&InputEventFilter::touchDown, std::placeholders::_1, id, pos, time));
     m_windowUpdatedInCycle = false;
 }
 
 void TouchInputRedirection::processUp(qint32 id, quint32 time, InputDevice *device)
 {
     Q_UNUSED(device)
+    // keep the order of pointer motion and touch events if pointer motion is batched
+    input()->pointer()->flushPendingMotion();
     if (!inited()) {
         return;
     }
@@ -156,7 +160,7 @@ void TouchInputRedirection::processUp(qint32 id, quint32 time, InputDevice *devi
     input()->setLastInputHandler(this);
     m_windowUpdatedInCycle = false;
     input()->processSpies(std::bind(&InputEventSpy::touchUp, std::placeholders::_1, id, time));
-    input()->processFilters(std::bind(&InputEventFilter::touchUp, std::placeholders::_1, id, time));
+    input()->processFilters(InputEventFilter::TouchEvents, std::bind(&InputEventFilter::touchUp, std::placeholders::_1, id, time));
     m_windowUpdatedInCycle = false;
     if (m_activeTouchPoints.count() == 0) {
         update();
@@ -166,6 +170,8 @@ void TouchInputRedirection::processUp(qint32 id, quint32 time, InputDevice *devi
 void TouchInputRedirection::processMotion(qint32 id, const QPointF &pos, quint32 time, InputDevice *device)
 {
     Q_UNUSED(device)
+    // keep the order of pointer motion and touch events if pointer motion is batched
+    input()->pointer()->flushPendingMotion();
     if (!inited()) {
         return;
     }
@@ -176,12 +182,14 @@ void TouchInputRedirection::processMotion(qint32 id, const QPointF &pos, quint32
     m_lastPosition = pos;
     m_windowUpdatedInCycle = false;
     input()->processSpies(std::bind(&InputEventSpy::touchMotion, std::placeholders::_1, id, pos, time));
-    input()->processFilters(std::bind(&InputEventFilter::touchMotion, std::placeholders::_1, id, pos, time));
+    input()->processFilters(InputEventFilter::TouchEvents, std::bind(&InputEventFilter::touchMotion, std::placeholders::_1, id, pos, time));
     m_windowUpdatedInCycle = false;
 }
 
 void TouchInputRedirection::cancel()
 {
+    // keep the order of pointer motion and touch events if pointer motion is batched
+    input()->pointer()->flushPendingMotion();
     if (!inited()) {
         return;
     }
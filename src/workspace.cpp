@@ -542,6 +542,7 @@ void Workspace::constrain(AbstractClient *below, AbstractClient *above)
         child->parents << constraint;
     }
 
+    invalidateConstrainedStackingOrder();
     updateStackingOrder();
 }
 
@@ -570,6 +571,7 @@ void Workspace::unconstrain(AbstractClient *below, AbstractClient *above)
     }
 
     delete constraint;
+    invalidateConstrainedStackingOrder();
     updateStackingOrder();
 }
 
@@ -583,6 +585,7 @@ void Workspace::addToStack(Toplevel *toplevel)
     if (!stacking_order.contains(toplevel)) {
         stacking_order.append(toplevel);
     }
+    invalidateConstrainedStackingOrder();
 }
 
 void Workspace::replaceInStack(Toplevel *original, Deleted *deleted)
@@ -610,12 +613,14 @@ void Workspace::replaceInStack(Toplevel *original, Deleted *deleted)
             constraint->above = deleted;
         }
     }
+    invalidateConstrainedStackingOrder();
 }
 
 void Workspace::removeFromStack(Toplevel *toplevel)
 {
     unconstrained_stacking_order.removeAll(toplevel);
     stacking_order.removeAll(toplevel);
+    invalidateConstrainedStackingOrder();
 
     for (int i = m_constraints.count() - 1; i >= 0; --i) {
         Constraint *constraint = m_constraints[i];
@@ -693,6 +698,10 @@ void Workspace::addClient(X11Client *c)
     }
     m_x11Clients.append(c);
     m_allClients.append(c);
+    addToX11WindowIndex(c->window(), c);
+    addToX11WindowIndex(c->wrapperId(), c);
+    addToX11WindowIndex(c->frameId(), c);
+    addToX11WindowIndex(c->inputId(), c);
     addToStack(c);
     markXStackingOrderAsDirty();
     updateClientArea(); // This cannot be in manage(), because the client got added only now
@@ -714,6 +723,7 @@ void Workspace::addClient(X11Client *c)
 void Workspace::addUnmanaged(Unmanaged* c)
 {
     m_unmanaged.append(c);
+    addToX11WindowIndex(c->window(), c);
     markXStackingOrderAsDirty();
 }
 
@@ -731,6 +741,10 @@ void Workspace::removeX11Client(X11Client *c)
     Q_ASSERT(m_x11Clients.contains(c));
     // TODO: if marked client is removed, notify the marked list
     m_x11Clients.removeAll(c);
+    removeFromX11WindowIndex(c->window(), c);
+    removeFromX11WindowIndex(c->wrapperId(), c);
+    removeFromX11WindowIndex(c->frameId(), c);
+    removeFromX11WindowIndex(c->inputId(), c);
     Group* group = findGroup(c->window());
     if (group != nullptr)
         group->lostLeader();
@@ -741,6 +755,7 @@ void Workspace::removeUnmanaged(Unmanaged* c)
 {
     Q_ASSERT(m_unmanaged.contains(c));
     m_unmanaged.removeAll(c);
+    removeFromX11WindowIndex(c->window(), c);
     Q_EMIT unmanagedRemoved(c);
     markXStackingOrderAsDirty();
 }
@@ -1711,6 +1726,7 @@ QString Workspace::supportInformation() const
             }
 
             support.append(QStringLiteral("OpenGL 2 Shaders are used\n"));
+            support.append(Compositor::self()->scene()->supportInformation());
             break;
         }
         case QPainterCompositing:
@@ -1789,34 +1805,61 @@ Unmanaged *Workspace::findUnmanaged(std::function<bool (const Unmanaged*)> func)
 
 Unmanaged *Workspace::findUnmanaged(xcb_window_t w) const
 {
-    return findUnmanaged([w](const Unmanaged *u) {
-        return u->window() == w;
-    });
+    Unmanaged *unmanaged = qobject_cast<Unmanaged *>(m_x11WindowIndex.value(w));
+    if (unmanaged && unmanaged->window() == w) {
+        return unmanaged;
+    }
+    return nullptr;
 }
 
 X11Client *Workspace::findClient(Predicate predicate, xcb_window_t w) const
 {
+    X11Client *c = qobject_cast<X11Client *>(m_x11WindowIndex.value(w));
+    if (!c) {
+        return nullptr;
+    }
+    // The same window id doesn't match every predicate
     switch (predicate) {
     case Predicate::WindowMatch:
-        return findClient([w](const X11Client *c) {
-            return c->window() == w;
-        });
+        return c->window() == w ? c : nullptr;
     case Predicate::WrapperIdMatch:
-        return findClient([w](const X11Client *c) {
-            return c->wrapperId() == w;
-        });
+        return c->wrapperId() == w ? c : nullptr;
     case Predicate::FrameIdMatch:
-        return findClient([w](const X11Client *c) {
-            return c->frameId() == w;
-        });
+        return c->frameId() == w ? c : nullptr;
     case Predicate::InputIdMatch:
-        return findClient([w](const X11Client *c) {
-            return c->inputId() == w;
-        });
+        return c->inputId() == w ? c : nullptr;
     }
     return nullptr;
 }
 
+void Workspace::registerInputWindow(X11Client *client, xcb_window_t inputId)
+{
+    if (m_x11WindowIndex.value(client->window()) == client) {
+        addToX11WindowIndex(inputId, client);
+    }
+}
+
+void Workspace::unregisterInputWindow(X11Client *client, xcb_window_t inputId)
+{
+    removeFromX11WindowIndex(inputId, client);
+}
+
+void Workspace::addToX11WindowIndex(xcb_window_t window, Toplevel *toplevel)
+{
+    if (window != XCB_WINDOW_NONE) {
+        m_x11WindowIndex.insert(window, toplevel);
+    }
+}
+
+void Workspace::removeFromX11WindowIndex(xcb_window_t window, Toplevel *toplevel)
+{
+    // An unmanaged window can turn into a managed one, only drop the entry of the given toplevel
+    auto it = m_x11WindowIndex.find(window);
+    if (it != m_x11WindowIndex.end() && *it == toplevel) {
+        m_x11WindowIndex.erase(it);
+    }
+}
+
 Toplevel *Workspace::findToplevel(std::function<bool (const Toplevel*)> func) const
 {
     if (auto *ret = Toplevel::findInList(m_allClients, func)) {
@@ -16,6 +16,7 @@
 // kwin
 #include "options.h"
 #include "sm.h"
+#include "stackingorder.h"
 #include "utils/common.h"
 // Qt
 #include <QTimer>
@@ -107,12 +108,21 @@ public:
     /**
      * @brief Finds the Client matching the given match @p predicate for the given window.
      *
+     * Unlike findClient(std::function<bool (const X11Client *)>) this is a hash lookup, it
+     * doesn't depend on the number of clients.
+     *
      * @param predicate Which window should be compared
      * @param w The window id to test against
      * @return KWin::X11Client *The found Client or @c null
      * @see findClient(std::function<bool (const X11Client *)>)
      */
     X11Client *findClient(Predicate predicate, xcb_window_t w) const;
+    /**
+     * Makes @p client findable by its input window @p inputId, see findClient().
+     * Does nothing if @p client hasn't been added to the workspace.
+     */
+    void registerInputWindow(X11Client *client, xcb_window_t inputId);
+    void unregisterInputWindow(X11Client *client, xcb_window_t inputId);
     void forEachClient(std::function<void (X11Client *)> func);
     void forEachAbstractClient(std::function<void (AbstractClient*)> func);
     Unmanaged *findUnmanaged(std::function<bool (const Unmanaged*)> func) const;
@@ -211,6 +221,11 @@ public:
     void restoreSessionStackingOrder(X11Client *c);
     void updateStackingOrder(bool propagate_new_clients = false);
     void forceRestacking();
+    /**
+     * Makes the next restack compute the constrained stacking order from scratch, e.g.
+     * because the layer of a window has changed.
+     */
+    void invalidateConstrainedStackingOrder();
 
     void constrain(AbstractClient *below, AbstractClient *above);
     void unconstrain(AbstractClient *below, AbstractClient *above);
@@ -560,6 +575,8 @@ private:
     void addToStack(Toplevel *toplevel);
     void replaceInStack(Toplevel *original, Deleted *deleted);
     void removeFromStack(Toplevel *toplevel);
+    void addToX11WindowIndex(xcb_window_t window, Toplevel *toplevel);
+    void removeFromX11WindowIndex(xcb_window_t window, Toplevel *toplevel);
 
     /// This is the right way to create a new client
     X11Client *createClient(xcb_window_t w, bool is_mapped);
@@ -579,19 +596,10 @@ private:
     AbstractClient *findClientToActivateOnDesktop(VirtualDesktop *desktop);
     void removeAbstractClient(AbstractClient *client);
 
-    struct Constraint
-    {
-        Toplevel *below;
-        Toplevel *above;
-        // All constraints above our "below" window
-        QList<Constraint *> parents;
-        // All constraints below our "above" window
-        QList<Constraint *> children;
-        // Used to prevent cycles.
-        bool enqueued = false;
-    };
+    using Constraint = StackingConstraint<Toplevel>;
 
     QList<Constraint *> m_constraints;
+    ConstrainedStackingOrder<Toplevel> m_constrainedStackingOrder;
     QWidget* active_popup;
     AbstractClient* active_popup_client;
 
@@ -617,6 +625,8 @@ private:
     QList<X11Client *> m_x11Clients;
     QList<AbstractClient*> m_allClients;
     QList<Unmanaged *> m_unmanaged;
+    // the client, wrapper, frame and input windows of the X11 clients and the unmanaged windows
+    QHash<xcb_window_t, Toplevel *> m_x11WindowIndex;
     QList<Deleted *> deleted;
     QList<InternalClient *> m_internalClients;
 
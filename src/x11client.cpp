@@ -1060,6 +1060,7 @@ void X11Client::updateInputWindow()
     }
 
     if (region.isEmpty()) {
+        workspace()->unregisterInputWindow(this, m_decoInputExtent);
         m_decoInputExtent.reset();
         return;
     }
@@ -1083,6 +1084,7 @@ void X11Client::updateInputWindow()
             XCB_EVENT_MASK_POINTER_MOTION
         };
         m_decoInputExtent.create(bounds, XCB_WINDOW_CLASS_INPUT_ONLY, mask, values);
+        workspace()->registerInputWindow(this, m_decoInputExtent);
         if (mapping_state == Mapped)
             m_decoInputExtent.map();
     } else {
@@ -1148,6 +1150,7 @@ void X11Client::destroyDecoration()
             Q_EMIT geometryShapeChanged(this, oldgeom);
         }
     }
+    workspace()->unregisterInputWindow(this, m_decoInputExtent);
     m_decoInputExtent.reset();
 }
 
@@ -7,6 +7,7 @@
     SPDX-License-Identifier: GPL-2.0-or-later
 */
 #include "xkb.h"
+#include "startuptimeline.h"
 #include "utils/common.h"
 // frameworks
 #include <KConfigGroup>
@@ -14,7 +15,14 @@
 #include <KWaylandServer/keyboard_interface.h>
 #include <KWaylandServer/seat_interface.h>
 // Qt
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
 #include <QTemporaryFile>
+#include <QtConcurrentRun>
 #include <QKeyEvent>
 #include <QtXkbCommonSupport/private/qxkbcommon_p.h>
 // xkbcommon
@@ -30,6 +38,9 @@ Q_LOGGING_CATEGORY(KWIN_XKB, "kwin_xkbcommon", QtWarningMsg)
 namespace KWin
 {
 
+// Compiles the configured keymap into the cache while the rest of kwin starts up.
+static QFuture<void> s_keymapPrefetch;
+
 static void xkbLogHandler(xkb_context *context, xkb_log_level priority, const char *format, va_list args)
 {
     Q_UNUSED(context)
@@ -128,6 +139,9 @@ void Xkb::reconfigure()
         return;
     }
 
+    // The keymap is loaded from the cache once the prefetch has compiled it.
+    s_keymapPrefetch.waitForFinished();
+
     xkb_keymap *keymap = nullptr;
     if (!qEnvironmentVariableIsSet("KWIN_XKB_DEFAULT_KEYMAP")) {
         keymap = loadKeymapFromConfig();
@@ -179,10 +193,15 @@ xkb_keymap *Xkb::loadKeymapFromConfig()
     if (!m_configGroup.isValid()) {
         return nullptr;
     }
-    const QByteArray model = m_configGroup.readEntry("Model", "pc104").toLatin1();
-    const QByteArray layout = m_configGroup.readEntry("LayoutList").toLatin1();
-    const QByteArray variant = m_configGroup.readEntry("VariantList").toLatin1();
-    const QByteArray options = m_configGroup.readEntry("Options").toLatin1();
+    return loadKeymapFromConfig(m_context, m_configGroup, &m_layoutList);
+}
+
+xkb_keymap *Xkb::loadKeymapFromConfig(xkb_context *context, const KConfigGroup &group, QStringList *layoutList)
+{
+    const QByteArray model = group.readEntry("Model", "pc104").toLatin1();
+    const QByteArray layout = group.readEntry("LayoutList").toLatin1();
+    const QByteArray variant = group.readEntry("VariantList").toLatin1();
+    const QByteArray options = group.readEntry("Options").toLatin1();
 
     xkb_rule_names ruleNames = {
         .rules = nullptr,
@@ -192,23 +211,168 @@ xkb_keymap *Xkb::loadKeymapFromConfig()
         .options = nullptr,
     };
 
-    if (m_configGroup.readEntry("ResetOldOptions", false)) {
+    if (group.readEntry("ResetOldOptions", false)) {
         ruleNames.options = options.constData();
     }
 
     applyEnvironmentRules(ruleNames);
 
-    m_layoutList = QString::fromLatin1(ruleNames.layout).split(QLatin1Char(','));
+    *layoutList = QString::fromLatin1(ruleNames.layout).split(QLatin1Char(','));
 
-    return xkb_keymap_new_from_names(m_context, &ruleNames, XKB_KEYMAP_COMPILE_NO_FLAGS);
+    return compileKeymap(context, ruleNames);
 }
 
 xkb_keymap *Xkb::loadDefaultKeymap()
+{
+    return loadDefaultKeymap(m_context, &m_layoutList);
+}
+
+xkb_keymap *Xkb::loadDefaultKeymap(xkb_context *context, QStringList *layoutList)
 {
     xkb_rule_names ruleNames = {};
     applyEnvironmentRules(ruleNames);
-    m_layoutList = QString::fromLatin1(ruleNames.layout).split(QLatin1Char(','));
-    return xkb_keymap_new_from_names(m_context, &ruleNames, XKB_KEYMAP_COMPILE_NO_FLAGS);
+    *layoutList = QString::fromLatin1(ruleNames.layout).split(QLatin1Char(','));
+    return compileKeymap(context, ruleNames);
+}
+
+// The cache keeps the keymaps of this many layout configurations.
+static const int s_maxCachedKeymaps = 16;
+
+QString Xkb::keymapCacheDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + QLatin1String("/kwin/keymaps");
+}
+
+static bool isKeymapCacheDisabled()
+{
+    static const bool disabled = qEnvironmentVariableIsSet("KWIN_XKB_NO_KEYMAP_CACHE");
+    return disabled;
+}
+
+/**
+ * Returns the path of the cached keymap for the given rule names, which depends on the
+ * names and on the modification times of the xkb data directories, so the cached keymap
+ * is ignored once the xkb data is updated or the user adds their own.
+ */
+QString Xkb::keymapCachePath(xkb_context *context, const xkb_rule_names &ruleNames)
+{
+    if (isKeymapCacheDisabled()) {
+        return QString();
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    for (const char *name : {ruleNames.rules, ruleNames.model, ruleNames.layout, ruleNames.variant, ruleNames.options}) {
+        // Distinguish an empty name from a missing one.
+        const char *value = name ? name : "\x01";
+        hash.addData(value, qstrlen(value) + 1);
+    }
+
+    static const QStringList subdirectories{
+        QStringLiteral("rules"),
+        QStringLiteral("keycodes"),
+        QStringLiteral("types"),
+        QStringLiteral("compat"),
+        QStringLiteral("symbols"),
+    };
+    const unsigned int includePathCount = xkb_context_num_include_paths(context);
+    for (unsigned int i = 0; i < includePathCount; ++i) {
+        const QString includePath = QFile::decodeName(xkb_context_include_path_get(context, i));
+        hash.addData(QFile::encodeName(includePath));
+        for (const QString &subdirectory : subdirectories) {
+            const QFileInfo info(includePath + QLatin1Char('/') + subdirectory);
+            const qint64 modified = info.exists() ? info.lastModified().toMSecsSinceEpoch() : -1;
+            hash.addData(reinterpret_cast<const char *>(&modified), sizeof(modified));
+        }
+    }
+
+    return keymapCacheDirectory() + QLatin1Char('/') + QString::fromLatin1(hash.result().toHex()) + QLatin1String(".xkb");
+}
+
+/**
+ * Compiling a keymap from rule names resolves the rules and parses dozens of files, so
+ * compiled keymaps are cached on disk in their text form, which loads much faster.
+ */
+xkb_keymap *Xkb::compileKeymap(xkb_context *context, const xkb_rule_names &ruleNames)
+{
+    const QString cachePath = keymapCachePath(context, ruleNames);
+    if (!cachePath.isEmpty()) {
+        QFile cacheFile(cachePath);
+        if (cacheFile.open(QIODevice::ReadOnly)) {
+            const QByteArray contents = cacheFile.readAll();
+            xkb_keymap *keymap = xkb_keymap_new_from_string(context, contents.constData(), XKB_KEYMAP_FORMAT_TEXT_V1, XKB_KEYMAP_COMPILE_NO_FLAGS);
+            if (keymap) {
+                qCDebug(KWIN_XKB) << "Loaded keymap from" << cachePath;
+                cacheFile.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+                return keymap;
+            }
+            qCWarning(KWIN_XKB) << "Discarding invalid cached keymap" << cachePath;
+            cacheFile.remove();
+        }
+    }
+
+    xkb_keymap *keymap = xkb_keymap_new_from_names(context, &ruleNames, XKB_KEYMAP_COMPILE_NO_FLAGS);
+    if (!keymap || cachePath.isEmpty()) {
+        return keymap;
+    }
+
+    ScopedCPointer<char> keymapString(xkb_keymap_get_as_string(keymap, XKB_KEYMAP_FORMAT_TEXT_V1));
+    if (keymapString.isNull()) {
+        return keymap;
+    }
+
+    QDir cacheDirectory(keymapCacheDirectory());
+    if (!cacheDirectory.mkpath(QStringLiteral("."))) {
+        return keymap;
+    }
+    QSaveFile cacheFile(cachePath);
+    if (!cacheFile.open(QIODevice::WriteOnly) || cacheFile.write(keymapString.data()) == -1 || !cacheFile.commit()) {
+        qCWarning(KWIN_XKB) << "Failed to cache keymap in" << cachePath;
+        return keymap;
+    }
+
+    // Drop the keymaps of the layout configurations that were used least recently.
+    const QFileInfoList cachedKeymaps = cacheDirectory.entryInfoList({QStringLiteral("*.xkb")}, QDir::Files, QDir::Time);
+    for (int i = s_maxCachedKeymaps; i < cachedKeymaps.count(); ++i) {
+        QFile::remove(cachedKeymaps[i].absoluteFilePath());
+    }
+
+    return keymap;
+}
+
+void Xkb::prefetchKeymap(const KSharedConfigPtr &config)
+{
+    // The compiled keymap is only of use to reconfigure() if it ends up in the cache.
+    if (isKeymapCacheDisabled()) {
+        return;
+    }
+
+    // Neither KConfig nor xkb contexts are thread safe, the worker reads a copy of the
+    // layout configuration and uses a context of its own.
+    QSharedPointer<KConfig> snapshot(new KConfig(QString(), KConfig::SimpleConfig));
+    KConfigGroup snapshotGroup = snapshot->group("Layout");
+    config->group("Layout").copyTo(&snapshotGroup);
+
+    s_keymapPrefetch = QtConcurrent::run([snapshot]() {
+        StartupPhase phase(QStringLiteral("keymap prefetch"));
+        const KConfigGroup group = snapshot->group("Layout");
+        xkb_context *context = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
+        if (!context) {
+            return;
+        }
+        xkb_context_set_log_level(context, XKB_LOG_LEVEL_DEBUG);
+        xkb_context_set_log_fn(context, &xkbLogHandler);
+
+        QStringList layoutList;
+        xkb_keymap *keymap = nullptr;
+        if (!qEnvironmentVariableIsSet("KWIN_XKB_DEFAULT_KEYMAP")) {
+            keymap = loadKeymapFromConfig(context, group, &layoutList);
+        }
+        if (!keymap) {
+            keymap = loadDefaultKeymap(context, &layoutList);
+        }
+        xkb_keymap_unref(keymap);
+        xkb_context_unref(context);
+    });
 }
 
 void Xkb::installKeymap(int fd, uint32_t size)
@@ -300,6 +464,11 @@ void Xkb::updateKeymap(xkb_keymap *keymap)
         setLock(m_capsModifier, capsLockIsOn);
     }
 
+    // The keymap is serialized once, the seat shares it with all clients and the input
+    // method gets the same copy.
+    ScopedCPointer<char> keymapString(xkb_keymap_get_as_string(m_keymap, XKB_KEYMAP_FORMAT_TEXT_V1));
+    m_keymapContents = keymapString.isNull() ? QByteArray() : QByteArray(keymapString.data());
+
     createKeymapFile();
     forwardModifiers();
     updateModifiers();
@@ -320,15 +489,7 @@ QByteArray Xkb::keymapContents() const
         return {};
     }
     // TODO: uninstall keymap on server?
-    if (!m_keymap) {
-        return {};
-    }
-
-    ScopedCPointer<char> keymapString(xkb_keymap_get_as_string(m_keymap, XKB_KEYMAP_FORMAT_TEXT_V1));
-    if (keymapString.isNull()) {
-        return {};
-    }
-    return keymapString.data();
+    return m_keymapContents;
 }
 
 void Xkb::updateModifiers(uint32_t modsDepressed, uint32_t modsLatched, uint32_t modsLocked, uint32_t group)
@@ -99,20 +99,37 @@ public:
     void setSeat(KWaylandServer::SeatInterface *seat);
     QByteArray keymapContents() const;
 
+    /**
+     * Returns the directory compiled keymaps are cached in.
+     */
+    static QString keymapCacheDirectory();
+
+    /**
+     * Compiles the keymap of the layout configuration in @a config on a worker thread, so
+     * the keymap is in the cache by the time the keyboard is configured. reconfigure()
+     * waits for the prefetch to finish. Nothing is prefetched if the keymap cache is disabled.
+     */
+    static void prefetchKeymap(const KSharedConfigPtr &config);
+
 Q_SIGNALS:
     void ledsChanged(const LEDs &leds);
     void modifierStateChanged();
 
 private:
-    void applyEnvironmentRules(xkb_rule_names &);
+    static void applyEnvironmentRules(xkb_rule_names &);
     xkb_keymap *loadKeymapFromConfig();
+    static xkb_keymap *loadKeymapFromConfig(xkb_context *context, const KConfigGroup &group, QStringList *layoutList);
     xkb_keymap *loadDefaultKeymap();
+    static xkb_keymap *loadDefaultKeymap(xkb_context *context, QStringList *layoutList);
+    static xkb_keymap *compileKeymap(xkb_context *context, const xkb_rule_names &ruleNames);
+    static QString keymapCachePath(xkb_context *context, const xkb_rule_names &ruleNames);
     void updateKeymap(xkb_keymap *keymap);
     void createKeymapFile();
     void updateModifiers();
     void updateConsumedModifiers(uint32_t key);
     xkb_context *m_context;
     xkb_keymap *m_keymap;
+    QByteArray m_keymapContents;
     QStringList m_layoutList;
     xkb_state *m_state;
     xkb_mod_index_t m_shiftModifier;
@@ -24,6 +24,9 @@
 #include <xcb/xfixes.h>
 
 #include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/resource.h>
 #include <unistd.h>
 
 #include <xwayland_logging.h>
@@ -36,12 +39,23 @@ namespace Xwl
 // in Bytes: equals 64KB
 static const uint32_t s_incrChunkSize = 63 * 1024;
 
+// Wayland data is read ahead by at most this many chunks, equals 256KB,
+// no matter how large the transferred data is
+static const int s_maxQueuedChunks = 4;
+
 Transfer::Transfer(xcb_atom_t selection, qint32 fd, xcb_timestamp_t timestamp, QObject *parent)
     : QObject(parent)
     , m_atom(selection)
     , m_fd(fd)
     , m_timestamp(timestamp)
 {
+    // a slow or stuck reader or writer on the other end of the fd must
+    // never block the compositor, only wait for the socket notifier
+    const int flags = fcntl(m_fd, F_GETFL);
+    if (flags != -1) {
+        fcntl(m_fd, F_SETFL, flags | O_NONBLOCK);
+    }
+    m_elapsedTimer.start();
 }
 
 void Transfer::createSocketNotifier(QSocketNotifier::Type type)
@@ -68,9 +82,30 @@ void Transfer::endTransfer()
 {
     clearSocketNotifier();
     closeFd();
+
+    if (KWIN_XWL().isDebugEnabled()) {
+        const qint64 elapsed = std::max(m_elapsedTimer.elapsed(), qint64(1));
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        qCDebug(KWIN_XWL) << "Transfer of" << m_transferredBytes << "bytes took" << elapsed << "ms,"
+                          << (m_transferredBytes * 1000 / elapsed / 1024) << "KiB/s, peak buffered:"
+                          << m_peakBufferedBytes << "bytes, peak RSS:" << usage.ru_maxrss << "KiB";
+    }
+
     Q_EMIT finished();
 }
 
+void Transfer::addTransferredBytes(qint64 count)
+{
+    m_transferredBytes += count;
+}
+
+void Transfer::setBufferedBytes(qint64 count)
+{
+    m_bufferedBytes = count;
+    m_peakBufferedBytes = std::max(m_peakBufferedBytes, count);
+}
+
 void Transfer::closeFd()
 {
     if (m_fd < 0) {
@@ -123,9 +158,21 @@ int TransferWltoX::flushSourceData()
     resetTimeout();
 
     const auto rm = m_chunks.takeFirst();
+    addTransferredBytes(rm.first.size());
+    updateBufferedBytes();
+
+    // the requestor consumes data again, resume reading the source
+    if (socketNotifier() && !socketNotifier()->isEnabled() && m_chunks.size() < s_maxQueuedChunks) {
+        socketNotifier()->setEnabled(true);
+    }
     return rm.first.size();
 }
 
+void TransferWltoX::updateBufferedBytes()
+{
+    setBufferedBytes(qint64(m_chunks.size()) * s_incrChunkSize);
+}
+
 void TransferWltoX::startIncr()
 {
     Q_ASSERT(m_chunks.size() == 1);
@@ -164,6 +211,7 @@ void TransferWltoX::readWlSource()
         next.first.resize(s_incrChunkSize);
         next.second = 0;
         m_chunks.append(next);
+        updateBufferedBytes();
     }
 
     const auto oldLen = m_chunks.last().second;
@@ -171,6 +219,9 @@ void TransferWltoX::readWlSource()
     Q_ASSERT(avail > 0);
 
     ssize_t readLen = read(fd(), m_chunks.last().first.data() + oldLen, avail);
+    if (readLen == -1 && (errno == EAGAIN || errno == EINTR)) {
+        return;
+    }
     if (readLen == -1) {
         qCWarning(KWIN_XWL) << "Error reading in Wl data.";
 
@@ -211,6 +262,12 @@ void TransferWltoX::readWlSource()
             // starting incremental transfer
             startIncr();
         }
+
+        if (socketNotifier() && m_chunks.size() >= s_maxQueuedChunks) {
+            // the requestor lags behind, stop reading until it deleted
+            // the property, the source blocks once the pipe is full
+            socketNotifier()->setEnabled(false);
+        }
     }
     resetTimeout();
 }
@@ -374,6 +431,7 @@ void TransferXtoWl::startTransfer()
         setIncr(false);
         // reply's ownership is transferred
         m_receiver->transferFromProperty(reply);
+        setBufferedBytes(m_receiver->data().size());
         dataSourceWrite();
     }
 }
@@ -408,6 +466,7 @@ void TransferXtoWl::getIncrChunk()
     if (xcb_get_property_value_length(reply) > 0) {
         // reply's ownership is transferred
         m_receiver->transferFromProperty(reply);
+        setBufferedBytes(m_receiver->data().size());
         dataSourceWrite();
     } else {
         // Transfer complete
@@ -541,14 +600,19 @@ void TransferXtoWl::dataSourceWrite()
     QByteArray property = m_receiver->data();
 
     ssize_t len = write(fd(), property.constData(), property.size());
-    if (len == -1) {
+    if (len == -1 && (errno == EAGAIN || errno == EINTR)) {
+        // the Wayland client has not read the previous data yet
+        len = 0;
+    } else if (len == -1) {
         qCWarning(KWIN_XWL) << "X11 to Wayland write error on fd:" << fd();
         endTransfer();
         return;
     }
 
     m_receiver->partRead(len);
+    addTransferredBytes(len);
     if (len == property.size()) {
+        setBufferedBytes(0);
         // property completely transferred
         if (incr()) {
             clearSocketNotifier();
@@ -9,6 +9,7 @@
 #ifndef KWIN_XWL_TRANSFER
 #define KWIN_XWL_TRANSFER
 
+#include <QElapsedTimer>
 #include <QObject>
 #include <QSocketNotifier>
 #include <QVector>
@@ -84,6 +85,13 @@ protected:
     QSocketNotifier *socketNotifier() const {
         return m_notifier;
     }
+
+    /**
+     * Statistics that are printed to the debug log when the transfer ends.
+     */
+    void addTransferredBytes(qint64 count);
+    void setBufferedBytes(qint64 count);
+
 private:
     void closeFd();
 
@@ -95,6 +103,11 @@ private:
     bool m_incr = false;
     bool m_timeout = false;
 
+    QElapsedTimer m_elapsedTimer;
+    qint64 m_transferredBytes = 0;
+    qint64 m_bufferedBytes = 0;
+    qint64 m_peakBufferedBytes = 0;
+
     Q_DISABLE_COPY(Transfer)
 };
 
@@ -123,11 +136,15 @@ private:
     void readWlSource();
     int flushSourceData();
     void handlePropertyDelete();
+    void updateBufferedBytes();
 
     xcb_selection_request_event_t *m_request = nullptr;
 
-    /* contains all received data portioned in chunks
-     * TODO: explain second QPair component
+    /* contains all received data portioned in chunks, the second
+     * component is the number of bytes used in the chunk
+     *
+     * At most s_maxQueuedChunks chunks are kept, reading from the
+     * source stops until the requestor has consumed one.
      */
     QVector<QPair<QByteArray, int> > m_chunks;
 